@@ -0,0 +1,22 @@
+#ifdef GL_ES
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;  /* floor() below needs whole tile numbers on big levels */
+#endif
+#endif
+/* Input */
+varying vec2 v_Texcoord0;
+varying vec2 v_Lightcoord;
+uniform sampler2D u_Texture0;
+uniform sampler2D u_LightMap;  /* Tile colors, bilinear */
+uniform vec2 u_LightSize;      /* Lightmap size in texels (= level size in tiles) */
+uniform float u_Lit;           /* 1: lit by the lightmap, 0: white */
+
+void main()
+{
+    /* Between tile centers the colors of the neighbours blend like the old corner light */
+    vec3 light = texture2D(u_LightMap, v_Lightcoord).rgb;
+    /* Alpha stays the tile's own, so sample the center of the tile */
+    float alpha = texture2D(u_LightMap, (floor(v_Lightcoord * u_LightSize) + 0.5) / u_LightSize).a;
+
+    gl_FragColor = texture2D(u_Texture0, v_Texcoord0) * vec4(mix(vec3(1.0), light, u_Lit), alpha);
+}
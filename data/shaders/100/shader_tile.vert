@@ -0,0 +1,16 @@
+/* Input */
+uniform mat4 u_MVPMatrix;      /* A constant representing the combined model/view/projection matrix. */
+uniform vec4 u_LightTransform; /* Screen position -> lightmap texcoords: xy scale, zw offset */
+attribute vec2 a_Position;     /* Per-vertex position information */
+attribute vec2 a_Texcoord0;    /* Per-vertex texcoord information */
+/* Output */
+varying vec2 v_Texcoord0;
+varying vec2 v_Lightcoord;
+
+void main()
+{
+    v_Texcoord0 = a_Texcoord0;
+    /* One lightmap texel per level tile, texel centers on tile centers */
+    v_Lightcoord = a_Position * u_LightTransform.xy + u_LightTransform.zw;
+    gl_Position = u_MVPMatrix * vec4(a_Position, 0.0, 1.0);
+}
@@ -0,0 +1,39 @@
+/* Input */
+uniform mat4 u_MVPMatrix;      /* A constant representing the combined model/view/projection matrix. */
+uniform vec4 u_LightTransform; /* Chunk tile position -> lightmap texcoords: xy scale, zw offset */
+uniform vec4 u_AtlasSlots[64]; /* Tileset texcoords -> atlas texcoords: xy scale, zw offset */
+uniform vec4 u_Anim;           /* x: animation phase, y: sine index of the first row, z: sway in tiles */
+attribute vec2 a_Corner;       /* Corner of the quad, 0 or 1 */
+attribute vec4 a_Tile;         /* Per-instance: x, y within the chunk, atlas slot, tile rect */
+attribute float a_Flags;       /* Per-instance: lit, animated, corners that sway */
+/* Output */
+varying vec2 v_Texcoord0;
+varying vec2 v_Lightcoord;
+varying float v_Lit;
+
+const float TILE_UV = 20.0 / 256.0; /* One tile in its tileset, 12 tiles per row */
+const float SINE_STEP = 3.14159265 / 32.0;
+
+float flag(float bit)
+{
+    return mod(floor(a_Flags / bit), 2.0);
+}
+
+void main()
+{
+    /* Animated tiles move on by 36 tiles per phase */
+    float rect = a_Tile.w + 36.0 * u_Anim.x * flag(2.0);
+    float row = floor((rect + 0.5) / 12.0);
+    vec4 slot = u_AtlasSlots[int(a_Tile.z)];
+    v_Texcoord0 = (vec2(rect - row * 12.0, row) + a_Corner) * TILE_UV * slot.xy + slot.zw;
+
+    /* Plants in water sway left and right, each corner on its own (flags 4, 8, 16, 32) */
+    vec2 pos = a_Tile.xy + a_Corner;
+    float sway = u_Anim.z * sin((u_Anim.y + 3.0 * pos.y) * SINE_STEP);
+    pos.x += sway * flag(4.0 * exp2(a_Corner.y * 2.0 + a_Corner.x));
+
+    /* One lightmap texel per level tile, texel centers on tile centers */
+    v_Lightcoord = pos * u_LightTransform.xy + u_LightTransform.zw;
+    v_Lit = flag(1.0);
+    gl_Position = u_MVPMatrix * vec4(pos, 0.0, 1.0);
+}
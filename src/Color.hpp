@@ -0,0 +1,44 @@
+// Datei : Color.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// D3DCOLOR ohne SDL und OpenGL
+// Die Leveltiles speichern ihre Eckfarben als D3DCOLOR, daher braucht der Level-Kern
+// den Typ auch ohne den Rest von SDL_port.hpp
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _COLOR_HPP_
+#define _COLOR_HPP_
+
+#include <cstdint>
+
+#include "Globals.hpp"
+#include "glm/vec4.hpp"
+
+class HCOLOR {
+public:
+    inline HCOLOR(std::uint32_t c) {
+#if !HURRICAN_BIG_ENDIAN
+        this->color = glm::tvec4<std::uint8_t>((c >> 16) & 0xFF, (c >> 8) & 0xFF, c & 0xFF, (c >> 24) & 0xFF);
+#else
+        this->color = glm::tvec4<std::uint8_t>((c >> 8) & 0xFF, (c >> 16) & 0xFF, (c >> 24) & 0xFF, c & 0xFF);
+#endif
+    };
+    inline HCOLOR() = default;
+    friend HCOLOR operator| (HCOLOR lhs, const HCOLOR& rhs) {
+        lhs.color |= rhs.color;
+        return lhs;
+    };
+private:
+    glm::tvec4<std::uint8_t> color;
+};
+using D3DCOLOR = HCOLOR;
+
+#if !HURRICAN_BIG_ENDIAN
+#define D3DCOLOR_RGBA(r, g, b, a) ((static_cast<std::uint32_t>(a) << 24u) | (static_cast<std::uint32_t>(r) << 16u) | (static_cast<std::uint32_t>(g) << 8u) | static_cast<std::uint32_t>(b))
+#else
+#define D3DCOLOR_RGBA(r, g, b, a) ((static_cast<std::uint32_t>(b) << 24u) | (static_cast<std::uint32_t>(g) << 16u) | (static_cast<std::uint32_t>(r) << 8u) | static_cast<std::uint32_t>(a))
+#endif
+
+#endif
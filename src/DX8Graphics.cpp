@@ -16,6 +16,8 @@
 
 #include "DX8Graphics.hpp"
 #include <time.h>
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include "DX8Texture.hpp"
 #include "Globals.hpp"
@@ -30,6 +32,16 @@ glm::mat4x4 matProj;   // Projektionsmatrix
 glm::mat4x4 matWorld;  // Weltmatrix
 float DegreetoRad[360];  // Tabelle mit Rotationswerten
 
+// Schlüssel der gesammelten Sprites, von oben nach unten: Layer, Wechsel der Matrizen,
+// Blendmodus, Programm, Textur
+constexpr int SPRITE_LAYER_SHIFT = 52;
+constexpr int SPRITE_MATRICES_SHIFT = 40;
+constexpr int SPRITE_BLEND_SHIFT = 36;
+constexpr int SPRITE_PROGRAM_SHIFT = 32;
+constexpr int SPRITE_LAYERS = 1 << 12;        // Layer -2048 bis 2047
+constexpr int SPRITE_MATRICES_MAX = 1 << 12;  // so oft dürfen sich die Matrizen ändern
+constexpr int SPRITE_GRID = 64;                 // Zellen pro Achse des Rasters in PlaceSprites()
+
 // --------------------------------------------------------------------------------------
 // Klassenfunktionen
 // --------------------------------------------------------------------------------------
@@ -45,8 +57,39 @@ float DegreetoRad[360];  // Tabelle mit Rotationswerten
 DirectGraphicsClass::DirectGraphicsClass() {
     SupportedETC1 = false;
     SupportedPVRTC = false;
+    SupportedLightMap = false;
+    SupportedInstancing = false;
     use_shader = shader_t::COLOR;
 
+    LightMap = 0;
+    LightMapSizeX = 0;
+    LightMapSizeY = 0;
+    Atlas = 0;
+    AtlasSlotsUploaded = false;
+    InstanceCorners = 0;
+
+    VertexBuffer = 0;
+    VertexBufferSize = 0;
+    VertexBufferPos = 0;
+    AttribsEnabled = 0;
+    QuadIndexBuffer = 0;
+
+    BatchType = GL_TRIANGLES;
+    BatchQuads = false;
+    BatchProgram = PROGRAM_NONE;
+    BatchTexture = 0;
+    Batching = true;
+    TextureCurrent = 0;
+    SpriteBatching = false;
+    SpriteLayer = 0;
+
+    Stats = RenderStatsStruct();
+    LastStats = RenderStatsStruct();
+    FrameStart = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < PROGRAM_TOTAL; i++)
+        ProgramMVPValid[i] = false;
+
     ProgramCurrent = PROGRAM_NONE;
 }
 
@@ -89,6 +132,22 @@ bool DirectGraphicsClass::Exit() {
     Shaders[PROGRAM_COLOR].Close();
     Shaders[PROGRAM_TEXTURE].Close();
     Shaders[PROGRAM_RENDER].Close();
+    Shaders[PROGRAM_TILE].Close();
+    Shaders[PROGRAM_TILEINSTANCED].Close();
+    DeleteLightMap();
+    DeleteAtlas();
+
+    if (VertexBuffer != 0)
+        glDeleteBuffers(1, &VertexBuffer);
+    VertexBuffer = 0;
+
+    if (QuadIndexBuffer != 0)
+        glDeleteBuffers(1, &QuadIndexBuffer);
+    QuadIndexBuffer = 0;
+
+    if (InstanceCorners != 0)
+        glDeleteBuffers(1, &InstanceCorners);
+    InstanceCorners = 0;
 
     SDL_GL_DeleteContext(GLcontext);
     SDL_Quit();
@@ -97,6 +156,8 @@ bool DirectGraphicsClass::Exit() {
 }
 
 void DirectGraphicsClass::ResizeToWindow(int width, int height) {
+  FlushBatch();
+
   RenderWidth = width;
   RenderHeight = height;
 
@@ -184,6 +245,103 @@ bool DirectGraphicsClass::SetDeviceInfo() {
     Shaders[PROGRAM_RENDER].NameMvp = Shaders[PROGRAM_RENDER].GetUniform("u_MVPMatrix");
     NameTime                        = Shaders[PROGRAM_RENDER].GetUniform("u_Time");
 
+    // Der Shader für die Lightmap ist optional, ohne ihn bleibt es beim Licht der Ecken
+    vert = g_storage_ext + "/data/shaders/" + glsl_version + "/shader_tile.vert";
+    frag = g_storage_ext + "/data/shaders/" + glsl_version + "/shader_tile.frag";
+
+    SupportedLightMap = Shaders[PROGRAM_TILE].Load(vert, frag);
+
+    if (SupportedLightMap) {
+        Shaders[PROGRAM_TILE].NamePos = Shaders[PROGRAM_TILE].GetAttribute("a_Position");
+        Shaders[PROGRAM_TILE].NameTex = Shaders[PROGRAM_TILE].GetAttribute("a_Texcoord0");
+        Shaders[PROGRAM_TILE].NameMvp = Shaders[PROGRAM_TILE].GetUniform("u_MVPMatrix");
+        NameLightMap                  = Shaders[PROGRAM_TILE].GetUniform("u_LightMap");
+        NameLightTransform            = Shaders[PROGRAM_TILE].GetUniform("u_LightTransform");
+        NameLightSize                 = Shaders[PROGRAM_TILE].GetUniform("u_LightSize");
+        NameLit                       = Shaders[PROGRAM_TILE].GetUniform("u_Lit");
+
+        // Die Lightmap liegt immer auf Textureinheit 1, die Tiles wie alles andere auf 0
+        Shaders[PROGRAM_TILE].Use();
+        glUniform1i(NameLightMap, 1);
+        ProgramCurrent = PROGRAM_NONE;
+    } else {
+        Protokoll << "Tile shader not available, level lightmap disabled" << std::endl;
+    }
+
+    // Instanzen für die Leveltiles gibt es ab GL 3.3 und GLES 3, mit den Extensions auch
+    // davor. Ohne bleibt es bei den Vertices von RenderStaticTiles()
+    if (epoxy_is_desktop_gl())
+        SupportedInstancing = epoxy_gl_version() >= 33 || (epoxy_has_gl_extension("GL_ARB_instanced_arrays") &&
+                                                           epoxy_has_gl_extension("GL_ARB_draw_instanced"));
+    else
+        SupportedInstancing = epoxy_gl_version() >= 30;
+
+    if (SupportedInstancing && SupportedLightMap) {
+        vert = g_storage_ext + "/data/shaders/" + glsl_version + "/shader_tile_instanced.vert";
+        frag = g_storage_ext + "/data/shaders/" + glsl_version + "/shader_tile_instanced.frag";
+
+        SupportedInstancing = Shaders[PROGRAM_TILEINSTANCED].Load(vert, frag);
+    } else {
+        SupportedInstancing = false;
+    }
+
+    if (SupportedInstancing) {
+        Shaders[PROGRAM_TILEINSTANCED].NamePos = Shaders[PROGRAM_TILEINSTANCED].GetAttribute("a_Corner");
+        Shaders[PROGRAM_TILEINSTANCED].NameMvp = Shaders[PROGRAM_TILEINSTANCED].GetUniform("u_MVPMatrix");
+        NameInstanceTile                       = Shaders[PROGRAM_TILEINSTANCED].GetAttribute("a_Tile");
+        NameInstanceFlags                      = Shaders[PROGRAM_TILEINSTANCED].GetAttribute("a_Flags");
+        NameInstanceLightTransform             = Shaders[PROGRAM_TILEINSTANCED].GetUniform("u_LightTransform");
+        NameInstanceLightSize                  = Shaders[PROGRAM_TILEINSTANCED].GetUniform("u_LightSize");
+        NameInstanceAtlasSlots                 = Shaders[PROGRAM_TILEINSTANCED].GetUniform("u_AtlasSlots[0]");
+        NameInstanceAnim                       = Shaders[PROGRAM_TILEINSTANCED].GetUniform("u_Anim");
+
+        Shaders[PROGRAM_TILEINSTANCED].Use();
+        glUniform1i(Shaders[PROGRAM_TILEINSTANCED].GetUniform("u_LightMap"), 1);
+        ProgramCurrent = PROGRAM_NONE;
+        AtlasSlotsUploaded = false;
+
+        // Die Ecken in der Reihenfolge eines Triangle-Strips
+        const float Corners[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+
+        if (InstanceCorners == 0)
+            glGenBuffers(1, &InstanceCorners);
+        glBindBuffer(GL_ARRAY_BUFFER, InstanceCorners);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(Corners), Corners, GL_STATIC_DRAW);
+    } else {
+        Protokoll << "Instanced tiles not available, tiles stay on vertex buffers" << std::endl;
+    }
+
+    // Vertexbuffer für RendertoBuffer() und RenderTiles(), bleibt die ganze Zeit gebunden
+    glGenBuffers(1, &VertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, VERTEXBUFFER_SIZE, nullptr, GL_STREAM_DRAW);
+    VertexBufferSize = VERTEXBUFFER_SIZE;
+    VertexBufferPos = 0;
+    AttribsEnabled = 0;
+    Batch.reserve(BATCH_VERTICES_MAX);
+
+    // Indexbuffer für alle Quads: zwei Dreiecke in derselben Eckenreihenfolge wie bei einem
+    // Triangle-Strip, so wird Pixel für Pixel dasselbe gerastert
+    std::vector<GLushort> QuadIndices(QUADS_MAX * 6);
+    for (int i = 0; i < QUADS_MAX; i++) {
+        const GLushort v = static_cast<GLushort>(i * 4);
+        GLushort *Index = &QuadIndices[i * 6];
+        Index[0] = v;
+        Index[1] = v + 1;
+        Index[2] = v + 2;
+        Index[3] = v + 2;
+        Index[4] = v + 1;
+        Index[5] = v + 3;
+    }
+
+    if (QuadIndexBuffer == 0)
+        glGenBuffers(1, &QuadIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, QuadIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, QuadIndices.size() * sizeof(GLushort), QuadIndices.data(), GL_STATIC_DRAW);
+
+    for (int i = 0; i < PROGRAM_TOTAL; i++)
+        ProgramMVPValid[i] = false;
+
     /* Matrices setup */
     g_matView = glm::mat4x4(1.0f);
     g_matModelView = glm::mat4x4(1.0f);
@@ -203,6 +361,7 @@ void DirectGraphicsClass::SetColorKeyMode() {
     if (BlendMode == BlendModeEnum::COLORKEY)
         return;
 
+    FlushBatch();
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     BlendMode = BlendModeEnum::COLORKEY;
@@ -216,6 +375,7 @@ void DirectGraphicsClass::SetWhiteMode() {
     if (BlendMode == BlendModeEnum::WHITE)
         return;
 
+    FlushBatch();
     glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_DST_ALPHA);
 
     BlendMode = BlendModeEnum::WHITE;
@@ -229,6 +389,7 @@ void DirectGraphicsClass::SetAdditiveMode() {
     if (BlendMode == BlendModeEnum::ADDITIV)
         return;
 
+    FlushBatch();
     glBlendFunc(GL_SRC_ALPHA, GL_ONE);
 
     BlendMode = BlendModeEnum::ADDITIV;
@@ -250,10 +411,95 @@ void DirectGraphicsClass::SetFilterMode(bool filteron) {
 void DirectGraphicsClass::RendertoBuffer(GLenum PrimitiveType,
                                          std::uint32_t PrimitiveCount,
                                          void *pVertexStreamZeroData) {
-    constexpr int STRIDE = sizeof(VERTEX2D);
-    constexpr size_t CLR_OFFSET = offsetof(VERTEX2D, color);
-    constexpr size_t TEX_OFFSET = offsetof(VERTEX2D, tu);
+    // Line-Strips werden in Linien aufgelöst, Triangle-Strips über degenerierte Dreiecke
+    // aneinandergehängt. So bleibt jedes Dreieck mit derselben Eckenreihenfolge wie vorher
+    // und wird Pixel für Pixel gleich gerastert
+    GLenum type_next;
+    std::uint32_t VertexCount;
 
+    if (PrimitiveType == GL_LINES) {
+        type_next = GL_LINES;
+        VertexCount = PrimitiveCount * 2;
+    } else if (PrimitiveType == GL_LINE_STRIP) {
+        type_next = GL_LINES;
+        VertexCount = (PrimitiveCount + 1) * 2;
+    } else if (PrimitiveType == GL_TRIANGLES) {
+        type_next = GL_TRIANGLES;
+        VertexCount = PrimitiveCount * 3;
+    } else if (PrimitiveType == GL_TRIANGLE_STRIP) {
+        type_next = GL_TRIANGLE_STRIP;
+        VertexCount = PrimitiveCount + 2 + 3;  // + bis zu drei Vertices Verbindung
+    } else {
+        Protokoll << "Add type to count indinces" << std::endl;
+        return;
+    }
+
+    Stats.Submits++;
+    FlushSprites();
+    PrepareBatch(type_next, false, VertexCount);
+
+    const VERTEX2D *v = reinterpret_cast<const VERTEX2D *>(pVertexStreamZeroData);
+
+    if (PrimitiveType == GL_TRIANGLE_STRIP) {
+        // Letzten und ersten Vertex doppelt, der neue Strip muss auf einer geraden Position
+        // anfangen, sonst wären seine Dreiecke umgedreht
+        if (!Batch.empty()) {
+            const VERTEX2D Last = Batch.back();
+            if (Batch.size() & 1)
+                Batch.push_back(Last);
+            Batch.push_back(Last);
+            Batch.push_back(v[0]);
+        }
+        Batch.insert(Batch.end(), v, v + PrimitiveCount + 2);
+    } else if (PrimitiveType == GL_LINE_STRIP) {
+        for (std::uint32_t i = 0; i <= PrimitiveCount; i++) {
+            Batch.push_back(v[i]);
+            Batch.push_back(v[i + 1]);
+        }
+    } else {
+        Batch.insert(Batch.end(), v, v + VertexCount);
+    }
+
+    if (!Batching)
+        FlushBatch();
+}
+
+// --------------------------------------------------------------------------------------
+// Quads sammeln: nur 4 Vertices pro Quad, die Dreiecke kommen aus QuadIndexBuffer. Quads
+// mit demselben State landen im selben Batch, egal wer sie schickt (Sprites, Tiles, Wasser)
+// --------------------------------------------------------------------------------------
+
+void DirectGraphicsClass::RenderQuads(std::uint32_t QuadCount, const VERTEX2D *Vertices) {
+    Stats.Submits++;
+
+    if (SpriteBatching) {
+        RecordSprites(QuadCount, Vertices);
+        return;
+    }
+
+    AppendQuads(QuadCount, Vertices);
+
+    if (!Batching)
+        FlushBatch();
+}
+
+void DirectGraphicsClass::AppendQuads(std::uint32_t QuadCount, const VERTEX2D *Vertices) {
+    constexpr std::uint32_t BATCH_QUADS_MAX = BATCH_VERTICES_MAX / 4;
+
+    while (QuadCount > 0) {
+        const std::uint32_t Count = std::min(QuadCount, BATCH_QUADS_MAX);
+
+        PrepareBatch(GL_TRIANGLES, true, Count * 4);
+        Batch.insert(Batch.end(), Vertices, Vertices + Count * 4);
+
+        Vertices += Count * 4;
+        QuadCount -= Count;
+    }
+}
+
+// Programm und Textur für den nächsten Aufruf bestimmen. Passt der bisher gesammelte Batch
+// nicht dazu oder wird er zu gross, wird er erst gezeichnet
+void DirectGraphicsClass::PrepareBatch(GLenum Type, bool Quads, std::uint32_t VertexCount) {
     uint8_t program_next;
     bool is_texture;
 
@@ -272,54 +518,786 @@ void DirectGraphicsClass::RendertoBuffer(GLenum PrimitiveType,
         is_texture = false;
     }
 
-    // Check if the program is already in use
-    if (ProgramCurrent != program_next) {
-        Shaders[program_next].Use();
-        if (program_next==PROGRAM_RENDER) {
-            glUniform1i(NameTime, 50*SDL_GetTicks()/1000);
+    const GLuint texture_next = is_texture ? TextureCurrent : 0;
+
+    // Anderer State als der bisher gesammelte? Dann erst den alten Batch zeichnen
+    if (!Batch.empty() &&
+        (BatchProgram != program_next || BatchType != Type || BatchQuads != Quads || BatchTexture != texture_next ||
+         BatchProj != matProj || BatchModelView != g_matModelView ||
+         Batch.size() + VertexCount > BATCH_VERTICES_MAX))
+        FlushBatch();
+
+    if (Batch.empty()) {
+        BatchProgram = program_next;
+        BatchType = Type;
+        BatchQuads = Quads;
+        BatchTexture = texture_next;
+        BatchProj = matProj;
+        BatchModelView = g_matModelView;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+// Gesammelte Vertices mit einem Draw-Call zeichnen
+// --------------------------------------------------------------------------------------
+
+void DirectGraphicsClass::FlushBatch() {
+    constexpr int STRIDE = sizeof(VERTEX2D);
+    constexpr size_t CLR_OFFSET = offsetof(VERTEX2D, color);
+    constexpr size_t TEX_OFFSET = offsetof(VERTEX2D, tu);
+
+    if (Batch.empty())
+        return;
+
+    const bool is_texture = BatchProgram != PROGRAM_COLOR;
+    CShader &Shader = Shaders[BatchProgram];
+
+    UseProgram(BatchProgram);
+
+    if (is_texture)
+        glBindTexture(GL_TEXTURE_2D, BatchTexture);
+
+    const uint8_t *Base = SourceVertices(Batch.data(), static_cast<int>(Batch.size() * STRIDE));
+
+    std::uint32_t Mask = (1u << Shader.NamePos) | (1u << Shader.NameClr);
+    if (is_texture)
+        Mask |= 1u << Shader.NameTex;
+    EnableAttributes(Mask);
+
+    glVertexAttribPointer(Shader.NamePos, 2, GL_FLOAT, GL_FALSE, STRIDE, Base);
+    glVertexAttribPointer(Shader.NameClr, 4, GL_UNSIGNED_BYTE, GL_TRUE, STRIDE, Base + CLR_OFFSET);
+    if (is_texture) {
+        glVertexAttribPointer(Shader.NameTex, 2, GL_FLOAT, GL_FALSE, STRIDE, Base + TEX_OFFSET);
+    }
+
+    SetMVP(BatchProgram, BatchProj * BatchModelView);
+
+    if (BatchQuads)
+        DrawQuads(0, static_cast<int>(Batch.size()));
+    else
+        glDrawArrays(BatchType, 0, static_cast<GLsizei>(Batch.size()));
+    Stats.DrawCalls++;
+    Stats.Vertices += static_cast<std::uint32_t>(Batch.size());
+
+    Batch.clear();
+}
+
+void DirectGraphicsClass::SetBatching(bool on) {
+    FlushSprites();
+    FlushBatch();
+    Batching = on;
+}
+
+// --------------------------------------------------------------------------------------
+// Sortierte Sprites
+//
+// Zwischen BeginSprites() und EndSprites() merkt sich RenderQuads() jedes Quad mit dem
+// State, mit dem es gezeichnet worden wäre. FlushSprites() sortiert nach Layer, Platz aus
+// PlaceSprites(), diesem Schlüssel und der Reihenfolge der Aufrufe und schickt jede Gruppe
+// mit einem AppendQuads() in den Batch. Danach gilt wieder der State, den der Aufrufer
+// zuletzt gesetzt hat.
+// --------------------------------------------------------------------------------------
+
+void DirectGraphicsClass::BeginSprites() {
+    FlushSprites();
+    SpriteBatching = Batching;  // ohne Batching bleibt es bei einem Draw-Call pro Sprite
+    SpriteLayer = 0;
+}
+
+void DirectGraphicsClass::SetSpriteLayer(int Layer) {
+    SpriteLayer = std::min(std::max(Layer, -SPRITE_LAYERS / 2), SPRITE_LAYERS / 2 - 1);
+}
+
+void DirectGraphicsClass::EndSprites() {
+    FlushSprites();
+    SpriteBatching = false;
+    SpriteLayer = 0;
+}
+
+void DirectGraphicsClass::RecordSprites(std::uint32_t QuadCount, const VERTEX2D *Vertices) {
+    // Andere Matrizen als beim letzten Sprite: die gehen erst danach
+    if (SpriteMatrices.empty() || SpriteMatrices.back().first != matProj ||
+        SpriteMatrices.back().second != g_matModelView) {
+        if (SpriteMatrices.size() >= SPRITE_MATRICES_MAX)
+            FlushSprites();
+        SpriteMatrices.emplace_back(matProj, g_matModelView);
+    }
+
+    const bool is_texture = use_shader != shader_t::COLOR;
+
+    const std::uint64_t Key =
+        static_cast<std::uint64_t>(SpriteLayer + SPRITE_LAYERS / 2) << SPRITE_LAYER_SHIFT |
+        static_cast<std::uint64_t>(SpriteMatrices.size() - 1) << SPRITE_MATRICES_SHIFT |
+        static_cast<std::uint64_t>(BlendMode) << SPRITE_BLEND_SHIFT |
+        static_cast<std::uint64_t>(use_shader) << SPRITE_PROGRAM_SHIFT | (is_texture ? TextureCurrent : 0);
+
+    for (std::uint32_t i = 0; i < QuadCount; i++)
+        SpriteQuads.push_back(SpriteQuad{Key, static_cast<std::uint32_t>(SpriteVertices.size() + i * 4), 0});
+
+    SpriteVertices.insert(SpriteVertices.end(), Vertices, Vertices + QuadCount * 4);
+}
+
+void DirectGraphicsClass::SetBlendMode(BlendModeEnum Mode) {
+    switch (Mode) {
+        case BlendModeEnum::ADDITIV:
+            SetAdditiveMode();
+            break;
+        case BlendModeEnum::WHITE:
+            SetWhiteMode();
+            break;
+        default:
+            SetColorKeyMode();
+    }
+}
+
+// Platz für jedes Quad im Layer [Begin, End) in Aufrufreihenfolge: hinter allen früheren
+// Quads, die es überdeckt, bei anderem Schlüssel sogar hinter deren Platz. Quads ohne
+// Überdeckung landen so alle auf Platz 0 und bilden eine Gruppe pro Schlüssel. Überdeckt
+// wird nur grob über die Zellen eines Rasters auf dem Schirm geprüft, im Zweifel bleibt
+// also die Reihenfolge.
+void DirectGraphicsClass::PlaceSprites(size_t Begin, size_t End) {
+    SpriteGrid.assign(SPRITE_GRID * SPRITE_GRID, SpriteCell{-1, 0, false});
+
+    // Bildschirmkoordinaten -1..1 auf die Zellen, was daneben liegt, auf den Rand
+    auto Cell = [](float f) {
+        const float c = (std::fmin(std::fmax(f, -1.0f), 1.0f) + 1.0f) * 0.5f * SPRITE_GRID;
+        return std::min(static_cast<int>(c), SPRITE_GRID - 1);
+    };
+
+    glm::mat4x4 MVP;
+    size_t MatrixIndex = SPRITE_MATRICES_MAX;
+
+    for (size_t n = Begin; n < End; n++) {
+        SpriteQuad &Quad = SpriteQuads[n];
+
+        const size_t m = Quad.Key >> SPRITE_MATRICES_SHIFT & (SPRITE_MATRICES_MAX - 1);
+        if (m != MatrixIndex) {
+            MVP = SpriteMatrices[m].first * SpriteMatrices[m].second;
+            MatrixIndex = m;
         }
-        ProgramCurrent = program_next;
+
+        // Orthografisch, w bleibt 1
+        float x0 = HUGE_VALF, y0 = HUGE_VALF, x1 = -HUGE_VALF, y1 = -HUGE_VALF;
+        for (int k = 0; k < 4; k++) {
+            const VERTEX2D &v = SpriteVertices[Quad.First + k];
+            const glm::vec4 p = MVP * glm::vec4(v.x, v.y, 0.0f, 1.0f);
+            x0 = std::fmin(x0, p.x);
+            y0 = std::fmin(y0, p.y);
+            x1 = std::fmax(x1, p.x);
+            y1 = std::fmax(y1, p.y);
+        }
+
+        // Ganz ausserhalb des Schirms überdeckt es nichts, dann ist der Platz egal
+        Quad.Slot = 0;
+        if (x1 < -1.0f || y1 < -1.0f || x0 > 1.0f || y0 > 1.0f)
+            continue;
+
+        const int cx0 = Cell(x0), cy0 = Cell(y0), cx1 = Cell(x1), cy1 = Cell(y1);
+        int Slot = 0;
+
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++) {
+                const SpriteCell &c = SpriteGrid[cy * SPRITE_GRID + cx];
+                if (c.Slot >= 0)
+                    Slot = std::max(Slot, c.Slot + (c.Mixed || c.Key != Quad.Key ? 1 : 0));
+            }
+
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++) {
+                SpriteCell &c = SpriteGrid[cy * SPRITE_GRID + cx];
+                if (c.Slot < Slot)
+                    c = SpriteCell{Slot, Quad.Key, false};
+                else if (c.Key != Quad.Key)
+                    c.Mixed = true;
+            }
+
+        Quad.Slot = static_cast<std::uint32_t>(Slot);
     }
+}
 
-    if (PrimitiveType == GL_LINES) {
-        PrimitiveCount *= 2;
-    } else if (PrimitiveType == GL_LINE_STRIP) {
-        PrimitiveCount += 2;
-    } else if (PrimitiveType == GL_TRIANGLES) {
-        PrimitiveCount *= 3;
-    } else if (PrimitiveType == GL_TRIANGLE_STRIP) {
-        PrimitiveCount += 2;
-    } else {
-        Protokoll << "Add type to count indinces" << std::endl;
+void DirectGraphicsClass::FlushSprites() {
+    if (SpriteQuads.empty())
         return;
+
+    // State des Aufrufers, die Sprites bringen ihren eigenen mit
+    const shader_t ShaderCaller = use_shader;
+    const GLuint TextureCaller = TextureCurrent;
+    const BlendModeEnum BlendCaller = BlendMode;
+    const glm::mat4x4 ProjCaller = matProj;
+    const glm::mat4x4 ModelViewCaller = g_matModelView;
+
+    // First steigt mit jedem Aufruf: erst nach Layer in Aufrufreihenfolge, dann in jedem
+    // Layer nach Platz und Schlüssel, bei gleichem Schlüssel wieder in Aufrufreihenfolge
+    std::sort(SpriteQuads.begin(), SpriteQuads.end(), [](const SpriteQuad &a, const SpriteQuad &b) {
+        const std::uint64_t LayerA = a.Key >> SPRITE_LAYER_SHIFT, LayerB = b.Key >> SPRITE_LAYER_SHIFT;
+        return LayerA < LayerB || (LayerA == LayerB && a.First < b.First);
+    });
+
+    for (size_t Begin = 0; Begin < SpriteQuads.size();) {
+        const std::uint64_t Layer = SpriteQuads[Begin].Key >> SPRITE_LAYER_SHIFT;
+
+        size_t End = Begin;
+        while (End < SpriteQuads.size() && SpriteQuads[End].Key >> SPRITE_LAYER_SHIFT == Layer)
+            End++;
+
+        PlaceSprites(Begin, End);
+
+        std::sort(SpriteQuads.begin() + Begin, SpriteQuads.begin() + End, [](const SpriteQuad &a, const SpriteQuad &b) {
+            if (a.Slot != b.Slot)
+                return a.Slot < b.Slot;
+            return a.Key < b.Key || (a.Key == b.Key && a.First < b.First);
+        });
+
+        Begin = End;
     }
 
-    // Enable attributes and uniforms for transfer
-    if (is_texture) {
-        glEnableVertexAttribArray(Shaders[ProgramCurrent].NameTex);
-        glVertexAttribPointer(Shaders[ProgramCurrent].NameTex, 2, GL_FLOAT, GL_FALSE, STRIDE,
-                              reinterpret_cast<uint8_t *>(pVertexStreamZeroData) + TEX_OFFSET);
+    for (size_t i = 0; i < SpriteQuads.size();) {
+        const std::uint64_t Key = SpriteQuads[i].Key;
+
+        SpriteRun.clear();
+        for (; i < SpriteQuads.size() && SpriteQuads[i].Key == Key; i++) {
+            const VERTEX2D *v = &SpriteVertices[SpriteQuads[i].First];
+            SpriteRun.insert(SpriteRun.end(), v, v + 4);
+        }
+
+        SetBlendMode(static_cast<BlendModeEnum>(Key >> SPRITE_BLEND_SHIFT & 0xF));
+
+        const auto &Matrices = SpriteMatrices[Key >> SPRITE_MATRICES_SHIFT & (SPRITE_MATRICES_MAX - 1)];
+        matProj = Matrices.first;
+        g_matModelView = Matrices.second;
+        use_shader = static_cast<shader_t>(Key >> SPRITE_PROGRAM_SHIFT & 0xF);
+        TextureCurrent = static_cast<GLuint>(Key);
+
+        AppendQuads(static_cast<std::uint32_t>(SpriteRun.size() / 4), SpriteRun.data());
     }
 
-    glEnableVertexAttribArray(Shaders[ProgramCurrent].NamePos);
-    glVertexAttribPointer(Shaders[ProgramCurrent].NamePos, 2, GL_FLOAT, GL_FALSE, STRIDE, pVertexStreamZeroData);
+    SpriteQuads.clear();
+    SpriteVertices.clear();
+    SpriteMatrices.clear();
 
-    glEnableVertexAttribArray(Shaders[ProgramCurrent].NameClr);
-    glVertexAttribPointer(Shaders[ProgramCurrent].NameClr, 4, GL_UNSIGNED_BYTE, GL_TRUE, STRIDE,
-                          reinterpret_cast<uint8_t *>(pVertexStreamZeroData) + CLR_OFFSET);
+    SetBlendMode(BlendCaller);
+    use_shader = ShaderCaller;
+    TextureCurrent = TextureCaller;
+    matProj = ProjCaller;
+    g_matModelView = ModelViewCaller;
+}
 
-    glm::mat4x4 matMVP = matProj * g_matModelView;
-    glUniformMatrix4fv(Shaders[ProgramCurrent].NameMvp, 1, GL_FALSE, glm::value_ptr(matMVP));
+// Count Vertices ab First als Quads über QuadIndexBuffer zeichnen, beide durch 4 teilbar
+void DirectGraphicsClass::DrawQuads(int First, int Count) {
+    const GLintptr Offset = static_cast<GLintptr>(First / 4 * 6) * sizeof(GLushort);
 
-    glDrawArrays(PrimitiveType, 0, PrimitiveCount);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, QuadIndexBuffer);
+    glDrawElements(GL_TRIANGLES, Count / 4 * 6, GL_UNSIGNED_SHORT, reinterpret_cast<const void *>(Offset));
+}
 
-    // Disable attributes and uniforms
-    glDisableVertexAttribArray(Shaders[ProgramCurrent].NamePos);
-    glDisableVertexAttribArray(Shaders[ProgramCurrent].NameClr);
+void DirectGraphicsClass::UseProgram(uint8_t Program) {
+    if (ProgramCurrent == Program)
+        return;
 
+    Shaders[Program].Use();
+    if (Program == PROGRAM_RENDER) {
+        glUniform1i(NameTime, 50*SDL_GetTicks()/1000);
+    }
+    ProgramCurrent = Program;
+}
+
+// Nur die Attribute umschalten, die sich gegenüber dem letzten Draw-Call geändert haben
+void DirectGraphicsClass::EnableAttributes(std::uint32_t Mask) {
+    std::uint32_t Changed = Mask ^ AttribsEnabled;
+
+    for (GLuint i = 0; Changed != 0; i++, Changed >>= 1) {
+        if (!(Changed & 1))
+            continue;
+
+        if (Mask & (1u << i))
+            glEnableVertexAttribArray(i);
+        else
+            glDisableVertexAttribArray(i);
+    }
+
+    AttribsEnabled = Mask;
+}
+
+void DirectGraphicsClass::SetMVP(uint8_t Program, const glm::mat4x4 &matMVP) {
+    if (ProgramMVPValid[Program] && ProgramMVP[Program] == matMVP)
+        return;
+
+    glUniformMatrix4fv(Shaders[Program].NameMvp, 1, GL_FALSE, glm::value_ptr(matMVP));
+    ProgramMVP[Program] = matMVP;
+    ProgramMVPValid[Program] = true;
+}
+
+// Adresse der Vertices für glVertexAttribPointer(): ein Offset im Vertexbuffer oder, ohne
+// Batching, wie früher direkt der Speicher des Aufrufers
+const uint8_t *DirectGraphicsClass::SourceVertices(const void *Vertices, int Bytes) {
+    if (!Batching) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return reinterpret_cast<const uint8_t *>(Vertices);
+    }
+
+    return reinterpret_cast<const uint8_t *>(UploadVertices(Vertices, Bytes));
+}
+
+// Vertices hinter die zuletzt geschriebenen in den Vertexbuffer kopieren, liefert den Offset.
+// Passen sie nicht mehr hinein, bekommt der Buffer neuen Speicher, den alten gibt der
+// Treiber frei, sobald die Draw-Calls darauf fertig sind
+GLintptr DirectGraphicsClass::UploadVertices(const void *Vertices, int Bytes) {
+    glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+
+    if (VertexBufferPos + Bytes > VertexBufferSize) {
+        while (Bytes > VertexBufferSize)
+            VertexBufferSize *= 2;
+
+        glBufferData(GL_ARRAY_BUFFER, VertexBufferSize, nullptr, GL_STREAM_DRAW);
+        VertexBufferPos = 0;
+        Stats.Orphans++;
+    }
+
+    const GLintptr Offset = VertexBufferPos;
+    glBufferSubData(GL_ARRAY_BUFFER, Offset, Bytes, Vertices);
+
+    VertexBufferPos += (Bytes + 15) & ~15;
+    return Offset;
+}
+
+// --------------------------------------------------------------------------------------
+// Lightmap der Leveltiles
+//
+// Ein Texel pro Tile mit dessen Farbe aus der Datei. Linear gefiltert ergibt das an den
+// Ecken eines Tiles den Mittelwert der vier Tiles drumherum, wie früher das Licht der
+// Ecken in den Vertexfarben. Die Lightmap liegt auf Textureinheit 1, damit SetTexture()
+// davon nichts merkt.
+// --------------------------------------------------------------------------------------
+
+bool DirectGraphicsClass::CreateLightMap(int SizeX, int SizeY) {
+    DeleteLightMap();
+
+    if (!SupportedLightMap)
+        return false;
+
+    GLint MaxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &MaxSize);
+
+    if (SizeX <= 0 || SizeY <= 0 || SizeX > MaxSize || SizeY > MaxSize) {
+        Protokoll << "Level lightmap " << SizeX << "x" << SizeY << " exceeds the maximum texture size " << MaxSize
+                  << std::endl;
+        return false;
+    }
+
+    glActiveTexture(GL_TEXTURE1);
+    glGenTextures(1, &LightMap);
+    glBindTexture(GL_TEXTURE_2D, LightMap);
+
+    // Keine Mipmaps und CLAMP_TO_EDGE, dann geht auch NPOT unter GLES2
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SizeX, SizeY, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glActiveTexture(GL_TEXTURE0);
+
+    if (glGetError() != GL_NO_ERROR) {
+        Protokoll << "Could not create " << SizeX << "x" << SizeY << " level lightmap" << std::endl;
+        DeleteLightMap();
+        return false;
+    }
+
+    LightMapSizeX = SizeX;
+    LightMapSizeY = SizeY;
+    return true;
+}
+
+void DirectGraphicsClass::UpdateLightMap(int x, int y, int w, int h, const void *Pixels) {
+    if (LightMap == 0 || w <= 0 || h <= 0)
+        return;
+
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, LightMap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, Pixels);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void DirectGraphicsClass::DeleteLightMap() {
+    if (LightMap != 0)
+        glDeleteTextures(1, &LightMap);
+
+    LightMap = 0;
+    LightMapSizeX = 0;
+    LightMapSizeY = 0;
+}
+
+void DirectGraphicsClass::RenderTiles(std::uint32_t QuadCount,
+                                      const VERTEXTILE *Vertices,
+                                      const glm::vec4 &Transform,
+                                      bool Lit) {
+    constexpr int STRIDE = sizeof(VERTEXTILE);
+    constexpr size_t TEX_OFFSET = offsetof(VERTEXTILE, tu);
+
+    if (LightMap == 0)
+        return;
+
+    // Was vorher gesammelt wurde, liegt darunter
+    FlushSprites();
+    FlushBatch();
+    Stats.Submits++;
+
+    UseTileProgram(Transform, Lit);
+
+    const uint8_t *Base = SourceVertices(Vertices, static_cast<int>(QuadCount * 4 * STRIDE));
+
+    glVertexAttribPointer(Shaders[PROGRAM_TILE].NamePos, 2, GL_FLOAT, GL_FALSE, STRIDE, Base);
+    glVertexAttribPointer(Shaders[PROGRAM_TILE].NameTex, 2, GL_FLOAT, GL_FALSE, STRIDE, Base + TEX_OFFSET);
+
+    SetMVP(PROGRAM_TILE, matProj * g_matModelView);
+
+    DrawQuads(0, static_cast<int>(QuadCount * 4));
+    Stats.DrawCalls++;
+    Stats.Vertices += QuadCount * 4;
+}
+
+// PROGRAM_TILE mit der aktuellen Textur und der Lightmap bereitmachen
+void DirectGraphicsClass::UseTileProgram(const glm::vec4 &Transform, bool Lit) {
+    UseProgram(PROGRAM_TILE);
+
+    glBindTexture(GL_TEXTURE_2D, TextureCurrent);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, LightMap);
+    glActiveTexture(GL_TEXTURE0);
+
+    glUniform4f(NameLightTransform, Transform.x, Transform.y, Transform.z, Transform.w);
+    glUniform2f(NameLightSize, static_cast<float>(LightMapSizeX), static_cast<float>(LightMapSizeY));
+    glUniform1f(NameLit, Lit ? 1.0f : 0.0f);
+
+    EnableAttributes((1u << Shaders[PROGRAM_TILE].NamePos) | (1u << Shaders[PROGRAM_TILE].NameTex));
+}
+
+// --------------------------------------------------------------------------------------
+// Statische Vertexbuffer
+//
+// Die Vertices werden einmal hochgeladen und dann in jedem Frame nur noch gezeichnet.
+// Wo sie auf dem Schirm landen, bestimmt matModel, so bleiben sie beim Scrollen und
+// Zoomen gültig. Der Vertexbuffer von RendertoBuffer() wird dabei nicht angefasst.
+// --------------------------------------------------------------------------------------
+
+void DirectGraphicsClass::UploadStaticBuffer(GLuint &Buffer, const VERTEX2D *Vertices, int Count) {
+    if (Buffer == 0)
+        glGenBuffers(1, &Buffer);
+
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(Count) * sizeof(VERTEX2D), Vertices, GL_STATIC_DRAW);
+}
+
+void DirectGraphicsClass::DeleteStaticBuffer(GLuint &Buffer) {
+    if (Buffer != 0)
+        glDeleteBuffers(1, &Buffer);
+
+    Buffer = 0;
+}
+
+void DirectGraphicsClass::RenderStatic(GLuint Buffer, int First, int Count, const glm::mat4x4 &matModel) {
+    constexpr int STRIDE = sizeof(VERTEX2D);
+    constexpr size_t CLR_OFFSET = offsetof(VERTEX2D, color);
+    constexpr size_t TEX_OFFSET = offsetof(VERTEX2D, tu);
+
+    if (Buffer == 0 || Count <= 0)
+        return;
+
+    FlushSprites();
+    FlushBatch();
+    Stats.Submits++;
+
+    const uint8_t Program = use_shader == shader_t::COLOR ? PROGRAM_COLOR : PROGRAM_TEXTURE;
+    const bool is_texture = Program != PROGRAM_COLOR;
+    CShader &Shader = Shaders[Program];
+
+    UseProgram(Program);
+
+    if (is_texture)
+        glBindTexture(GL_TEXTURE_2D, TextureCurrent);
+
+    std::uint32_t Mask = (1u << Shader.NamePos) | (1u << Shader.NameClr);
+    if (is_texture)
+        Mask |= 1u << Shader.NameTex;
+    EnableAttributes(Mask);
+
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    glVertexAttribPointer(Shader.NamePos, 2, GL_FLOAT, GL_FALSE, STRIDE, nullptr);
+    glVertexAttribPointer(Shader.NameClr, 4, GL_UNSIGNED_BYTE, GL_TRUE, STRIDE,
+                          reinterpret_cast<const void *>(CLR_OFFSET));
     if (is_texture) {
-        glDisableVertexAttribArray(Shaders[ProgramCurrent].NameTex);
+        glVertexAttribPointer(Shader.NameTex, 2, GL_FLOAT, GL_FALSE, STRIDE,
+                              reinterpret_cast<const void *>(TEX_OFFSET));
+    }
+
+    SetMVP(Program, matProj * g_matModelView * matModel);
+
+    DrawQuads(First, Count);
+    Stats.DrawCalls++;
+    Stats.Vertices += Count;
+}
+
+void DirectGraphicsClass::RenderStaticTiles(GLuint Buffer,
+                                            int First,
+                                            int Count,
+                                            const glm::mat4x4 &matModel,
+                                            const glm::vec4 &Transform,
+                                            bool Lit) {
+    constexpr int STRIDE = sizeof(VERTEX2D);
+    constexpr size_t TEX_OFFSET = offsetof(VERTEX2D, tu);
+
+    if (LightMap == 0 || Buffer == 0 || Count <= 0)
+        return;
+
+    FlushSprites();
+    FlushBatch();
+    Stats.Submits++;
+
+    UseTileProgram(Transform, Lit);
+
+    // Die Farbe der Vertices bleibt liegen, das Licht kommt aus der Lightmap
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    glVertexAttribPointer(Shaders[PROGRAM_TILE].NamePos, 2, GL_FLOAT, GL_FALSE, STRIDE, nullptr);
+    glVertexAttribPointer(Shaders[PROGRAM_TILE].NameTex, 2, GL_FLOAT, GL_FALSE, STRIDE,
+                          reinterpret_cast<const void *>(TEX_OFFSET));
+
+    SetMVP(PROGRAM_TILE, matProj * g_matModelView * matModel);
+
+    DrawQuads(First, Count);
+    Stats.DrawCalls++;
+    Stats.Vertices += Count;
+}
+
+// --------------------------------------------------------------------------------------
+// Leveltiles als Instanzen
+//
+// Pro Tile liegt nur ein TILEINSTANCE im Buffer, die vier Ecken kommen aus InstanceCorners
+// und der Vertex-Shader setzt daraus Position, Ausschnitt im Atlas, Animation und das
+// Schwabbeln im Wasser zusammen. So bleiben auch animierte Tiles im Buffer des Chunks.
+// --------------------------------------------------------------------------------------
+
+void DirectGraphicsClass::UploadStaticBuffer(GLuint &Buffer, const TILEINSTANCE *Instances, int Count) {
+    if (Buffer == 0)
+        glGenBuffers(1, &Buffer);
+
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(Count) * sizeof(TILEINSTANCE), Instances, GL_STATIC_DRAW);
+}
+
+void DirectGraphicsClass::RenderTileInstances(GLuint Buffer,
+                                              int First,
+                                              int Count,
+                                              const glm::mat4x4 &matModel,
+                                              const glm::vec4 &Transform,
+                                              const glm::vec4 &Anim) {
+    constexpr int STRIDE = sizeof(TILEINSTANCE);
+    constexpr size_t FLAGS_OFFSET = offsetof(TILEINSTANCE, Flags);
+
+    if (!SupportedInstancing || LightMap == 0 || Atlas == 0 || Buffer == 0 || Count <= 0)
+        return;
+
+    FlushSprites();
+    FlushBatch();
+    Stats.Submits++;
+
+    CShader &Shader = Shaders[PROGRAM_TILEINSTANCED];
+
+    UseProgram(PROGRAM_TILEINSTANCED);
+
+    glBindTexture(GL_TEXTURE_2D, Atlas);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, LightMap);
+    glActiveTexture(GL_TEXTURE0);
+
+    // Die Plätze ändern sich nur mit dem Atlas
+    if (!AtlasSlotsUploaded) {
+        glUniform4fv(NameInstanceAtlasSlots, std::min(static_cast<int>(AtlasSlots.size()), INSTANCE_ATLAS_SLOTS),
+                     glm::value_ptr(AtlasSlots[0]));
+        AtlasSlotsUploaded = true;
+    }
+
+    glUniform4f(NameInstanceLightTransform, Transform.x, Transform.y, Transform.z, Transform.w);
+    glUniform2f(NameInstanceLightSize, static_cast<float>(LightMapSizeX), static_cast<float>(LightMapSizeY));
+    glUniform4f(NameInstanceAnim, Anim.x, Anim.y, Anim.z, Anim.w);
+
+    EnableAttributes((1u << Shader.NamePos) | (1u << NameInstanceTile) | (1u << NameInstanceFlags));
+
+    glBindBuffer(GL_ARRAY_BUFFER, InstanceCorners);
+    glVertexAttribPointer(Shader.NamePos, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+    const uint8_t *Base = reinterpret_cast<const uint8_t *>(static_cast<GLintptr>(First) * STRIDE);
+
+    glBindBuffer(GL_ARRAY_BUFFER, Buffer);
+    glVertexAttribPointer(NameInstanceTile, 4, GL_UNSIGNED_BYTE, GL_FALSE, STRIDE, Base);
+    glVertexAttribPointer(NameInstanceFlags, 1, GL_UNSIGNED_BYTE, GL_FALSE, STRIDE, Base + FLAGS_OFFSET);
+
+    SetMVP(PROGRAM_TILEINSTANCED, matProj * g_matModelView * matModel);
+
+    glVertexAttribDivisor(NameInstanceTile, 1);
+    glVertexAttribDivisor(NameInstanceFlags, 1);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, Count);
+
+    // Die anderen Programme erwarten auf denselben Attributen wieder einen Wert pro Vertex
+    glVertexAttribDivisor(NameInstanceTile, 0);
+    glVertexAttribDivisor(NameInstanceFlags, 0);
+
+    Stats.DrawCalls++;
+    Stats.Vertices += Count * 4;
+}
+
+// --------------------------------------------------------------------------------------
+// Texturatlas
+//
+// Die Texturen werden auf der Grafikkarte über ein Framebuffer Object in den Atlas kopiert,
+// so geht das auch mit komprimierten Texturen und ohne die Bilder noch einmal zu laden.
+// Jeder Platz bekommt einen Rand von ATLAS_GUTTER Texeln, in dem sich die Randtexel der
+// Textur wiederholen, damit an den Kanten nichts vom Nachbarn durchscheint.
+// --------------------------------------------------------------------------------------
+
+bool DirectGraphicsClass::CreateAtlas(const std::vector<int> &TexIdx, int SlotSize) {
+    constexpr int STRIDE = sizeof(VERTEX2D);
+    constexpr size_t CLR_OFFSET = offsetof(VERTEX2D, color);
+    constexpr size_t TEX_OFFSET = offsetof(VERTEX2D, tu);
+
+    DeleteAtlas();
+
+    const int Count = static_cast<int>(TexIdx.size());
+
+    if (Count == 0 || SlotSize <= 0)
+        return false;
+
+    // GLES2 hat Framebuffer Objects immer, Desktop GL erst ab 3.0 oder mit der Extension
+    if (epoxy_is_desktop_gl() && epoxy_gl_version() < 30 && !epoxy_has_gl_extension("GL_ARB_framebuffer_object")) {
+        Protokoll << "Framebuffer objects not supported, texture atlas disabled" << std::endl;
+        return false;
     }
+
+    // Möglichst quadratisch anordnen
+    const int Pitch = SlotSize + 2 * ATLAS_GUTTER;
+    int Columns = 1;
+    while (Columns * Columns < Count)
+        Columns++;
+    const int Rows = (Count + Columns - 1) / Columns;
+    const int SizeX = Columns * Pitch;
+    const int SizeY = Rows * Pitch;
+
+    GLint MaxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &MaxSize);
+
+    if (SizeX > MaxSize || SizeY > MaxSize) {
+        Protokoll << "Texture atlas " << SizeX << "x" << SizeY << " exceeds the maximum texture size " << MaxSize
+                  << std::endl;
+        return false;
+    }
+
+    FlushBatch();
+
+    // Filter wie bei den einzelnen Texturen, CLAMP_TO_EDGE wegen NPOT unter GLES2
+    glGenTextures(1, &Atlas);
+    glBindTexture(GL_TEXTURE_2D, Atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SizeX, SizeY, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    GLint OldFramebuffer = 0;
+    GLint OldViewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &OldFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, OldViewport);
+
+    GLuint Framebuffer = 0;
+    glGenFramebuffers(1, &Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, Atlas, 0);
+
+    bool Complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+    if (Complete) {
+        glViewport(0, 0, SizeX, SizeY);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+        // Kopieren, nicht mischen
+        glDisable(GL_BLEND);
+
+        CShader &Shader = Shaders[PROGRAM_TEXTURE];
+        UseProgram(PROGRAM_TEXTURE);
+        EnableAttributes((1u << Shader.NamePos) | (1u << Shader.NameClr) | (1u << Shader.NameTex));
+
+        // y nach oben, dann landet die erste Zeile der Textur bei v = 0 wie im Original
+        SetMVP(PROGRAM_TEXTURE,
+               glm::ortho(0.0f, static_cast<float>(SizeX), 0.0f, static_cast<float>(SizeY), 0.0f, 1.0f));
+
+        AtlasSlots.resize(Count);
+
+        for (int Slot = 0; Slot < Count; Slot++) {
+            const float x = static_cast<float>((Slot % Columns) * Pitch);
+            const float y = static_cast<float>((Slot / Columns) * Pitch);
+
+            AtlasSlots[Slot] = glm::vec4(static_cast<float>(SlotSize) / SizeX, static_cast<float>(SlotSize) / SizeY,
+                                         (x + ATLAS_GUTTER) / SizeX, (y + ATLAS_GUTTER) / SizeY);
+
+            if (TexIdx[Slot] < 0)
+                continue;
+
+            // Über die Kante hinaus liefert CLAMP_TO_EDGE die Randtexel, das gibt den Rand
+            const float u0 = -static_cast<float>(ATLAS_GUTTER) / SlotSize;
+            const float u1 = 1.0f - u0;
+            const float w = static_cast<float>(Pitch);
+            const D3DCOLOR White = D3DCOLOR_RGBA(255, 255, 255, 255);
+
+            VERTEX2D Quad[4] = {{x, y, White, u0, u0},
+                                {x + w, y, White, u1, u0},
+                                {x, y + w, White, u0, u1},
+                                {x + w, y + w, White, u1, u1}};
+
+            glBindTexture(GL_TEXTURE_2D, Textures[TexIdx[Slot]].tex);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+            const uint8_t *Base = SourceVertices(Quad, sizeof(Quad));
+            glVertexAttribPointer(Shader.NamePos, 2, GL_FLOAT, GL_FALSE, STRIDE, Base);
+            glVertexAttribPointer(Shader.NameClr, 4, GL_UNSIGNED_BYTE, GL_TRUE, STRIDE, Base + CLR_OFFSET);
+            glVertexAttribPointer(Shader.NameTex, 2, GL_FLOAT, GL_FALSE, STRIDE, Base + TEX_OFFSET);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        }
+
+        glEnable(GL_BLEND);
+        Complete = glGetError() == GL_NO_ERROR;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(OldFramebuffer));
+    glViewport(OldViewport[0], OldViewport[1], OldViewport[2], OldViewport[3]);
+    glDeleteFramebuffers(1, &Framebuffer);
+
+    if (!Complete) {
+        Protokoll << "Could not create " << SizeX << "x" << SizeY << " texture atlas" << std::endl;
+        DeleteAtlas();
+        return false;
+    }
+
+    Protokoll << "Texture atlas " << SizeX << "x" << SizeY << " with " << Count << " slots" << std::endl;
+    return true;
+}
+
+void DirectGraphicsClass::DeleteAtlas() {
+    if (Atlas != 0)
+        glDeleteTextures(1, &Atlas);
+
+    Atlas = 0;
+    AtlasSlots.clear();
+    AtlasSlotsUploaded = false;
+}
+
+void DirectGraphicsClass::SetAtlasTexture() {
+    use_shader = shader_t::TEXTURE;
+    TextureCurrent = Atlas;
 }
 
 bool DirectGraphicsClass::ExtensionSupported(const char *ext) {
@@ -332,11 +1310,12 @@ bool DirectGraphicsClass::ExtensionSupported(const char *ext) {
     return false;
 }
 
+// Gebunden wird die Textur erst beim Zeichnen, so bleibt ein Batch über SetTexture()
+// mit derselben Textur hinweg erhalten
 void DirectGraphicsClass::SetTexture(int idx) {
     if (idx >= 0) {
         use_shader = shader_t::TEXTURE;
-        TextureHandle &th = Textures[idx];
-        glBindTexture(GL_TEXTURE_2D, th.tex);
+        TextureCurrent = Textures[idx].tex;
     } else {
         use_shader = shader_t::COLOR;
     }
@@ -358,6 +1337,26 @@ void DirectGraphicsClass::SetupFramebuffers() {
               << WindowView.y << std::endl;
 }
 
+// Beginnt einen neuen Frame
 void DirectGraphicsClass::ClearBackBuffer() {
+    FlushSprites();
+    FlushBatch();
+
+    Stats = RenderStatsStruct();
+    FrameStart = std::chrono::steady_clock::now();
+
     glClear(GL_COLOR_BUFFER_BIT);
 }
+
+// --------------------------------------------------------------------------------------
+// Frame abschliessen: alles Gesammelte zeichnen und die Zähler festhalten. Den Buffer
+// tauscht danach der Aufrufer (wxGLCanvas::SwapBuffers)
+// --------------------------------------------------------------------------------------
+
+void DirectGraphicsClass::DisplayBuffer() {
+    FlushSprites();
+    FlushBatch();
+
+    Stats.CpuTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+    LastStats = Stats;
+}
@@ -17,6 +17,8 @@
 // Include Dateien
 // --------------------------------------------------------------------------------------
 
+#include <chrono>
+#include <vector>
 #include "SDL_port.hpp"
 #if defined(USE_GL2) || defined(USE_GL3)
 #  include "cshader.hpp"
@@ -33,9 +35,15 @@ enum class BlendModeEnum {
 };
 
 #if defined(USE_GL2) || defined(USE_GL3)
-enum { PROGRAM_COLOR = 0, PROGRAM_TEXTURE, PROGRAM_RENDER, PROGRAM_TOTAL, PROGRAM_NONE };
+enum { PROGRAM_COLOR = 0, PROGRAM_TEXTURE, PROGRAM_RENDER, PROGRAM_TILE, PROGRAM_TILEINSTANCED, PROGRAM_TOTAL, PROGRAM_NONE };
 #endif
 
+constexpr int VERTEXBUFFER_SIZE = 1024 * 1024;  // Bytes im Vertexbuffer, bevor er neu angelegt wird
+constexpr int BATCH_VERTICES_MAX = 6 * 2048;    // ab hier wird ein Batch auch ohne Statewechsel gezeichnet
+constexpr int QUADS_MAX = 65536 / 4;            // Quads im Indexbuffer, so passen die Indizes in GLushort
+constexpr int ATLAS_GUTTER = 2;                 // Rand um jede Textur im Atlas, in Texeln
+constexpr int INSTANCE_ATLAS_SLOTS = 64;        // Plätze im Atlas, die der Shader für Instanzen kennt
+
 // --------------------------------------------------------------------------------------
 // Strukturen
 // --------------------------------------------------------------------------------------
@@ -51,11 +59,44 @@ struct VERTEX2D {
     float tu, tv;    // Textur-Koordinaten
 };
 
+// Vertex für Leveltiles mit Lightmap, die Farbe kommt erst im Shader dazu
+struct VERTEXTILE {
+    float x, y;      // x,y Koordinaten
+    float tu, tv;    // Textur-Koordinaten
+};
+
+// Ein Leveltile für RenderTileInstances(), das Quad dazu baut erst der Vertex-Shader
+struct TILEINSTANCE {
+    uint8_t x, y;        // Position in Tiles relativ zur Ecke des Chunks
+    uint8_t Slot;        // Platz des Tilesets im Atlas
+    uint8_t Rect;        // Ausschnitt im Tileset, ohne Animationsphase
+    uint8_t Flags;       // TILEINSTANCE_...
+    uint8_t Unused[3];
+};
+
+enum {
+    TILEINSTANCE_LIT = 0x01,       // Licht aus der Lightmap, sonst weiss
+    TILEINSTANCE_ANIM = 0x02,      // Ausschnitt wandert mit der Animationsphase
+    TILEINSTANCE_SWAY_V1 = 0x04,   // Ecke schwabbelt im Wasser: links oben,
+    TILEINSTANCE_SWAY_V2 = 0x08,   // rechts oben,
+    TILEINSTANCE_SWAY_V3 = 0x10,   // links unten,
+    TILEINSTANCE_SWAY_V4 = 0x20    // rechts unten
+};
+
 // DKS - Added
 struct QUAD2D {
     VERTEX2D v1, v2, v3, v4;
 };
 
+// Zähler für einen Frame, von ClearBackBuffer() bis DisplayBuffer()
+struct RenderStatsStruct {
+    std::uint32_t Submits;    // Aufrufe von RendertoBuffer(), RenderQuads() und RenderTiles()
+    std::uint32_t DrawCalls;  // glDrawArrays(), glDrawElements() und glDrawArraysInstanced()
+    std::uint32_t Vertices;   // gezeichnete Vertices
+    std::uint32_t Orphans;    // wie oft der Vertexbuffer neu angelegt wurde
+    double CpuTime;           // Millisekunden
+};
+
 // --------------------------------------------------------------------------------------
 // Klassendeklaration
 // --------------------------------------------------------------------------------------
@@ -78,12 +119,91 @@ class DirectGraphicsClass {
     int MaxTextureUnits;
     bool SupportedETC1;
     bool SupportedPVRTC;
+    bool SupportedLightMap;
+    bool SupportedInstancing;
     GLuint ProgramCurrent;
     GLuint NameTime;
+    GLint NameLightMap;        // Uniforms von PROGRAM_TILE
+    GLint NameLightTransform;
+    GLint NameLightSize;
+    GLint NameLit;
+    GLint NameInstanceTile;    // Attribute und Uniforms von PROGRAM_TILEINSTANCED
+    GLint NameInstanceFlags;
+    GLint NameInstanceLightTransform;
+    GLint NameInstanceLightSize;
+    GLint NameInstanceAtlasSlots;
+    GLint NameInstanceAnim;
+    GLuint InstanceCorners;    // die vier Ecken eines Quads, für alle Instanzen derselbe Buffer
+    GLuint LightMap;           // Lightmap der Leveltiles, 0 = keine
+    int LightMapSizeX;
+    int LightMapSizeY;
+    GLuint Atlas;              // Texturatlas, 0 = keiner
+    std::vector<glm::vec4> AtlasSlots;  // Texturkoordinaten je Platz, xy Faktor, zw Offset
+    bool AtlasSlotsUploaded;            // schon in PROGRAM_TILEINSTANCED
     CShader Shaders[PROGRAM_TOTAL];
+    glm::mat4x4 ProgramMVP[PROGRAM_TOTAL];  // zuletzt hochgeladene Matrix je Programm
+    bool ProgramMVPValid[PROGRAM_TOTAL];
     glm::mat4x4 matProjWindow;
     glm::mat4x4 matProjRender;
 
+    // Alle Vertices gehen durch einen Vertexbuffer, der als Ring beschrieben wird. Ist er
+    // voll, wird er verwaist und neu angelegt, statt auf die laufenden Draw-Calls zu warten
+    GLuint VertexBuffer;
+    int VertexBufferSize;
+    int VertexBufferPos;
+    std::uint32_t AttribsEnabled;  // Bitmaske der eingeschalteten Vertex-Attribute
+
+    // Indizes 0, 1, 2, 2, 1, 3 für jedes Quad, für alle Quads derselbe Buffer
+    GLuint QuadIndexBuffer;
+
+    // Gesammelte Vertices, die mit demselben State gezeichnet werden (siehe RendertoBuffer())
+    std::vector<VERTEX2D> Batch;
+    GLenum BatchType;
+    bool BatchQuads;  // Quads aus RenderQuads(), gezeichnet über QuadIndexBuffer
+    uint8_t BatchProgram;
+    GLuint BatchTexture;
+    glm::mat4x4 BatchProj;
+    glm::mat4x4 BatchModelView;
+    bool Batching;
+    GLuint TextureCurrent;  // von SetTexture(), gebunden wird erst beim Zeichnen
+
+    // Sprites zwischen BeginSprites() und EndSprites(), gezeichnet wird erst sortiert
+    struct SpriteQuad {
+        std::uint64_t Key;    // Layer, Matrizen, Blendmodus, Programm, Textur
+        std::uint32_t First;  // erster Vertex in SpriteVertices
+        std::uint32_t Slot;   // frühester Platz innerhalb des Layers, siehe PlaceSprites()
+    };
+    struct SpriteCell {
+        std::int32_t Slot;  // höchster Platz eines Quads in dieser Zelle, -1 = noch keins
+        std::uint64_t Key;  // Schlüssel der Quads auf diesem Platz,
+        bool Mixed;         // wenn es nicht mehrere verschiedene sind
+    };
+    bool SpriteBatching;
+    int SpriteLayer;
+    std::vector<SpriteQuad> SpriteQuads;
+    std::vector<SpriteCell> SpriteGrid;  // grobes Raster über den Schirm für PlaceSprites()
+    std::vector<VERTEX2D> SpriteVertices;
+    std::vector<VERTEX2D> SpriteRun;  // Vertices einer Gruppe am Stück
+    std::vector<std::pair<glm::mat4x4, glm::mat4x4>> SpriteMatrices;  // matProj und g_matModelView
+
+    RenderStatsStruct Stats;
+    RenderStatsStruct LastStats;
+    std::chrono::steady_clock::time_point FrameStart;
+
+    void UseProgram(uint8_t Program);
+    void EnableAttributes(std::uint32_t Mask);
+    void SetMVP(uint8_t Program, const glm::mat4x4 &matMVP);
+    void PrepareBatch(GLenum Type, bool Quads, std::uint32_t VertexCount);
+    void AppendQuads(std::uint32_t QuadCount, const VERTEX2D *Vertices);
+    void RecordSprites(std::uint32_t QuadCount, const VERTEX2D *Vertices);
+    void PlaceSprites(size_t Begin, size_t End);
+    void FlushSprites();
+    void SetBlendMode(BlendModeEnum Mode);
+    void DrawQuads(int First, int Count);
+    void UseTileProgram(const glm::vec4 &Transform, bool Lit);
+    const uint8_t *SourceVertices(const void *Vertices, int Bytes);
+    GLintptr UploadVertices(const void *Vertices, int Bytes);
+
     SDL_GLContext GLcontext;
     SDL_Rect WindowView;
     SDL_Rect RenderRect;
@@ -108,6 +228,56 @@ class DirectGraphicsClass {
     void RendertoBuffer(GLenum PrimitiveType,          // Rendert in den Buffer, der am Ende
                         std::uint32_t PrimitiveCount,  // eines jeden Frames komplett in
                         void *pVertexStreamZeroData);  // den Backbuffer gerendert wird
+    void RenderQuads(std::uint32_t QuadCount,          // je 4 Vertices wie ein Triangle-Strip: links oben,
+                     const VERTEX2D *Vertices);        // rechts oben, links unten, rechts unten
+    void FlushBatch();                                 // gesammelte Vertices jetzt zeichnen
+    void DisplayBuffer();                              // Frame abschliessen, Swap macht der Aufrufer
+    void SetBatching(bool on);                         // aus: ein Draw-Call pro RendertoBuffer() wie früher
+
+    // Sprites sammeln statt gleich zeichnen: bis EndSprites() landen alle Quads aus RenderQuads()
+    // (die Render...() von DirectGraphicsSprite, RenderRect4() usw.) mit Textur, Blendmodus und
+    // Layer in einer Liste. EndSprites() sortiert sie stabil nach Layer, Blendmodus und Textur
+    // und zeichnet jede Gruppe am Stück. Vorziehen darf es ein Sprite dabei nur über andere,
+    // mit denen es sich nicht überdeckt, innerhalb eines Layers sieht das Bild also genauso
+    // aus wie ohne Sortieren. Alles andere, was zeichnet, holt die gesammelten Sprites vorher
+    // nach
+    void BeginSprites();
+    void SetSpriteLayer(int Layer);  // niedrigere zuerst, gilt für die folgenden Sprites
+    void EndSprites();
+
+    // Lightmap der Leveltiles: ein RGBA Texel pro Tile, Filter linear
+    bool CreateLightMap(int SizeX, int SizeY);                             // leer anlegen
+    void UpdateLightMap(int x, int y, int w, int h, const void *Pixels);  // Rechteck hochladen, zeilenweise
+    void DeleteLightMap();
+
+    // Leveltiles mit der aktuellen Textur und Licht aus der Lightmap rendern, 4 Vertices pro
+    // Tile wie bei RenderQuads(). Transform bildet Screen-Koordinaten auf Lightmap-Koordinaten
+    // ab (xy Faktor, zw Offset), Lit false rendert weiss mit dem Alpha des Tiles
+    void RenderTiles(std::uint32_t QuadCount, const VERTEXTILE *Vertices, const glm::vec4 &Transform, bool Lit);
+
+    // Eigene Vertexbuffer für Quads, die über viele Frames gleich bleiben (Leveltiles), mit
+    // höchstens QUADS_MAX Quads. Gezeichnet werden Count Vertices (4 pro Quad) ab First mit
+    // matProj * g_matModelView * matModel, RenderStatic() mit der aktuellen Textur,
+    // RenderStaticTiles() wie RenderTiles()
+    void UploadStaticBuffer(GLuint &Buffer, const VERTEX2D *Vertices, int Count);  // legt Buffer bei 0 an
+    void DeleteStaticBuffer(GLuint &Buffer);
+    void RenderStatic(GLuint Buffer, int First, int Count, const glm::mat4x4 &matModel);
+    void RenderStaticTiles(GLuint Buffer, int First, int Count, const glm::mat4x4 &matModel,
+                           const glm::vec4 &Transform, bool Lit);
+
+    // Leveltiles als Instanzen, 8 Bytes pro Tile statt 4 Vertices. Die Tiles liegen im Atlas,
+    // Licht wie bei RenderStaticTiles(). Anim: x Animationsphase, y Index in die Sinustabelle
+    // des Wassers für Zeile 0 des Chunks, z Ausschlag des Schwabbelns in Tiles. Nur wenn
+    // IsInstancingSupported(), gezeichnet werden Count Instanzen ab First
+    void UploadStaticBuffer(GLuint &Buffer, const TILEINSTANCE *Instances, int Count);
+    void RenderTileInstances(GLuint Buffer, int First, int Count, const glm::mat4x4 &matModel,
+                             const glm::vec4 &Transform, const glm::vec4 &Anim);
+
+    // Texturatlas: gleich grosse Texturen in einer, jede mit einem Rand aus ihren Randtexeln.
+    // Texturkoordinaten uv einer Textur werden im Atlas zu uv * xy + zw von GetAtlasSlot()
+    bool CreateAtlas(const std::vector<int> &TexIdx, int SlotSize);  // -1 lässt den Platz leer
+    void DeleteAtlas();
+    void SetAtlasTexture();  // wie SetTexture(), nur mit dem Atlas
 
     void SetTexture(int idx);
     bool ExtensionSupported(const char *ext);
@@ -116,8 +286,13 @@ class DirectGraphicsClass {
     void SelectBuffer(bool active);
 
     inline BlendModeEnum GetBlendMode() const { return BlendMode; }
+    inline const RenderStatsStruct &GetRenderStats() const { return LastStats; }  // des letzten Frames
     inline bool IsETC1Supported() const { return SupportedETC1; }
     inline bool IsPVRTCSupported() const { return SupportedPVRTC; }
+    inline bool IsLightMapSupported() const { return SupportedLightMap; }
+    inline bool IsInstancingSupported() const { return SupportedInstancing; }
+    inline bool IsAtlasReady() const { return Atlas != 0; }
+    inline const glm::vec4 &GetAtlasSlot(int Slot) const { return AtlasSlots[Slot]; }
 };
 
 
@@ -184,7 +184,7 @@ void DirectGraphicsSprite::RenderSprite(float x, float y, D3DCOLOR Color) {
     DirectGraphics.SetTexture(itsTexIdx);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 }
 
 // --------------------------------------------------------------------------------------
@@ -247,7 +247,7 @@ void DirectGraphicsSprite::RenderSprite(float x,
     DirectGraphics.SetTexture(itsTexIdx);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 }
 
 // --------------------------------------------------------------------------------------
@@ -307,7 +307,7 @@ void DirectGraphicsSprite::RenderMirroredSprite(float x, float y, D3DCOLOR Color
     DirectGraphics.SetTexture(itsTexIdx);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 }
 
 // --------------------------------------------------------------------------------------
@@ -355,7 +355,7 @@ void DirectGraphicsSprite::RenderMirroredSprite(float x, float y, D3DCOLOR Color
     DirectGraphics.SetTexture(itsTexIdx);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 }
 
 void DirectGraphicsSprite::RenderSpriteWithScale(float x, float y, float scale, D3DCOLOR col) {
@@ -398,7 +398,7 @@ void DirectGraphicsSprite::RenderSpriteWithScale(float x, float y, float scale,
     DirectGraphics.SetTexture(itsTexIdx);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 }
 
 // --------------------------------------------------------------------------------------
@@ -448,7 +448,7 @@ void DirectGraphicsSprite::RenderSpriteScaled(float x, float y, int width, int h
     DirectGraphics.SetFilterMode(true);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 
     DirectGraphics.SetFilterMode(false);
 }
@@ -500,7 +500,7 @@ void DirectGraphicsSprite::RenderSpriteScaled(float x, float y, int width, int h
     DirectGraphics.SetFilterMode(true);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 
     DirectGraphics.SetFilterMode(false);
 }
@@ -578,7 +578,7 @@ void DirectGraphicsSprite::RenderSpriteRotated(float x, float y, float Winkel, D
     DirectGraphics.SetFilterMode(true);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 
     DirectGraphics.SetFilterMode(false);
 
@@ -689,7 +689,7 @@ void DirectGraphicsSprite::RenderSpriteRotated(float x, float y, float Winkel, i
     DirectGraphics.SetFilterMode(true);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 
     DirectGraphics.SetFilterMode(false);
 
@@ -794,7 +794,7 @@ void DirectGraphicsSprite::RenderSpriteRotatedOffset(float x,
     DirectGraphics.SetFilterMode(true);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 
     DirectGraphics.SetFilterMode(false);
 
@@ -884,7 +884,7 @@ void DirectGraphicsSprite::RenderSpriteScaledRotated(float x,
     DirectGraphics.SetFilterMode(true);
 
     // Sprite zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 
     DirectGraphics.SetFilterMode(false);
 
@@ -933,7 +933,7 @@ void RenderRect4(float x, float y, float width, float height, D3DCOLOR c1, D3DCO
     DirectGraphics.SetTexture(-1);
 
     // Rechteck zeichnen
-    DirectGraphics.RendertoBuffer(GL_TRIANGLE_STRIP, 2, &TriangleStrip[0]);
+    DirectGraphics.RenderQuads(1, &TriangleStrip[0]);
 }
 
 // --------------------------------------------------------------------------------------
@@ -6,11 +6,16 @@
 #ifndef _DX8TEXTURE_HPP_
 #define _DX8TEXTURE_HPP_
 
+#include <atomic>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 #include "SDLPort/SDL_port.hpp"
 #include "Globals.hpp"
 
+struct image_t;
+
 class TextureHandle {
   public:
     TextureHandle()
@@ -43,6 +48,18 @@ class TexturesystemClass {
     int16_t LoadTexture(const std::string &filename);
     void UnloadTexture(const int idx);
 
+    // Only decodes the image file into memory, no GL calls, so this may run on any thread
+    static bool DecodeTexture(const std::string &filename, image_t &image);
+
+    // Decodes a whole list of files in one go, again without any GL calls. Every filename
+    // is decoded once, files that fail are left out. Stops early once *cancel is set.
+    static std::vector<std::pair<std::string, image_t>> DecodeTextures(const std::vector<std::string> &filenames,
+                                                                        const std::atomic<bool> *cancel = nullptr);
+
+    // Decodes every file that isn't already in VRAM and queues the images,
+    // so the LoadTexture() calls that follow only have to upload them. GL thread only.
+    void PreloadTextures(const std::vector<std::string> &filenames);
+
     TextureHandle &operator[](int idx) {
 #ifndef NDEBUG
         if (idx < 0 || idx >= static_cast<int>(_loaded_textures.size())) {
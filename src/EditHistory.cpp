@@ -0,0 +1,383 @@
+// Datei : EditHistory.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Undo/Redo für Tile- und Objektänderungen im Editor (siehe EditHistory.hpp)
+//
+// --------------------------------------------------------------------------------------
+
+#include "EditHistory.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "EditJournal.hpp"
+#include "LevelFormat.hpp"
+#include "Logdatei.hpp"
+
+// --------------------------------------------------------------------------------------
+// Hilfsfunktionen
+// --------------------------------------------------------------------------------------
+
+static TileRawStruct XorTile(const TileRawStruct &a, const TileRawStruct &b) {
+    uint32_t wa[3], wb[3];
+    memcpy(wa, &a, sizeof(wa));
+    memcpy(wb, &b, sizeof(wb));
+
+    for (int k = 0; k < 3; k++)
+        wa[k] ^= wb[k];
+
+    TileRawStruct Tile;
+    memcpy(&Tile, wa, sizeof(Tile));
+    return Tile;
+}
+
+static bool IsZero(const TileRawStruct &Tile) {
+    uint32_t w[3];
+    memcpy(w, &Tile, sizeof(w));
+    return (w[0] | w[1] | w[2]) == 0;
+}
+
+static bool SameObject(const Object &a, const Object &b) {
+    return a.ObjectID == b.ObjectID && a.XPos == b.XPos && a.YPos == b.YPos && a.ChangeLight == b.ChangeLight &&
+           a.Skill == b.Skill && a.Value1 == b.Value1 && a.Value2 == b.Value2;
+}
+
+static uint32_t TileKey(int x, int y) {
+    return static_cast<uint32_t>(y) << 16 | static_cast<uint32_t>(x);
+}
+
+size_t HistoryStep::Bytes() const {
+    return sizeof(HistoryStep) + Tiles.capacity() * sizeof(HistoryTile) + Region.capacity() +
+           Objects.capacity() * sizeof(HistoryObject);
+}
+
+// --------------------------------------------------------------------------------------
+// Striche
+// --------------------------------------------------------------------------------------
+
+void EditHistoryClass::BeginStroke() {
+    if (itsDepth++ > 0)
+        return;
+
+    itsOldTiles.clear();
+    itsOldRegions.clear();
+    itsOldObjects.clear();
+    itsOldCount = ObjectList.ObjectCount;
+    itsBroken = false;
+}
+
+void EditHistoryClass::EndStroke() {
+    if (itsDepth == 0 || --itsDepth > 0)
+        return;
+
+    // Tiles schreibt der Aufrufer selbst ins Journal, geänderte Objekte kennt nur die History
+    for (const auto &Old : itsOldObjects)
+        if (!SameObject(Old.second, ObjectList.Objects[Old.first]))
+            itsJournal.RecordObject(Old.first, ObjectList.Objects[Old.first]);
+
+    if (itsOldCount != ObjectList.ObjectCount)
+        itsJournal.RecordObjectCount(ObjectList.ObjectCount);
+
+    HistoryStep Step;
+    if (!itsBroken)
+        Step = BuildStep();
+
+    itsOldTiles.clear();
+    itsOldRegions.clear();
+    itsOldObjects.clear();
+
+    if (itsBroken) {
+        Protokoll << "-> Edit too large to undo, discarding undo history" << std::endl;
+        Clear();
+        return;
+    }
+
+    if (Step.Empty())
+        return;
+
+    // Ein neuer Schritt macht alles Wiederherstellbare ungültig
+    for (const HistoryStep &Old : itsRedo)
+        itsBytes -= Old.Bytes();
+    itsRedo.clear();
+
+    itsBytes += Step.Bytes();
+    itsUndo.push_back(std::move(Step));
+
+    Trim();
+}
+
+void EditHistoryClass::TouchTile(int x, int y) {
+    // Nicht angemeldet, danach passt kein XOR mehr
+    if (itsDepth == 0) {
+        Clear();
+        return;
+    }
+
+    if (x < 0 || y < 0 || x >= itsLevel.LEVELSIZE_X || y >= itsLevel.LEVELSIZE_Y)
+        return;
+
+    const uint32_t Key = TileKey(x, y);
+    if (itsOldTiles.count(Key) != 0)
+        return;
+
+    // Steckt schon in einem früher angemeldeten Rechteck
+    for (const OldRegion &Region : itsOldRegions)
+        if (x >= Region.x0 && x < Region.x1 && y >= Region.y0 && y < Region.y1)
+            return;
+
+    TileRawStruct Old;
+    itsLevel.ReadTiles(x, y, x + 1, y + 1, &Old);
+    itsOldTiles.emplace(Key, Old);
+}
+
+void EditHistoryClass::TouchRegion(int x0, int y0, int x1, int y1) {
+    if (itsDepth == 0) {
+        Clear();
+        return;
+    }
+
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, itsLevel.LEVELSIZE_X);
+    y1 = std::min(y1, itsLevel.LEVELSIZE_Y);
+
+    if (x0 >= x1 || y0 >= y1 || itsBroken)
+        return;
+
+    // Schon der alte Stand allein würde das Budget sprengen
+    const size_t Count = static_cast<size_t>(x1 - x0) * (y1 - y0);
+    if (Count * sizeof(TileRawStruct) > itsBudget) {
+        itsBroken = true;
+        return;
+    }
+
+    OldRegion Region{x0, y0, x1, y1, std::vector<TileRawStruct>(Count)};
+    itsLevel.ReadTiles(x0, y0, x1, y1, Region.Tiles.data());
+    itsOldRegions.push_back(std::move(Region));
+}
+
+void EditHistoryClass::TouchObject(int Index) {
+    if (itsDepth == 0) {
+        Clear();
+        return;
+    }
+
+    if (Index >= 0 && Index < MAX_GEGNER)
+        itsOldObjects.emplace(Index, ObjectList.Objects[Index]);
+}
+
+// --------------------------------------------------------------------------------------
+// Schritt aus dem alten und dem jetzigen Stand bauen
+// --------------------------------------------------------------------------------------
+
+HistoryStep EditHistoryClass::BuildStep() {
+    HistoryStep Step;
+
+    for (const auto &Old : itsOldObjects) {
+        const Object &New = ObjectList.Objects[Old.first];
+        if (!SameObject(Old.second, New))
+            Step.Objects.push_back(HistoryObject{static_cast<uint32_t>(Old.first), Old.second, New});
+    }
+
+    Step.OldCount = itsOldCount;
+    Step.NewCount = ObjectList.ObjectCount;
+
+    // Gepacktes Rechteck um alle angemeldeten Bereiche, sonst um einen langen, dichten Strich
+    int x0 = INT_MAX, y0 = INT_MAX, x1 = INT_MIN, y1 = INT_MIN;
+
+    auto Extend = [&](int ax0, int ay0, int ax1, int ay1) {
+        x0 = std::min(x0, ax0);
+        y0 = std::min(y0, ay0);
+        x1 = std::max(x1, ax1);
+        y1 = std::max(y1, ay1);
+    };
+
+    for (const OldRegion &Region : itsOldRegions)
+        Extend(Region.x0, Region.y0, Region.x1, Region.y1);
+
+    bool Packed = !itsOldRegions.empty();
+
+    if (!Packed && itsOldTiles.size() >= HISTORY_REGION_TILES) {
+        for (const auto &Old : itsOldTiles)
+            Extend(Old.first & 0xFFFF, Old.first >> 16, (Old.first & 0xFFFF) + 1, (Old.first >> 16) + 1);
+
+        Packed = static_cast<size_t>(x1 - x0) * (y1 - y0) <= itsOldTiles.size() * HISTORY_REGION_SPARSE;
+    }
+
+    auto InRegion = [&](int x, int y) { return Packed && x >= x0 && x < x1 && y >= y0 && y < y1; };
+
+    if (Packed) {
+        const int w = x1 - x0;
+        const size_t Count = static_cast<size_t>(w) * (y1 - y0);
+
+        if (Count * sizeof(TileRawStruct) > itsBudget) {
+            itsBroken = true;
+            return Step;
+        }
+
+        std::vector<TileRawStruct> Now(Count);
+        itsLevel.ReadTiles(x0, y0, x1, y1, Now.data());
+
+        // Alter Stand: was nicht angemeldet war, ist gleich geblieben. Früher Angemeldetes
+        // gewinnt, also die Rechtecke von hinten und die einzelnen Tiles zum Schluss
+        std::vector<TileRawStruct> Diff(Now);
+
+        for (auto Region = itsOldRegions.rbegin(); Region != itsOldRegions.rend(); ++Region) {
+            const int rw = Region->x1 - Region->x0;
+            for (int y = Region->y0; y < Region->y1; y++)
+                memcpy(&Diff[static_cast<size_t>(y - y0) * w + Region->x0 - x0],
+                       &Region->Tiles[static_cast<size_t>(y - Region->y0) * rw], rw * sizeof(TileRawStruct));
+        }
+
+        for (const auto &Old : itsOldTiles) {
+            const int x = Old.first & 0xFFFF;
+            const int y = Old.first >> 16;
+            if (InRegion(x, y))
+                Diff[static_cast<size_t>(y - y0) * w + x - x0] = Old.second;
+        }
+
+        bool Changed = false;
+        for (size_t n = 0; n < Count; n++) {
+            Diff[n] = XorTile(Diff[n], Now[n]);
+            Changed = Changed || !IsZero(Diff[n]);
+        }
+
+        if (Changed) {
+            Step.RegionX0 = x0;
+            Step.RegionY0 = y0;
+            Step.RegionX1 = x1;
+            Step.RegionY1 = y1;
+            LevelEncodeTiles(reinterpret_cast<const uint8_t *>(Diff.data()), static_cast<int>(Count), Step.Region);
+            Step.Region.shrink_to_fit();
+        }
+    }
+
+    // Der Rest einzeln
+    for (const auto &Old : itsOldTiles) {
+        const int x = Old.first & 0xFFFF;
+        const int y = Old.first >> 16;
+        if (InRegion(x, y))
+            continue;
+
+        TileRawStruct Now;
+        itsLevel.ReadTiles(x, y, x + 1, y + 1, &Now);
+
+        const TileRawStruct Diff = XorTile(Old.second, Now);
+        if (!IsZero(Diff))
+            Step.Tiles.push_back(HistoryTile{static_cast<uint16_t>(x), static_cast<uint16_t>(y), Diff});
+    }
+
+    std::sort(Step.Tiles.begin(), Step.Tiles.end(), [](const HistoryTile &a, const HistoryTile &b) {
+        return a.Y != b.Y ? a.Y < b.Y : a.X < b.X;
+    });
+    Step.Tiles.shrink_to_fit();
+
+    return Step;
+}
+
+// --------------------------------------------------------------------------------------
+// Undo / Redo
+// --------------------------------------------------------------------------------------
+
+bool EditHistoryClass::Undo() {
+    if (!CanUndo())
+        return false;
+
+    HistoryStep Step = std::move(itsUndo.back());
+    itsUndo.pop_back();
+
+    Apply(Step, true);
+    itsRedo.push_back(std::move(Step));
+    return true;
+}
+
+bool EditHistoryClass::Redo() {
+    if (!CanRedo())
+        return false;
+
+    HistoryStep Step = std::move(itsRedo.back());
+    itsRedo.pop_back();
+
+    Apply(Step, false);
+    itsUndo.push_back(std::move(Step));
+    return true;
+}
+
+void EditHistoryClass::Apply(const HistoryStep &Step, bool Backwards) {
+    // Tiles: XOR ist in beide Richtungen dasselbe
+    if (!Step.Region.empty()) {
+        const int x0 = Step.RegionX0, y0 = Step.RegionY0, x1 = Step.RegionX1, y1 = Step.RegionY1;
+        const size_t Count = static_cast<size_t>(x1 - x0) * (y1 - y0);
+
+        std::vector<TileRawStruct> Diff(Count);
+        std::vector<TileRawStruct> Tiles(Count);
+
+        if (LevelDecodeTiles(Step.Region.data(), Step.Region.size(), reinterpret_cast<uint8_t *>(Diff.data()),
+                             static_cast<int>(Count))) {
+            itsLevel.ReadTiles(x0, y0, x1, y1, Tiles.data());
+
+            for (size_t n = 0; n < Count; n++)
+                Tiles[n] = XorTile(Tiles[n], Diff[n]);
+
+            itsLevel.WriteTiles(x0, y0, x1, y1, Tiles.data());
+            itsJournal.RecordTiles(x0, y0, x1, y1, Tiles.data());
+        } else {
+            Protokoll << "-> Error: broken undo step at " << x0 << "/" << y0 << std::endl;
+        }
+    }
+
+    for (const HistoryTile &Tile : Step.Tiles) {
+        TileRawStruct Now;
+        itsLevel.ReadTiles(Tile.X, Tile.Y, Tile.X + 1, Tile.Y + 1, &Now);
+
+        Now = XorTile(Now, Tile.Diff);
+        itsLevel.WriteTiles(Tile.X, Tile.Y, Tile.X + 1, Tile.Y + 1, &Now);
+        itsJournal.RecordTile(Tile.X, Tile.Y, itsLevel.GetTile(Tile.X, Tile.Y));
+    }
+
+    // Objekte
+    for (const HistoryObject &Obj : Step.Objects) {
+        ObjectList.Objects[Obj.Index] = Backwards ? Obj.Old : Obj.New;
+        itsJournal.RecordObject(Obj.Index, ObjectList.Objects[Obj.Index]);
+    }
+
+    if (Step.OldCount != Step.NewCount) {
+        ObjectList.ObjectCount = Backwards ? Step.OldCount : Step.NewCount;
+        itsJournal.RecordObjectCount(ObjectList.ObjectCount);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+// Speicher
+// --------------------------------------------------------------------------------------
+
+void EditHistoryClass::Clear() {
+    itsUndo.clear();
+    itsRedo.clear();
+    itsBytes = 0;
+
+    itsOldTiles.clear();
+    itsOldRegions.clear();
+    itsOldObjects.clear();
+    itsOldCount = ObjectList.ObjectCount;
+}
+
+void EditHistoryClass::SetBudget(size_t Bytes) {
+    itsBudget = Bytes;
+    Trim();
+}
+
+void EditHistoryClass::Trim() {
+    // Erst die ältesten Undo-Schritte, dann die Redo-Schritte, die am weitesten weg sind
+    while (itsBytes > itsBudget && !itsUndo.empty()) {
+        itsBytes -= itsUndo.front().Bytes();
+        itsUndo.pop_front();
+    }
+
+    while (itsBytes > itsBudget && !itsRedo.empty()) {
+        itsBytes -= itsRedo.front().Bytes();
+        itsRedo.pop_front();
+    }
+}
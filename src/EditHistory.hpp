@@ -0,0 +1,153 @@
+// Datei : EditHistory.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Undo/Redo für Tile- und Objektänderungen im Editor
+//
+// Alles zwischen BeginStroke() und EndStroke() (im TileCanvas ein Strich von Maustaste
+// runter bis wieder hoch) wird ein einziger Schritt. Vor jeder Änderung meldet der
+// Aufrufer das Tile/Objekt mit Touch...() an, gemerkt wird dabei nur der alte Stand beim
+// ersten Mal. EndStroke() vergleicht mit dem neuen Stand und behält nur, was sich wirklich
+// geändert hat, als alt XOR neu. Dasselbe XOR macht einen Schritt rückgängig und wieder
+// neu, es muss also nur einmal gespeichert werden.
+//
+// Wenige Tiles stehen einzeln mit Position im Schritt. Bei grossen Änderungen (Füllen,
+// Einfügen: TouchRegion(), oder einfach ein sehr langer Strich) wird das ganze Rechteck
+// mit LevelEncodeTiles() gepackt wie die v2 Chunks. Unveränderte Tiles sind im XOR Null,
+// das packt sich fast weg. Zurückgeschrieben wird dann mit LevelClass::WriteTiles() in
+// einem Rutsch, auch 100000 Tiles brauchen so nur ein paar Millisekunden.
+//
+// Alle Schritte zusammen dürfen höchstens Budget() Bytes belegen, sonst fallen die
+// ältesten raus. Was Undo/Redo ändert, geht wie jede andere Änderung ins EditJournal.
+// Geänderte Objekte schreibt EndStroke() selbst ins Journal, Tiles meldet der Aufrufer.
+//
+// Das XOR passt nur, solange jede Änderung angemeldet wird. Ändert etwas Tiles ausserhalb
+// eines Strichs, wird die History verworfen.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _EDITHISTORY_HPP_
+#define _EDITHISTORY_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "ObjectList.hpp"
+#include "Level.hpp"
+
+class EditJournalClass;
+
+// --------------------------------------------------------------------------------------
+// Defines
+// --------------------------------------------------------------------------------------
+
+constexpr size_t HISTORY_BUDGET = 64 * 1024 * 1024;  // Standard für SetBudget(), in Bytes
+constexpr size_t HISTORY_REGION_TILES = 1024;        // ab so vielen Tiles lohnt ein gepacktes Rechteck,
+constexpr size_t HISTORY_REGION_SPARSE = 8;          // wenn darin mindestens jedes 8. Tile geändert ist
+
+// --------------------------------------------------------------------------------------
+// Strukturen
+// --------------------------------------------------------------------------------------
+
+// Ein einzeln gemerktes Tile, Levels sind höchstens MAX_LEVELSIZE_X/Y gross
+//
+struct HistoryTile {
+    uint16_t X;
+    uint16_t Y;
+    TileRawStruct Diff;  // alt XOR neu
+};
+
+struct HistoryObject {
+    uint32_t Index;
+    Object Old;
+    Object New;
+};
+
+// Ein Schritt, der mit einem Undo zurückgenommen wird
+//
+struct HistoryStep {
+    std::vector<HistoryTile> Tiles;  // ausserhalb des Rechtecks
+
+    int RegionX0 = 0;  // gepacktes Rechteck [X0, X1) x [Y0, Y1)
+    int RegionY0 = 0;
+    int RegionX1 = 0;
+    int RegionY1 = 0;
+    std::vector<uint8_t> Region;  // alt XOR neu zeilenweise, mit LevelEncodeTiles() gepackt
+
+    std::vector<HistoryObject> Objects;
+    uint32_t OldCount = 0;  // ObjectList.ObjectCount vorher und nachher
+    uint32_t NewCount = 0;
+
+    bool Empty() const { return Tiles.empty() && Region.empty() && Objects.empty() && OldCount == NewCount; }
+    size_t Bytes() const;
+};
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class EditHistoryClass {
+  public:
+    // Im Editor die TileEngine und EditJournal
+    EditHistoryClass(LevelClass &Level, EditJournalClass &Journal) : itsLevel(Level), itsJournal(Journal) {}
+
+    // Ein Schritt, die beiden dürfen auch verschachtelt werden
+    void BeginStroke();
+    void EndStroke();
+    bool InStroke() const { return itsDepth > 0; }
+
+    // Vor der Änderung aufrufen
+    void TouchTile(int x, int y);
+    void TouchRegion(int x0, int y0, int x1, int y1);  // [x0, x1) x [y0, y1)
+    void TouchObject(int Index);
+
+    // false, wenn es nichts zu tun gibt (oder gerade ein Strich läuft)
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const { return !itsUndo.empty() && itsDepth == 0; }
+    bool CanRedo() const { return !itsRedo.empty() && itsDepth == 0; }
+
+    void Clear();  // neues Level geladen
+
+    void SetBudget(size_t Bytes);
+    size_t Budget() const { return itsBudget; }
+    size_t Bytes() const { return itsBytes; }  // belegt von allen Schritten
+
+  private:
+    struct OldRegion {
+        int x0, y0, x1, y1;
+        std::vector<TileRawStruct> Tiles;
+    };
+
+    HistoryStep BuildStep();
+    void Apply(const HistoryStep &Step, bool Backwards);
+    void Trim();
+
+    LevelClass &itsLevel;
+    EditJournalClass &itsJournal;
+
+    std::deque<HistoryStep> itsUndo;  // hinten der neueste
+    std::deque<HistoryStep> itsRedo;  // hinten der nächste
+    size_t itsBytes = 0;
+    size_t itsBudget = HISTORY_BUDGET;
+
+    // Laufender Strich: alter Stand von allem, was angemeldet wurde
+    int itsDepth = 0;
+    std::unordered_map<uint32_t, TileRawStruct> itsOldTiles;  // Y << 16 | X
+    std::vector<OldRegion> itsOldRegions;
+    std::map<int, Object> itsOldObjects;
+    uint32_t itsOldCount = 0;
+    bool itsBroken = false;  // zu gross zum Merken, am Ende wird die History verworfen
+};
+
+// --------------------------------------------------------------------------------------
+// Externals
+// --------------------------------------------------------------------------------------
+
+extern EditHistoryClass EditHistory;
+
+#endif
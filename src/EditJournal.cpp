@@ -0,0 +1,398 @@
+// Datei : EditJournal.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Journal der Änderungen seit dem letzten Speichern (siehe EditJournal.hpp)
+//
+// --------------------------------------------------------------------------------------
+
+#include "EditJournal.hpp"
+
+#include <cstring>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include "Globals.hpp"
+#include "LevelFormat.hpp"
+#include "Logdatei.hpp"
+#include "MappedFile.hpp"
+
+static int64_t MapFileTime(const std::string &MapFilename) {
+    std::error_code ec;
+    const auto Time = fs::last_write_time(MapFilename, ec);
+    return ec ? 0 : static_cast<int64_t>(Time.time_since_epoch().count());
+}
+
+EditJournalClass::~EditJournalClass() {
+    Close();
+}
+
+// --------------------------------------------------------------------------------------
+// Öffnen / Schliessen
+// --------------------------------------------------------------------------------------
+
+int EditJournalClass::Open(const std::string &MapFilename) {
+    Close();
+
+    const std::string JournalFilename = MapFilename + JOURNAL_EXTENSION;
+    int Records = 0;
+
+    std::error_code ec;
+    if (fs::exists(JournalFilename, ec)) {
+        Records = Replay(JournalFilename);
+
+        if (Records < 0) {
+            Protokoll << "-> Journal " << JournalFilename << " does not belong to this level, discarding it"
+                      << std::endl;
+            Records = 0;
+        } else if (Records > 0) {
+            Protokoll << "-> Replayed " << Records << " unsaved edits from " << JournalFilename << std::endl;
+        }
+    }
+
+    // Wiederhergestellte Änderungen stehen noch nicht in der .map, also bleibt das alte
+    // Journal einfach liegen und wird weiter fortgeschrieben
+    if (Records > 0) {
+        itsFile = fopen(JournalFilename.c_str(), "ab");
+        if (itsFile == nullptr) {
+            Protokoll << "-> Error: could not open " << JournalFilename << std::endl;
+            return Records;
+        }
+        itsFilename = JournalFilename;
+    } else if (!Create(MapFilename)) {
+        return Records;
+    }
+
+    itsStop = false;
+    itsWriter = std::thread(&EditJournalClass::WriterThread, this);
+
+    return Records;
+}
+
+bool EditJournalClass::Create(const std::string &MapFilename) {
+    const std::string JournalFilename = MapFilename + JOURNAL_EXTENSION;
+
+    JournalHeader Header;
+    memcpy(Header.Magic, JOURNAL_MAGIC, sizeof(Header.Magic));
+    Header.Version = FixEndian(JOURNAL_VERSION);
+    Header.SizeX = FixEndian(static_cast<uint32_t>(itsLevel.LEVELSIZE_X));
+    Header.SizeY = FixEndian(static_cast<uint32_t>(itsLevel.LEVELSIZE_Y));
+    Header.Reserved = 0;
+    Header.MapTime = static_cast<int64_t>(FixEndian(static_cast<uint64_t>(MapFileTime(MapFilename))));
+
+    // Der Header muss genauso sicher auf der Platte sein wie die Datensätze danach
+    itsFile = fopen(JournalFilename.c_str(), "wb");
+    bool ok = itsFile != nullptr && fwrite(&Header, sizeof(Header), 1, itsFile) == 1 && fflush(itsFile) == 0;
+#if !defined(_WIN32)
+    ok = ok && fsync(fileno(itsFile)) == 0;
+#endif
+    if (!ok) {
+        Protokoll << "-> Error: could not create " << JournalFilename << std::endl;
+        if (itsFile != nullptr)
+            fclose(itsFile);
+        itsFile = nullptr;
+        return false;
+    }
+
+    itsFilename = JournalFilename;
+    return true;
+}
+
+void EditJournalClass::Close() {
+    if (itsWriter.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(itsMutex);
+            itsStop = true;
+        }
+        itsWake.notify_all();
+        itsWriter.join();
+    }
+
+    if (itsFile != nullptr)
+        fclose(itsFile);
+
+    itsFile = nullptr;
+    itsFilename.clear();
+    itsPending.clear();
+}
+
+void EditJournalClass::Compact(const std::string &MapFilename) {
+    const std::string OldFilename = itsFilename;
+
+    Close();
+
+    // Unter anderem Namen gespeichert? Dann gehören die alten Änderungen jetzt dorthin
+    std::error_code ec;
+    if (!OldFilename.empty() && OldFilename != MapFilename + JOURNAL_EXTENSION)
+        fs::remove(OldFilename, ec);
+
+    if (Create(MapFilename)) {
+        itsStop = false;
+        itsWriter = std::thread(&EditJournalClass::WriterThread, this);
+    }
+}
+
+// --------------------------------------------------------------------------------------
+// Journal abspielen
+// Gibt -1 zurück, wenn das Journal nicht zum geladenen Level passt
+// --------------------------------------------------------------------------------------
+
+int EditJournalClass::Replay(const std::string &JournalFilename) {
+    MappedFile Datei;
+
+    if (!Datei.Open(JournalFilename))
+        return -1;
+
+    const uint8_t *HeaderData = Datei.Range(0, sizeof(JournalHeader));
+    if (HeaderData == nullptr)
+        return -1;
+
+    JournalHeader Header;
+    memcpy(&Header, HeaderData, sizeof(Header));
+
+    const std::string MapFilename = JournalFilename.substr(0, JournalFilename.size() - strlen(JOURNAL_EXTENSION));
+
+    if (memcmp(Header.Magic, JOURNAL_MAGIC, sizeof(Header.Magic)) != 0 ||
+        FixEndian(Header.Version) != JOURNAL_VERSION ||
+        FixEndian(Header.SizeX) != static_cast<uint32_t>(itsLevel.LEVELSIZE_X) ||
+        FixEndian(Header.SizeY) != static_cast<uint32_t>(itsLevel.LEVELSIZE_Y) ||
+        static_cast<int64_t>(FixEndian(static_cast<uint64_t>(Header.MapTime))) != MapFileTime(MapFilename))
+        return -1;
+
+    // v2 Chunks, die noch gepackt sind, würden die Änderungen später überschreiben
+    itsLevel.PrepareAllTiles();
+
+    int Records = 0;
+    size_t Offset = sizeof(JournalHeader);
+
+    while (const uint8_t *RecordData = Datei.Range(Offset, sizeof(JournalRecordHeader))) {
+        JournalRecordHeader Record;
+        memcpy(&Record, RecordData, sizeof(Record));
+
+        const uint32_t Length = FixEndian(Record.Length);
+        const uint8_t *Data = Datei.Range(Offset + sizeof(Record), Length);
+
+        // Abgeschnitten oder kaputt: hier ist der Editor beim Schreiben abgestürzt
+        if (Data == nullptr || LevelCRC32(Data, Length) != FixEndian(Record.Checksum))
+            break;
+
+        if (Record.Type == JOURNAL_TILE && Length == sizeof(JournalTile)) {
+            JournalTile Tile;
+            memcpy(&Tile, Data, sizeof(Tile));
+
+            const uint32_t x = FixEndian(Tile.X);
+            const uint32_t y = FixEndian(Tile.Y);
+
+            if (x < static_cast<uint32_t>(itsLevel.LEVELSIZE_X) &&
+                y < static_cast<uint32_t>(itsLevel.LEVELSIZE_Y)) {
+                LevelTileStruct tile = itsLevel.GetTile(x, y);
+                tile.TileSetBack = Tile.TileSetBack;
+                tile.TileSetFront = Tile.TileSetFront;
+                tile.BackArt = Tile.BackArt;
+                tile.FrontArt = Tile.FrontArt;
+                tile.Red = Tile.Red;
+                tile.Green = Tile.Green;
+                tile.Blue = Tile.Blue;
+                tile.Alpha = Tile.Alpha;
+                tile.Block = FixEndian(Tile.Block);
+                itsLevel.SetTile(x, y, tile);
+            }
+        } else if (Record.Type == JOURNAL_TILES && Length >= sizeof(JournalTileRect)) {
+            JournalTileRect Rect;
+            memcpy(&Rect, Data, sizeof(Rect));
+
+            const uint32_t x0 = FixEndian(Rect.X);
+            const uint32_t y0 = FixEndian(Rect.Y);
+            const uint32_t w = FixEndian(Rect.Width);
+            const uint32_t h = FixEndian(Rect.Height);
+            const uint32_t TileBytes = sizeof(JournalTile) - 2 * sizeof(uint32_t);
+
+            if (static_cast<uint64_t>(x0) + w <= static_cast<uint64_t>(itsLevel.LEVELSIZE_X) &&
+                static_cast<uint64_t>(y0) + h <= static_cast<uint64_t>(itsLevel.LEVELSIZE_Y) &&
+                Length == sizeof(Rect) + static_cast<uint64_t>(w) * h * TileBytes) {
+                std::vector<TileRawStruct> Tiles(static_cast<size_t>(w) * h);
+                const uint8_t *Src = Data + sizeof(Rect);
+
+                for (TileRawStruct &Tile : Tiles) {
+                    memcpy(&Tile.Art, Src, sizeof(Tile.Art));
+                    memcpy(&Tile.Color, Src + 4, sizeof(Tile.Color));
+                    memcpy(&Tile.Block, Src + 8, sizeof(Tile.Block));
+                    Tile.Block = FixEndian(Tile.Block);
+                    Src += TileBytes;
+                }
+
+                itsLevel.WriteTiles(x0, y0, x0 + w, y0 + h, Tiles.data());
+            }
+        } else if (Record.Type == JOURNAL_OBJECT && Length == sizeof(JournalObject)) {
+            JournalObject Obj;
+            memcpy(&Obj, Data, sizeof(Obj));
+
+            const uint32_t Index = FixEndian(Obj.Index);
+
+            if (Index < MAX_GEGNER) {
+                Object &object = ObjectList.Objects[Index];
+                object.ObjectID = FixEndian(Obj.ObjectID);
+                object.XPos = FixEndian(Obj.XPos);
+                object.YPos = FixEndian(Obj.YPos);
+                object.ChangeLight = Obj.ChangeLight;
+                object.Skill = Obj.Skill;
+                object.Value1 = FixEndian(Obj.Value1);
+                object.Value2 = FixEndian(Obj.Value2);
+            }
+        } else if (Record.Type == JOURNAL_OBJECTCOUNT && Length == sizeof(uint32_t)) {
+            uint32_t Count;
+            memcpy(&Count, Data, sizeof(Count));
+            Count = FixEndian(Count);
+
+            if (Count <= MAX_GEGNER) {
+                for (uint32_t i = Count; i < MAX_GEGNER; i++)
+                    ObjectList.Objects[i] = {NULLENEMY, 0, 0, 0, 0, 0, 0};
+                ObjectList.ObjectCount = Count;
+            }
+        }
+
+        Offset += sizeof(Record) + Length;
+        Records++;
+    }
+
+    // Einen kaputten Rest abschneiden, sonst landen neue Datensätze dahinter
+    if (Offset < Datei.Size()) {
+        Datei.Close();
+
+        std::error_code ec;
+        fs::resize_file(JournalFilename, Offset, ec);
+    }
+
+    return Records;
+}
+
+// --------------------------------------------------------------------------------------
+// Datensätze anhängen
+// --------------------------------------------------------------------------------------
+
+void EditJournalClass::Append(uint8_t Type, const void *Data, uint32_t Length) {
+    if (itsFile == nullptr)
+        return;
+
+    JournalRecordHeader Record;
+    Record.Type = Type;
+    Record.Reserved[0] = Record.Reserved[1] = Record.Reserved[2] = 0;
+    Record.Length = FixEndian(Length);
+    Record.Checksum = FixEndian(LevelCRC32(static_cast<const uint8_t *>(Data), Length));
+
+    {
+        std::lock_guard<std::mutex> lock(itsMutex);
+        const uint8_t *RecordBytes = reinterpret_cast<const uint8_t *>(&Record);
+        itsPending.insert(itsPending.end(), RecordBytes, RecordBytes + sizeof(Record));
+        itsPending.insert(itsPending.end(), static_cast<const uint8_t *>(Data),
+                          static_cast<const uint8_t *>(Data) + Length);
+    }
+
+    itsWake.notify_one();
+}
+
+void EditJournalClass::RecordTile(int x, int y, const LevelTileStruct &Tile) {
+    JournalTile Data;
+    Data.X = FixEndian(static_cast<uint32_t>(x));
+    Data.Y = FixEndian(static_cast<uint32_t>(y));
+    Data.TileSetBack = Tile.TileSetBack;
+    Data.TileSetFront = Tile.TileSetFront;
+    Data.BackArt = Tile.BackArt;
+    Data.FrontArt = Tile.FrontArt;
+    Data.Red = Tile.Red;
+    Data.Green = Tile.Green;
+    Data.Blue = Tile.Blue;
+    Data.Alpha = Tile.Alpha;
+    Data.Block = FixEndian(Tile.Block);
+
+    Append(JOURNAL_TILE, &Data, sizeof(Data));
+}
+
+void EditJournalClass::RecordTiles(int x0, int y0, int x1, int y1, const TileRawStruct *Tiles) {
+    if (itsFile == nullptr || x0 >= x1 || y0 >= y1)
+        return;
+
+    const size_t Count = static_cast<size_t>(x1 - x0) * (y1 - y0);
+    const size_t TileBytes = sizeof(JournalTile) - 2 * sizeof(uint32_t);
+
+    JournalTileRect Rect;
+    Rect.X = FixEndian(static_cast<uint32_t>(x0));
+    Rect.Y = FixEndian(static_cast<uint32_t>(y0));
+    Rect.Width = FixEndian(static_cast<uint32_t>(x1 - x0));
+    Rect.Height = FixEndian(static_cast<uint32_t>(y1 - y0));
+
+    std::vector<uint8_t> Data(sizeof(Rect) + Count * TileBytes);
+    memcpy(Data.data(), &Rect, sizeof(Rect));
+
+    // Gleiche Reihenfolge wie JournalTile: Tilesets/Arten, Farbe, Block
+    uint8_t *Dst = Data.data() + sizeof(Rect);
+    for (size_t n = 0; n < Count; n++, Dst += TileBytes) {
+        const uint32_t Block = FixEndian(Tiles[n].Block);
+        memcpy(Dst, &Tiles[n].Art, sizeof(Tiles[n].Art));
+        memcpy(Dst + 4, &Tiles[n].Color, sizeof(Tiles[n].Color));
+        memcpy(Dst + 8, &Block, sizeof(Block));
+    }
+
+    Append(JOURNAL_TILES, Data.data(), static_cast<uint32_t>(Data.size()));
+}
+
+void EditJournalClass::RecordObject(int Index, const Object &object) {
+    JournalObject Data;
+    Data.Index = FixEndian(static_cast<uint32_t>(Index));
+    Data.ObjectID = FixEndian(object.ObjectID);
+    Data.XPos = FixEndian(object.XPos);
+    Data.YPos = FixEndian(object.YPos);
+    Data.ChangeLight = object.ChangeLight;
+    Data.Skill = object.Skill;
+    Data.Reserved[0] = Data.Reserved[1] = 0;
+    Data.Value1 = FixEndian(object.Value1);
+    Data.Value2 = FixEndian(object.Value2);
+
+    Append(JOURNAL_OBJECT, &Data, sizeof(Data));
+}
+
+void EditJournalClass::RecordObjectCount(int Count) {
+    const uint32_t Data = FixEndian(static_cast<uint32_t>(Count));
+    Append(JOURNAL_OBJECTCOUNT, &Data, sizeof(Data));
+}
+
+// --------------------------------------------------------------------------------------
+// Schreib-Thread
+// Alles, was während eines fsync() dazukommt, geht beim nächsten Mal in einem Stück raus
+// --------------------------------------------------------------------------------------
+
+void EditJournalClass::WriterThread() {
+    std::unique_lock<std::mutex> lock(itsMutex);
+
+    for (;;) {
+        itsWake.wait(lock, [this] { return itsStop || !itsPending.empty(); });
+
+        if (itsPending.empty())
+            break;  // itsStop und nichts mehr zu tun
+
+        std::vector<uint8_t> Batch;
+        Batch.swap(itsPending);
+        itsWriting = true;
+        lock.unlock();
+
+        bool ok = fwrite(Batch.data(), 1, Batch.size(), itsFile) == Batch.size() && fflush(itsFile) == 0;
+#if !defined(_WIN32)
+        ok = ok && fsync(fileno(itsFile)) == 0;
+#endif
+        if (!ok)
+            Protokoll << "-> Error: could not write edit journal " << itsFilename << std::endl;
+
+        lock.lock();
+        itsWriting = false;
+        itsFlushed.notify_all();
+    }
+}
+
+void EditJournalClass::Flush() {
+    std::unique_lock<std::mutex> lock(itsMutex);
+    itsFlushed.wait(lock, [this] { return !itsWriter.joinable() || (itsPending.empty() && !itsWriting); });
+}
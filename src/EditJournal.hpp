@@ -0,0 +1,164 @@
+// Datei : EditJournal.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Journal der Änderungen seit dem letzten Speichern (<level>.journal)
+//
+// Jede Tile- und Objektänderung wird als kleiner Datensatz hinten an die Datei
+// angehängt. Ein eigener Thread schreibt alles, was sich inzwischen angesammelt hat, in
+// einem Rutsch und wartet dann auf die Platte (group commit). Stürzt der Editor ab,
+// wird das Journal beim nächsten Laden des Levels einfach wieder abgespielt. Nach dem
+// Speichern ist alles in der .map, das Journal wird dann wieder geleert.
+//
+// Aufbau:
+//   JournalHeader
+//   beliebig viele { JournalRecordHeader, Daten }, jeweils mit CRC32 der Daten
+//
+// Ein halb geschriebener letzter Datensatz (Absturz mitten im Schreiben) fällt über
+// Länge/Checksumme auf, das Abspielen hört dann dort auf.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _EDITJOURNAL_HPP_
+#define _EDITJOURNAL_HPP_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ObjectList.hpp"
+#include "Level.hpp"
+
+// --------------------------------------------------------------------------------------
+// Defines
+// --------------------------------------------------------------------------------------
+
+constexpr char JOURNAL_MAGIC[8] = {'H', 'U', 'R', 'R', 'J', 'N', 'L', '\0'};
+constexpr uint32_t JOURNAL_VERSION = 1;
+constexpr char JOURNAL_EXTENSION[] = ".journal";
+
+enum : uint8_t {
+    JOURNAL_TILE = 1,         // ein Tile wurde geändert
+    JOURNAL_OBJECT = 2,       // ein Objekt wurde geändert
+    JOURNAL_OBJECTCOUNT = 3,  // Anzahl der Objekte hat sich geändert
+    JOURNAL_TILES = 4,        // ein ganzes Rechteck von Tiles (Undo/Redo)
+};
+
+// --------------------------------------------------------------------------------------
+// Strukturen (alle Werte little endian, wie in der .map)
+// --------------------------------------------------------------------------------------
+
+struct JournalHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t SizeX;    // Grösse des Levels, auf das sich das Journal bezieht
+    uint32_t SizeY;
+    uint32_t Reserved;
+    int64_t MapTime;   // Änderungszeit der .map beim Anlegen, sonst passt das Journal nicht
+};
+
+static_assert(sizeof(JournalHeader) == 32, "Size of JournalHeader is wrong");
+
+struct JournalRecordHeader {
+    uint8_t Type;
+    uint8_t Reserved[3];
+    uint32_t Length;    // Länge der Daten danach
+    uint32_t Checksum;  // CRC32 der Daten
+};
+
+static_assert(sizeof(JournalRecordHeader) == 12, "Size of JournalRecordHeader is wrong");
+
+struct JournalTile {
+    uint32_t X;
+    uint32_t Y;
+    uint8_t TileSetBack;
+    uint8_t TileSetFront;
+    uint8_t BackArt;
+    uint8_t FrontArt;
+    uint8_t Red;
+    uint8_t Green;
+    uint8_t Blue;
+    uint8_t Alpha;
+    uint32_t Block;  // wie im Speicher, also inklusive BLOCKWERT_LIQUID
+};
+
+static_assert(sizeof(JournalTile) == 20, "Size of JournalTile is wrong");
+
+// Danach Width * Height mal JournalTile ohne X/Y, zeilenweise
+struct JournalTileRect {
+    uint32_t X;
+    uint32_t Y;
+    uint32_t Width;
+    uint32_t Height;
+};
+
+static_assert(sizeof(JournalTileRect) == 16, "Size of JournalTileRect is wrong");
+
+struct JournalObject {
+    uint32_t Index;
+    uint32_t ObjectID;
+    int32_t XPos;
+    int32_t YPos;
+    uint8_t ChangeLight;
+    uint8_t Skill;
+    uint8_t Reserved[2];
+    int32_t Value1;
+    int32_t Value2;
+};
+
+static_assert(sizeof(JournalObject) == 28, "Size of JournalObject is wrong");
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class EditJournalClass {
+  public:
+    explicit EditJournalClass(LevelClass &Level) : itsLevel(Level) {}  // im Editor die TileEngine
+    ~EditJournalClass();
+
+    // Journal zum gerade geladenen Level öffnen und, falls noch eins vom letzten Mal
+    // da ist, auf das Level/ObjectList abspielen. Gibt die Zahl der Datensätze zurück.
+    int Open(const std::string &MapFilename);
+    void Close();
+
+    // Nach dem Speichern: alles steht in MapFilename, also mit leerem Journal neu anfangen
+    void Compact(const std::string &MapFilename);
+
+    void RecordTile(int x, int y, const LevelTileStruct &Tile);
+    void RecordTiles(int x0, int y0, int x1, int y1, const TileRawStruct *Tiles);  // wie LevelClass::ReadTiles()
+    void RecordObject(int Index, const Object &object);
+    void RecordObjectCount(int Count);
+
+    void Flush();  // wartet, bis alles auf der Platte ist
+
+  private:
+    void Append(uint8_t Type, const void *Data, uint32_t Length);
+    int Replay(const std::string &JournalFilename);
+    bool Create(const std::string &MapFilename);
+    void WriterThread();
+
+    LevelClass &itsLevel;     // darauf wird abgespielt
+    std::string itsFilename;  // Pfad des Journals (leer = keins offen)
+    FILE *itsFile = nullptr;
+
+    std::thread itsWriter;
+    std::mutex itsMutex;
+    std::condition_variable itsWake;     // neue Daten oder Ende
+    std::condition_variable itsFlushed;  // ein Schub ist geschrieben
+    std::vector<uint8_t> itsPending;     // noch nicht geschriebene Datensätze
+    bool itsWriting = false;
+    bool itsStop = false;
+};
+
+// --------------------------------------------------------------------------------------
+// Externals
+// --------------------------------------------------------------------------------------
+
+extern EditJournalClass EditJournal;
+
+#endif
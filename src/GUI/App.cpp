@@ -4,9 +4,16 @@
 
 #include "DX8Graphics.hpp"
 #include "DX8Texture.hpp"
+#include "EditHistory.hpp"
+#include "EditJournal.hpp"
+#include "LevelLoader.hpp"
+#include "LevelScanner.hpp"
 #include "Logdatei.hpp"
 #include "MainFrame.hpp"
+#include "ObjectGraphics.hpp"
 #include "ObjectList.hpp"
+#include "Thumbnail.hpp"
+#include "TilePager.hpp"
 #include "Tileengine.hpp"
 #include "Timer.hpp"
 
@@ -21,12 +28,50 @@ TexturesystemClass Textures;
 TimerClass Timer;
 TileEngineClass TileEngine;
 ObjectListClass ObjectList;
+ObjectGraphicsClass ObjectGraphics;
+LevelLoaderClass LevelLoader;
+LevelScannerClass LevelScanner;
+ThumbnailClass Thumbnails;
+EditJournalClass EditJournal(TileEngine);
+EditHistoryClass EditHistory(TileEngine, EditJournal);
 
 MainFrame* frame;
 
 bool App::OnInit() {
+  // editor --page-dir <dir>: swap files of large levels go there instead of next to the level
+  for (int n = 1; n + 1 < argc; n++)
+    if (argv[n] == "--page-dir") TilePager::SetDirectory(argv[n + 1].ToStdString());
+
   wxInitAllImageHandlers();
 
+  // Header infos from earlier sessions, the level browser only reads changed maps
+  LevelScanner.LoadCache(LEVELSCAN_CACHEFILE);
+
+  // Thumbnails only need the average color of every tile, wxImage can decode
+  // the tilesets without a GL context
+  Thumbnails.SetTexturePath(g_storage_ext + "/data/textures");
+  Thumbnails.SetCachePath("thumbnails");
+  Thumbnails.SetDecoder([](const std::string& path, std::vector<uint8_t>& pixels,
+                           int& width, int& height) {
+    wxImage image;
+    if (!image.LoadFile(path, wxBITMAP_TYPE_PNG)) return false;
+    if (!image.HasAlpha()) image.InitAlpha();
+
+    width = image.GetWidth();
+    height = image.GetHeight();
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+
+    const unsigned char* rgb = image.GetData();
+    const unsigned char* alpha = image.GetAlpha();
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+      pixels[i * 4 + 0] = rgb[i * 3 + 0];
+      pixels[i * 4 + 1] = rgb[i * 3 + 1];
+      pixels[i * 4 + 2] = rgb[i * 3 + 2];
+      pixels[i * 4 + 3] = alpha[i];
+    }
+    return true;
+  });
+
   frame = new MainFrame("Hurrican Editor");
   frame->SetClientSize(800, 600);
   frame->Center();
@@ -34,6 +79,18 @@ bool App::OnInit() {
 
   frame->Init();
 
+#ifdef HURRICANEDITOR_BENCH
+  // editor --bench-pan [frames] [scale]: jungle.map diagonal durchscrollen, ohne und mit
+  // Batching. Scale 0 = ganz herausgezoomt
+  if (argc >= 2 && argv[1] == "--bench-pan") {
+    long frames = 600;
+    double scale = 1.0;
+    if (argc >= 3) argv[2].ToLong(&frames);
+    if (argc >= 4) argv[3].ToCDouble(&scale);
+    frame->canvas->StartPanBenchmark(static_cast<int>(frames), static_cast<float>(scale));
+  }
+#endif
+
   Connect(wxID_ANY, wxEVT_IDLE, wxIdleEventHandler(App::OnIdle));
   return true;
 }
@@ -56,14 +56,7 @@ void EditMenu::Init() {
   tileSet->SetBackgroundColour(wxColor(0, 0, 0));
   controls->SetBackgroundColour(wxColor(200, 100, 100));
 
-  for (auto& loadedTileSet : TileEngine.LoadedTilesetPathsWithID) {
-    // TODO: make non hardcoded
-    tileSet->LoadTileSet(
-        wxString::Format("../data/textures/%s", loadedTileSet.first),
-        loadedTileSet.second, wxBITMAP_TYPE_PNG);
-    setsChoice->Append(loadedTileSet.first);
-  }
-  setsChoice->Select(0);
+  ReloadTileSets();
 
   auto font =
       wxFont(18, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_NORMAL, wxFONTWEIGHT_NORMAL);
@@ -126,6 +119,22 @@ void EditMenu::Init() {
   });
 }
 
+void EditMenu::ReloadTileSets() {
+  tileSet->Clear();
+  setsChoice->Clear();
+
+  for (auto& loadedTileSet : TileEngine.LoadedTilesetPathsWithID) {
+    // TODO: make non hardcoded
+    tileSet->LoadTileSet(
+        wxString::Format("../data/textures/%s", loadedTileSet.first),
+        loadedTileSet.second, wxBITMAP_TYPE_PNG);
+    setsChoice->Append(loadedTileSet.first);
+  }
+  setsChoice->Select(0);
+
+  if (!setsChoice->IsEmpty()) tileSet->Select(setsChoice->GetString(0));
+}
+
 uint32_t EditMenu::getBlockFlags() {
   uint32_t flags = 0;
 
@@ -10,6 +10,10 @@ enum IDs {
   ID_EDITOR_MODE_BACK = 7,
   ID_EDITOR_MODE_OBJECTS = 8,
   ID_EDITOR_MODE_VIEW = 9,
+  ID_CANCEL_LOAD = 10,
+  ID_BROWSE = 11,
+  ID_LIGHTMAP = 12,
+  ID_INSTANCING = 13,
 };
 
 #endif
@@ -0,0 +1,140 @@
+#include "LevelBrowser.hpp"
+
+#include <wx/filename.h>
+#include <wx/wx.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "LevelScanner.hpp"
+#include "Logdatei.hpp"
+#include "Thumbnail.hpp"
+
+constexpr int PREVIEW_SIZE = 256;
+
+enum LevelBrowserColumns {
+  COLUMN_FILE,
+  COLUMN_DESCRIPTION,
+  COLUMN_SIZE,
+  COLUMN_OBJECTS,
+  COLUMN_TILESETS,
+  COLUMN_SONG,
+};
+
+LevelBrowser::LevelBrowser(wxWindow* parent, const wxString& directory)
+    : wxDialog(parent, wxID_ANY, "Levels in " + directory, wxDefaultPosition,
+               wxSize(900, 500), wxDEFAULT_DIALOG_STYLE | wxRESIZE_BORDER),
+      directory(directory) {
+  list = new wxListCtrl(this, wxID_ANY, wxDefaultPosition, wxDefaultSize,
+                        wxLC_REPORT | wxLC_SINGLE_SEL);
+  list->AppendColumn("File", wxLIST_FORMAT_LEFT, 180);
+  list->AppendColumn("Description", wxLIST_FORMAT_LEFT, 220);
+  list->AppendColumn("Size", wxLIST_FORMAT_RIGHT, 80);
+  list->AppendColumn("Objects", wxLIST_FORMAT_RIGHT, 60);
+  list->AppendColumn("Tilesets", wxLIST_FORMAT_LEFT, 220);
+  list->AppendColumn("Song", wxLIST_FORMAT_LEFT, 120);
+
+  summary = new wxStaticText(this, wxID_ANY, "");
+  preview = new wxStaticBitmap(this, wxID_ANY, wxNullBitmap, wxDefaultPosition,
+                               wxSize(PREVIEW_SIZE, PREVIEW_SIZE));
+
+  auto listSizer = new wxBoxSizer(wxHORIZONTAL);
+  listSizer->Add(list, 1, wxEXPAND);
+  listSizer->Add(preview, 0, wxLEFT, 5);
+
+  auto sizer = new wxBoxSizer(wxVERTICAL);
+  sizer->Add(listSizer, 1, wxEXPAND | wxALL, 5);
+  sizer->Add(summary, 0, wxEXPAND | wxLEFT | wxRIGHT, 5);
+  sizer->Add(CreateButtonSizer(wxOK | wxCANCEL), 0, wxEXPAND | wxALL, 5);
+  SetSizer(sizer);
+
+  // clang-format off
+  list->Bind(wxEVT_LIST_ITEM_ACTIVATED, [&](auto&) { EndModal(wxID_OK); });
+  list->Bind(wxEVT_LIST_ITEM_SELECTED,
+             [&](wxListEvent& evt) { ShowPreview(evt.GetIndex()); });
+  // clang-format on
+
+  Scan();
+}
+
+void LevelBrowser::Scan() {
+  auto start = std::chrono::steady_clock::now();
+  infos = LevelScanner.Scan(
+      LevelScannerClass::ListPack(directory.ToStdString()));
+  auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start)
+                .count();
+
+  if (LevelScanner.GetFilesRead() > 0) LevelScanner.SaveCache(LEVELSCAN_CACHEFILE);
+
+  list->DeleteAllItems();
+  for (size_t i = 0; i < infos.size(); i++) {
+    const auto& info = infos[i];
+    wxFileName name(info.Filename);
+    name.MakeRelativeTo(directory);
+
+    long item = list->InsertItem(static_cast<long>(i), name.GetFullPath());
+    if (!info.Valid) {
+      list->SetItem(item, COLUMN_DESCRIPTION, "(unreadable)");
+      list->SetItemTextColour(item, *wxRED);
+      continue;
+    }
+
+    wxString tilesets;
+    for (int t = 0; t < info.UsedTilesets(); t++) {
+      if (t > 0) tilesets += ", ";
+      tilesets += info.Tileset(t);
+    }
+
+    list->SetItem(item, COLUMN_DESCRIPTION, info.Description());
+    list->SetItem(item, COLUMN_SIZE,
+                  wxString::Format("%dx%d", info.SizeX(), info.SizeY()));
+    list->SetItem(item, COLUMN_OBJECTS,
+                  wxString::Format("%d", info.NumObjects()));
+    list->SetItem(item, COLUMN_TILESETS, tilesets);
+    list->SetItem(item, COLUMN_SONG, info.Song(0));
+  }
+
+  summary->SetLabel(wxString::Format("%zu levels, %zu read from disk, %lld ms",
+                                     infos.size(),
+                                     LevelScanner.GetFilesRead(),
+                                     static_cast<long long>(ms)));
+  Protokoll << "-> Level browser: " << infos.size() << " levels in "
+            << directory.ToStdString() << ", " << LevelScanner.GetFilesRead()
+            << " read, " << ms << " ms" << std::endl;
+}
+
+void LevelBrowser::ShowPreview(long item) {
+  LevelThumbnail thumbnail;
+  if (item < 0 || item >= static_cast<long>(infos.size()) ||
+      !infos[item].Valid ||
+      !Thumbnails.Render(infos[item].Filename, PREVIEW_SIZE, thumbnail)) {
+    preview->SetBitmap(wxNullBitmap);
+    return;
+  }
+
+  wxImage image(thumbnail.Width, thumbnail.Height);
+  unsigned char* rgb = image.GetData();
+  for (size_t i = 0; i < static_cast<size_t>(thumbnail.Width) * thumbnail.Height;
+       i++) {
+    rgb[i * 3 + 0] = thumbnail.Pixels[i * 4 + 0];
+    rgb[i * 3 + 1] = thumbnail.Pixels[i * 4 + 1];
+    rgb[i * 3 + 2] = thumbnail.Pixels[i * 4 + 2];
+  }
+
+  // Small levels get one pixel per tile, blow them up without smoothing
+  float scale = static_cast<float>(PREVIEW_SIZE) /
+                std::max(thumbnail.Width, thumbnail.Height);
+  if (scale > 1.0f)
+    image.Rescale(static_cast<int>(thumbnail.Width * scale),
+                  static_cast<int>(thumbnail.Height * scale),
+                  wxIMAGE_QUALITY_NEAREST);
+
+  preview->SetBitmap(wxBitmap(image));
+}
+
+wxString LevelBrowser::GetSelectedPath() const {
+  long item = list->GetNextItem(-1, wxLIST_NEXT_ALL, wxLIST_STATE_SELECTED);
+  if (item < 0 || item >= static_cast<long>(infos.size())) return {};
+  return infos[item].Filename;
+}
@@ -0,0 +1,32 @@
+#ifndef LEVEL_BROWSER_HPP_
+#define LEVEL_BROWSER_HPP_
+
+#include <wx/listctrl.h>
+#include <wx/wx.h>
+
+#include <string>
+#include <vector>
+
+#include "LevelScanner.hpp"
+
+// Lists every level of a pack with the infos from its header and appendix,
+// without loading any of them
+class LevelBrowser : public wxDialog {
+ public:
+  LevelBrowser(wxWindow* parent, const wxString& directory);
+
+  wxString GetSelectedPath() const;
+
+ private:
+  void Scan();
+  void ShowPreview(long item);
+
+  wxString directory;
+  std::vector<LevelInfo> infos;
+
+  wxListCtrl* list;
+  wxStaticBitmap* preview;
+  wxStaticText* summary;
+};
+
+#endif
@@ -2,19 +2,30 @@
 
 #include <wx/wx.h>
 
+#include "EditHistory.hpp"
+#include "EditJournal.hpp"
 #include "GUI/EditMenu.hpp"
 #include "GUI/IDs.hpp"
+#include "GUI/LevelBrowser.hpp"
 #include "GUI/TileCanvas.hpp"
+#include "LevelLoader.hpp"
 #include "Tileengine.hpp"
 
 MainFrame::MainFrame(const wxString& title)
     : wxFrame(nullptr, wxID_ANY, title) {
   auto menuFile = new wxMenu;
   menuFile->Append(ID_LOAD, "&Load Map", "Opens a Hurrican map file");
+  menuFile->Append(ID_BROWSE, "&Browse Levels",
+                   "Lists all maps of a level pack with their description");
+  menuFile->Append(ID_CANCEL_LOAD, "&Cancel Loading\tEsc",
+                   "Stops loading a map, the current map stays open");
   menuFile->AppendSeparator();
   menuFile->Append(ID_SAVE, "&Save Map", "Saves a Hurrican map file to a path");
   menuFile->AppendSeparator();
   menuFile->Append(wxID_EXIT);
+  auto menuEdit = new wxMenu;
+  menuEdit->Append(wxID_UNDO, "&Undo\tCtrl+Z", "Takes back the last edit");
+  menuEdit->Append(wxID_REDO, "&Redo\tCtrl+Y", "Does the last undone edit again");
   auto menuEditor = new wxMenu;
   menuEditor->Append(ID_RESET_ZOOM, "&Reset Zoom",
                      "Sets the Zoom of the Level back to 1.0");
@@ -26,16 +37,30 @@ MainFrame::MainFrame(const wxString& title)
                      "Changes the editor mode to 'objects'");
   menuEditor->Append(ID_EDITOR_MODE_VIEW, "&EM: view",
                      "Changes the editor mode to 'view'");
+  menuEditor->AppendSeparator();
+  menuEditor->AppendCheckItem(
+      ID_LIGHTMAP, "&Lightmap",
+      "Lights tiles from a level texture in the shader instead of corner colors");
+  menuEditor->AppendCheckItem(
+      ID_INSTANCING, "&Instanced Tiles",
+      "Draws tiles as one instance each (needs the lightmap and OpenGL 3.3)");
 
   auto menuBar = new wxMenuBar;
   menuBar->Append(menuFile, "&File");
+  menuBar->Append(menuEdit, "&Edit");
   menuBar->Append(menuEditor, "&Editor");
   SetMenuBar(menuBar);
+  CreateStatusBar();
 
   // clang-format off
   Bind(wxEVT_MENU, [&](auto&) { LoadLevel(); }, ID_LOAD);
+  Bind(wxEVT_MENU, [&](auto&) { BrowseLevels(); }, ID_BROWSE);
+  Bind(wxEVT_MENU, [&](auto&) { CancelLoad(); }, ID_CANCEL_LOAD);
   Bind(wxEVT_MENU, [&](auto&) { SaveLevel(); }, ID_SAVE);
 
+  Bind(wxEVT_MENU, [&](auto&) { Undo(); }, wxID_UNDO);
+  Bind(wxEVT_MENU, [&](auto&) { Redo(); }, wxID_REDO);
+
   Bind(wxEVT_MENU, [&](auto&) { ResetZoom(); }, ID_RESET_ZOOM);
   Bind(wxEVT_MENU, [&](auto&) { canvas->editMode = EDIT_MODE_FRONT; },
       ID_EDITOR_MODE_FRONT);
@@ -45,6 +70,10 @@ MainFrame::MainFrame(const wxString& title)
       ID_EDITOR_MODE_OBJECTS);
   Bind(wxEVT_MENU, [&](auto&) { canvas->editMode = EDIT_MODE_VIEW; },
       ID_EDITOR_MODE_VIEW);
+  Bind(wxEVT_MENU, [&](wxCommandEvent& evt) { TileEngine.SetLightMap(evt.IsChecked()); },
+      ID_LIGHTMAP);
+  Bind(wxEVT_MENU, [&](wxCommandEvent& evt) { TileEngine.SetInstancing(evt.IsChecked()); },
+      ID_INSTANCING);
   // clang-format on
 
   mainSplitter =
@@ -58,19 +87,54 @@ MainFrame::MainFrame(const wxString& title)
 
 void MainFrame::LoadLevel() {
   wxFileDialog fileDialog(this, _("Open map File"), "../data/levels", "",
-                          "map files (*.map)|*.map",
+                          "map files (*.map;*.map2)|*.map;*.map2",
                           wxFD_OPEN | wxFD_FILE_MUST_EXIST);
   if (fileDialog.ShowModal() == wxID_CANCEL) return;
   Protokoll << fileDialog.GetPath().ToStdString() << std::endl;
-  TileEngine.LoadLevel(fileDialog.GetPath().ToStdString());
+
+  // The canvas keeps drawing the old map until TileCanvas::Update() swaps it
+  LevelLoader.Start(fileDialog.GetPath().ToStdString());
+}
+
+void MainFrame::BrowseLevels() {
+  wxDirDialog dirDialog(this, _("Choose level pack"), "../data/levels",
+                        wxDD_DEFAULT_STYLE | wxDD_DIR_MUST_EXIST);
+  if (dirDialog.ShowModal() == wxID_CANCEL) return;
+
+  LevelBrowser browser(this, dirDialog.GetPath());
+  if (browser.ShowModal() != wxID_OK) return;
+
+  auto path = browser.GetSelectedPath();
+  if (path.empty()) return;
+
+  Protokoll << path.ToStdString() << std::endl;
+  LevelLoader.Start(path.ToStdString());
+}
+
+void MainFrame::CancelLoad() {
+  if (!LevelLoader.IsBusy()) return;
+
+  LevelLoader.Cancel();
+  SetStatusText("Loading cancelled");
 }
 
 void MainFrame::SaveLevel() {
   wxFileDialog fileDialog(this, _("Save map File"), "../data/levels", "",
-                          "map files (*.map)|*.map",
+                          "map files (*.map)|*.map|v2 map files (*.map2)|*.map2",
                           wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
   if (fileDialog.ShowModal() == wxID_CANCEL) return;
-  TileEngine.SaveLevel(fileDialog.GetPath().ToStdString());
+
+  // Everything in the journal is in the map now
+  auto path = fileDialog.GetPath().ToStdString();
+  if (TileEngine.SaveLevel(path)) EditJournal.Compact(path);
+}
+
+void MainFrame::Undo() {
+  if (!EditHistory.Undo()) SetStatusText("Nothing to undo");
+}
+
+void MainFrame::Redo() {
+  if (!EditHistory.Redo()) SetStatusText("Nothing to redo");
 }
 
 void MainFrame::ResetZoom() { TileEngine.ZoomBy(1.0f - TileEngine.Scale); }
@@ -17,7 +17,11 @@ class MainFrame : public wxFrame {
 
  private:
   void LoadLevel();
+  void BrowseLevels();
+  void CancelLoad();
   void SaveLevel();
+  void Undo();
+  void Redo();
   void ResetZoom();
 
   wxSplitterWindow* mainSplitter;
@@ -1,6 +1,7 @@
 #include "TileCanvas.hpp"
 
 #include <epoxy/gl.h>
+#include <algorithm>
 #include <wx/event.h>
 #include <wx/glcanvas.h>
 #include <wx/window.h>
@@ -8,7 +9,11 @@
 
 #include "DX8Graphics.hpp"
 #include "DX8Sprite.hpp"
+#include "EditHistory.hpp"
+#include "EditJournal.hpp"
 #include "GUI/App.hpp"
+#include "LevelLoader.hpp"
+#include "ObjectGraphics.hpp"
 #include "ObjectList.hpp"
 #include "Tileengine.hpp"
 #include "Timer.hpp"
@@ -33,10 +38,16 @@ TileCanvas::TileCanvas(wxWindow* parent)
   Protokoll << "\n-> OpenGL init successful!\n" << std::endl;
 
   TileEngine.LoadSprites();
-  TileEngine.LoadLevel(g_storage_ext + "/data/levels/jungle.map");
+  LevelLoader.Start(g_storage_ext + "/data/levels/jungle.map");
 
   editMode = EDIT_MODE_VIEW;
 
+#ifdef HURRICANEDITOR_BENCH
+  benchFrames = 0;
+  benchFrame = 0;
+  benchScale = 1.0f;
+#endif
+
   Bind(wxEVT_SIZE, [&](wxSizeEvent& evt) {
     auto size = this->GetSize();
     DirectGraphics.ResizeToWindow(size.GetWidth(), size.GetHeight());
@@ -46,7 +57,8 @@ TileCanvas::TileCanvas(wxWindow* parent)
   mouseLeft = false;
   mouseRight = false;
   Bind(wxEVT_LEFT_DOWN, [&](wxMouseEvent& evt) {
-    mouseLeft = true;
+    // Everything until the button goes up again is one undo step
+    BeginStroke();
     if (evt.AltDown()) {
       TryRemove();
     } else {
@@ -55,9 +67,10 @@ TileCanvas::TileCanvas(wxWindow* parent)
     evt.Skip();
   });
   Bind(wxEVT_LEFT_UP, [&](wxMouseEvent& evt) {
-    mouseLeft = false;
+    EndStroke();
     evt.Skip();
   });
+  Bind(wxEVT_MOUSE_CAPTURE_LOST, [&](wxMouseCaptureLostEvent&) { EndStroke(); });
   Bind(wxEVT_RIGHT_DOWN, [&](wxMouseEvent& evt) {
     mouseRight = true;
     evt.Skip();
@@ -97,49 +110,86 @@ TileCanvas::TileCanvas(wxWindow* parent)
 }
 
 void TileCanvas::PlaceBlock(wxPoint pos, LevelTileStruct tile) {
-  TileEngine.Tiles[pos.x][pos.y] = tile;
+  EditHistory.TouchTile(pos.x, pos.y);
+  TileEngine.SetTile(pos.x, pos.y, tile);
+  EditJournal.RecordTile(pos.x, pos.y, tile);
 }
 
 void TileCanvas::PlaceTileFront(wxPoint pos, unsigned char art,
                                 unsigned char tileSet, uint32_t flags) {
-  TileEngine.Tiles[pos.x][pos.y].FrontArt = art;
-  TileEngine.Tiles[pos.x][pos.y].TileSetFront = tileSet;
-  TileEngine.Tiles[pos.x][pos.y].Block = flags;
+  EditHistory.TouchTile(pos.x, pos.y);
+  auto tile = TileEngine.GetTile(pos.x, pos.y);
+  tile.FrontArt = art;
+  tile.TileSetFront = tileSet;
+  tile.Block = flags;
+  TileEngine.SetTile(pos.x, pos.y, tile);
+  EditJournal.RecordTile(pos.x, pos.y, tile);
 }
 void TileCanvas::PlaceTileBack(wxPoint pos, unsigned char art,
                                unsigned char tileSet, uint32_t flags) {
-  TileEngine.Tiles[pos.x][pos.y].BackArt = art;
-  TileEngine.Tiles[pos.x][pos.y].TileSetBack = tileSet;
-  TileEngine.Tiles[pos.x][pos.y].Block = flags;
+  EditHistory.TouchTile(pos.x, pos.y);
+  auto tile = TileEngine.GetTile(pos.x, pos.y);
+  tile.BackArt = art;
+  tile.TileSetBack = tileSet;
+  tile.Block = flags;
+  TileEngine.SetTile(pos.x, pos.y, tile);
+  EditJournal.RecordTile(pos.x, pos.y, tile);
 }
 
 void TileCanvas::RemoveTileFront(wxPoint pos) {
-  TileEngine.Tiles[pos.x][pos.y].FrontArt = 0;
-  TileEngine.Tiles[pos.x][pos.y].TileSetFront = 0;
-  if (TileEngine.Tiles[pos.x][pos.y].BackArt == 0) {
-    TileEngine.Tiles[pos.x][pos.y].Block = 0;
+  EditHistory.TouchTile(pos.x, pos.y);
+  auto tile = TileEngine.GetTile(pos.x, pos.y);
+  tile.FrontArt = 0;
+  tile.TileSetFront = 0;
+  if (tile.BackArt == 0) {
+    tile.Block = 0;
   } else {
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_VERDECKEN;
+    tile.Block &= ~BLOCKWERT_VERDECKEN;
   }
+  TileEngine.SetTile(pos.x, pos.y, tile);
+  EditJournal.RecordTile(pos.x, pos.y, tile);
 }
 void TileCanvas::RemoveTileBack(wxPoint pos) {
-  TileEngine.Tiles[pos.x][pos.y].BackArt = 0;
-  TileEngine.Tiles[pos.x][pos.y].TileSetBack = 0;
-  if (TileEngine.Tiles[pos.x][pos.y].FrontArt == 0) {
-    TileEngine.Tiles[pos.x][pos.y].Block = 0;
+  EditHistory.TouchTile(pos.x, pos.y);
+  auto tile = TileEngine.GetTile(pos.x, pos.y);
+  tile.BackArt = 0;
+  tile.TileSetBack = 0;
+  if (tile.FrontArt == 0) {
+    tile.Block = 0;
   } else {
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_WAND;
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_EIS;
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_SUMPF;
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_LIQUID;
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_WASSER;
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_PLATTFORM;
-    TileEngine.Tiles[pos.x][pos.y].Block &= ~BLOCKWERT_DESTRUCTIBLE;
+    tile.Block &= ~BLOCKWERT_WAND;
+    tile.Block &= ~BLOCKWERT_EIS;
+    tile.Block &= ~BLOCKWERT_SUMPF;
+    tile.Block &= ~BLOCKWERT_LIQUID;
+    tile.Block &= ~BLOCKWERT_WASSER;
+    tile.Block &= ~BLOCKWERT_PLATTFORM;
+    tile.Block &= ~BLOCKWERT_DESTRUCTIBLE;
   }
+  TileEngine.SetTile(pos.x, pos.y, tile);
+  EditJournal.RecordTile(pos.x, pos.y, tile);
+}
+
+void TileCanvas::BeginStroke() {
+  if (mouseLeft) return;
+
+  mouseLeft = true;
+  CaptureMouse();
+  EditHistory.BeginStroke();
+}
+
+void TileCanvas::EndStroke() {
+  if (!mouseLeft) return;
+
+  mouseLeft = false;
+  if (HasCapture()) ReleaseMouse();
+  EditHistory.EndStroke();
 }
 
 void TileCanvas::TryPlace() {
   auto pos = GetTileCordsUnderCursor();
+  if (!IsInsideLevel(pos)) {
+    return;
+  }
   auto& tileSet = frame->editMenu->tileSet;
 
   switch (editMode) {
@@ -167,6 +217,9 @@ void TileCanvas::TryPlace() {
 
 void TileCanvas::TryRemove() {
   auto pos = GetTileCordsUnderCursor();
+  if (!IsInsideLevel(pos)) {
+    return;
+  }
 
   switch (editMode) {
     case EDIT_MODE_FRONT:
@@ -181,6 +234,12 @@ void TileCanvas::TryRemove() {
   }
 }
 
+bool TileCanvas::IsInsideLevel(wxPoint pos) {
+  // The level only has storage for LEVELSIZE_X * LEVELSIZE_Y tiles
+  return pos.x >= 0 && pos.x < TileEngine.LEVELSIZE_X && pos.y >= 0 &&
+         pos.y < TileEngine.LEVELSIZE_Y;
+}
+
 wxPoint TileCanvas::GetTileCordsUnderCursor() {
   const float scaledOffsetX = TileEngine.XOffset / TileEngine.TileSizeX;
   const float scaledOffsetY = TileEngine.YOffset / TileEngine.TileSizeY;
@@ -195,11 +254,96 @@ wxPoint TileCanvas::GetTileCordsUnderCursor() {
 }
 
 void TileCanvas::Update() {
+  if (LevelLoader.IsBusy()) {
+    // Swap in a finished map before anything below looks at the tiles
+    if (LevelLoader.Poll()) {
+      // Edits that didn't make it into the map before a crash come back here
+      int restored = EditJournal.Open(LevelLoader.GetFilename());
+      EditHistory.Clear();
+      if (restored > 0)
+        frame->SetStatusText(
+            wxString::Format("%s (%d unsaved edits restored)",
+                             LevelLoader.GetFilename(), restored));
+      else
+        frame->SetStatusText(LevelLoader.GetFilename());
+      frame->editMenu->ReloadTileSets();
+    } else if (LevelLoader.IsCancelled()) {
+      // The worker may take a moment to notice, don't put the progress back
+      frame->SetStatusText("Loading cancelled");
+    } else if (LevelLoader.IsBusy()) {
+      frame->SetStatusText(
+          wxString::Format("Loading %s ... %d%%", LevelLoader.GetFilename(),
+                           static_cast<int>(LevelLoader.GetProgress() * 100)));
+    } else {
+      frame->SetStatusText(
+          wxString::Format("Could not load %s", LevelLoader.GetFilename()));
+    }
+  }
+
+#ifdef HURRICANEDITOR_BENCH
+  if (benchFrames > 0 && !LevelLoader.IsBusy()) {
+    // Both halves take the same diagonal path through the level
+    const int half = benchFrames / 2;
+    const float t = static_cast<float>(benchFrame % half) / half;
+    DirectGraphics.SetBatching(benchFrame >= half);
+    float scale = benchScale;
+    if (scale <= 0.0f) {
+      // Zoomed out as far as the level still covers the window
+      scale = std::max(
+          static_cast<float>(DirectGraphics.RenderWidth) /
+              (TileEngine.LEVELSIZE_X * ORIGINAL_TILE_SIZE_X),
+          static_cast<float>(DirectGraphics.RenderHeight) /
+              (TileEngine.LEVELSIZE_Y * ORIGINAL_TILE_SIZE_Y));
+    }
+    TileEngine.Scale = scale;
+    TileEngine.CalcRenderRange();
+    TileEngine.XOffset = t * (TileEngine.LEVELPIXELSIZE_X - DirectGraphics.RenderWidth);
+    TileEngine.YOffset = t * (TileEngine.LEVELPIXELSIZE_Y - DirectGraphics.RenderHeight);
+  }
+#endif
+
   Timer.update();
   TileEngine.UpdateLevel();
   TileEngine.CalcRenderRange();
 }
 
+#ifdef HURRICANEDITOR_BENCH
+void TileCanvas::StartPanBenchmark(int frames, float scale) {
+  benchFrames = std::max(frames, 2);
+  benchFrame = 0;
+  benchScale = scale;
+  benchStats[0] = benchStats[1] = RenderStatsStruct();
+}
+
+void TileCanvas::StepPanBenchmark() {
+  const int half = benchFrames / 2;
+  const RenderStatsStruct& frameStats = DirectGraphics.GetRenderStats();
+  RenderStatsStruct& sum = benchStats[benchFrame >= half ? 1 : 0];
+  sum.Submits += frameStats.Submits;
+  sum.DrawCalls += frameStats.DrawCalls;
+  sum.Vertices += frameStats.Vertices;
+  sum.Orphans += frameStats.Orphans;
+  sum.CpuTime += frameStats.CpuTime;
+
+  if (++benchFrame < half * 2) return;
+
+  const char* names[2] = {"unbatched", "batched"};
+  for (int i = 0; i < 2; i++) {
+    Protokoll << "-> Pan " << LevelLoader.GetFilename() << " at scale "
+              << TileEngine.Scale << " " << names[i] << ": "
+              << benchStats[i].Submits / half << " submits, "
+              << benchStats[i].DrawCalls / half << " draw calls, "
+              << benchStats[i].Vertices / half << " vertices, "
+              << benchStats[i].CpuTime / half << " ms CPU per frame, "
+              << benchStats[i].Orphans << " buffer orphans" << std::endl;
+  }
+
+  benchFrames = 0;
+  DirectGraphics.SetBatching(true);
+  frame->Close();
+}
+#endif
+
 void TileCanvas::Render() {
   context->SetCurrent(*this);
 
@@ -211,22 +355,22 @@ void TileCanvas::Render() {
   switch (editMode) {
     case EDIT_MODE_FRONT: {
       TileEngine.DrawFrontLevel();
-      ObjectList.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
-                                TileEngine.Scale);
+      ObjectGraphics.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
+                                    TileEngine.Scale);
       TileEngine.DrawOverlayLevel();
     } break;
     case EDIT_MODE_BACK: {
       TileEngine.DrawBackLevel();
-      ObjectList.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
-                                TileEngine.Scale);
+      ObjectGraphics.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
+                                    TileEngine.Scale);
       TileEngine.DrawWater();
       TileEngine.DrawBackLevelOverlay();
     } break;
     case EDIT_MODE_OBJECTS: {
       TileEngine.DrawBackLevel();
       TileEngine.DrawFrontLevel();
-      ObjectList.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
-                                TileEngine.Scale);
+      ObjectGraphics.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
+                                    TileEngine.Scale);
       TileEngine.DrawBackLevelOverlay();
       TileEngine.DrawWater();
     } break;
@@ -234,8 +378,8 @@ void TileCanvas::Render() {
       TileEngine.DrawBackLevel();
       TileEngine.DrawFrontLevel();
 
-      ObjectList.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
-                                TileEngine.Scale);
+      ObjectGraphics.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset,
+                                    TileEngine.Scale);
 
       TileEngine.DrawWater();
       TileEngine.DrawBackLevelOverlay();
@@ -250,6 +394,11 @@ void TileCanvas::Render() {
 
   DrawGrid();
 
+  DirectGraphics.DisplayBuffer();
+#ifdef HURRICANEDITOR_BENCH
+  if (benchFrames > 0 && !LevelLoader.IsBusy()) StepPanBenchmark();
+#endif
+
   glFlush();
   SwapBuffers();
 }
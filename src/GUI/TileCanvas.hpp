@@ -22,7 +22,15 @@ class TileCanvas : public wxGLCanvas {
     Render();
   }
 
+#ifdef HURRICANEDITOR_BENCH
+  // Scripted pan across the loaded level, the first half of the frames without
+  // batching, then logs draw calls and CPU time per frame of both halves and quits.
+  // A scale of 0 zooms out until the whole level just fits the window
+  void StartPanBenchmark(int frames, float scale = 1.0f);
+#endif
+
   wxPoint GetTileCordsUnderCursor();
+  bool IsInsideLevel(wxPoint pos);
 
   EditMode editMode;
 
@@ -43,12 +51,26 @@ class TileCanvas : public wxGLCanvas {
   void TryPlace();
   void TryRemove();
 
+  void BeginStroke();
+  void EndStroke();
+
+#ifdef HURRICANEDITOR_BENCH
+  void StepPanBenchmark();
+#endif
+
   wxGLContext* context;
 
   wxPoint mousePos;
   bool mouseLeft;
   bool mouseRight;
 
+#ifdef HURRICANEDITOR_BENCH
+  int benchFrames;  // 0 = no benchmark running
+  int benchFrame;
+  float benchScale;
+  RenderStatsStruct benchStats[2];
+#endif
+
  protected:
   DECLARE_EVENT_TABLE()
 };
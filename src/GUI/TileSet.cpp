@@ -55,6 +55,15 @@ bool TileSet::LoadTileSet(wxString path, int tileSetID, wxBitmapType type) {
   return success;
 }
 
+void TileSet::Clear() {
+  images.clear();
+  currentImage.clear();
+  resized = wxBitmap();
+  selectedTile = 0;
+
+  Refresh();
+}
+
 void TileSet::Select(wxString name) {
   auto idx = images.find(name);
   if (idx == images.end())
@@ -14,6 +14,7 @@ class TileSet : public wxPanel {
  public:
   TileSet(wxWindow* parent);
   bool LoadTileSet(wxString path, int tileSetID, wxBitmapType type);
+  void Clear();
 
   void PaintIt(wxPaintEvent&) {
     wxPaintDC dc(this);
@@ -3,7 +3,14 @@
 
 #include <cstdint>
 #include <string>
-#include <SDL2/SDL.h>
+#include <type_traits>
+
+// Byte-Reihenfolge ohne SDL bestimmen, damit der Level-Kern auch ohne SDL baut
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define HURRICAN_BIG_ENDIAN 1
+#else
+#define HURRICAN_BIG_ENDIAN 0
+#endif
 
 constexpr int RENDERWIDTH = 640;
 constexpr int RENDERHEIGHT = 480;
@@ -13,23 +20,35 @@ constexpr int SCREENHEIGHT = 480;
 extern std::string g_storage_ext;
 extern bool GameRunning;
 
+static inline uint32_t SwapBytes32(uint32_t x) {
+    return (x >> 24) | ((x >> 8) & 0xFF00u) | ((x << 8) & 0xFF0000u) | (x << 24);
+}
+
 static inline uint32_t FixEndian(uint32_t x) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    return SDL_Swap32(x);
+#if HURRICAN_BIG_ENDIAN
+    return SwapBytes32(x);
 #else
     return x;
 #endif
 }
 
 static inline int32_t FixEndian(int32_t x) {
-#if SDL_BYTEORDER == SDL_BIG_ENDIAN
-    uint32_t val = SDL_Swap32(*reinterpret_cast<uint32_t *>(&x));
+#if HURRICAN_BIG_ENDIAN
+    uint32_t val = SwapBytes32(*reinterpret_cast<uint32_t *>(&x));
     return *reinterpret_cast<int32_t *>(&val);
 #else
     return x;
 #endif
 }
 
+static inline uint64_t FixEndian(uint64_t x) {
+#if HURRICAN_BIG_ENDIAN
+    return (static_cast<uint64_t>(SwapBytes32(static_cast<uint32_t>(x))) << 32) | SwapBytes32(static_cast<uint32_t>(x >> 32));
+#else
+    return x;
+#endif
+}
+
 void ReplaceAll(std::string &str, const std::string &from, const std::string &to);
 
 template<typename T>
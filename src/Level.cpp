@@ -0,0 +1,1651 @@
+// Datei : Level.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Leveldaten ohne Grafik (siehe Level.hpp)
+//
+// --------------------------------------------------------------------------------------
+
+// --------------------------------------------------------------------------------------
+// Includes
+// --------------------------------------------------------------------------------------
+
+#include "Level.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#if defined(__SSE2__) && !HURRICAN_BIG_ENDIAN
+#define LIGHT_SIMD
+#include <emmintrin.h>
+#endif
+#if defined(LIGHT_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "Gegner.hpp"
+#include "Globals.hpp"
+#include "LevelFormat.hpp"
+#include "Logdatei.hpp"
+#include "MappedFile.hpp"
+#include "ObjectList.hpp"
+#include "TilePager.hpp"
+
+namespace fs = std::filesystem;
+
+// --------------------------------------------------------------------------------------
+// LevelStage
+// --------------------------------------------------------------------------------------
+
+LevelStage::LevelStage() = default;
+LevelStage::~LevelStage() = default;
+
+// --------------------------------------------------------------------------------------
+// Konstruktor
+// --------------------------------------------------------------------------------------
+
+LevelClass::LevelClass() {
+    LEVELSIZE_X = 128;
+    LEVELSIZE_Y = 96;
+
+    CornerLight = true;
+    ColorsChangedX0 = ColorsChangedY0 = 0;
+    ColorsChangedX1 = ColorsChangedY1 = 0;
+    TilesChangedX0 = TilesChangedY0 = 0;
+    TilesChangedX1 = TilesChangedY1 = 0;
+
+    LoadedTilesets = 0;
+    PendingChunks = 0;
+    ClearDirty();
+
+    Tiles.Resize(LEVELSIZE_X, LEVELSIZE_Y, TileBaseColorStruct{255, 255, 255, 255});
+}
+
+// --------------------------------------------------------------------------------------
+// Destruktor
+// --------------------------------------------------------------------------------------
+
+LevelClass::~LevelClass() {}
+
+// --------------------------------------------------------------------------------------
+// Neues, leeres Level der Grösse xSize/ySize erstellen
+// --------------------------------------------------------------------------------------
+
+void LevelClass::InitNewLevel(int xSize, int ySize, const std::string &LevelFile) {
+    ClearLevel();
+
+    LEVELSIZE_X = xSize;
+    LEVELSIZE_Y = ySize;
+
+    // Nur so viel Speicher, wie das Level wirklich braucht
+    Tiles.Resize(xSize, ySize, {}, LevelFile);
+    CornerWindow = TileCornerWindow();
+    MarkColorsChanged(0, 0, xSize, ySize);
+
+    SavedFilename.clear();
+    ClearDirty();
+}
+
+// --------------------------------------------------------------------------------------
+// Level freigeben
+// --------------------------------------------------------------------------------------
+
+void LevelClass::ClearLevel() {
+    LevelV2.reset();
+    ChunkState.clear();
+    PendingChunks = 0;
+}
+
+// --------------------------------------------------------------------------------------
+// Tile Ebenen
+// --------------------------------------------------------------------------------------
+
+void TilePlanes::Resize(int xSize, int ySize, TileBaseColorStruct Color, const std::string &LevelFile) {
+    SizeX = xSize;
+    SizeY = ySize;
+    BricksX = TileBricks(xSize);
+
+    // Ein gemeinsamer Brick für alle, kopiert wird erst beim Schreiben
+    auto Fill = std::make_shared<TileBrick>();
+    memset(Fill.get(), 0, sizeof(TileBrick));
+    std::fill(std::begin(Fill->Color), std::end(Fill->Color), Color);
+
+    Bricks.assign(TileBrickStorage(xSize, ySize) / TILEBRICK_TILES, Fill);
+    Bricks.shrink_to_fit();
+
+    // Grosse Levels auslagern. Platz für die Hälfte mehr, damit Schnappschüsse beim
+    // Editieren auch noch in die Datei passen
+    Pager.reset();
+    if (Bricks.size() > TilePager::ResidentLimit())
+        Pager = TilePager::Create(Bricks.size() + Bricks.size() / 2, LevelFile);
+}
+
+void TilePlanes::CloneBrick(std::shared_ptr<TileBrick> &Brick) {
+    Brick = Pager ? Pager->NewBrick(*Brick) : std::make_shared<TileBrick>(*Brick);
+}
+
+void TilePlanes::KeepResident(int x0, int y0, int x1, int y1) {
+    if (!Pager)
+        return;
+
+    x0 = std::max(x0, 0) >> TILEBRICK_SHIFT;
+    y0 = std::max(y0, 0) >> TILEBRICK_SHIFT;
+    x1 = (std::min(x1, SizeX) + TILEBRICK_MASK) >> TILEBRICK_SHIFT;
+    y1 = (std::min(y1, SizeY) + TILEBRICK_MASK) >> TILEBRICK_SHIFT;
+
+    for (int by = y0; by < y1; by++)
+        for (int bx = x0; bx < x1; bx++)
+            Pager->Touch(Bricks[static_cast<size_t>(by) * BricksX + bx].get());
+}
+
+void TilePlanes::PageOut(int x0, int y0, int x1, int y1) {
+    if (!Pager)
+        return;
+
+    x0 = std::max(x0, 0) >> TILEBRICK_SHIFT;
+    y0 = std::max(y0, 0) >> TILEBRICK_SHIFT;
+    x1 = (std::min(x1, SizeX) + TILEBRICK_MASK) >> TILEBRICK_SHIFT;
+    y1 = (std::min(y1, SizeY) + TILEBRICK_MASK) >> TILEBRICK_SHIFT;
+
+    for (int by = y0; by < y1; by++)
+        for (int bx = x0; bx < x1; bx++)
+            Pager->PageOut(Bricks[static_cast<size_t>(by) * BricksX + bx].get());
+}
+
+LevelTileStruct TilePlanes::Get(size_t t) const {
+    const TileBrick &Brick = *Bricks[t / TILEBRICK_TILES];
+    const size_t n = t % TILEBRICK_TILES;
+
+    // Für das Licht wird die Position im Level gebraucht
+    const size_t b = t / TILEBRICK_TILES;
+    const int i = static_cast<int>(b % BricksX) * TILEBRICK_SIZE + static_cast<int>(n & TILEBRICK_MASK);
+    const int j = static_cast<int>(b / BricksX) * TILEBRICK_SIZE + static_cast<int>(n >> TILEBRICK_SHIFT);
+
+    LevelTileStruct Tile;
+    Tile.TileSetBack = Brick.Art[n].TileSetBack;
+    Tile.TileSetFront = Brick.Art[n].TileSetFront;
+    Tile.BackArt = Brick.Art[n].BackArt;
+    Tile.FrontArt = Brick.Art[n].FrontArt;
+    Tile.Red = Brick.Color[n].Red;
+    Tile.Green = Brick.Color[n].Green;
+    Tile.Blue = Brick.Color[n].Blue;
+    Tile.Alpha = Brick.Color[n].Alpha;
+    memcpy(Tile.Color, ComputeTileCorners(*this, i, j).Color, sizeof(Tile.Color));
+    Tile.Block = Brick.Block[n];
+    Tile.move_v1 = (Tile.Block & BLOCKWERT_MOVE_V1) != 0;
+    Tile.move_v2 = (Tile.Block & BLOCKWERT_MOVE_V2) != 0;
+    Tile.move_v3 = (Tile.Block & BLOCKWERT_MOVE_V3) != 0;
+    Tile.move_v4 = (Tile.Block & BLOCKWERT_MOVE_V4) != 0;
+    return Tile;
+}
+
+void TilePlanes::Set(size_t t, const LevelTileStruct &Tile) {
+    TileBrick &Brick = EditBrick(t);
+    const size_t n = t % TILEBRICK_TILES;
+
+    Brick.Art[n] = TileArtStruct{Tile.TileSetBack, Tile.TileSetFront, Tile.BackArt, Tile.FrontArt};
+    Brick.Color[n] = TileBaseColorStruct{Tile.Red, Tile.Green, Tile.Blue, Tile.Alpha};
+
+    // Tile.Color ergibt sich aus den Nachbarn und wird nicht gespeichert
+    uint32_t Block = Tile.Block & ~BLOCKWERT_WASSERANIM;
+    if (Tile.move_v1)
+        Block |= BLOCKWERT_MOVE_V1;
+    if (Tile.move_v2)
+        Block |= BLOCKWERT_MOVE_V2;
+    if (Tile.move_v3)
+        Block |= BLOCKWERT_MOVE_V3;
+    if (Tile.move_v4)
+        Block |= BLOCKWERT_MOVE_V4;
+    Brick.Block[n] = Block;
+}
+
+// --------------------------------------------------------------------------------------
+// Geladene Tiles (12 Bytes) auf die Ebenen verteilen
+// --------------------------------------------------------------------------------------
+
+// count Tiles aus der Datei nach Index t, t + Stride, t + 2 * Stride ... umwandeln,
+// die müssen alle im selben Brick liegen
+static void ExpandLevelTiles(const uint8_t *src, TilePlanes &Planes, size_t t, int count, int Stride,
+                             uint8_t MaxTileset) {
+    TileBrick &Brick = Planes.EditBrick(t);
+    t %= TILEBRICK_TILES;
+
+    for (int n = 0; n < count; n++, src += sizeof(LevelTileLoadStruct), t += Stride) {
+        uint8_t head[8];  // TileSetBack, TileSetFront, BackArt, FrontArt, Red, Green, Blue, Alpha
+        uint32_t Block;
+        memcpy(head, src, sizeof(head));
+        memcpy(&Block, src + 8, sizeof(Block));
+
+        if (head[0] > MaxTileset)
+            head[0] = MaxTileset;
+        if (head[1] > MaxTileset)
+            head[1] = MaxTileset;
+
+        Block = FixEndian(Block);
+
+        // Eine Flüssigkeit als Block?
+        // damit man nicht immer auf alle vier möglichen Flüssigkeiten checken muss,
+        // sondern nur auf BLOCKWERT_LIQUID
+        if (Block & BLOCKWERT_WASSER || Block & BLOCKWERT_SUMPF)
+            Block ^= BLOCKWERT_LIQUID;
+
+        // Die Wasseranim berechnet erst ComputeWaterAnim()
+        Block &= ~BLOCKWERT_WASSERANIM;
+
+        memcpy(&Brick.Art[t], head, sizeof(TileArtStruct));
+        memcpy(&Brick.Color[t], head + 4, sizeof(TileBaseColorStruct));
+        Brick.Block[t] = Block;
+    }
+}
+
+// Eine Spalte ab Tile i/j aus der Datei umwandeln. Untereinander liegen die Tiles im
+// Brick TILEBRICK_SIZE auseinander, nur beim Wechsel in den nächsten Brick nicht
+static void ExpandLevelColumn(const uint8_t *src, TilePlanes &Planes, int i, int j, int count, uint8_t MaxTileset) {
+    while (count > 0) {
+        const int n = std::min(count, TILEBRICK_SIZE - (j & TILEBRICK_MASK));
+
+        ExpandLevelTiles(src, Planes, Planes.Index(i, j), n, TILEBRICK_SIZE, MaxTileset);
+
+        src += n * sizeof(LevelTileLoadStruct);
+        j += n;
+        count -= n;
+    }
+}
+
+// --------------------------------------------------------------------------------------
+// v2 Chunks nachladen
+//
+// Ein Chunk ist erst fertig, wenn auch die Wasseranim berechnet ist. Die braucht (wie
+// das Licht) die direkten Nachbarn eines Tiles, daher werden vorher die umliegenden
+// Chunks ausgepackt (aber noch nicht fertig gemacht).
+// --------------------------------------------------------------------------------------
+
+enum : uint8_t {
+    CHUNK_PACKED,   // liegt noch gepackt in der Datei
+    CHUNK_DECODED,  // Tiles ausgepackt, Wasser/Licht fehlen noch
+    CHUNK_READY     // fertig
+};
+
+bool LevelClass::DecodeChunk(int cx, int cy) {
+    static uint8_t Raw[LEVELV2_CHUNKSIZE * LEVELV2_CHUNKSIZE * sizeof(LevelTileLoadStruct)];
+
+    ChunkState[cx * LevelV2->ChunksY() + cy] = CHUNK_DECODED;
+
+    // Kaputte Chunks bleiben leer, der Rest vom Level ist trotzdem benutzbar
+    if (!LevelV2->DecodeChunk(cx, cy, Raw))
+        return false;
+
+    const int w = LevelV2->ChunkWidth(cx);
+    const int h = LevelV2->ChunkHeight(cy);
+
+    for (int i = 0; i < w; i++)
+        ExpandLevelColumn(Raw + i * h * sizeof(LevelTileLoadStruct), Tiles, cx * LEVELV2_CHUNKSIZE + i,
+                          cy * LEVELV2_CHUNKSIZE, h, LoadedTilesets);
+
+    UpdateCorners(cx * LEVELV2_CHUNKSIZE, cy * LEVELV2_CHUNKSIZE, cx * LEVELV2_CHUNKSIZE + w,
+                  cy * LEVELV2_CHUNKSIZE + h);
+    return true;
+}
+
+void LevelClass::PrepareChunk(int cx, int cy) {
+    const int ChunksX = LevelV2->ChunksX();
+    const int ChunksY = LevelV2->ChunksY();
+
+    if (ChunkState[cx * ChunksY + cy] == CHUNK_READY)
+        return;
+
+    for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, ChunksX - 1); nx++)
+        for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, ChunksY - 1); ny++)
+            if (ChunkState[nx * ChunksY + ny] == CHUNK_PACKED)
+                DecodeChunk(nx, ny);
+
+    const int x0 = cx * LEVELV2_CHUNKSIZE;
+    const int y0 = cy * LEVELV2_CHUNKSIZE;
+    const int x1 = x0 + LevelV2->ChunkWidth(cx);
+    const int y1 = y0 + LevelV2->ChunkHeight(cy);
+
+    ComputeWaterAnim(x0, y0, x1, y1);
+
+    ChunkState[cx * ChunksY + cy] = CHUNK_READY;
+
+    // Alles ausgepackt? Dann wird die Datei nicht mehr gebraucht
+    if (--PendingChunks == 0) {
+        LevelV2.reset();
+        ChunkState.clear();
+    }
+}
+
+void LevelClass::PrepareTiles(int x0, int y0, int x1, int y1) {
+    if (PendingChunks > 0)
+        PrepareChunks(x0, y0, x1, y1);
+
+    // Was gerade zu sehen ist, nicht auslagern
+    Tiles.KeepResident(x0, y0, x1, y1);
+
+    PrepareCorners(x0, y0, x1, y1);
+}
+
+void LevelClass::PrepareChunks(int x0, int y0, int x1, int y1) {
+    const int cx0 = std::max(x0, 0) / LEVELV2_CHUNKSIZE;
+    const int cy0 = std::max(y0, 0) / LEVELV2_CHUNKSIZE;
+    const int cx1 = (std::min(x1, LEVELSIZE_X) + LEVELV2_CHUNKSIZE - 1) / LEVELV2_CHUNKSIZE;
+    const int cy1 = (std::min(y1, LEVELSIZE_Y) + LEVELV2_CHUNKSIZE - 1) / LEVELV2_CHUNKSIZE;
+
+    for (int cx = cx0; cx < cx1 && PendingChunks > 0; cx++)
+        for (int cy = cy0; cy < cy1 && PendingChunks > 0; cy++)
+            PrepareChunk(cx, cy);
+}
+
+void LevelClass::PrepareAllTiles() {
+    if (PendingChunks > 0)
+        PrepareChunks(0, 0, LEVELSIZE_X, LEVELSIZE_Y);
+}
+
+// --------------------------------------------------------------------------------------
+// Ein Brick und die acht um ihn herum
+//
+// Wasseranim und Licht brauchen für jedes Tile die direkten Nachbarn. Die beiden gehen
+// deshalb Brick für Brick durch und holen die Nachbarn über die neun Zeiger hier, statt
+// für jedes Tile erst in TilePlanes::Bricks nachzusehen. i/j zählen ab der linken oberen
+// Ecke des mittleren Bricks und gehen von -1 bis TILEBRICK_SIZE.
+// --------------------------------------------------------------------------------------
+
+struct BrickWindow {
+    const TileBrick *Near[3][3];
+
+    BrickWindow(const TilePlanes &Grid, int bx, int by) {
+        const int BricksY = TileBricks(Grid.SizeY);
+
+        for (int y = 0; y < 3; y++)
+            for (int x = 0; x < 3; x++) {
+                const int nx = bx + x - 1;
+                const int ny = by + y - 1;
+                Near[y][x] = nx >= 0 && ny >= 0 && nx < Grid.BricksX && ny < BricksY
+                                 ? Grid.Bricks[ny * Grid.BricksX + nx].get()
+                                 : nullptr;
+            }
+    }
+
+    const TileBrick &Brick(int i, int j) const {
+        return *Near[(j + TILEBRICK_SIZE) >> TILEBRICK_SHIFT][(i + TILEBRICK_SIZE) >> TILEBRICK_SHIFT];
+    }
+    static size_t Local(int i, int j) { return (j & TILEBRICK_MASK) * TILEBRICK_SIZE + (i & TILEBRICK_MASK); }
+
+    uint32_t Block(int i, int j) const { return Brick(i, j).Block[Local(i, j)]; }
+    const TileBaseColorStruct &Color(int i, int j) const { return Brick(i, j).Color[Local(i, j)]; }
+};
+
+// Alle Bricks, die [x0, x1) x [y0, y1) berühren, der Reihe nach an Fn(Brick, Window, bx, by)
+// geben. Der Brick ist dabei schon zum Schreiben kopiert, falls er geteilt war
+template <typename Function>
+static void ForEachBrick(TilePlanes &Grid, int x0, int y0, int x1, int y1, Function Fn) {
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    for (int by = y0 >> TILEBRICK_SHIFT; by <= (y1 - 1) >> TILEBRICK_SHIFT; by++)
+        for (int bx = x0 >> TILEBRICK_SHIFT; bx <= (x1 - 1) >> TILEBRICK_SHIFT; bx++) {
+            TileBrick &Brick = Grid.EditBrick((static_cast<size_t>(by) * Grid.BricksX + bx) * TILEBRICK_TILES);
+            Fn(Brick, BrickWindow(Grid, bx, by), bx * TILEBRICK_SIZE, by * TILEBRICK_SIZE);
+        }
+}
+
+// --------------------------------------------------------------------------------------
+// Eventuelle Schrägen ermitteln und Ecken für die Wasseranim festlegen
+// (nur für die Tiles in [x0, x1) x [y0, y1))
+// --------------------------------------------------------------------------------------
+
+static void ComputeGridWaterAnim(TilePlanes &Grid, int x0, int y0, int x1, int y1) {
+    x0 = std::max(x0, 1);
+    y0 = std::max(y0, 2);
+    x1 = std::min(x1, Grid.SizeX - 1);
+    y1 = std::min(y1, Grid.SizeY - 1);
+
+    ForEachBrick(Grid, x0, y0, x1, y1, [=](TileBrick &Brick, const BrickWindow &Window, int ox, int oy) {
+        auto BlockAt = [&Window, ox, oy](int i, int j) { return Window.Block(i - ox, j - oy); };
+
+        // zeilenweise, so wie die Tiles im Brick liegen
+        for (int j = std::max(y0, oy); j < std::min(y1, oy + TILEBRICK_SIZE); j++)
+            for (int i = std::max(x0, ox); i < std::min(x1, ox + TILEBRICK_SIZE); i++) {
+          #if 0
+                // Schräge links hoch
+                if (BlockAt(i + 0, j + 0) & BLOCKWERT_WAND && !(BlockAt(i + 1, j + 0) & BLOCKWERT_WAND) &&
+                    BlockAt(i + 1, j + 1) & BLOCKWERT_WAND && !(BlockAt(i + 0, j - 1) & BLOCKWERT_WAND)) {
+                    if (!(BlockAt(i + 1, j + 0) & BLOCKWERT_SCHRAEGE_L))
+                        BlockAt(i + 1, j + 0) ^= BLOCKWERT_SCHRAEGE_L;
+                }
+
+                // Schräge rechts hoch
+                if (BlockAt(i + 0, j + 0) & BLOCKWERT_WAND && !(BlockAt(i - 1, j + 0) & BLOCKWERT_WAND) &&
+                    BlockAt(i - 1, j + 1) & BLOCKWERT_WAND && !(BlockAt(i + 0, j - 1) & BLOCKWERT_WAND)) {
+                    if (!(BlockAt(i - 1, j + 0) & BLOCKWERT_SCHRAEGE_R))
+                        BlockAt(i - 1, j + 0) ^= BLOCKWERT_SCHRAEGE_R;
+                }
+          #endif
+
+                // Wasseranim
+                //
+                uint32_t bl = BlockAt(i - 1, j + 0);
+                uint32_t br = BlockAt(i + 1, j + 0);
+                uint32_t bo = BlockAt(i + 0, j - 1);
+                uint32_t bu = BlockAt(i + 0, j + 1);
+
+                uint32_t Move = 0;
+
+                if (!(BlockAt(i - 1, j - 1) & BLOCKWERT_WAND) && !(BlockAt(i, j - 1) & BLOCKWERT_WASSERFALL) &&
+                    !(BlockAt(i - 1, j - 1) & BLOCKWERT_WASSERFALL) &&
+                    (bl & BLOCKWERT_LIQUID && (!(bo & BLOCKWERT_WAND))))
+                    Move |= BLOCKWERT_MOVE_V1;
+
+                if (!(BlockAt(i - 1, j + 1) & BLOCKWERT_WAND) && (bl & BLOCKWERT_LIQUID && bu & BLOCKWERT_LIQUID))
+                    Move |= BLOCKWERT_MOVE_V3;
+
+                if (!(BlockAt(i + 1, j - 1) & BLOCKWERT_WAND) && !(BlockAt(i, j - 1) & BLOCKWERT_WASSERFALL) &&
+                    !(BlockAt(i + 1, j - 1) & BLOCKWERT_WASSERFALL) &&
+                    (br & BLOCKWERT_LIQUID && (!(bo & BLOCKWERT_WAND))))
+                    Move |= BLOCKWERT_MOVE_V2;
+
+                if (!(BlockAt(i + 1, j + 1) & BLOCKWERT_WAND) && (br & BLOCKWERT_LIQUID && bu & BLOCKWERT_LIQUID))
+                    Move |= BLOCKWERT_MOVE_V4;
+
+                // Die Nachbarn lesen nur andere Bits, das Tile kann also gleich geschrieben werden
+                uint32_t &Block = Brick.Block[BrickWindow::Local(i, j)];
+                Block = (Block & ~BLOCKWERT_WASSERANIM) | Move;
+            }
+    });
+}
+
+void LevelClass::ComputeWaterAnim(int x0, int y0, int x1, int y1) {
+    ComputeGridWaterAnim(Tiles, x0, y0, x1, y1);
+}
+
+// --------------------------------------------------------------------------------------
+// Tiles und Objekte wieder so packen, wie sie in der Datei stehen
+// --------------------------------------------------------------------------------------
+
+static LevelTileLoadStruct PackTile(const TilePlanes &Tiles, size_t t) {
+    const TileArtStruct &Art = Tiles.ArtAt(t);
+    const TileBaseColorStruct &Color = Tiles.ColorAt(t);
+
+    LevelTileLoadStruct SaveTile;
+    SaveTile.TileSetBack = Art.TileSetBack;
+    SaveTile.TileSetFront = Art.TileSetFront;
+    SaveTile.BackArt = Art.BackArt;
+    SaveTile.FrontArt = Art.FrontArt;
+    SaveTile.Red = Color.Red;
+    SaveTile.Green = Color.Green;
+    SaveTile.Blue = Color.Blue;
+    SaveTile.Alpha = Color.Alpha;
+    SaveTile.Block = FixEndian(Tiles.BlockAt(t) & ~(BLOCKWERT_LIQUID | BLOCKWERT_WASSERANIM));
+    return SaveTile;
+}
+
+static LevelObjectStruct PackObject(const Object &object) {
+    LevelObjectStruct SaveObject;
+    SaveObject.ObjectID = FixEndian(object.ObjectID);
+    SaveObject.XPos = FixEndian(object.XPos);
+    SaveObject.YPos = FixEndian(object.YPos);
+    SaveObject.ChangeLight = object.ChangeLight;
+    SaveObject.Skill = object.Skill;
+    SaveObject.Value1 = FixEndian(object.Value1);
+    SaveObject.Value2 = FixEndian(object.Value2);
+
+    SaveObject.PADDING_CHUNK_1[0] = 0xcc;
+    SaveObject.PADDING_CHUNK_1[1] = 0xcc;
+    return SaveObject;
+}
+
+// --------------------------------------------------------------------------------------
+// Level einlesen
+//
+// Läuft für den LevelLoader auf einem Worker-Thread und fasst daher das Level selbst
+// nicht an: Header, Tiles samt Wasser/Licht und Objekte landen in Stage. Sobald Header
+// und Objekte stehen, wird ObjectsParsed aufgerufen, die Engine dekodiert von da an
+// nebenher schon die PNGs. Erst ApplyLevel() übernimmt alles.
+// --------------------------------------------------------------------------------------
+
+constexpr int PARSE_STRIPE = 64;  // Spalten pro Schritt, danach Fortschritt/Abbruch prüfen
+
+bool LevelClass::ParseLevel(const std::string &Filename, LevelStage &Stage, LevelLoadProgress *Progress,
+                            const std::function<void()> &ObjectsParsed) {
+    auto Cancelled = [Progress] { return Progress != nullptr && Progress->Cancel; };
+    auto Report = [Progress](float Fraction) {
+        if (Progress != nullptr)
+            Progress->Fraction = Fraction;
+    };
+
+    // File einblenden
+    MappedFile Datei;
+
+    if (!Datei.Open(Filename)) {
+        Protokoll << " \n-> Error loading level !" << std::endl;
+        return false;
+    }
+
+    // v2 Container? Der prüft seine Abschnitte beim Öffnen selbst
+    std::unique_ptr<LevelV2File> V2;
+    FileHeader Header;
+
+    if (LevelV2File::IsLevelV2(Datei.Data(), Datei.Size())) {
+        Datei.Close();
+
+        V2 = std::make_unique<LevelV2File>();
+        if (!V2->Open(Filename)) {
+            Protokoll << " \n-> Error loading level !" << std::endl;
+            return false;
+        }
+
+        Header = V2->Header();
+    } else {
+        const uint8_t *HeaderData = Datei.Range(0, sizeof(FileHeader));
+        if (HeaderData == nullptr) {
+            Protokoll << " \n-> Error loading level: file too small for FileHeader" << std::endl;
+            return false;
+        }
+
+        memcpy(&Header, HeaderData, sizeof(Header));
+    }
+
+    // Alle Abschnitte prüfen, bevor irgendetwas übernommen wird
+    const uint32_t SizeX = FixEndian(Header.SizeX);
+    const uint32_t SizeY = FixEndian(Header.SizeY);
+    const uint32_t FileObjects = V2 ? V2->NumObjects() : FixEndian(Header.NumObjects);
+    const uint32_t NumObjects = std::min<uint32_t>(FileObjects, MAX_GEGNER);
+
+    if (SizeX == 0 || SizeY == 0 || SizeX > MAX_LEVELSIZE_X || SizeY > MAX_LEVELSIZE_Y) {
+        Protokoll << " \n-> Error loading level: invalid size " << SizeX << "x" << SizeY << std::endl;
+        return false;
+    }
+
+    // Mehr Objekte passen nicht in die ObjectList, der Rest fällt weg
+    if (FileObjects > MAX_GEGNER)
+        Protokoll << " \n-> Level has " << FileObjects << " objects, loading only the first " << MAX_GEGNER
+                  << std::endl;
+
+    const uint8_t *TileData = nullptr;  // bei v2 kommen die Tiles erst in PrepareTiles()
+    const uint8_t *ObjectData;
+    const uint8_t *AppendixData;
+
+    if (V2) {
+        ObjectData = V2->ObjectData();
+        AppendixData = reinterpret_cast<const uint8_t *>(&V2->Appendix());
+    } else {
+        const size_t TilesOffset = sizeof(FileHeader);
+        const size_t TilesLength = static_cast<size_t>(SizeX) * SizeY * sizeof(LevelTileLoadStruct);
+        const size_t ObjectsOffset = TilesOffset + TilesLength;
+        const size_t ObjectsLength = static_cast<size_t>(FileObjects) * sizeof(LevelObjectStruct);
+        const size_t AppendixOffset = ObjectsOffset + ObjectsLength;
+
+        TileData = Datei.Range(TilesOffset, TilesLength);
+        ObjectData = Datei.Range(ObjectsOffset, ObjectsLength);
+        AppendixData = Datei.Range(AppendixOffset, sizeof(FileAppendix));
+
+        if (TileData == nullptr || ObjectData == nullptr || AppendixData == nullptr) {
+            Protokoll << " \n-> Error loading level: file is truncated (" << Datei.Size() << " bytes, expected "
+                      << AppendixOffset + sizeof(FileAppendix) << ")" << std::endl;
+            return false;
+        }
+    }
+
+    Stage.Filename = Filename;
+    Stage.Header = Header;
+    Stage.Header.NumObjects = FixEndian(NumObjects);
+    Stage.ObjectsClamped = NumObjects != FileObjects;
+    Stage.SizeX = static_cast<int>(SizeX);
+    Stage.SizeY = static_cast<int>(SizeY);
+
+    // Objekt Daten laden und mitzählen
+    Stage.Objects.clear();
+    Stage.Objects.reserve(NumObjects);
+
+    for (uint32_t i = 0; i < NumObjects; i++) {
+        LevelObjectStruct LoadObject;
+        memcpy(&LoadObject, ObjectData + i * sizeof(LevelObjectStruct), sizeof(LoadObject));  // Objekt laden
+        LoadObject.ObjectID = FixEndian(LoadObject.ObjectID);
+        LoadObject.XPos = FixEndian(LoadObject.XPos);
+        LoadObject.YPos = FixEndian(LoadObject.YPos);
+        LoadObject.Value1 = FixEndian(LoadObject.Value1);
+        LoadObject.Value2 = FixEndian(LoadObject.Value2);
+
+        // Count Secrets, OneUps etc., for Summary-Box
+        switch (LoadObject.ObjectID) {
+            case SECRET:
+                Stage.MaxSecrets++;
+                break;
+            case DIAMANT:
+                Stage.MaxDiamonds++;
+                break;
+            case ONEUP:
+                Stage.MaxOneUps++;
+                break;
+            case POWERBLOCK:
+                Stage.MaxBlocks++;
+                break;
+
+            default:
+                break;
+        }
+
+        // Startposition des Spielers
+        if (LoadObject.ObjectID == 0) {
+            Stage.HasPlayerStart = true;
+            Stage.PlayerX = LoadObject.XPos;
+            Stage.PlayerY = LoadObject.YPos;
+        }
+
+        Stage.Objects.push_back(Object{
+            LoadObject.ObjectID,
+            LoadObject.XPos,
+            LoadObject.YPos,
+            LoadObject.ChangeLight,
+            LoadObject.Skill,
+            LoadObject.Value1,
+            LoadObject.Value2,
+        });
+    }
+
+    if (ObjectsParsed)
+        ObjectsParsed();
+
+    if (V2) {
+        // Chunks packt erst die Engine aus, wenn sie in Sicht kommen
+        Stage.V2 = std::move(V2);
+        Stage.Appendix = Stage.V2->Appendix();
+    } else {
+        // Das Level liegt spaltenweise in der Datei und wird Spalte für Spalte in die
+        // Bricks verteilt
+        Stage.Tiles.Resize(SizeX, SizeY, {}, Filename);
+        TilePlanes &Grid = Stage.Tiles;
+
+        for (int i = 0; i < Grid.SizeX && !Cancelled(); i++) {
+            ExpandLevelColumn(TileData + static_cast<size_t>(i) * Grid.SizeY * sizeof(LevelTileLoadStruct), Grid, i,
+                              0, Grid.SizeY, Header.UsedTilesets);
+
+            if (i % PARSE_STRIPE == 0) {
+                Report(0.3f * static_cast<float>(i) / static_cast<float>(Grid.SizeX));
+
+                // Gelesene Spalten werden nicht mehr gebraucht
+                if (Grid.Pager)
+                    Datei.Release(sizeof(FileHeader),
+                                  static_cast<size_t>(i) * Grid.SizeY * sizeof(LevelTileLoadStruct));
+            }
+        }
+
+        // Die Wasseranim liest von den Nachbarn nur Block, die sind jetzt alle fertig,
+        // also geht das streifenweise. Das Licht kommt erst beim Zeichnen dazu
+        for (int x0 = 0; x0 < Grid.SizeX && !Cancelled(); x0 += PARSE_STRIPE) {
+            const int x1 = std::min(x0 + PARSE_STRIPE, Grid.SizeX);
+
+            ComputeGridWaterAnim(Grid, x0, 0, x1, Grid.SizeY);
+
+            // Bei ausgelagerten Levels nicht alles im Speicher liegen lassen. Die Spalte links
+            // davor ist schon fertig, wurde aber für die Nachbarn gerade wieder eingelesen
+            Grid.PageOut(x0 - 1, 0, x1, Grid.SizeY);
+
+            Report(0.3f + 0.6f * static_cast<float>(x1) / static_cast<float>(Grid.SizeX));
+        }
+
+        memcpy(&Stage.Appendix, AppendixData, sizeof(Stage.Appendix));
+    }
+
+    Stage.Appendix.UsedPowerblock = FixEndian(Stage.Appendix.UsedPowerblock);
+
+    if (Cancelled())
+        return false;
+
+    Report(1.0f);
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+// Eingelesenes Level übernehmen
+// Bis hierhin bleibt das alte Level unverändert stehen. Grafiken lädt erst
+// TileEngineClass::ApplyLevel() dazu.
+// --------------------------------------------------------------------------------------
+
+bool LevelClass::ApplyLevel(LevelStage &Stage) {
+    ObjectList.ClearObjects();
+
+    // DateiHeader übernehmen
+    DateiHeader = Stage.Header;
+
+    // und Werte übertragen
+    LEVELSIZE_X = Stage.SizeX;
+    LEVELSIZE_Y = Stage.SizeY;
+    LoadedTilesets = DateiHeader.UsedTilesets;
+    memcpy(Beschreibung, DateiHeader.Beschreibung, sizeof(Beschreibung));
+    Beschreibung[sizeof(Beschreibung) - 1] = '\0';
+
+    //Timelimit = static_cast<float>(FixEndian(DateiHeader.Timelimit));
+
+    if (Timelimit <= 0.0f)
+        Timelimit = 500.0f;
+
+    MaxSecrets = Stage.MaxSecrets;
+    MaxDiamonds = Stage.MaxDiamonds;
+    MaxOneUps = Stage.MaxOneUps;
+    MaxBlocks = Stage.MaxBlocks;
+
+    // LevelDaten übernehmen
+    InitNewLevel(LEVELSIZE_X, LEVELSIZE_Y, Stage.Filename);
+
+    if (Stage.V2) {
+        // Chunks werden erst ausgepackt, wenn sie in Sicht kommen
+        ChunkState.assign(static_cast<size_t>(Stage.V2->ChunksX()) * Stage.V2->ChunksY(), CHUNK_PACKED);
+        PendingChunks = static_cast<int>(ChunkState.size());
+        LevelV2 = std::move(Stage.V2);
+    } else {
+        // Stage.Tiles liegt schon genauso wie Tiles, also nur den Speicher übernehmen
+        std::swap(Tiles, Stage.Tiles);
+    }
+
+    // Liste mit Objekten erstellen
+    for (const auto &object : Stage.Objects)
+        ObjectList.PushObject(object);
+
+    DateiAppendix = Stage.Appendix;
+
+    // Stand der Datei merken, eine .map kann dann beim Speichern nur noch gepatcht werden.
+    // Fehlen Objekte aus der Datei, stimmt der Stand nicht, dann wird neu geschrieben
+    if (LevelV2 == nullptr && !Stage.ObjectsClamped) {
+        std::vector<LevelObjectStruct> FileObjects;
+        for (const auto &object : Stage.Objects)
+            FileObjects.push_back(PackObject(object));
+
+        FileAppendix FileAppx = DateiAppendix;
+        FileAppx.UsedPowerblock = FixEndian(DateiAppendix.UsedPowerblock);
+
+        RememberSavedState(Stage.Filename, std::move(FileObjects), FileAppx);
+    }
+
+    // Temp Datei löschen und speicher freigeben
+    fs::remove(fs::path("temp.map"));
+
+    // Liquid Farben setzen
+    ColR1 = std::stoi(std::string(&DateiAppendix.Col1[0], 2), nullptr, 16);
+    ColG1 = std::stoi(std::string(&DateiAppendix.Col1[2], 2), nullptr, 16);
+    ColB1 = std::stoi(std::string(&DateiAppendix.Col1[4], 2), nullptr, 16);
+
+    ColR2 = std::stoi(std::string(&DateiAppendix.Col2[0], 2), nullptr, 16);
+    ColG2 = std::stoi(std::string(&DateiAppendix.Col2[2], 2), nullptr, 16);
+    ColB2 = std::stoi(std::string(&DateiAppendix.Col2[4], 2), nullptr, 16);
+    
+    ColA1 = std::stoi(std::string(&DateiAppendix.Col1[6], 2), nullptr, 16);
+    ColA2 = std::stoi(std::string(&DateiAppendix.Col2[6], 2), nullptr, 16);
+
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+// Level laden (synchron und ohne Grafiken, für Tools; der Editor nimmt den LevelLoader)
+// --------------------------------------------------------------------------------------
+
+bool LevelClass::LoadLevel(const std::string &Filename) {
+    // Dann checken, ob sich das File im Standard Ordner befindet
+    if (!fs::exists(Filename) && !fs::is_regular_file(Filename)) {
+        Protokoll << "\n-> Error loading level " << Filename << "!" << std::endl;
+        GameRunning = false;
+        return false;
+    }
+
+    Protokoll << "\n-> Loading Level <-\n" << std::endl;
+
+    LevelStage Stage;
+
+    if (!ParseLevel(Filename, Stage, nullptr) || !ApplyLevel(Stage))
+        return false;
+
+    // Level korrekt geladen
+    Protokoll << "-> Load Level : " << Filename << " successful ! <-\n" << std::endl;
+
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+// Geänderte Tiles merken
+// --------------------------------------------------------------------------------------
+
+void LevelClass::ClearDirty() {
+    DirtyRows.assign(LEVELSIZE_X, std::make_pair(LEVELSIZE_Y, -1));
+}
+
+void LevelClass::MarkTileDirty(int i, int j) {
+    if (i < 0 || i >= static_cast<int>(DirtyRows.size()) || j < 0 || j >= LEVELSIZE_Y)
+        return;
+
+    DirtyRows[i].first = std::min(DirtyRows[i].first, j);
+    DirtyRows[i].second = std::max(DirtyRows[i].second, j);
+}
+
+// --------------------------------------------------------------------------------------
+// Schnappschüsse der Tiles
+//
+// Ein Schnappschuss teilt sich alle Bricks mit dem Level. Noch nicht ausgepackte v2
+// Chunks werden vorher ausgepackt, sonst stünden im Schnappschuss leere Bricks, die
+// beim Zurückholen über schon ausgepackte Tiles geschrieben würden.
+// --------------------------------------------------------------------------------------
+
+TilePlanes LevelClass::SnapshotTiles() {
+    PrepareAllTiles();
+    return Tiles;
+}
+
+void LevelClass::RestoreTiles(const TilePlanes &Snapshot) {
+    // Andere Grösse: alles neu schreiben
+    if (Snapshot.SizeX != Tiles.SizeX || Snapshot.SizeY != Tiles.SizeY) {
+        Tiles = Snapshot;
+        LEVELSIZE_X = Tiles.SizeX;
+        LEVELSIZE_Y = Tiles.SizeY;
+        DirtyRows.clear();
+        CornerWindow = TileCornerWindow();
+        MarkColorsChanged(0, 0, LEVELSIZE_X, LEVELSIZE_Y);
+        return;
+    }
+
+    // Nur Bricks, die nicht mehr dieselben sind, haben sich geändert
+    bool Changed = false;
+
+    for (size_t b = 0; b < Tiles.Bricks.size(); b++) {
+        if (Tiles.Bricks[b] == Snapshot.Bricks[b])
+            continue;
+
+        Changed = true;
+
+        const int x0 = static_cast<int>(b % Tiles.BricksX) * TILEBRICK_SIZE;
+        const int y0 = static_cast<int>(b / Tiles.BricksX) * TILEBRICK_SIZE;
+        const int x1 = std::min(x0 + TILEBRICK_SIZE, Tiles.SizeX);
+        const int y1 = std::min(y0 + TILEBRICK_SIZE, Tiles.SizeY);
+
+        for (int i = x0; i < x1; i++) {
+            MarkTileDirty(i, y0);
+            MarkTileDirty(i, y1 - 1);
+        }
+    }
+
+    Tiles = Snapshot;
+
+    if (Changed)
+        UpdateCorners(0, 0, LEVELSIZE_X, LEVELSIZE_Y);
+}
+
+// --------------------------------------------------------------------------------------
+// Rechtecke roh lesen und schreiben
+//
+// Innerhalb einer Brickzeile liegen die Tiles am Stück, der Brick wird also nur einmal
+// pro TILEBRICK_SIZE Tiles gesucht (und beim Schreiben höchstens einmal kopiert).
+// Licht und Dirty-Markierung gibt es für das ganze Rechteck nur einmal.
+// --------------------------------------------------------------------------------------
+
+void LevelClass::ReadTiles(int x0, int y0, int x1, int y1, TileRawStruct *Out) {
+    // Noch gepackte v2 Chunks hätten hier nur leere Tiles
+    if (PendingChunks > 0)
+        PrepareChunks(x0, y0, x1, y1);
+
+    for (int j = y0; j < y1; j++)
+        for (int i = x0; i < x1;) {
+            const size_t t = Tiles.Index(i, j);
+            const TileBrick &Brick = *Tiles.Bricks[t / TILEBRICK_TILES];
+            const int n = std::min(x1 - i, TILEBRICK_SIZE - (i & TILEBRICK_MASK));
+
+            for (size_t k = t % TILEBRICK_TILES, e = k + n; k < e; k++)
+                *Out++ = TileRawStruct{Brick.Block[k], Brick.Art[k], Brick.Color[k]};
+
+            i += n;
+        }
+}
+
+void LevelClass::WriteTiles(int x0, int y0, int x1, int y1, const TileRawStruct *In) {
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    if (PendingChunks > 0)
+        PrepareChunks(x0, y0, x1, y1);
+
+    for (int j = y0; j < y1; j++)
+        for (int i = x0; i < x1;) {
+            const size_t t = Tiles.Index(i, j);
+            TileBrick &Brick = Tiles.EditBrick(t);
+            const int n = std::min(x1 - i, TILEBRICK_SIZE - (i & TILEBRICK_MASK));
+
+            // Wie bei SetTile(): Wasser und Sumpf sind immer auch BLOCKWERT_LIQUID
+            for (size_t k = t % TILEBRICK_TILES, e = k + n; k < e; k++, In++) {
+                Brick.Block[k] = LiquidBlock(In->Block);
+                Brick.Art[k] = In->Art;
+                Brick.Color[k] = In->Color;
+            }
+
+            i += n;
+        }
+
+    for (int i = x0; i < x1; i++) {
+        MarkTileDirty(i, y0);
+        MarkTileDirty(i, y1 - 1);
+    }
+
+    UpdateDerived(x0, y0, x1, y1);
+}
+
+// --------------------------------------------------------------------------------------
+// Einzelne Tiles ändern
+//
+// Beim Laden werden Liquid, Wasseranim und Licht für das ganze Level berechnet. Nach
+// einer Änderung muss nur das Tile selbst und was seine Nachbarn davon ablesen neu.
+// --------------------------------------------------------------------------------------
+
+void LevelClass::SetTile(const int i, const int j, const LevelTileStruct &Tile) {
+    // Ein noch gepackter v2 Chunk würde die Änderung beim Auspacken überschreiben
+    if (PendingChunks > 0)
+        PrepareChunks(i, j, i + 1, j + 1);
+
+    LevelTileStruct Changed = Tile;
+    Changed.Block = LiquidBlock(Tile.Block);
+
+    MarkTileDirty(i, j);
+    Tiles.Set(TileIndex(i, j), Changed);
+    UpdateDerived(i, j, i + 1, j + 1);
+}
+
+void LevelClass::UpdateDerived(int x0, int y0, int x1, int y1) {
+    // Die Wasseranim eines Tiles hängt an allen acht Nachbarn, genauso das Licht
+    ComputeWaterAnim(x0 - 1, y0 - 1, x1 + 1, y1 + 1);
+    UpdateCorners(x0, y0, x1, y1);
+}
+
+void LevelClass::RememberSavedState(const std::string &Filename,
+                                         std::vector<LevelObjectStruct> &&Objects,
+                                         const FileAppendix &Appendix) {
+    SavedFilename = Filename;
+    SavedHeader = DateiHeader;
+    SavedObjects = std::move(Objects);
+    SavedAppendix = Appendix;
+    ClearDirty();
+}
+
+// --------------------------------------------------------------------------------------
+// Level speichern
+// Endet der Name auf LEVELV2_EXTENSION, wird der v2 Container geschrieben, sonst .map.
+// Ist die .map noch die, die geladen/zuletzt gespeichert wurde, und haben sich Grösse
+// und Objektanzahl nicht geändert, werden nur die geänderten Tiles und Abschnitte
+// überschrieben. Sonst wird die Datei komplett über eine Temp-Datei ersetzt.
+// --------------------------------------------------------------------------------------
+
+bool LevelClass::SaveLevel(const std::string &Filename) {
+    // Noch gepackte v2 Chunks müssen mit gespeichert werden
+    PrepareAllTiles();
+
+    std::vector<LevelObjectStruct> SaveObjects;
+    for (auto& object: ObjectList.Objects) {
+        if (object.ObjectID == NULLENEMY) {
+            break;
+        }
+
+        SaveObjects.push_back(PackObject(object));
+    }
+
+    // Grösse und Objektanzahl können sich beim Editieren geändert haben
+    DateiHeader.SizeX = FixEndian(static_cast<uint32_t>(LEVELSIZE_X));
+    DateiHeader.SizeY = FixEndian(static_cast<uint32_t>(LEVELSIZE_Y));
+    DateiHeader.NumObjects = FixEndian(static_cast<uint32_t>(SaveObjects.size()));
+
+    memset(DateiAppendix.Col1, 0, 8);
+    memset(DateiAppendix.Col2, 0, 8);
+
+    auto ColToString = [](int col) {
+        std::ostringstream TmpString;
+        TmpString << std::setfill('0') << std::setw(2) << std::hex << col;
+        auto str = TmpString.str();
+        std::transform(str.begin(), str.end(), str.begin(), ::toupper);
+        return str;
+    };
+
+    std::memcpy(&DateiAppendix.Col1[0], ColToString(ColR1).c_str(), 2);
+    std::memcpy(&DateiAppendix.Col1[2], ColToString(ColG1).c_str(), 2);
+    std::memcpy(&DateiAppendix.Col1[4], ColToString(ColB1).c_str(), 2);
+
+    std::memcpy(&DateiAppendix.Col2[0], ColToString(ColR2).c_str(), 2);
+    std::memcpy(&DateiAppendix.Col2[2], ColToString(ColG2).c_str(), 2);
+    std::memcpy(&DateiAppendix.Col2[4], ColToString(ColB2).c_str(), 2);
+
+    std::memcpy(&DateiAppendix.Col1[6], ColToString(ColA1).c_str(), 2);
+    std::memcpy(&DateiAppendix.Col2[6], ColToString(ColA2).c_str(), 2);
+
+    FileAppendix SaveAppendix = DateiAppendix;
+    SaveAppendix.UsedPowerblock = FixEndian(DateiAppendix.UsedPowerblock);
+
+    const bool V2 = fs::path(Filename).extension() == LEVELV2_EXTENSION;
+
+    if (!V2 && PatchLevel(Filename, SaveObjects, SaveAppendix)) {
+        RememberSavedState(Filename, std::move(SaveObjects), SaveAppendix);
+        return true;
+    }
+
+    if (!WriteLevel(Filename, SaveObjects, SaveAppendix))
+        return false;
+
+    // Nur eine .map kann später gepatcht werden
+    if (V2) {
+        SavedFilename.clear();
+        ClearDirty();
+    } else {
+        RememberSavedState(Filename, std::move(SaveObjects), SaveAppendix);
+    }
+
+    return true;
+}
+
+bool LevelClass::PatchLevel(const std::string &Filename,
+                                 const std::vector<LevelObjectStruct> &Objects,
+                                 const FileAppendix &Appendix) {
+    std::error_code ec;
+
+    if (SavedFilename.empty() || !fs::equivalent(Filename, SavedFilename, ec))
+        return false;
+
+    // Alles hinter den Tiles verschiebt sich, wenn sich Grösse oder Objektanzahl ändern
+    if (DateiHeader.SizeX != SavedHeader.SizeX || DateiHeader.SizeY != SavedHeader.SizeY ||
+        Objects.size() != SavedObjects.size() || DirtyRows.size() != static_cast<size_t>(LEVELSIZE_X))
+        return false;
+
+    const size_t TilesOffset = sizeof(FileHeader);
+    const size_t ObjectsOffset = TilesOffset + static_cast<size_t>(LEVELSIZE_X) * LEVELSIZE_Y * sizeof(LevelTileLoadStruct);
+    const size_t AppendixOffset = ObjectsOffset + Objects.size() * sizeof(LevelObjectStruct);
+
+    // Wurde die Datei inzwischen von aussen gekürzt, lieber neu schreiben
+    const auto FileSize = fs::file_size(Filename, ec);
+    if (ec || FileSize < AppendixOffset + sizeof(FileAppendix))
+        return false;
+
+    std::fstream Datei(Filename, std::fstream::in | std::fstream::out | std::fstream::binary);
+    if (!Datei)
+        return false;
+
+    auto Write = [&Datei](size_t Offset, const void *Data, size_t Length) {
+        Datei.seekp(static_cast<std::streamoff>(Offset));
+        Datei.write(static_cast<const char *>(Data), static_cast<std::streamsize>(Length));
+    };
+
+    if (memcmp(&DateiHeader, &SavedHeader, sizeof(FileHeader)) != 0)
+        Write(0, &DateiHeader, sizeof(FileHeader));
+
+    // Pro Spalte liegen die geänderten Tiles am Stück in der Datei
+    std::vector<LevelTileLoadStruct> Run(LEVELSIZE_Y);
+    int Runs = 0;
+
+    for (int i = 0; i < LEVELSIZE_X; i++) {
+        const int First = DirtyRows[i].first;
+        const int Last = DirtyRows[i].second;
+
+        if (First > Last)
+            continue;
+
+        for (int j = First; j <= Last; j++)
+            Run[j - First] = PackTile(Tiles, TileIndex(i, j));
+
+        Write(TilesOffset + (static_cast<size_t>(i) * LEVELSIZE_Y + First) * sizeof(LevelTileLoadStruct), Run.data(),
+              (Last - First + 1) * sizeof(LevelTileLoadStruct));
+        Runs++;
+    }
+
+    if (!Objects.empty() && memcmp(Objects.data(), SavedObjects.data(), Objects.size() * sizeof(LevelObjectStruct)) != 0)
+        Write(ObjectsOffset, Objects.data(), Objects.size() * sizeof(LevelObjectStruct));
+
+    if (memcmp(&Appendix, &SavedAppendix, sizeof(FileAppendix)) != 0)
+        Write(AppendixOffset, &Appendix, sizeof(FileAppendix));
+
+    Datei.close();
+
+    // Halb geschrieben? Dann wird die ganze Datei neu geschrieben
+    if (!Datei) {
+        Protokoll << "-> Error patching " << Filename << ", rewriting it" << std::endl;
+        return false;
+    }
+
+    Protokoll << "-> Saved level " << Filename << " (" << Runs << " tile runs patched)" << std::endl;
+    return true;
+}
+
+bool LevelClass::WriteLevel(const std::string &Filename,
+                                 const std::vector<LevelObjectStruct> &Objects,
+                                 const FileAppendix &Appendix) {
+    // Die Tiles werden Spalte für Spalte gepackt und gleich geschrieben, ein ausgelagertes
+    // Level muss dafür also nie ganz im Speicher liegen
+    auto Column = [this](int i, int j, int Count, LevelTileLoadStruct *Out) {
+        for (int n = 0; n < Count; n++)
+            Out[n] = PackTile(Tiles, TileIndex(i, j + n));
+
+        // Brickspalte fertig?
+        if (j + Count == LEVELSIZE_Y && ((i & TILEBRICK_MASK) == TILEBRICK_MASK || i == LEVELSIZE_X - 1))
+            Tiles.PageOut(i & ~TILEBRICK_MASK, 0, i + 1, LEVELSIZE_Y);
+    };
+
+    // Erst in eine Temp-Datei schreiben und die dann umbenennen, damit bei einem
+    // Fehler die alte Datei heil bleibt
+    const std::string TempFilename = Filename + ".tmp";
+    bool ok;
+
+    if (fs::path(Filename).extension() == LEVELV2_EXTENSION) {
+        ok = WriteLevelV2(TempFilename, DateiHeader, Column, Objects.data(), static_cast<uint32_t>(Objects.size()),
+                          Appendix);
+    } else {
+        std::ofstream Datei(TempFilename, std::ofstream::binary);
+        std::vector<LevelTileLoadStruct> SaveTiles(LEVELSIZE_Y);
+
+        Datei.write(reinterpret_cast<const char *>(&DateiHeader), sizeof(DateiHeader));
+        for (int i = 0; i < LEVELSIZE_X && Datei; i++) {
+            Column(i, 0, LEVELSIZE_Y, SaveTiles.data());
+            Datei.write(reinterpret_cast<const char *>(SaveTiles.data()),
+                        SaveTiles.size() * sizeof(LevelTileLoadStruct));
+        }
+        Datei.write(reinterpret_cast<const char *>(Objects.data()), Objects.size() * sizeof(LevelObjectStruct));
+        Datei.write(reinterpret_cast<const char *>(&Appendix), sizeof(Appendix));
+
+        Datei.close();
+        ok = !Datei.fail();
+    }
+
+    std::error_code ec;
+
+    if (ok)
+        fs::rename(TempFilename, Filename, ec);
+
+    if (!ok || ec) {
+        Protokoll << "-> Error: could not save level " << Filename << std::endl;
+        fs::remove(TempFilename, ec);
+        return false;
+    }
+
+    Protokoll << "-> Saved level " << Filename << std::endl;
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+// Neue Lichtberechnung
+// Jedes Tile hat an allen vier Ecken eine interpolierte Farbe
+// entsprechend der umliegenden Tiles -> smoothe Übergänge -> Geilomat!
+//
+// Gespeichert wird das nur in CornerWindow, für die Bricks um den sichtbaren Bereich.
+// Ändert sich ein Tile, sind auch die Ecken seiner acht Nachbarn neu zu berechnen.
+// --------------------------------------------------------------------------------------
+
+// Block und Farbe eines Bricks samt einem Tile Rand, am Stück. Für das Licht liest jedes
+// Tile zwölf Nachbarn, die müssen so nicht jedesmal erst im BrickWindow gesucht werden.
+// i/j zählen wie dort
+//
+struct BrickCopy {
+    uint32_t Blocks[TILEBRICK_SIZE + 2][TILEBRICK_SIZE + 2];
+    TileBaseColorStruct Colors[TILEBRICK_SIZE + 2][TILEBRICK_SIZE + 2];
+
+    explicit BrickCopy(const BrickWindow &Window) {
+        for (int j = -1; j <= TILEBRICK_SIZE; j++)
+            for (int x = 0; x < 3; x++) {
+                // links eine Spalte, in der Mitte eine ganze Zeile, rechts wieder eine Spalte
+                const int i = x == 0 ? -1 : x == 1 ? 0 : TILEBRICK_SIZE;
+                const int n = x == 1 ? TILEBRICK_SIZE : 1;
+                const TileBrick *Brick = Window.Near[(j + TILEBRICK_SIZE) >> TILEBRICK_SHIFT][x];
+
+                // Ausserhalb des Levels liest das Licht nichts, da reicht irgendwas
+                if (Brick == nullptr) {
+                    memset(&Blocks[j + 1][i + 1], 0, n * sizeof(uint32_t));
+                    memset(&Colors[j + 1][i + 1], 0, n * sizeof(TileBaseColorStruct));
+                    continue;
+                }
+
+                memcpy(&Blocks[j + 1][i + 1], &Brick->Block[BrickWindow::Local(i, j)], n * sizeof(uint32_t));
+                memcpy(&Colors[j + 1][i + 1], &Brick->Color[BrickWindow::Local(i, j)],
+                       n * sizeof(TileBaseColorStruct));
+            }
+    }
+
+    uint32_t Block(int i, int j) const { return Blocks[j + 1][i + 1]; }
+    const TileBaseColorStruct &Color(int i, int j) const { return Colors[j + 1][i + 1]; }
+};
+
+template <typename Tiles>
+inline void interpolateColor(const Tiles& Window, int i, int j, int oi, int oj, int& r, int& g, int& b) {
+    const TileBaseColorStruct& color =
+        (Window.Block(oi, oj) ^ Window.Block(i, j)) & BLOCKWERT_WAND ? Window.Color(i, j) : Window.Color(oi, oj);
+    r = color.Red;
+    g = color.Green;
+    b = color.Blue;
+}
+
+// Ecken von Tile i/j, Window (BrickWindow oder BrickCopy) ist der Brick ab Tile ox/oy
+template <typename Tiles>
+static TileCornerStruct ComputeCorners(const TilePlanes &Grid, const Tiles &Window, int i, int j, int ox, int oy) {
+    // Lichter im Level interpolieren
+    // Dann werden die 4 Ecken des aktuellen Tiles auf die Farben der Nachbarfelder gesetzt
+    // Farben der Nachbarfelder werden allerdings nur mit verrechnet, wenn es sich nicht um eine massive Wand handelt.
+    // In diesem Falle wird die Standard-Tilefarbe verwendet
+    //
+    TileCornerStruct corner;
+    const bool Rand = i < 1 || j < 1 || i >= Grid.SizeX - 1 || j >= Grid.SizeY - 1;
+
+    i -= ox;
+    j -= oy;
+
+    const TileBaseColorStruct& color = Window.Color(i, j);
+
+    int const al = color.Alpha;
+
+    int const r4 = color.Red;
+    int const g4 = color.Green;
+    int const b4 = color.Blue;
+
+    // Am Rand fehlen Nachbarn, da bleibt es bei der Tilefarbe
+    if (Rand) {
+        corner.Color[0] = corner.Color[1] = corner.Color[2] = corner.Color[3] = D3DCOLOR_RGBA(r4, g4, b4, al);
+        return corner;
+    }
+
+    int rn, gn, bn, r1, r2, r3, g1, g2, g3, b1, b2, b3;
+
+    // Ecke links oben
+    //
+    interpolateColor(Window, i, j, i - 1, j - 1, r1, g1, b1);
+    interpolateColor(Window, i, j, i + 0, j - 1, r2, g2, b2);
+    interpolateColor(Window, i, j, i - 1, j + 0, r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[0] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    // Ecke rechts oben
+    //
+    interpolateColor(Window, i, j, i - 0, j - 1, r1, g1, b1);
+    interpolateColor(Window, i, j, i + 1, j - 1, r2, g2, b2);
+    interpolateColor(Window, i, j, i + 1, j + 0, r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[1] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    // Ecke links unten
+    //
+    interpolateColor(Window, i, j, i - 1, j - 0, r1, g1, b1);
+    interpolateColor(Window, i, j, i - 1, j + 1, r2, g2, b2);
+    interpolateColor(Window, i, j, i - 0, j + 1, r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[2] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    // Ecke rechts unten
+    //
+    interpolateColor(Window, i, j, i + 1, j - 0, r1, g1, b1);
+    interpolateColor(Window, i, j, i - 0, j + 0, r2, g2, b2);
+    interpolateColor(Window, i, j, i + 1, j + 1, r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[3] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    return corner;
+}
+
+// --------------------------------------------------------------------------------------
+// Licht für eine ganze Brickzeile auf einmal
+//
+// Dasselbe wie ComputeCorners(), nur für 4 (SSE2) oder 8 (AVX2) Tiles nebeneinander.
+// Jeder Nachbar wird einmal ausgewählt (Farbe des Nachbarn, ausser genau einer der
+// beiden ist Wand) und dann für alle Ecken mitbenutzt, in denen er vorkommt. Summen in
+// 16 Bit, /4 ist bei positiven Zahlen >> 2, Alpha kommt vom Tile selbst. D3DCOLOR liegt
+// wie TileBaseColorStruct als R, G, B, A im Speicher, daher geht das bitgenau auf.
+// Die Ränder des Levels übernimmt weiterhin ComputeCorners().
+// --------------------------------------------------------------------------------------
+
+#if defined(LIGHT_SIMD)
+static_assert(sizeof(D3DCOLOR) == 4, "D3DCOLOR must be four bytes");
+
+static void ComputeCornerRowSSE2(const BrickCopy &Window, int i, int j, TileCornerStruct *Out) {
+    auto LoadColor = [&](int di, int dj) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(&Window.Colors[j + 1 + dj][i + 1 + di]));
+    };
+    auto LoadWall = [&](int di, int dj) {
+        return _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&Window.Blocks[j + 1 + dj][i + 1 + di])),
+                             _mm_set1_epi32(BLOCKWERT_WAND));
+    };
+
+    __m128i const Zero = _mm_setzero_si128();
+    __m128i const Color = LoadColor(0, 0);
+    __m128i const Wall = LoadWall(0, 0);
+
+    // Nachbar oder eigene Farbe, gleich auf 16 Bit: [0] Tile 0 und 1, [1] Tile 2 und 3
+    auto Select = [&](int di, int dj, __m128i *Half) {
+        __m128i const Same = _mm_cmpeq_epi32(LoadWall(di, dj), Wall);
+        __m128i const c = _mm_or_si128(_mm_and_si128(Same, LoadColor(di, dj)), _mm_andnot_si128(Same, Color));
+        Half[0] = _mm_unpacklo_epi8(c, Zero);
+        Half[1] = _mm_unpackhi_epi8(c, Zero);
+    };
+
+    __m128i lo[2], o[2], ro[2], l[2], r[2], lu[2], u[2], ru[2], m[2];
+    Select(-1, -1, lo);
+    Select(0, -1, o);
+    Select(1, -1, ro);
+    Select(-1, 0, l);
+    Select(1, 0, r);
+    Select(-1, 1, lu);
+    Select(0, 1, u);
+    Select(1, 1, ru);
+    m[0] = _mm_unpacklo_epi8(Color, Zero);
+    m[1] = _mm_unpackhi_epi8(Color, Zero);
+
+    auto Corner = [&](const __m128i *a, const __m128i *b, const __m128i *c) {
+        __m128i const s0 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a[0], b[0]), _mm_add_epi16(c[0], m[0])), 2);
+        __m128i const s1 = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(a[1], b[1]), _mm_add_epi16(c[1], m[1])), 2);
+        __m128i const AlphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+        return _mm_or_si128(_mm_andnot_si128(AlphaMask, _mm_packus_epi16(s0, s1)), _mm_and_si128(AlphaMask, Color));
+    };
+
+    __m128i const c0 = Corner(lo, o, l);
+    __m128i const c1 = Corner(o, ro, r);
+    __m128i const c2 = Corner(l, lu, u);
+    __m128i const c3 = Corner(r, m, ru);
+
+    // Ecke für Ecke -> Tile für Tile
+    __m128i const a = _mm_unpacklo_epi32(c0, c1);
+    __m128i const b = _mm_unpackhi_epi32(c0, c1);
+    __m128i const c = _mm_unpacklo_epi32(c2, c3);
+    __m128i const d = _mm_unpackhi_epi32(c2, c3);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&Out[0]), _mm_unpacklo_epi64(a, c));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&Out[1]), _mm_unpackhi_epi64(a, c));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&Out[2]), _mm_unpacklo_epi64(b, d));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&Out[3]), _mm_unpackhi_epi64(b, d));
+}
+
+#if defined(__AVX2__)
+// Wie oben, die beiden 128 Bit Hälften rechnen je vier Tiles für sich
+static void ComputeCornerRowAVX2(const BrickCopy &Window, int i, int j, TileCornerStruct *Out) {
+    auto LoadColor = [&](int di, int dj) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&Window.Colors[j + 1 + dj][i + 1 + di]));
+    };
+    auto LoadWall = [&](int di, int dj) {
+        return _mm256_and_si256(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&Window.Blocks[j + 1 + dj][i + 1 + di])),
+            _mm256_set1_epi32(BLOCKWERT_WAND));
+    };
+
+    __m256i const Zero = _mm256_setzero_si256();
+    __m256i const Color = LoadColor(0, 0);
+    __m256i const Wall = LoadWall(0, 0);
+
+    auto Select = [&](int di, int dj, __m256i *Half) {
+        __m256i const Same = _mm256_cmpeq_epi32(LoadWall(di, dj), Wall);
+        __m256i const c = _mm256_blendv_epi8(Color, LoadColor(di, dj), Same);
+        Half[0] = _mm256_unpacklo_epi8(c, Zero);
+        Half[1] = _mm256_unpackhi_epi8(c, Zero);
+    };
+
+    __m256i lo[2], o[2], ro[2], l[2], r[2], lu[2], u[2], ru[2], m[2];
+    Select(-1, -1, lo);
+    Select(0, -1, o);
+    Select(1, -1, ro);
+    Select(-1, 0, l);
+    Select(1, 0, r);
+    Select(-1, 1, lu);
+    Select(0, 1, u);
+    Select(1, 1, ru);
+    m[0] = _mm256_unpacklo_epi8(Color, Zero);
+    m[1] = _mm256_unpackhi_epi8(Color, Zero);
+
+    auto Corner = [&](const __m256i *a, const __m256i *b, const __m256i *c) {
+        __m256i const s0 =
+            _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a[0], b[0]), _mm256_add_epi16(c[0], m[0])), 2);
+        __m256i const s1 =
+            _mm256_srli_epi16(_mm256_add_epi16(_mm256_add_epi16(a[1], b[1]), _mm256_add_epi16(c[1], m[1])), 2);
+        __m256i const AlphaMask = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        return _mm256_blendv_epi8(_mm256_packus_epi16(s0, s1), Color, AlphaMask);
+    };
+
+    __m256i const c0 = Corner(lo, o, l);
+    __m256i const c1 = Corner(o, ro, r);
+    __m256i const c2 = Corner(l, lu, u);
+    __m256i const c3 = Corner(r, m, ru);
+
+    __m256i const a = _mm256_unpacklo_epi32(c0, c1);
+    __m256i const b = _mm256_unpackhi_epi32(c0, c1);
+    __m256i const c = _mm256_unpacklo_epi32(c2, c3);
+    __m256i const d = _mm256_unpackhi_epi32(c2, c3);
+
+    // Tile 0, 1, 2, 3 in der unteren Hälfte, 4, 5, 6, 7 in der oberen
+    __m256i const t0 = _mm256_unpacklo_epi64(a, c);
+    __m256i const t1 = _mm256_unpackhi_epi64(a, c);
+    __m256i const t2 = _mm256_unpacklo_epi64(b, d);
+    __m256i const t3 = _mm256_unpackhi_epi64(b, d);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&Out[0]), _mm256_permute2x128_si256(t0, t1, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&Out[2]), _mm256_permute2x128_si256(t2, t3, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&Out[4]), _mm256_permute2x128_si256(t0, t1, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(&Out[6]), _mm256_permute2x128_si256(t2, t3, 0x31));
+}
+#endif
+#endif
+
+// Ecken der Tiles von Brick bx/by in den Zeilen [y0, y1). Gerechnet wird immer die ganze
+// Brickzeile, Tiles ausserhalb von [x0, x1) bekommen dabei dasselbe Licht wie sonst auch
+static void ComputeBrickCorners(const TilePlanes &Grid, int bx, int by, TileCornerBrick &Out, int x0, int y0, int x1,
+                                int y1) {
+    const BrickCopy Window{BrickWindow(Grid, bx, by)};
+    const int ox = bx * TILEBRICK_SIZE;
+    const int oy = by * TILEBRICK_SIZE;
+
+#if defined(LIGHT_SIMD)
+    (void)x0;
+    (void)x1;
+
+    for (int j = std::max(y0, oy); j < std::min(y1, oy + TILEBRICK_SIZE); j++) {
+        TileCornerStruct *Row = &Out.Corner[BrickWindow::Local(0, j)];
+
+#if defined(__AVX2__)
+        for (int i = 0; i < TILEBRICK_SIZE; i += 8)
+            ComputeCornerRowAVX2(Window, i, j - oy, Row + i);
+#else
+        for (int i = 0; i < TILEBRICK_SIZE; i += 4)
+            ComputeCornerRowSSE2(Window, i, j - oy, Row + i);
+#endif
+
+        // Am Rand des Levels fehlen Nachbarn
+        if (j < 1 || j >= Grid.SizeY - 1) {
+            for (int i = ox; i < ox + TILEBRICK_SIZE; i++)
+                Row[i - ox] = ComputeCorners(Grid, Window, i, j, ox, oy);
+        } else {
+            if (ox == 0)
+                Row[0] = ComputeCorners(Grid, Window, 0, j, ox, oy);
+            if (Grid.SizeX - 1 >= ox && Grid.SizeX - 1 < ox + TILEBRICK_SIZE)
+                Row[Grid.SizeX - 1 - ox] = ComputeCorners(Grid, Window, Grid.SizeX - 1, j, ox, oy);
+        }
+    }
+#else
+    for (int j = std::max(y0, oy); j < std::min(y1, oy + TILEBRICK_SIZE); j++)
+        for (int i = std::max(x0, ox); i < std::min(x1, ox + TILEBRICK_SIZE); i++)
+            Out.Corner[BrickWindow::Local(i, j)] = ComputeCorners(Grid, Window, i, j, ox, oy);
+#endif
+}
+
+// --------------------------------------------------------------------------------------
+// Viele Bricks auf einmal (Fenster springt, Zoom raus, ComputeCoolLight)
+//
+// Jeder Brick liest nur die Tiles und schreibt nur sein eigenes TileCornerBrick.
+// --------------------------------------------------------------------------------------
+
+struct CornerJob {
+    int bx, by;
+    TileCornerBrick *Out;
+};
+
+static void ComputeCornerJobs(const TilePlanes &Grid, const std::vector<CornerJob> &Jobs, int x0, int y0, int x1,
+                              int y1) {
+    for (const CornerJob &Job : Jobs)
+        ComputeBrickCorners(Grid, Job.bx, Job.by, *Job.Out, x0, y0, x1, y1);
+}
+
+TileCornerStruct ComputeTileCorners(const TilePlanes &Planes, int i, int j) {
+    const int bx = i >> TILEBRICK_SHIFT;
+    const int by = j >> TILEBRICK_SHIFT;
+
+    return ComputeCorners(Planes, BrickWindow(Planes, bx, by), i, j, bx * TILEBRICK_SIZE, by * TILEBRICK_SIZE);
+}
+
+void LevelClass::PrepareCorners(int x0, int y0, int x1, int y1) {
+    const int bx0 = std::max(x0, 0) >> TILEBRICK_SHIFT;
+    const int by0 = std::max(y0, 0) >> TILEBRICK_SHIFT;
+    const int bx1 = TileBricks(std::min(x1, LEVELSIZE_X));
+    const int by1 = TileBricks(std::min(y1, LEVELSIZE_Y));
+
+    if (bx0 >= bx1 || by0 >= by1)
+        return;
+
+    // Mit Lightmap braucht es das Fenster nicht, dann auch keinen Speicher dafür
+    if (!CornerLight) {
+        if (!CornerWindow.Bricks.empty()) {
+            CornerWindow = TileCornerWindow();
+            CornerSpare = TileCornerWindow();
+        }
+        return;
+    }
+
+    // Noch dieselben Bricks, dann ist schon alles berechnet
+    if (bx0 == CornerWindow.BrickX && by0 == CornerWindow.BrickY && bx1 - bx0 == CornerWindow.Width &&
+        by1 - by0 == CornerWindow.Height)
+        return;
+
+    CornerSpare.BrickX = bx0;
+    CornerSpare.BrickY = by0;
+    CornerSpare.Width = bx1 - bx0;
+    CornerSpare.Height = by1 - by0;
+    CornerSpare.Bricks.resize(static_cast<size_t>(CornerSpare.Width) * CornerSpare.Height);
+
+    // Was schon im alten Fenster lag, wird nur umkopiert
+    std::vector<CornerJob> Jobs;
+
+    for (int by = by0; by < by1; by++)
+        for (int bx = bx0; bx < bx1; bx++) {
+            TileCornerBrick &Brick = CornerSpare.Bricks[static_cast<size_t>(by - by0) * CornerSpare.Width + bx - bx0];
+
+            if (const TileCornerBrick *Old = CornerWindow.Find(bx, by))
+                Brick = *Old;
+            else
+                Jobs.push_back(CornerJob{bx, by, &Brick});
+        }
+
+    ComputeCornerJobs(Tiles, Jobs, 0, 0, LEVELSIZE_X, LEVELSIZE_Y);
+
+    std::swap(CornerWindow, CornerSpare);
+}
+
+void LevelClass::UpdateCorners(int x0, int y0, int x1, int y1) {
+    MarkColorsChanged(x0, y0, x1, y1);
+
+    // Die Nachbarn rundherum rechnen mit den geänderten Tiles
+    x0 = std::max(x0 - 1, CornerWindow.BrickX * TILEBRICK_SIZE);
+    y0 = std::max(y0 - 1, CornerWindow.BrickY * TILEBRICK_SIZE);
+    x1 = std::min(x1 + 1, (CornerWindow.BrickX + CornerWindow.Width) * TILEBRICK_SIZE);
+    y1 = std::min(y1 + 1, (CornerWindow.BrickY + CornerWindow.Height) * TILEBRICK_SIZE);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    std::vector<CornerJob> Jobs;
+
+    for (int by = y0 >> TILEBRICK_SHIFT; by <= (y1 - 1) >> TILEBRICK_SHIFT; by++)
+        for (int bx = x0 >> TILEBRICK_SHIFT; bx <= (x1 - 1) >> TILEBRICK_SHIFT; bx++)
+            Jobs.push_back(CornerJob{bx, by,
+                                     &CornerWindow.Bricks[static_cast<size_t>(by - CornerWindow.BrickY) *
+                                                              CornerWindow.Width +
+                                                          bx - CornerWindow.BrickX]});
+
+    ComputeCornerJobs(Tiles, Jobs, x0, y0, x1, y1);
+}
+
+// [x0, x1) x [y0, y1) zum Rechteck X0..Y1 dazunehmen, auf das Level begrenzt
+static void UniteRect(int &X0, int &Y0, int &X1, int &Y1, int x0, int y0, int x1, int y1, int SizeX, int SizeY) {
+    x0 = std::max(x0, 0);
+    y0 = std::max(y0, 0);
+    x1 = std::min(x1, SizeX);
+    y1 = std::min(y1, SizeY);
+
+    if (x0 >= x1 || y0 >= y1)
+        return;
+
+    if (X0 >= X1) {
+        X0 = x0;
+        Y0 = y0;
+        X1 = x1;
+        Y1 = y1;
+        return;
+    }
+
+    X0 = std::min(X0, x0);
+    Y0 = std::min(Y0, y0);
+    X1 = std::max(X1, x1);
+    Y1 = std::max(Y1, y1);
+}
+
+void LevelClass::MarkColorsChanged(int x0, int y0, int x1, int y1) {
+    UniteRect(ColorsChangedX0, ColorsChangedY0, ColorsChangedX1, ColorsChangedY1, x0, y0, x1, y1, LEVELSIZE_X,
+              LEVELSIZE_Y);
+
+    // Hier kommt jede Änderung an den Tiles vorbei, Ecken und Wasseranim reichen ein Tile
+    // weiter. Rechts noch eins, die TileEngine zeichnet ein Tile nach seinem linken
+    // Nachbarn, wenn der schwabbelt
+    UniteRect(TilesChangedX0, TilesChangedY0, TilesChangedX1, TilesChangedY1, x0 - 1, y0 - 1, x1 + 2, y1 + 1,
+              LEVELSIZE_X, LEVELSIZE_Y);
+}
+
+void LevelClass::ComputeCoolLight() {
+    UpdateCorners(0, 0, LEVELSIZE_X, LEVELSIZE_Y);
+}  // ComputeCoolLight
+
+// --------------------------------------------------------------------------------------
+// Die Brickzeilen-Berechnung (SIMD) und ComputeTileCorners() müssen beide genau dasselbe
+// liefern wie Reference (checklight nimmt dafür die alte Berechnung Tile für Tile). Geht
+// Brickzeile für Brickzeile durch das ganze Level, braucht also auch bei ausgelagerten
+// Levels nicht mehr Speicher als eine Zeile.
+// --------------------------------------------------------------------------------------
+
+size_t LevelClass::CheckCoolLight(const std::function<TileCornerStruct(int i, int j)> &Reference) {
+    PrepareAllTiles();
+
+    std::vector<TileCornerBrick> Row(Tiles.BricksX);
+    std::vector<CornerJob> Jobs;
+    size_t Mismatches = 0;
+
+    for (int by = 0; by < TileBricks(LEVELSIZE_Y); by++) {
+        Jobs.clear();
+        for (int bx = 0; bx < Tiles.BricksX; bx++)
+            Jobs.push_back(CornerJob{bx, by, &Row[bx]});
+
+        ComputeCornerJobs(Tiles, Jobs, 0, 0, LEVELSIZE_X, LEVELSIZE_Y);
+
+        for (int j = by * TILEBRICK_SIZE; j < std::min((by + 1) * TILEBRICK_SIZE, LEVELSIZE_Y); j++)
+            for (int i = 0; i < LEVELSIZE_X; i++) {
+                const TileCornerStruct Expected = Reference(i, j);
+                const TileCornerStruct Brick = Row[i >> TILEBRICK_SHIFT].Corner[BrickWindow::Local(i, j)];
+                const TileCornerStruct Single = ComputeTileCorners(Tiles, i, j);
+
+                if (memcmp(&Brick, &Expected, sizeof(Expected)) == 0 &&
+                    memcmp(&Single, &Expected, sizeof(Expected)) == 0)
+                    continue;
+
+                if (Mismatches++ < 10)
+                    Protokoll << "-> Light mismatch at " << i << "/" << j << std::endl;
+            }
+    }
+
+    return Mismatches;
+}
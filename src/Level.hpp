@@ -0,0 +1,593 @@
+// Datei : Level.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Leveldaten ohne Grafik
+//
+// Tiles, Header, Anhang, Laden/Speichern der .map und v2 Dateien sowie die daraus
+// abgeleiteten Daten (Ecken für die Wasseranim, Lichtberechnung). Hier wird weder
+// OpenGL noch SDL noch wxWidgets gebraucht, damit Tools und Benchmarks ein Level ohne
+// Fenster laden können. TileEngineClass baut darauf das Rendern auf.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _LEVEL_HPP_
+#define _LEVEL_HPP_
+
+// --------------------------------------------------------------------------------------
+// Includes
+// --------------------------------------------------------------------------------------
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Color.hpp"
+#include "Globals.hpp"
+#include "Logdatei.hpp"
+#include "ObjectList.hpp"
+
+class LevelV2File;
+
+// --------------------------------------------------------------------------------------
+// Defines
+// --------------------------------------------------------------------------------------
+
+//----- Flags für den Blockwert
+
+enum BlockValue : uint32_t {
+  BLOCKWERT_WAND           = 0x000001,    // Solide Wand
+  BLOCKWERT_GEGNERWAND     = 0x000002,    // Wand nur für Gegner
+  BLOCKWERT_PLATTFORM      = 0x000004,    // Plattform
+  BLOCKWERT_LIGHT          = 0x000008,    // Licht bei Objekten verändern
+  BLOCKWERT_VERDECKEN      = 0x000010,    // Spieler und Objekte verdecken
+  BLOCKWERT_ANIMIERT_BACK  = 0x000020,    // Animiert Hintergrund
+  BLOCKWERT_ANIMIERT_FRONT = 0x000040,    // Animiert Overlay
+  BLOCKWERT_WASSER         = 0x000080,    // Wasser (macht platsch :D )
+  BLOCKWERT_SCHADEN        = 0x000100,    // Schaden
+  BLOCKWERT_FLIESSBANDL    = 0x000200,    // Fliessband Links
+  BLOCKWERT_FLIESSBANDR    = 0x000400,    // Fliessband Rechts
+  BLOCKWERT_WENDEPUNKT     = 0x000800,    // Bewegte Plattformen umdrehen lassen
+  BLOCKWERT_DESTRUCTIBLE   = 0x001000,    // Zerstörbare Wand
+  BLOCKWERT_MOVELINKS      = 0x002000,    // Textur nach links bewegen
+  BLOCKWERT_OVERLAY_LIGHT  = 0x004000,    // Overlay nimmt Licht an
+  BLOCKWERT_SUMPF          = 0x008000,    // Einsinken
+  BLOCKWERT_EIS            = 0x010000,    // Eis, auf dem man ausrutscht
+  BLOCKWERT_MOVEVERTICAL   = 0x020000,    // Vertikale Texturbewegung
+  BLOCKWERT_WASSERFALL     = 0x040000,    // Wasserfall
+  BLOCKWERT_MOVERECHTS     = 0x080000,    // Textur nach rechts bewegen
+
+  BLOCKWERT_SCHRAEGE_L     = 0x200000,    // Schräge Rechts
+  BLOCKWERT_SCHRAEGE_R     = 0x400000,    // Schräge Rechts
+  BLOCKWERT_LIQUID         = 0x800000,    // Flüssigkeit (Wasser, Säure, Lava, Magensäure)
+
+  // Nur im Speicher, nicht in der Datei: Ecken bei der Wasseranim bewegen (ComputeWaterAnim)
+  BLOCKWERT_MOVE_V1        = 0x1000000,   // links oben
+  BLOCKWERT_MOVE_V2        = 0x2000000,   // rechts oben
+  BLOCKWERT_MOVE_V3        = 0x4000000,   // links unten
+  BLOCKWERT_MOVE_V4        = 0x8000000    // rechts unten
+};
+
+constexpr uint32_t BLOCKWERT_WASSERANIM = BLOCKWERT_MOVE_V1 | BLOCKWERT_MOVE_V2 | BLOCKWERT_MOVE_V3 | BLOCKWERT_MOVE_V4;
+
+// Im Speicher ist jedes Wasser- und Sumpftile auch BLOCKWERT_LIQUID, in der Datei steht das nicht
+constexpr uint32_t LiquidBlock(const uint32_t Block) {
+    return Block & (BLOCKWERT_WASSER | BLOCKWERT_SUMPF) ? Block | BLOCKWERT_LIQUID : Block;
+}
+
+//--- Werte zur Levelgrösse
+
+constexpr int ORIGINAL_TILE_SIZE_X = 20;         // Grösse eines
+constexpr int ORIGINAL_TILE_SIZE_Y = 20;         // einzelnen Tiles
+constexpr float TILESETSIZE_X = 256.0f;  // Grösse eines
+constexpr float TILESETSIZE_Y = 256.0f;  // Tilesets
+
+constexpr int MAX_LEVELSIZE_X = 32768;  // Gesamtgrösse des Level, grosse Levels lagert
+constexpr int MAX_LEVELSIZE_Y = 32768;  // der TilePager aus
+
+constexpr int TILEBRICK_SHIFT = 4;                               // Tiles liegen in Bricks zu
+constexpr int TILEBRICK_SIZE = 1 << TILEBRICK_SHIFT;             // 16x16 Tiles, innerhalb eines
+constexpr int TILEBRICK_MASK = TILEBRICK_SIZE - 1;               // Bricks und von Brick zu Brick
+constexpr int TILEBRICK_TILES = TILEBRICK_SIZE * TILEBRICK_SIZE;  // zeilenweise
+
+constexpr int MAX_TILESETS = 64;     // Maximalzahl der Tilesets
+constexpr int INCLUDE_ZEROTILE = 1;  // Tile = 0;,0 im Tileset mit verwenden ?
+
+constexpr int MAX_TILERECTS = 144;
+
+constexpr char LEVELV2_EXTENSION[] = ".map2";  // Dateiendung für den v2 Level-Container
+
+// --------------------------------------------------------------------------------------
+// Strukturen
+// --------------------------------------------------------------------------------------
+
+// Struktur für ein Level Tile wie es aus dem Level geladen wird
+//
+struct LevelTileLoadStruct {
+    uint8_t TileSetBack;              // Back  aus welchem Tileset ?
+    uint8_t TileSetFront;             // Front aus welchem Tileset ?
+    uint8_t BackArt;                  // Tile im Hintergrund
+    uint8_t FrontArt;                 // Tile im Vordergrund
+    uint8_t Red, Green, Blue, Alpha;  // Farbwert des Tiles
+    uint32_t Block;                   // Blockierungsart (siehe #defines)
+};
+
+static_assert(sizeof(LevelTileLoadStruct) == 12, "Size of LevelTileLoadStruct is wrong");
+
+// Ein ganzes Level Tile wie beim Laden, nur noch mit Extra Farben für alle Ecken. Im Level
+// selbst liegen die Teile davon getrennt in TilePlanes, das hier ist nur noch die Sicht
+// auf ein einzelnes Tile (GUI, Journal)
+//
+struct LevelTileStruct {
+    unsigned char TileSetBack;                // Back  aus welchem Tileset ?
+    unsigned char TileSetFront;               // Front aus welchem Tileset ?
+    unsigned char BackArt;                    // Tile im Hintergrund
+    unsigned char FrontArt;                   // Tile im Vordergrund
+    unsigned char Red, Green, Blue, Alpha;    // Farbwert des Tiles
+    D3DCOLOR Color[4];                        // Farbwert des Tiles (Alle vier Ecken)
+    uint32_t Block;                           // Blockierungsart (siehe #defines)
+    bool move_v1, move_v2, move_v3, move_v4;  // Die Ecken eines Tiles bei der Wasseranim bewegen?
+};
+
+static_assert(sizeof(LevelTileStruct) == 32, "Size of LevelTileStruct is wrong");
+
+// Teile eines Tiles, wie sie in TilePlanes liegen
+//
+struct TileArtStruct {
+    uint8_t TileSetBack;   // Back  aus welchem Tileset ?
+    uint8_t TileSetFront;  // Front aus welchem Tileset ?
+    uint8_t BackArt;       // Tile im Hintergrund
+    uint8_t FrontArt;      // Tile im Vordergrund
+};
+
+struct TileBaseColorStruct {
+    uint8_t Red, Green, Blue, Alpha;  // Farbwert des Tiles aus der Datei
+};
+
+struct TileCornerStruct {
+    D3DCOLOR Color[4];  // Licht an allen vier Ecken (ComputeCoolLight)
+};
+
+static_assert(sizeof(TileArtStruct) == 4 && sizeof(TileBaseColorStruct) == 4 && sizeof(TileCornerStruct) == 16,
+              "Size of the tile planes is wrong");
+
+// Ein Tile genau so, wie es in den Ebenen eines Bricks liegt (Block mit LIQUID und
+// Wasseranim), für ReadTiles()/WriteTiles()
+//
+struct TileRawStruct {
+    uint32_t Block;
+    TileArtStruct Art;
+    TileBaseColorStruct Color;
+};
+
+static_assert(sizeof(TileRawStruct) == 12, "Size of TileRawStruct is wrong");
+
+// --------------------------------------------------------------------------------------
+// Tiles in Bricks
+//
+// Die Draw-Funktionen gehen das Level Zeile für Zeile durch, beim Laden, Licht und
+// Wasser sind es immer nur die direkten Nachbarn. Spaltenweise abgelegt lag jedes Tile
+// einer Zeile eine ganze Spalte weiter, in 16x16 Bricks liegen 16 Tiles einer Zeile am
+// Stück und die Nachbarn darüber und darunter im selben Brick.
+// --------------------------------------------------------------------------------------
+
+// Bricks für Size Tiles (in X oder Y)
+inline int TileBricks(const int Size) {
+    return (Size + TILEBRICK_MASK) >> TILEBRICK_SHIFT;
+}
+
+// Platz für ein Level in Bricks, am rechten und unteren Rand aufgefüllt
+inline size_t TileBrickStorage(const int SizeX, const int SizeY) {
+    return static_cast<size_t>(TileBricks(SizeX)) * TileBricks(SizeY) * TILEBRICK_TILES;
+}
+
+// Index von Tile i/j, wenn BricksX Bricks in einer Brickzeile liegen
+inline size_t TileBrickIndex(const int i, const int j, const int BricksX) {
+    return (static_cast<size_t>(j >> TILEBRICK_SHIFT) * BricksX + (i >> TILEBRICK_SHIFT)) * TILEBRICK_TILES +
+           ((j & TILEBRICK_MASK) << TILEBRICK_SHIFT) + (i & TILEBRICK_MASK);
+}
+
+// --------------------------------------------------------------------------------------
+// Tiles in getrennten Ebenen
+//
+// Jede Schleife liest nur, was sie braucht: DrawWater und die Kollisionsabfragen nur
+// Block, die Draw-Funktionen erst Block und Art und nur für wirklich gezeichnete Tiles
+// noch die Ecken, Licht und Wasseranim die Farben und Blocks der Nachbarn.
+//
+// Jeder Brick hat seine eigenen Ebenen und wird nur über einen shared_ptr gehalten. Eine
+// Kopie von TilePlanes kopiert also nur die Zeiger und ist ein Schnappschuss des ganzen
+// Levels, der sich alle Bricks mit dem Original teilt. Geschrieben wird nur über
+// EditBrick(), das einen geteilten Brick vorher kopiert. Schnappschüsse nimmt nur der
+// Thread, der auch schreibt, lesen und freigeben dürfen sie dann alle.
+//
+// Levels mit mehr Bricks als TilePager::ResidentLimit() bekommen einen Pager, dann
+// liegen die Bricks in dessen Auslagerungsdatei. Lesen geht trotzdem immer, was gleich
+// gebraucht wird, meldet KeepResident() an, was erstmal nicht mehr, PageOut().
+//
+// Gespeichert werden nur die 12 Bytes aus der Datei, die Wasseranim steckt in freien
+// Bits von Block. Das Licht der Ecken (16 Bytes) lässt sich jederzeit aus den Nachbarn
+// berechnen und liegt nur für die Bricks um den sichtbaren Bereich in einem
+// TileCornerWindow.
+// --------------------------------------------------------------------------------------
+
+class TilePager;
+
+struct TileBrick {
+    uint32_t Block[TILEBRICK_TILES];             // Blockierungsart (siehe #defines)
+    TileArtStruct Art[TILEBRICK_TILES];          // Tilesets und Tiles
+    TileBaseColorStruct Color[TILEBRICK_TILES];  // Farbe aus der Datei
+};
+
+struct TilePlanes {
+    int SizeX = 0;
+    int SizeY = 0;
+    int BricksX = 0;  // Bricks pro Brickzeile
+
+    std::vector<std::shared_ptr<TileBrick>> Bricks;
+    std::shared_ptr<TilePager> Pager;  // nur bei grossen Levels
+
+    // Alle Tiles leer, bis auf die Farbe. Anfangs teilen sich alle Bricks einen. Eine
+    // Auslagerungsdatei kommt neben LevelFile (siehe TilePager)
+    void Resize(int xSize, int ySize, TileBaseColorStruct Color = {}, const std::string &LevelFile = {});
+
+    size_t Index(const int i, const int j) const { return TileBrickIndex(i, j, BricksX); }
+
+    uint32_t BlockAt(const size_t t) const { return Bricks[t / TILEBRICK_TILES]->Block[t % TILEBRICK_TILES]; }
+    const TileArtStruct &ArtAt(const size_t t) const { return Bricks[t / TILEBRICK_TILES]->Art[t % TILEBRICK_TILES]; }
+    const TileBaseColorStruct &ColorAt(const size_t t) const {
+        return Bricks[t / TILEBRICK_TILES]->Color[t % TILEBRICK_TILES];
+    }
+
+    // Brick mit Tile t zum Schreiben, Index darin ist t % TILEBRICK_TILES
+    TileBrick &EditBrick(const size_t t) {
+        std::shared_ptr<TileBrick> &Brick = Bricks[t / TILEBRICK_TILES];
+        if (Brick.use_count() > 1)
+            CloneBrick(Brick);
+        return *Brick;
+    }
+
+    // Bricks, die [x0, x1) x [y0, y1) berühren, im Speicher halten oder auslagern
+    void KeepResident(int x0, int y0, int x1, int y1);
+    void PageOut(int x0, int y0, int x1, int y1);
+
+    LevelTileStruct Get(size_t t) const;              // Tile aus allen Ebenen zusammensetzen
+    void Set(size_t t, const LevelTileStruct &Tile);  // und wieder verteilen
+
+  private:
+    void CloneBrick(std::shared_ptr<TileBrick> &Brick);
+};
+
+// Licht der Ecken von Tile i/j aus den Nachbarn berechnen
+TileCornerStruct ComputeTileCorners(const TilePlanes &Planes, int i, int j);
+
+// Licht der Ecken für einen Brick
+//
+struct TileCornerBrick {
+    TileCornerStruct Corner[TILEBRICK_TILES];
+};
+
+// Licht der Ecken für ein Rechteck aus Bricks, zeilenweise
+//
+// PrepareTiles() schiebt das Fenster mit dem sichtbaren Bereich mit. Berechnet werden
+// nur Bricks, die dabei neu hineinkommen, also nur beim Überschreiten einer Brickkante.
+// Bei normalem Scrollen kostet das im Mittel so viel wie vorher das Auspacken allein,
+// springt die Ansicht weit, ein paar µs pro Frame, gegenüber gut 1 ms für die Tiles.
+//
+struct TileCornerWindow {
+    int BrickX = 0;  // linke obere Ecke
+    int BrickY = 0;
+    int Width = 0;   // Grösse in Bricks
+    int Height = 0;
+    std::vector<TileCornerBrick> Bricks;
+
+    // nullptr, wenn Brick bx/by nicht im Fenster liegt
+    const TileCornerBrick *Find(int bx, int by) const {
+        bx -= BrickX;
+        by -= BrickY;
+        if (bx < 0 || by < 0 || bx >= Width || by >= Height)
+            return nullptr;
+        return &Bricks[static_cast<size_t>(by) * Width + bx];
+    }
+};
+
+// Geht eine Tilezeile nach rechts durch, ohne für jedes Tile den Brick neu zu suchen.
+// Wie weit, muss der Aufrufer selbst auf das Level begrenzen. Das Licht der Ecken kommt
+// aus Corners, für Tiles ausserhalb wird es erst bei Bedarf berechnet
+//
+class TileRowIterator {
+  public:
+    TileRowIterator(const TilePlanes &Planes, const int i, const int j, const TileCornerWindow *Corners = nullptr) :
+        itsPlanes(&Planes),
+        itsCorners(Corners),
+        itsNext(Planes.Bricks.data() + Planes.Index(i, j) / TILEBRICK_TILES),
+        itsEnd(Planes.Bricks.data() + Planes.Bricks.size()),
+        itsBrick(itsNext->get()),
+        itsCornerBrick(Corners ? Corners->Find(i >> TILEBRICK_SHIFT, j >> TILEBRICK_SHIFT) : nullptr),
+        itsTile(Planes.Index(i, j) % TILEBRICK_TILES),
+        itsLeft(TILEBRICK_SIZE - (i & TILEBRICK_MASK)),
+        itsX(i),
+        itsY(j) {}
+
+    uint32_t Block() const { return itsBrick->Block[itsTile]; }
+    const TileArtStruct &Art() const { return itsBrick->Art[itsTile]; }
+    const TileBaseColorStruct &Color() const { return itsBrick->Color[itsTile]; }
+
+    const TileCornerStruct &Corner() const {
+        if (itsCornerBrick != nullptr)
+            return itsCornerBrick->Corner[itsTile];
+
+        itsCorner = ComputeTileCorners(*itsPlanes, itsX, itsY);
+        return itsCorner;
+    }
+
+    TileRowIterator &operator++() {
+        itsX++;
+
+        if (--itsLeft > 0) {
+            itsTile++;
+        } else {
+            // gleiche Zeile im Brick rechts daneben
+            itsTile -= TILEBRICK_SIZE - 1;
+            itsLeft = TILEBRICK_SIZE;
+            itsBrick = ++itsNext < itsEnd ? itsNext->get() : nullptr;
+            itsCornerBrick =
+                itsCorners ? itsCorners->Find(itsX >> TILEBRICK_SHIFT, itsY >> TILEBRICK_SHIFT) : nullptr;
+        }
+        return *this;
+    }
+
+  private:
+    const TilePlanes *itsPlanes;
+    const TileCornerWindow *itsCorners;
+    const std::shared_ptr<TileBrick> *itsNext;
+    const std::shared_ptr<TileBrick> *itsEnd;
+    const TileBrick *itsBrick;
+    const TileCornerBrick *itsCornerBrick;  // nullptr: ausserhalb von itsCorners
+    size_t itsTile;                         // im Brick
+    int itsLeft;                            // Tiles bis zum Ende der Brickzeile
+    int itsX, itsY;                         // Tile im Level
+    mutable TileCornerStruct itsCorner;     // bei Bedarf berechnetes Licht
+};
+
+// --------------------------------------------------------------------------------------
+// Struktur für ein aus dem Level zu ladendes Objekte
+// --------------------------------------------------------------------------------------
+
+struct LevelObjectStruct {
+    uint32_t ObjectID;           // Welche Objekt ID ?
+    int32_t XPos;                // x-Position
+    int32_t YPos;                // y-Position
+    bool ChangeLight;         // Umgebungslicht annehmen ?
+    uint8_t Skill;               // 0 = Easy, 1 = Medium, 2 = Hard, 3 = Hurrican
+    uint8_t PADDING_CHUNK_1[2];  // 2 PADDING BYTES
+    int32_t Value1;              // Werte für diverse Trigger
+    int32_t Value2;              // Werte für diverse Trigger
+};
+
+static_assert(sizeof(LevelObjectStruct) == 24, "Size of LevelObjectStruct is wrong");
+
+// --------------------------------------------------------------------------------------
+// Level-Datei Header
+// --------------------------------------------------------------------------------------
+
+struct FileHeader {
+    char Kennung[46];            // Level-Kennung
+    char Beschreibung[100];      // Level-Beschreibung
+    char BackgroundFile[24];     // Dateiname des Hintergrundes
+    char ParallaxAFile[24];      // Dateiname des 1. Parallax Layers
+    char ParallaxBFile[24];      // Dateiname des 2. Parallax Layers
+    char CloudFile[24];          // Dateiname des WolkenLayers
+    uint8_t PADDING_CHUNK_1[2];  // 2 PADDING  BYTES
+    uint32_t Timelimit;          // aktuelles Zeitlimit des Levels
+    uint8_t UsedTilesets;        // Anzahl der Tilesets
+    char SetNames[64][16];       // Namen der benutzten Sets
+    uint8_t PADDING_CHUNK_2[3];  // 3 PADDING BYTES
+    uint32_t SizeX, SizeY;       // Größe des Levels
+    uint32_t NumObjects;         // Anzahl der Objekte
+    uint8_t ScrollBackground;    // Hintergrundbild srollen oder statisch ?
+    uint8_t PADDING_CHUNK_3[3];  // 3 PADDING BYTES
+};
+
+static_assert(sizeof(FileHeader) == 1292, "Size of FileHeader is wrong");
+
+// --------------------------------------------------------------------------------------
+// Anhang am File nach den Level Daten
+// damit nicht alle levels nochmal konvertiert werden, hänge ich einfach alle dinge, die
+// noch ins level format reinmüssen, dahinter =)
+// --------------------------------------------------------------------------------------
+
+struct FileAppendix {
+    char Songs[2][30];       // Namen der benutzten Songs (Stage und Boss)
+    int32_t UsedPowerblock;  // ID der benutzten Powerblock Art
+    char Col1[8], Col2[8];   // Farben für Liquid
+    uint8_t Taschenlampe;
+    uint8_t PADDING_CHUNK_1[3];  // 3 padding bytes
+};
+
+static_assert(sizeof(FileAppendix) == 84, "Size of FileAppendix is wrong");
+
+// --------------------------------------------------------------------------------------
+// Eingelesenes, aber noch nicht übernommenes Level
+// --------------------------------------------------------------------------------------
+
+// Fortschritt und Abbruch, wird beim Einlesen geschrieben und von aussen gelesen
+//
+struct LevelLoadProgress {
+    std::atomic<float> Fraction{0.0f};  // 0.0 - 1.0
+    std::atomic<bool> Cancel{false};    // von aussen gesetzt, das Einlesen bricht dann ab
+};
+
+// Ein fertig eingelesenes Level, das noch nicht im LevelClass steckt
+//
+struct LevelStage {
+    LevelStage();
+    ~LevelStage();
+
+    std::string Filename;
+    FileHeader Header;      // NumObjects schon korrigiert
+    FileAppendix Appendix;  // UsedPowerblock schon FixEndian
+    int SizeX = 0;
+    int SizeY = 0;
+
+    TilePlanes Tiles;                    // wie LevelClass::Tiles (leer bei v2)
+    std::unique_ptr<LevelV2File> V2;     // v2 Chunks werden erst nach dem Tausch ausgepackt
+
+    std::vector<Object> Objects;
+    int MaxSecrets = 0;
+    int MaxDiamonds = 0;
+    int MaxOneUps = 0;
+    int MaxBlocks = 0;
+    bool HasPlayerStart = false;
+    int PlayerX = 0;
+    int PlayerY = 0;
+    bool ObjectsClamped = false;  // mehr als MAX_GEGNER Objekte in der Datei, nur die ersten geladen
+};
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class LevelClass {
+  protected:
+    FileHeader DateiHeader;        // Header der Level-Datei
+    FileAppendix DateiAppendix;    // Anhang der Level-Datei
+    unsigned char LoadedTilesets;  // Anzahl geladener Sets
+
+    // v2 Levels werden chunkweise erst dann ausgepackt, wenn sie in Sicht kommen
+    std::unique_ptr<LevelV2File> LevelV2;  // offene v2 Datei, solange noch Chunks fehlen
+    std::vector<uint8_t> ChunkState;       // pro Chunk CHUNK_PACKED, CHUNK_DECODED oder CHUNK_READY
+    int PendingChunks;                     // Chunks, die noch nicht CHUNK_READY sind
+
+    // Licht der Ecken, nur für die Bricks um den sichtbaren Bereich
+    TileCornerWindow CornerWindow;
+    TileCornerWindow CornerSpare;  // zum Umbauen von CornerWindow, damit nichts neu angelegt wird
+    bool CornerLight;              // false: CornerWindow bleibt leer, das Licht kommt aus der Lightmap
+
+    // Tiles, deren Farbe sich geändert hat, seit die TileEngine sie zuletzt in die Lightmap
+    // geladen hat: [X0, X1) x [Y0, Y1), leer bei X0 >= X1
+    int ColorsChangedX0, ColorsChangedY0, ColorsChangedX1, ColorsChangedY1;
+
+    // dito für die zwischengespeicherten Tiles der TileEngine: geänderte Tiles samt den
+    // Nachbarn, deren Ecken und Wasseranim davon abhängen
+    int TilesChangedX0, TilesChangedY0, TilesChangedX1, TilesChangedY1;
+
+  private:
+    // Stand der .map auf der Platte, damit SaveLevel() nur Geändertes schreiben muss
+    std::string SavedFilename;                    // Datei mit diesem Stand (leer = keine)
+    FileHeader SavedHeader;                       // Header, Objekte und Anhang genau so,
+    std::vector<LevelObjectStruct> SavedObjects;  // wie sie in der Datei stehen
+    FileAppendix SavedAppendix;
+    std::vector<std::pair<int, int>> DirtyRows;   // pro Spalte erste/letzte geänderte Zeile (First > Last: sauber)
+
+    void ClearDirty();
+    void RememberSavedState(const std::string &Filename, std::vector<LevelObjectStruct> &&Objects,
+                            const FileAppendix &Appendix);
+    bool PatchLevel(const std::string &Filename, const std::vector<LevelObjectStruct> &Objects,
+                    const FileAppendix &Appendix);  // nur geänderte Tiles/Abschnitte schreiben
+    bool WriteLevel(const std::string &Filename, const std::vector<LevelObjectStruct> &Objects,
+                    const FileAppendix &Appendix);  // ganze Datei über eine Temp-Datei ersetzen
+
+    bool DecodeChunk(int cx, int cy);                 // v2 Chunk nach Tiles[][] auspacken
+    void PrepareChunk(int cx, int cy);                // auspacken + Wasser/Licht berechnen
+    void PrepareChunks(int x0, int y0, int x1, int y1);     // alle Chunks im Bereich
+    void ComputeWaterAnim(int x0, int y0, int x1, int y1);  // Ecken für die Wasseranim
+    void PrepareCorners(int x0, int y0, int x1, int y1);    // CornerWindow auf den Bereich legen
+    void UpdateCorners(int x0, int y0, int x1, int y1);     // [x0, x1) x [y0, y1) hat sich geändert
+    void UpdateDerived(int x0, int y0, int x1, int y1);     // dito, Wasseranim und Licht
+    void MarkColorsChanged(int x0, int y0, int x1, int y1); // für die Lightmap merken
+
+  public:
+    TilePlanes Tiles;  // Leveldaten, Index über TileIndex()/TileRow()
+
+    int ColR1, ColG1, ColB1, ColA1;  // Farben in RGB
+    int ColR2, ColG2, ColB2, ColA2;
+
+    char Beschreibung[100];      // Beschreibung des Levels
+    int MaxBlocks;
+    int MaxOneUps;
+    int MaxSecrets;
+    int MaxDiamonds;
+
+    float Timelimit;             // Zeitlimit
+    int LEVELSIZE_X;             // Grösse des Levels
+    int LEVELSIZE_Y;             // in Tiles
+
+    LevelClass();   // Konstruktor
+    ~LevelClass();  // Destruktor
+
+    void ClearLevel();                            // Level freigeben
+    bool LoadLevel(const std::string &Filename);  // Level laden (.map oder v2), ohne Grafiken
+    static bool ParseLevel(const std::string &Filename,  // Level nur einlesen, darf auf
+                           LevelStage &Stage,            // jedem Thread laufen. ObjectsParsed
+                           LevelLoadProgress *Progress,  // kommt, sobald Header und Objekte
+                           const std::function<void()> &ObjectsParsed = {});  // in Stage stehen
+    bool ApplyLevel(LevelStage &Stage);           // eingelesenes Level übernehmen
+    bool SaveLevel(const std::string &Filename);  // Save level (v2 bei LEVELV2_EXTENSION)
+    void PrepareTiles(int x0, int y0, int x1, int y1);  // v2 Chunks und Licht im Bereich bereitstellen
+    void PrepareAllTiles();                       // alle v2 Chunks bereitstellen
+    void InitNewLevel(int xSize, int ySize, const std::string &LevelFile = {});  // Neues Level initialisieren
+    void MarkTileDirty(int i, int j);             // geändertes Tile fürs Speichern merken
+
+    TilePlanes SnapshotTiles();                     // teilt alle Bricks, kostet nur die Zeiger
+    void RestoreTiles(const TilePlanes &Snapshot);  // zurück dazu, nur geänderte Bricks werden dirty
+
+    // [x0, x1) x [y0, y1) zeilenweise roh lesen/schreiben, in einem Rutsch statt
+    // GetTile()/SetTile() für jedes Tile (Undo/Redo grosser Bereiche)
+    void ReadTiles(int x0, int y0, int x1, int y1, TileRawStruct *Out);
+    void WriteTiles(int x0, int y0, int x1, int y1, const TileRawStruct *In);
+
+    void ComputeCoolLight();  // Coole   Lightberechnung (für den sichtbaren Bereich, der Rest bei Bedarf)
+    // Licht aller Tiles (Brickzeilen und ComputeTileCorners()) gegen Reference prüfen, gibt Abweichungen zurück
+    size_t CheckCoolLight(const std::function<TileCornerStruct(int i, int j)> &Reference);
+
+#ifdef NDEBUG
+    inline
+#endif
+    size_t TileIndex(const int i, const int j) const {
+#ifndef NDEBUG
+        if (i >= MAX_LEVELSIZE_X || i < 0 || j >= MAX_LEVELSIZE_Y || j < 0) {
+            Protokoll << "-> Error: Out of bounds in LevelClass::TileIndex():\n"
+                      << "\tparam i: " << i << "\tLower bound: " << 0 << "\tUpper bound: " << MAX_LEVELSIZE_X - 1
+                      << "\n"
+                      << "\tparam j: " << j << "\tLower bound: " << 0 << "\tUpper bound: " << MAX_LEVELSIZE_Y - 1
+                      << std::endl;
+            GameRunning = false;
+            exit(EXIT_FAILURE);  // WriteText above should do this for us (first param==true)
+        }
+
+        // Hinter dem Level liegt kein Speicher mehr, also ist das jetzt auch ein Fehler
+        if (i >= LEVELSIZE_X || j >= LEVELSIZE_Y) {
+            Protokoll << "-> Error: Out of level bound in LevelClass::TileIndex():\n"
+                      << "\tparam i: " << i << "\tUpper bound: " << LEVELSIZE_X - 1 << "\n"
+                      << "\tparam j: " << j << "\tUpper bound: " << LEVELSIZE_Y - 1
+                      << std::endl;
+            GameRunning = false;
+            exit(EXIT_FAILURE);
+        }
+#endif
+        return Tiles.Index(i, j);
+    }
+
+    // Tile i/j und die rechts daneben
+    TileRowIterator TileRow(const int i, const int j) const {
+        return TileRowIterator(Tiles, i, j, &CornerWindow);
+    }
+
+    uint32_t BlockAt(const int i, const int j) const { return Tiles.BlockAt(TileIndex(i, j)); }
+
+    LevelTileStruct GetTile(const int i, const int j) const { return Tiles.Get(TileIndex(i, j)); }
+
+    // Alle Änderungen an Tiles gehen hier durch, damit SaveLevel() nur die geänderten
+    // Tiles zurückschreiben muss und Wasseranim und Licht drumherum stimmen
+    void SetTile(int i, int j, const LevelTileStruct &Tile);
+
+    int32_t GetUsedPowerBlock() const { return DateiAppendix.UsedPowerblock; }
+    const char* GetSong(int i) const { return DateiAppendix.Songs[i]; }
+};
+
+#endif
@@ -0,0 +1,604 @@
+// Datei : LevelFormat.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Level-Container Version 2 (siehe LevelFormat.hpp)
+//
+// Ein Chunk wird vor dem Packen in 12 Byte-Ebenen zerlegt (erst alle TileSetBack, dann
+// alle TileSetFront, ...) und die dann mit einem einfachen Lauflängenverfahren (wie
+// PackBits) gepackt. Tilesets, Blockwerte und Farben ändern sich innerhalb eines Chunks
+// kaum, die Ebenen bestehen also fast nur aus langen Läufen. Dafür braucht es keine
+// zusätzliche Bibliothek.
+//
+// Ein Steuerbyte c leitet jeweils ein:
+//   c & 0x80  -> (c & 0x7F) + 1 mal das folgende Byte
+//   sonst     -> c + 1 Bytes folgen unverändert
+//
+// --------------------------------------------------------------------------------------
+
+#include "LevelFormat.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Globals.hpp"
+#include "Logdatei.hpp"
+
+namespace fs = std::filesystem;
+
+// --------------------------------------------------------------------------------------
+// CRC32 (IEEE, wie bei zip/png)
+// --------------------------------------------------------------------------------------
+
+uint32_t LevelCRC32(const uint8_t *Data, size_t Length, uint32_t crc) {
+    static const auto Table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t n = 0; n < Length; n++)
+        crc = Table[(crc ^ Data[n]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// --------------------------------------------------------------------------------------
+// Chunks packen / entpacken
+// --------------------------------------------------------------------------------------
+
+constexpr size_t TILEBYTES = sizeof(LevelTileLoadStruct);
+constexpr int MAX_RUN = 128;
+
+void LevelEncodeTiles(const uint8_t *src, int count, std::vector<uint8_t> &out) {
+    const int size = count * static_cast<int>(TILEBYTES);
+
+    // In Ebenen zerlegen
+    std::vector<uint8_t> planes(size);
+    for (int n = 0; n < count; n++)
+        for (size_t b = 0; b < TILEBYTES; b++)
+            planes[b * count + n] = src[n * TILEBYTES + b];
+
+    const uint8_t *p = planes.data();
+    int n = 0;
+    while (n < size) {
+        // Gleiche Bytes hintereinander?
+        int run = 1;
+        while (n + run < size && run < MAX_RUN && p[n + run] == p[n])
+            run++;
+
+        if (run > 1) {
+            out.push_back(static_cast<uint8_t>(0x80 | (run - 1)));
+            out.push_back(p[n]);
+            n += run;
+            continue;
+        }
+
+        // sonst bis zum nächsten Lauf alles unverändert übernehmen
+        int lit = 1;
+        while (n + lit < size && lit < MAX_RUN && !(n + lit + 1 < size && p[n + lit] == p[n + lit + 1]))
+            lit++;
+
+        out.push_back(static_cast<uint8_t>(lit - 1));
+        out.insert(out.end(), p + n, p + n + lit);
+        n += lit;
+    }
+}
+
+bool LevelDecodeTiles(const uint8_t *src, size_t length, uint8_t *dst, int count) {
+    // Meist ein Chunk, beim Undo aber auch mal ein ganzer Bereich
+    static thread_local std::vector<uint8_t> buffer;
+
+    const int size = count * static_cast<int>(TILEBYTES);
+    if (buffer.size() < static_cast<size_t>(size))
+        buffer.resize(size);
+
+    uint8_t *planes = buffer.data();
+
+    const uint8_t *end = src + length;
+    int n = 0;
+
+    while (src < end) {
+        const uint8_t c = *src++;
+        const int num = (c & 0x7F) + 1;
+
+        if (n + num > size)
+            return false;
+
+        if (c & 0x80) {
+            if (src == end)
+                return false;
+            memset(planes + n, *src++, num);
+        } else {
+            if (end - src < num)
+                return false;
+            memcpy(planes + n, src, num);
+            src += num;
+        }
+
+        n += num;
+    }
+
+    if (n != size)
+        return false;
+
+    // Ebenen wieder zu Tiles zusammensetzen
+    for (int t = 0; t < count; t++)
+        for (size_t b = 0; b < TILEBYTES; b++)
+            dst[t * TILEBYTES + b] = planes[b * count + t];
+
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+// LevelV2File
+// --------------------------------------------------------------------------------------
+
+bool LevelV2File::IsLevelV2(const uint8_t *Data, size_t Size) {
+    return Size >= sizeof(LevelV2Header) && memcmp(Data, LEVELV2_MAGIC, sizeof(LEVELV2_MAGIC)) == 0;
+}
+
+const LevelV2Section *LevelV2File::FindSection(uint32_t Type) const {
+    for (const auto &Section : itsSections)
+        if (Section.Type == Type)
+            return &Section;
+    return nullptr;
+}
+
+bool LevelV2File::Open(const std::string &Filename) {
+    Close();
+
+    if (!itsFile.Open(Filename))
+        return false;
+
+    auto Fail = [&](const char *Reason) {
+        Protokoll << "-> Error: " << Filename << ": " << Reason << std::endl;
+        Close();
+        return false;
+    };
+
+    if (!IsLevelV2(itsFile.Data(), itsFile.Size()))
+        return Fail("not a v2 level");
+
+    LevelV2Header Header;
+    memcpy(&Header, itsFile.Data(), sizeof(Header));
+
+    const uint32_t Version = FixEndian(Header.Version);
+
+    if (Version != LEVELV2_VERSION && Version != LEVELV2_VERSION_OFFSET32)
+        return Fail("unsupported v2 version");
+
+    itsChunkEntrySize = Version == LEVELV2_VERSION_OFFSET32 ? sizeof(LevelV2Chunk32) : sizeof(LevelV2Chunk);
+
+    // Inhaltsverzeichnis
+    const uint32_t NumSections = FixEndian(Header.NumSections);
+    const uint8_t *Toc = itsFile.Range(sizeof(LevelV2Header), static_cast<size_t>(NumSections) * sizeof(LevelV2Section));
+
+    if (NumSections == 0 || NumSections > 64 || Toc == nullptr)
+        return Fail("broken table of contents");
+
+    if (LevelCRC32(Toc, NumSections * sizeof(LevelV2Section)) != FixEndian(Header.TocChecksum))
+        return Fail("table of contents checksum mismatch");
+
+    itsSections.resize(NumSections);
+    memcpy(itsSections.data(), Toc, NumSections * sizeof(LevelV2Section));
+
+    for (auto &Section : itsSections) {
+        Section.Type = FixEndian(Section.Type);
+        Section.Checksum = FixEndian(Section.Checksum);
+        Section.Offset = FixEndian(Section.Offset);
+        Section.Length = FixEndian(Section.Length);
+
+        if (itsFile.Range(Section.Offset, Section.Length) == nullptr)
+            return Fail("section out of range");
+
+        // CDAT wird erst Chunk für Chunk geprüft, sonst wäre das Nachladen sinnlos
+        if (Section.Type != LEVELV2_CDAT &&
+            LevelCRC32(itsFile.Data() + Section.Offset, Section.Length) != Section.Checksum)
+            return Fail("section checksum mismatch");
+    }
+
+    const LevelV2Section *Head = FindSection(LEVELV2_HEAD);
+    const LevelV2Section *Cidx = FindSection(LEVELV2_CIDX);
+    const LevelV2Section *Objs = FindSection(LEVELV2_OBJS);
+    const LevelV2Section *Appx = FindSection(LEVELV2_APPX);
+    const LevelV2Section *Tail = FindSection(LEVELV2_TAIL);
+    const LevelV2Section *Cdat = FindSection(LEVELV2_CDAT);
+
+    if (!Head || !Cidx || !Objs || !Appx || !Cdat)
+        return Fail("missing section");
+
+    if (Head->Length != sizeof(FileHeader) || Appx->Length != sizeof(FileAppendix) ||
+        Objs->Length % sizeof(LevelObjectStruct) != 0 || Cidx->Length < sizeof(LevelV2ChunkIndex))
+        return Fail("section has wrong size");
+
+    memcpy(&itsHeader, itsFile.Data() + Head->Offset, sizeof(itsHeader));
+    memcpy(&itsAppendix, itsFile.Data() + Appx->Offset, sizeof(itsAppendix));
+
+    itsObjects = itsFile.Data() + Objs->Offset;
+    itsNumObjects = static_cast<uint32_t>(Objs->Length / sizeof(LevelObjectStruct));
+
+    if (Tail) {
+        itsTail = itsFile.Data() + Tail->Offset;
+        itsTailSize = Tail->Length;
+    }
+
+    // Chunk-Index gegen die Levelgrösse prüfen
+    itsSizeX = static_cast<int>(FixEndian(itsHeader.SizeX));
+    itsSizeY = static_cast<int>(FixEndian(itsHeader.SizeY));
+
+    if (itsSizeX <= 0 || itsSizeY <= 0 || itsSizeX > MAX_LEVELSIZE_X || itsSizeY > MAX_LEVELSIZE_Y)
+        return Fail("invalid level size");
+
+    LevelV2ChunkIndex Index;
+    memcpy(&Index, itsFile.Data() + Cidx->Offset, sizeof(Index));
+
+    itsChunksX = (itsSizeX + LEVELV2_CHUNKSIZE - 1) / LEVELV2_CHUNKSIZE;
+    itsChunksY = (itsSizeY + LEVELV2_CHUNKSIZE - 1) / LEVELV2_CHUNKSIZE;
+
+    if (FixEndian(Index.ChunkSize) != static_cast<uint32_t>(LEVELV2_CHUNKSIZE) ||
+        FixEndian(Index.ChunksX) != static_cast<uint32_t>(itsChunksX) ||
+        FixEndian(Index.ChunksY) != static_cast<uint32_t>(itsChunksY) ||
+        Cidx->Length != sizeof(LevelV2ChunkIndex) + static_cast<size_t>(itsChunksX) * itsChunksY * itsChunkEntrySize)
+        return Fail("chunk index does not match level size");
+
+    itsChunkIndex = itsFile.Data() + Cidx->Offset + sizeof(LevelV2ChunkIndex);
+    itsChunkData = itsFile.Data() + Cdat->Offset;
+    itsChunkDataSize = Cdat->Length;
+
+    return true;
+}
+
+void LevelV2File::Close() {
+    itsFile.Close();
+    itsSections.clear();
+    itsObjects = nullptr;
+    itsNumObjects = 0;
+    itsTail = nullptr;
+    itsTailSize = 0;
+    itsChunkIndex = nullptr;
+    itsChunkEntrySize = sizeof(LevelV2Chunk);
+    itsChunkData = nullptr;
+    itsChunkDataSize = 0;
+    itsSizeX = itsSizeY = 0;
+    itsChunksX = itsChunksY = 0;
+}
+
+int LevelV2File::ChunkWidth(int cx) const {
+    return std::min(LEVELV2_CHUNKSIZE, itsSizeX - cx * LEVELV2_CHUNKSIZE);
+}
+
+int LevelV2File::ChunkHeight(int cy) const {
+    return std::min(LEVELV2_CHUNKSIZE, itsSizeY - cy * LEVELV2_CHUNKSIZE);
+}
+
+bool LevelV2File::DecodeChunk(int cx, int cy, uint8_t *dst) const {
+    if (cx < 0 || cy < 0 || cx >= itsChunksX || cy >= itsChunksY)
+        return false;
+
+    const uint8_t *Entry = itsChunkIndex + (static_cast<size_t>(cx) * itsChunksY + cy) * itsChunkEntrySize;
+    LevelV2Chunk Chunk;
+
+    if (itsChunkEntrySize == sizeof(LevelV2Chunk32)) {
+        LevelV2Chunk32 Old;
+        memcpy(&Old, Entry, sizeof(Old));
+        Chunk.Offset = FixEndian(static_cast<uint64_t>(FixEndian(Old.Offset)));
+        Chunk.Length = Old.Length;
+        Chunk.Checksum = Old.Checksum;
+    } else {
+        memcpy(&Chunk, Entry, sizeof(Chunk));
+    }
+
+    const uint64_t Offset = FixEndian(Chunk.Offset);
+    const size_t Length = FixEndian(Chunk.Length);
+
+    if (Offset > itsChunkDataSize || Length > itsChunkDataSize - Offset) {
+        Protokoll << "-> Error: level chunk " << cx << "/" << cy << " out of range" << std::endl;
+        return false;
+    }
+
+    const uint8_t *Packed = itsChunkData + Offset;
+
+    if (LevelCRC32(Packed, Length) != FixEndian(Chunk.Checksum)) {
+        Protokoll << "-> Error: level chunk " << cx << "/" << cy << " checksum mismatch" << std::endl;
+        return false;
+    }
+
+    if (!LevelDecodeTiles(Packed, Length, dst, ChunkWidth(cx) * ChunkHeight(cy))) {
+        Protokoll << "-> Error: level chunk " << cx << "/" << cy << " is corrupt" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool LevelV2File::VerifyChunkData() const {
+    const LevelV2Section *Cdat = FindSection(LEVELV2_CDAT);
+    return Cdat && LevelCRC32(itsChunkData, itsChunkDataSize) == Cdat->Checksum;
+}
+
+// --------------------------------------------------------------------------------------
+// v2 Datei schreiben
+// --------------------------------------------------------------------------------------
+
+bool WriteLevelV2(const std::string &Filename,
+                  const FileHeader &Header,
+                  const LevelTileColumn &Column,
+                  const LevelObjectStruct *Objects,
+                  uint32_t NumObjects,
+                  const FileAppendix &Appendix,
+                  const uint8_t *Tail,
+                  size_t TailSize) {
+    const int SizeX = static_cast<int>(FixEndian(Header.SizeX));
+    const int SizeY = static_cast<int>(FixEndian(Header.SizeY));
+    const int ChunksX = (SizeX + LEVELV2_CHUNKSIZE - 1) / LEVELV2_CHUNKSIZE;
+    const int ChunksY = (SizeY + LEVELV2_CHUNKSIZE - 1) / LEVELV2_CHUNKSIZE;
+
+    // Chunk-Index und CDAT stehen erst fest, wenn alle Chunks gepackt sind. Die Datei wird
+    // deshalb einmal durchgeschrieben (CDAT Chunk für Chunk, direkt nach dem Packen), danach
+    // werden Inhaltsverzeichnis und Chunk-Index an ihrem Platz nachgetragen.
+    std::vector<LevelV2Chunk> Chunks(static_cast<size_t>(ChunksX) * ChunksY);
+
+    LevelV2ChunkIndex Index;
+    Index.ChunkSize = FixEndian(static_cast<uint32_t>(LEVELV2_CHUNKSIZE));
+    Index.ChunksX = FixEndian(static_cast<uint32_t>(ChunksX));
+    Index.ChunksY = FixEndian(static_cast<uint32_t>(ChunksY));
+    Index.Reserved = 0;
+
+    std::vector<uint8_t> IndexData(sizeof(Index) + Chunks.size() * sizeof(LevelV2Chunk));
+
+    // Abschnitte in Dateireihenfolge, CDAT hat keine Daten im Speicher
+    struct Part {
+        uint32_t Type;
+        const uint8_t *Data;
+        uint64_t Length;
+    };
+
+    std::vector<Part> Parts = {
+        {LEVELV2_HEAD, reinterpret_cast<const uint8_t *>(&Header), sizeof(FileHeader)},
+        {LEVELV2_CIDX, IndexData.data(), IndexData.size()},
+        {LEVELV2_OBJS, reinterpret_cast<const uint8_t *>(Objects), NumObjects * sizeof(LevelObjectStruct)},
+        {LEVELV2_APPX, reinterpret_cast<const uint8_t *>(&Appendix), sizeof(FileAppendix)},
+    };
+
+    if (TailSize > 0)
+        Parts.push_back({LEVELV2_TAIL, Tail, TailSize});
+
+    Parts.push_back({LEVELV2_CDAT, nullptr, 0});
+
+    const uint64_t TocLength = Parts.size() * sizeof(LevelV2Section);
+    const uint64_t IndexOffset = sizeof(LevelV2Header) + TocLength + sizeof(FileHeader);
+
+    std::ofstream Datei(Filename, std::ofstream::binary);
+
+    // Platz für Header und Inhaltsverzeichnis, dann alles vor CDAT
+    const std::vector<char> Placeholder(sizeof(LevelV2Header) + TocLength, 0);
+    Datei.write(Placeholder.data(), Placeholder.size());
+
+    for (const auto &P : Parts)
+        if (P.Data)
+            Datei.write(reinterpret_cast<const char *>(P.Data), P.Length);
+
+    // Chunks packen und sofort schreiben
+    std::vector<LevelTileLoadStruct> Raw(LEVELV2_CHUNKSIZE * LEVELV2_CHUNKSIZE);
+    std::vector<uint8_t> Packed;
+    uint64_t ChunkOffset = 0;
+    uint32_t ChunkCRC = 0;
+
+    for (int cx = 0; cx < ChunksX && Datei; cx++)
+        for (int cy = 0; cy < ChunksY; cy++) {
+            const int x0 = cx * LEVELV2_CHUNKSIZE;
+            const int y0 = cy * LEVELV2_CHUNKSIZE;
+            const int w = std::min(LEVELV2_CHUNKSIZE, SizeX - x0);
+            const int h = std::min(LEVELV2_CHUNKSIZE, SizeY - y0);
+
+            for (int i = 0; i < w; i++)
+                Column(x0 + i, y0, h, &Raw[i * h]);
+
+            Packed.clear();
+            LevelEncodeTiles(reinterpret_cast<const uint8_t *>(Raw.data()), w * h, Packed);
+            Datei.write(reinterpret_cast<const char *>(Packed.data()), Packed.size());
+
+            LevelV2Chunk &Chunk = Chunks[static_cast<size_t>(cx) * ChunksY + cy];
+            Chunk.Offset = FixEndian(ChunkOffset);
+            Chunk.Length = FixEndian(static_cast<uint32_t>(Packed.size()));
+            Chunk.Checksum = FixEndian(LevelCRC32(Packed.data(), Packed.size()));
+
+            ChunkCRC = LevelCRC32(Packed.data(), Packed.size(), ChunkCRC);
+            ChunkOffset += Packed.size();
+        }
+
+    memcpy(IndexData.data(), &Index, sizeof(Index));
+    memcpy(IndexData.data() + sizeof(Index), Chunks.data(), Chunks.size() * sizeof(LevelV2Chunk));
+
+    std::vector<LevelV2Section> Toc(Parts.size());
+    uint64_t Offset = sizeof(LevelV2Header) + TocLength;
+
+    for (size_t n = 0; n < Parts.size(); n++) {
+        const bool Cdat = Parts[n].Type == LEVELV2_CDAT;
+        const uint64_t Length = Cdat ? ChunkOffset : Parts[n].Length;
+
+        Toc[n].Type = FixEndian(Parts[n].Type);
+        Toc[n].Checksum = FixEndian(Cdat ? ChunkCRC : LevelCRC32(Parts[n].Data, Length));
+        Toc[n].Offset = FixEndian(Offset);
+        Toc[n].Length = FixEndian(Length);
+        Offset += Length;
+    }
+
+    LevelV2Header FileHead;
+    memcpy(FileHead.Magic, LEVELV2_MAGIC, sizeof(FileHead.Magic));
+    FileHead.Version = FixEndian(LEVELV2_VERSION);
+    FileHead.NumSections = FixEndian(static_cast<uint32_t>(Toc.size()));
+    FileHead.TocChecksum =
+        FixEndian(LevelCRC32(reinterpret_cast<const uint8_t *>(Toc.data()), Toc.size() * sizeof(LevelV2Section)));
+    FileHead.Reserved = 0;
+
+    Datei.seekp(0);
+    Datei.write(reinterpret_cast<const char *>(&FileHead), sizeof(FileHead));
+    Datei.write(reinterpret_cast<const char *>(Toc.data()), Toc.size() * sizeof(LevelV2Section));
+    Datei.seekp(static_cast<std::streamoff>(IndexOffset));
+    Datei.write(reinterpret_cast<const char *>(IndexData.data()), IndexData.size());
+
+    Datei.close();
+
+    if (!Datei) {
+        Protokoll << "-> Error: could not write " << Filename << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool WriteLevelV2(const std::string &Filename,
+                  const FileHeader &Header,
+                  const LevelTileLoadStruct *Tiles,
+                  const LevelObjectStruct *Objects,
+                  uint32_t NumObjects,
+                  const FileAppendix &Appendix,
+                  const uint8_t *Tail,
+                  size_t TailSize) {
+    const size_t SizeY = FixEndian(Header.SizeY);
+
+    auto Column = [Tiles, SizeY](int i, int j, int Count, LevelTileLoadStruct *Out) {
+        memcpy(Out, Tiles + static_cast<size_t>(i) * SizeY + j, Count * TILEBYTES);
+    };
+
+    return WriteLevelV2(Filename, Header, Column, Objects, NumObjects, Appendix, Tail, TailSize);
+}
+
+// --------------------------------------------------------------------------------------
+// .map <-> v2 konvertieren
+// --------------------------------------------------------------------------------------
+
+static bool ConvertV2ToLegacy(const std::string &From, const std::string &To) {
+    LevelV2File Level;
+
+    if (!Level.Open(From))
+        return false;
+
+    if (!Level.VerifyChunkData()) {
+        Protokoll << "-> Error: " << From << ": chunk data checksum mismatch" << std::endl;
+        return false;
+    }
+
+    const int SizeX = Level.SizeX();
+    const int SizeY = Level.SizeY();
+
+    std::vector<uint8_t> TileData(static_cast<size_t>(SizeX) * SizeY * TILEBYTES);
+    std::vector<uint8_t> Raw(LEVELV2_CHUNKSIZE * LEVELV2_CHUNKSIZE * TILEBYTES);
+
+    for (int cx = 0; cx < Level.ChunksX(); cx++)
+        for (int cy = 0; cy < Level.ChunksY(); cy++) {
+            if (!Level.DecodeChunk(cx, cy, Raw.data()))
+                return false;
+
+            const int w = Level.ChunkWidth(cx);
+            const int h = Level.ChunkHeight(cy);
+
+            for (int i = 0; i < w; i++)
+                memcpy(&TileData[(static_cast<size_t>(cx * LEVELV2_CHUNKSIZE + i) * SizeY + cy * LEVELV2_CHUNKSIZE) *
+                                 TILEBYTES],
+                       &Raw[i * h * TILEBYTES], h * TILEBYTES);
+        }
+
+    std::ofstream Datei(To, std::ofstream::binary);
+
+    Datei.write(reinterpret_cast<const char *>(&Level.Header()), sizeof(FileHeader));
+    Datei.write(reinterpret_cast<const char *>(TileData.data()), TileData.size());
+    Datei.write(reinterpret_cast<const char *>(Level.ObjectData()), Level.NumObjects() * sizeof(LevelObjectStruct));
+    Datei.write(reinterpret_cast<const char *>(&Level.Appendix()), sizeof(FileAppendix));
+    Datei.write(reinterpret_cast<const char *>(Level.TailData()), Level.TailSize());
+
+    Datei.close();
+
+    if (!Datei) {
+        Protokoll << "-> Error: could not write " << To << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool ConvertLegacyToV2(const MappedFile &Datei, const std::string &From, const std::string &To) {
+    const uint8_t *HeaderData = Datei.Range(0, sizeof(FileHeader));
+    if (HeaderData == nullptr) {
+        Protokoll << "-> Error: " << From << ": file too small for FileHeader" << std::endl;
+        return false;
+    }
+
+    FileHeader Header;
+    memcpy(&Header, HeaderData, sizeof(Header));
+
+    const uint32_t SizeX = FixEndian(Header.SizeX);
+    const uint32_t SizeY = FixEndian(Header.SizeY);
+    const uint32_t NumObjects = FixEndian(Header.NumObjects);
+
+    if (SizeX == 0 || SizeY == 0 || SizeX > MAX_LEVELSIZE_X || SizeY > MAX_LEVELSIZE_Y) {
+        Protokoll << "-> Error: " << From << ": invalid size " << SizeX << "x" << SizeY << std::endl;
+        return false;
+    }
+
+    const size_t TilesOffset = sizeof(FileHeader);
+    const size_t TilesLength = static_cast<size_t>(SizeX) * SizeY * TILEBYTES;
+    const size_t ObjectsOffset = TilesOffset + TilesLength;
+    const size_t ObjectsLength = static_cast<size_t>(NumObjects) * sizeof(LevelObjectStruct);
+    const size_t AppendixOffset = ObjectsOffset + ObjectsLength;
+    const size_t TailOffset = AppendixOffset + sizeof(FileAppendix);
+
+    const uint8_t *TileData = Datei.Range(TilesOffset, TilesLength);
+    const uint8_t *ObjectData = Datei.Range(ObjectsOffset, ObjectsLength);
+    const uint8_t *AppendixData = Datei.Range(AppendixOffset, sizeof(FileAppendix));
+
+    if (TileData == nullptr || ObjectData == nullptr || AppendixData == nullptr) {
+        Protokoll << "-> Error: " << From << ": file is truncated" << std::endl;
+        return false;
+    }
+
+    FileAppendix Appendix;
+    memcpy(&Appendix, AppendixData, sizeof(Appendix));
+
+    // Tiles/Objekte werden nur byteweise kopiert, daher reicht ein Zeiger in die Datei
+    return WriteLevelV2(To, Header, reinterpret_cast<const LevelTileLoadStruct *>(TileData),
+                        reinterpret_cast<const LevelObjectStruct *>(ObjectData), NumObjects, Appendix,
+                        Datei.Data() + TailOffset, Datei.Size() - TailOffset);
+}
+
+bool ConvertLevelFile(const std::string &From, const std::string &To) {
+    MappedFile Datei;
+
+    if (!Datei.Open(From))
+        return false;
+
+    // Wie beim Speichern erst in eine Temp-Datei schreiben und die dann umbenennen, damit
+    // bei einem Fehler eine vorhandene Datei To heil bleibt. Das geht so auch mit To == From
+    const std::string TempFilename = To + ".tmp";
+    bool ok;
+
+    if (LevelV2File::IsLevelV2(Datei.Data(), Datei.Size())) {
+        Datei.Close();
+        ok = ConvertV2ToLegacy(From, TempFilename);
+    } else {
+        ok = ConvertLegacyToV2(Datei, From, TempFilename);
+        Datei.Close();
+    }
+
+    std::error_code ec;
+
+    if (ok)
+        fs::rename(TempFilename, To, ec);
+
+    if (!ok || ec) {
+        Protokoll << "-> Error: could not convert " << From << " to " << To << std::endl;
+        fs::remove(TempFilename, ec);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,208 @@
+// Datei : LevelFormat.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Level-Container Version 2
+//
+// Das alte .map Format ist FileHeader, SizeX * SizeY rohe 12-Byte Tiles, die Objekte
+// und zum Schluss der FileAppendix. Die v2 Datei packt genau diese Daten in einzelne
+// Abschnitte mit Inhaltsverzeichnis und CRC32 pro Abschnitt. Die Tiles liegen dabei
+// in 32x32 Tile grossen Chunks, die jeweils für sich komprimiert sind und erst dann
+// ausgepackt werden, wenn sie gebraucht werden.
+//
+// Aufbau:
+//   LevelV2Header
+//   LevelV2Section[NumSections]            Inhaltsverzeichnis
+//   HEAD  FileHeader, unverändert
+//   CIDX  LevelV2ChunkIndex + LevelV2Chunk[ChunksX * ChunksY]
+//   OBJS  LevelObjectStruct[NumObjects], unverändert
+//   APPX  FileAppendix, unverändert
+//   TAIL  Bytes hinter dem Appendix (optional, nur damit die Konvertierung verlustfrei ist)
+//   CDAT  gepackte Chunks
+//
+// Alle Zahlen im Container sind Little Endian, die Nutzdaten sind Byte für Byte die
+// aus der .map Datei. Damit kommt bei der Rückkonvertierung exakt die alte Datei heraus.
+//
+// Version 2 hatte 32 Bit Chunk-Offsets, das reicht für MAX_LEVELSIZE_X/Y nicht mehr.
+// Seit Version 3 sind sie 64 Bit, Version 2 Dateien werden weiter gelesen.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _LEVELFORMAT_HPP_
+#define _LEVELFORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Level.hpp"
+
+// --------------------------------------------------------------------------------------
+// Defines
+// --------------------------------------------------------------------------------------
+
+constexpr char LEVELV2_MAGIC[8] = {'H', 'U', 'R', 'R', 'L', 'V', '2', 0};
+constexpr uint32_t LEVELV2_VERSION = 3;
+constexpr uint32_t LEVELV2_VERSION_OFFSET32 = 2;  // LevelV2Chunk32 statt LevelV2Chunk
+constexpr int LEVELV2_CHUNKSIZE = 32;  // Tiles pro Chunk in X und Y
+
+constexpr uint32_t LevelV2FourCC(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 |
+           static_cast<uint32_t>(d) << 24;
+}
+
+constexpr uint32_t LEVELV2_HEAD = LevelV2FourCC('H', 'E', 'A', 'D');
+constexpr uint32_t LEVELV2_CIDX = LevelV2FourCC('C', 'I', 'D', 'X');
+constexpr uint32_t LEVELV2_OBJS = LevelV2FourCC('O', 'B', 'J', 'S');
+constexpr uint32_t LEVELV2_APPX = LevelV2FourCC('A', 'P', 'P', 'X');
+constexpr uint32_t LEVELV2_TAIL = LevelV2FourCC('T', 'A', 'I', 'L');
+constexpr uint32_t LEVELV2_CDAT = LevelV2FourCC('C', 'D', 'A', 'T');
+
+// --------------------------------------------------------------------------------------
+// Strukturen
+// --------------------------------------------------------------------------------------
+
+struct LevelV2Header {
+    char Magic[8];          // LEVELV2_MAGIC
+    uint32_t Version;       // LEVELV2_VERSION
+    uint32_t NumSections;   // Einträge im Inhaltsverzeichnis
+    uint32_t TocChecksum;   // CRC32 über das Inhaltsverzeichnis
+    uint32_t Reserved;
+};
+
+static_assert(sizeof(LevelV2Header) == 24, "Size of LevelV2Header is wrong");
+
+struct LevelV2Section {
+    uint32_t Type;      // LEVELV2_HEAD, LEVELV2_CIDX, ...
+    uint32_t Checksum;  // CRC32 über den ganzen Abschnitt
+    uint64_t Offset;    // ab Dateianfang
+    uint64_t Length;
+};
+
+static_assert(sizeof(LevelV2Section) == 24, "Size of LevelV2Section is wrong");
+
+struct LevelV2ChunkIndex {
+    uint32_t ChunkSize;  // LEVELV2_CHUNKSIZE
+    uint32_t ChunksX;    // Chunks pro Spalte / Zeile,
+    uint32_t ChunksY;    // die Ränder sind evtl. kleiner
+    uint32_t Reserved;
+};
+
+static_assert(sizeof(LevelV2ChunkIndex) == 16, "Size of LevelV2ChunkIndex is wrong");
+
+struct LevelV2Chunk {
+    uint64_t Offset;    // ab Anfang von CDAT
+    uint32_t Length;    // gepackte Länge
+    uint32_t Checksum;  // CRC32 der gepackten Daten
+};
+
+static_assert(sizeof(LevelV2Chunk) == 16, "Size of LevelV2Chunk is wrong");
+
+struct LevelV2Chunk32 {
+    uint32_t Offset;
+    uint32_t Length;
+    uint32_t Checksum;
+};
+
+static_assert(sizeof(LevelV2Chunk32) == 12, "Size of LevelV2Chunk32 is wrong");
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+// Offene v2 Datei. Open() prüft Inhaltsverzeichnis, Header, Chunk-Index, Objekte und
+// Appendix. Die Chunks selbst werden erst in DecodeChunk() gegen ihre CRC geprüft.
+//
+class LevelV2File {
+  public:
+    static bool IsLevelV2(const uint8_t *Data, size_t Size);  // Magic am Dateianfang?
+
+    bool Open(const std::string &Filename);
+    void Close();
+    bool IsOpen() const { return itsFile.IsOpen(); }
+
+    const FileHeader &Header() const { return itsHeader; }          // wie in der Datei (nicht FixEndian)
+    const FileAppendix &Appendix() const { return itsAppendix; }    // wie in der Datei (nicht FixEndian)
+    uint32_t NumObjects() const { return itsNumObjects; }
+    const uint8_t *ObjectData() const { return itsObjects; }        // LevelObjectStruct[NumObjects]
+    const uint8_t *TailData() const { return itsTail; }
+    size_t TailSize() const { return itsTailSize; }
+
+    int SizeX() const { return itsSizeX; }
+    int SizeY() const { return itsSizeY; }
+    int ChunksX() const { return itsChunksX; }
+    int ChunksY() const { return itsChunksY; }
+
+    // Chunk cx/cy als rohe LevelTileLoadStructs nach dst auspacken, spaltenweise wie in
+    // der .map Datei, mit ChunkHeight(cy) Tiles pro Spalte
+    bool DecodeChunk(int cx, int cy, uint8_t *dst) const;
+    int ChunkWidth(int cx) const;
+    int ChunkHeight(int cy) const;
+
+    bool VerifyChunkData() const;  // CRC über den ganzen CDAT Abschnitt
+
+  private:
+    const LevelV2Section *FindSection(uint32_t Type) const;
+
+    MappedFile itsFile;
+    std::vector<LevelV2Section> itsSections;
+    FileHeader itsHeader;
+    FileAppendix itsAppendix;
+    const uint8_t *itsObjects = nullptr;
+    uint32_t itsNumObjects = 0;
+    const uint8_t *itsTail = nullptr;
+    size_t itsTailSize = 0;
+    const uint8_t *itsChunkIndex = nullptr;  // LevelV2Chunk[ChunksX * ChunksY]
+    size_t itsChunkEntrySize = sizeof(LevelV2Chunk);  // oder sizeof(LevelV2Chunk32)
+    const uint8_t *itsChunkData = nullptr;
+    size_t itsChunkDataSize = 0;
+    int itsSizeX = 0;
+    int itsSizeY = 0;
+    int itsChunksX = 0;
+    int itsChunksY = 0;
+};
+
+// --------------------------------------------------------------------------------------
+// Funktionen
+// --------------------------------------------------------------------------------------
+
+uint32_t LevelCRC32(const uint8_t *Data, size_t Length, uint32_t crc = 0);
+
+// count Datensätze zu je 12 Bytes so packen wie die v2 Chunks (in Bytes-Ebenen zerlegt,
+// dann Lauflänge). Was in den Bytes steht, ist egal, das Undo packt damit auch Tiles
+// im Format von TileRawStruct
+void LevelEncodeTiles(const uint8_t *src, int count, std::vector<uint8_t> &out);
+bool LevelDecodeTiles(const uint8_t *src, size_t length, uint8_t *dst, int count);
+
+// Liefert Count Tiles der Spalte i ab Zeile j so, wie sie in der .map Datei stehen
+using LevelTileColumn = std::function<void(int i, int j, int Count, LevelTileLoadStruct *Out)>;
+
+// v2 Datei schreiben. Die Tiles werden Chunk für Chunk bei Column abgeholt und gepackt
+// gleich in die Datei geschrieben, SizeX/SizeY kommen aus dem Header.
+bool WriteLevelV2(const std::string &Filename,
+                  const FileHeader &Header,
+                  const LevelTileColumn &Column,
+                  const LevelObjectStruct *Objects,
+                  uint32_t NumObjects,
+                  const FileAppendix &Appendix,
+                  const uint8_t *Tail = nullptr,
+                  size_t TailSize = 0);
+
+// Dasselbe, wenn die Tiles spaltenweise wie in der .map Datei am Stück vorliegen
+bool WriteLevelV2(const std::string &Filename,
+                  const FileHeader &Header,
+                  const LevelTileLoadStruct *Tiles,
+                  const LevelObjectStruct *Objects,
+                  uint32_t NumObjects,
+                  const FileAppendix &Appendix,
+                  const uint8_t *Tail = nullptr,
+                  size_t TailSize = 0);
+
+// .map nach v2 oder v2 nach .map, je nachdem was From ist. Geschrieben wird über
+// To + ".tmp", ein vorhandenes To bleibt bei einem Fehler also unverändert
+bool ConvertLevelFile(const std::string &From, const std::string &To);
+
+#endif
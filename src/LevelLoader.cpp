@@ -0,0 +1,70 @@
+// Datei : LevelLoader.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Level im Hintergrund laden (siehe LevelLoader.hpp)
+//
+// --------------------------------------------------------------------------------------
+
+#include "LevelLoader.hpp"
+
+#include "Logdatei.hpp"
+#include "ObjectGraphics.hpp"
+
+LevelLoaderClass::~LevelLoaderClass() {
+    Cancel();
+    Join();
+}
+
+bool LevelLoaderClass::Start(const std::string &Filename) {
+    if (IsBusy()) {
+        Cancel();
+        Join();
+    }
+
+    itsFilename = Filename;
+    itsStage = std::make_unique<LevelLoaderStage>();
+    itsProgress.Fraction = 0.0f;
+    itsProgress.Cancel = false;
+    itsDone = false;
+    itsSuccess = false;
+
+    // Welche Objektgrafiken schon da sind, kann nur der GL-Thread sagen
+    for (int i = 0; i < MAX_GEGNERGFX; i++)
+        itsStage->ObjectGraphicLoaded[i] = ObjectGraphics.IsLoaded(i);
+
+    Protokoll << "-> Loading level " << Filename << " in the background" << std::endl;
+
+    itsThread = std::thread([this] {
+        itsSuccess = TileEngineClass::ParseLevel(itsFilename, *itsStage, &itsProgress);
+        itsDone = true;
+    });
+
+    return true;
+}
+
+void LevelLoaderClass::Cancel() {
+    itsProgress.Cancel = true;
+}
+
+void LevelLoaderClass::Join() {
+    if (itsThread.joinable())
+        itsThread.join();
+}
+
+bool LevelLoaderClass::Poll() {
+    if (!IsBusy() || !itsDone)
+        return false;
+
+    Join();
+
+    bool Swapped = false;
+
+    if (itsProgress.Cancel)
+        Protokoll << "-> Loading " << itsFilename << " cancelled" << std::endl;
+    else if (itsSuccess)
+        Swapped = TileEngine.ApplyLevel(*itsStage);
+
+    itsStage.reset();
+    return Swapped;
+}
@@ -0,0 +1,79 @@
+// Datei : LevelLoader.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Level im Hintergrund laden
+//
+// Ein Worker-Thread liest die Datei, baut die Tiles samt Wasseranim und Licht auf und
+// dekodiert nebenbei die PNGs der Tilesets, des Hintergrunds und der Objekte. Alles
+// landet in einem LevelStage, die Engine selbst wird dabei nicht angefasst. Erst
+// Poll() auf dem GL-Thread lädt die fertigen Bilder hoch und tauscht das Level in
+// einem Rutsch aus, bis dahin wird einfach das alte Level weiter gezeichnet.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _LEVELLOADER_HPP_
+#define _LEVELLOADER_HPP_
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Level.hpp"
+#include "LevelFormat.hpp"
+#include "ObjectList.hpp"
+#include "Tileengine.hpp"
+#include "SDLPort/texture.hpp"
+
+// --------------------------------------------------------------------------------------
+// Strukturen
+// --------------------------------------------------------------------------------------
+
+// Ein eingelesenes Level samt der Grafiken, die beim Übernehmen hochgeladen werden
+//
+struct LevelLoaderStage : LevelStage {
+    // Objektgrafiken, die beim Start schon geladen waren, müssen nicht dekodiert werden
+    std::array<bool, MAX_GEGNERGFX> ObjectGraphicLoaded{};
+
+    std::vector<std::pair<std::string, image_t>> Images;  // vorab dekodierte Texturen
+};
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class LevelLoaderClass {
+  public:
+    ~LevelLoaderClass();
+
+    bool Start(const std::string &Filename);  // läuft schon ein Laden, wird das abgebrochen
+    void Cancel();
+    bool Poll();  // GL-Thread: fertiges Level übernehmen, true wenn getauscht wurde
+
+    bool IsBusy() const { return itsThread.joinable(); }
+    bool IsCancelled() const { return itsProgress.Cancel; }
+    float GetProgress() const { return itsProgress.Fraction; }
+    const std::string &GetFilename() const { return itsFilename; }
+
+  private:
+    void Join();
+
+    std::thread itsThread;
+    std::atomic<bool> itsDone{false};
+    bool itsSuccess = false;
+    LevelLoadProgress itsProgress;
+    std::unique_ptr<LevelLoaderStage> itsStage;
+    std::string itsFilename;
+};
+
+// --------------------------------------------------------------------------------------
+// Externals
+// --------------------------------------------------------------------------------------
+
+extern LevelLoaderClass LevelLoader;
+
+#endif
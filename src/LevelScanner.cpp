@@ -0,0 +1,403 @@
+// Datei : LevelScanner.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Level-Infos ohne das Level zu laden (siehe LevelScanner.hpp)
+//
+// --------------------------------------------------------------------------------------
+
+#include "LevelScanner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Gegner.hpp"
+#include "Globals.hpp"
+#include "LevelFormat.hpp"
+#include "Logdatei.hpp"
+
+namespace fs = std::filesystem;
+
+constexpr char LEVELSCAN_MAGIC[8] = {'H', 'U', 'R', 'R', 'S', 'C', 'N', '1'};
+
+// --------------------------------------------------------------------------------------
+// Datei nur für gezielte Leseaufrufe öffnen, pread() braucht keinen Dateizeiger und
+// kann so von mehreren Threads ohne Absprache benutzt werden
+// --------------------------------------------------------------------------------------
+
+namespace {
+
+class PositionedFile {
+  public:
+    ~PositionedFile() {
+#if !defined(_WIN32)
+        if (itsFd >= 0)
+            close(itsFd);
+#endif
+    }
+
+    bool Open(const std::string &Filename) {
+#if !defined(_WIN32)
+        itsFd = open(Filename.c_str(), O_RDONLY);
+        return itsFd >= 0;
+#else
+        itsFile.open(Filename, std::ifstream::binary);
+        return itsFile.good();
+#endif
+    }
+
+    bool ReadAt(uint64_t Offset, void *Dest, size_t Length) {
+#if !defined(_WIN32)
+        auto *Out = static_cast<char *>(Dest);
+        while (Length > 0) {
+            ssize_t const Got = pread(itsFd, Out, Length, static_cast<off_t>(Offset));
+            if (Got <= 0)
+                return false;
+            Out += Got;
+            Offset += static_cast<uint64_t>(Got);
+            Length -= static_cast<size_t>(Got);
+        }
+        return true;
+#else
+        itsFile.clear();
+        itsFile.seekg(static_cast<std::streamoff>(Offset));
+        itsFile.read(static_cast<char *>(Dest), static_cast<std::streamsize>(Length));
+        return itsFile.good();
+#endif
+    }
+
+  private:
+#if !defined(_WIN32)
+    int itsFd = -1;
+#else
+    std::ifstream itsFile;
+#endif
+};
+
+// Die Originallevels wurden mit einem Debug-Build gespeichert, ungenutzte Bytes sind
+// dort nicht 0 sondern 0xCC
+std::string FixedString(const char *Text, size_t Size) {
+    size_t Length = 0;
+    while (Length < Size && Text[Length] != '\0' && static_cast<uint8_t>(Text[Length]) != 0xCC)
+        Length++;
+    return std::string(Text, Length);
+}
+
+bool IsLevelFile(const fs::path &Path) {
+    auto const Ext = Path.extension().string();
+    return Ext == ".map" || Ext == LEVELV2_EXTENSION;
+}
+
+}  // namespace
+
+// --------------------------------------------------------------------------------------
+// LevelInfo
+// --------------------------------------------------------------------------------------
+
+std::string LevelInfo::Description() const {
+    return FixedString(Header.Beschreibung, sizeof(Header.Beschreibung));
+}
+
+std::string LevelInfo::Tileset(int i) const {
+    if (i < 0 || i >= Header.UsedTilesets || i >= MAX_TILESETS)
+        return {};
+    return FixedString(Header.SetNames[i], sizeof(Header.SetNames[i]));
+}
+
+std::string LevelInfo::Song(int i) const {
+    if (i < 0 || i > 1)
+        return {};
+    return FixedString(Appendix.Songs[i], sizeof(Appendix.Songs[i]));
+}
+
+// --------------------------------------------------------------------------------------
+// Header und Appendix einer Datei lesen
+// --------------------------------------------------------------------------------------
+
+bool LevelScannerClass::ReadLevelInfo(const std::string &Filename, LevelInfo &Info) {
+    Info.Valid = false;
+    Info.V2 = false;
+
+    std::error_code ec;
+    Info.FileSize = fs::file_size(Filename, ec);
+    if (ec)
+        return false;
+
+    PositionedFile Datei;
+    if (!Datei.Open(Filename))
+        return false;
+
+    LevelV2Header V2Header;
+    uint64_t AppendixOffset;
+
+    if (Info.FileSize >= sizeof(V2Header) && Datei.ReadAt(0, &V2Header, sizeof(V2Header)) &&
+        LevelV2File::IsLevelV2(reinterpret_cast<const uint8_t *>(&V2Header), sizeof(V2Header))) {
+        // v2: Inhaltsverzeichnis lesen, dann nur HEAD und APPX
+        // Inhaltsverzeichnis und HEAD/APPX sind in beiden Versionen gleich, wie beim Laden
+        const uint32_t Version = FixEndian(V2Header.Version);
+        const uint32_t NumSections = FixEndian(V2Header.NumSections);
+        if ((Version != LEVELV2_VERSION && Version != LEVELV2_VERSION_OFFSET32) || NumSections == 0 ||
+            NumSections > 64)
+            return false;
+
+        std::vector<LevelV2Section> Toc(NumSections);
+        if (!Datei.ReadAt(sizeof(V2Header), Toc.data(), NumSections * sizeof(LevelV2Section)) ||
+            LevelCRC32(reinterpret_cast<const uint8_t *>(Toc.data()), NumSections * sizeof(LevelV2Section)) !=
+                FixEndian(V2Header.TocChecksum))
+            return false;
+
+        const LevelV2Section *Head = nullptr;
+        const LevelV2Section *Appx = nullptr;
+        uint64_t ObjectsLength = 0;
+
+        for (auto &Section : Toc) {
+            Section.Type = FixEndian(Section.Type);
+            Section.Checksum = FixEndian(Section.Checksum);
+            Section.Offset = FixEndian(Section.Offset);
+            Section.Length = FixEndian(Section.Length);
+
+            if (Section.Type == LEVELV2_HEAD)
+                Head = &Section;
+            else if (Section.Type == LEVELV2_APPX)
+                Appx = &Section;
+            else if (Section.Type == LEVELV2_OBJS)
+                ObjectsLength = Section.Length;
+        }
+
+        if (Head == nullptr || Appx == nullptr || Head->Length != sizeof(FileHeader) ||
+            Appx->Length != sizeof(FileAppendix) || !Datei.ReadAt(Head->Offset, &Info.Header, sizeof(FileHeader)) ||
+            !Datei.ReadAt(Appx->Offset, &Info.Appendix, sizeof(FileAppendix)) ||
+            LevelCRC32(reinterpret_cast<const uint8_t *>(&Info.Header), sizeof(FileHeader)) != Head->Checksum ||
+            LevelCRC32(reinterpret_cast<const uint8_t *>(&Info.Appendix), sizeof(FileAppendix)) != Appx->Checksum)
+            return false;
+
+        // Die Objekte stehen im OBJS Abschnitt, nicht im Header
+        Info.Header.NumObjects = FixEndian(static_cast<uint32_t>(ObjectsLength / sizeof(LevelObjectStruct)));
+        Info.V2 = true;
+        AppendixOffset = Appx->Offset;
+    } else {
+        // .map: der Appendix steht direkt hinter Tiles und Objekten
+        if (!Datei.ReadAt(0, &Info.Header, sizeof(FileHeader)))
+            return false;
+
+        AppendixOffset = sizeof(FileHeader) +
+                         static_cast<uint64_t>(FixEndian(Info.Header.SizeX)) * FixEndian(Info.Header.SizeY) *
+                             sizeof(LevelTileLoadStruct) +
+                         static_cast<uint64_t>(FixEndian(Info.Header.NumObjects)) * sizeof(LevelObjectStruct);
+
+        if (AppendixOffset + sizeof(FileAppendix) > Info.FileSize ||
+            !Datei.ReadAt(AppendixOffset, &Info.Appendix, sizeof(FileAppendix)))
+            return false;
+    }
+
+    Info.Header.Timelimit = FixEndian(Info.Header.Timelimit);
+    Info.Header.SizeX = FixEndian(Info.Header.SizeX);
+    Info.Header.SizeY = FixEndian(Info.Header.SizeY);
+    // Mehr Objekte als MAX_GEGNER lädt LoadLevel() auch, nur eben die ersten MAX_GEGNER
+    Info.Header.NumObjects = std::min<uint32_t>(FixEndian(Info.Header.NumObjects), MAX_GEGNER);
+    Info.Appendix.UsedPowerblock = FixEndian(Info.Appendix.UsedPowerblock);
+
+    Info.Valid = Info.Header.SizeX > 0 && Info.Header.SizeY > 0 && Info.Header.SizeX <= MAX_LEVELSIZE_X &&
+                 Info.Header.SizeY <= MAX_LEVELSIZE_Y && Info.Header.UsedTilesets <= MAX_TILESETS &&
+                 AppendixOffset < Info.FileSize;
+
+    return Info.Valid;
+}
+
+// --------------------------------------------------------------------------------------
+// Mehrere Dateien parallel lesen
+// --------------------------------------------------------------------------------------
+
+std::vector<LevelInfo> LevelScannerClass::Scan(const std::vector<std::string> &Files) {
+    std::vector<LevelInfo> Infos(Files.size());
+    std::atomic<size_t> Next{0};
+    std::atomic<size_t> Read{0};
+
+    auto Worker = [&] {
+        for (size_t i = Next++; i < Files.size(); i = Next++) {
+            LevelInfo &Info = Infos[i];
+            Info.Filename = Files[i];
+
+            std::error_code ec;
+            auto const ModTime = fs::last_write_time(Files[i], ec);
+            Info.ModTime = ec ? 0 : static_cast<int64_t>(ModTime.time_since_epoch().count());
+            auto const FileSize = fs::file_size(Files[i], ec);
+
+            if (!ec) {
+                std::lock_guard<std::mutex> Lock(itsMutex);
+                auto Cached = itsCache.find(Files[i]);
+                if (Cached != itsCache.end() && Cached->second.ModTime == Info.ModTime &&
+                    Cached->second.FileSize == FileSize) {
+                    Info = Cached->second;
+                    continue;
+                }
+            }
+
+            ReadLevelInfo(Files[i], Info);
+            Read++;
+
+            std::lock_guard<std::mutex> Lock(itsMutex);
+            itsCache[Files[i]] = Info;
+        }
+    };
+
+    // Pro Datei sind das nur zwei kleine Leseaufrufe, die Zeit geht fürs Warten auf die
+    // Platte drauf - also ruhig mehr Threads als Kerne
+    size_t const NumThreads =
+        std::min<size_t>(Files.size(), std::max(4u, std::thread::hardware_concurrency() * 2));
+
+    std::vector<std::thread> Threads;
+    for (size_t t = 1; t < NumThreads; t++)
+        Threads.emplace_back(Worker);
+    Worker();
+    for (auto &Thread : Threads)
+        Thread.join();
+
+    itsFilesRead = Read;
+    return Infos;
+}
+
+// --------------------------------------------------------------------------------------
+// Levels eines Pakets auflisten
+// --------------------------------------------------------------------------------------
+
+std::vector<std::string> LevelScannerClass::ListPack(const std::string &Directory) {
+    std::vector<std::string> Files;
+    std::error_code ec;
+
+    if (!fs::is_directory(Directory, ec))
+        return Files;
+
+    // levellist.dat gibt die Reihenfolge im Spiel vor
+    std::ifstream List(fs::path(Directory) / "levellist.dat");
+    std::string Line;
+    while (std::getline(List, Line)) {
+        Line.erase(std::remove_if(Line.begin(), Line.end(), [](char c) { return c == '\r' || c == '\n'; }),
+                   Line.end());
+        auto const Path = fs::path(Directory) / Line;
+        if (!Line.empty() && fs::is_regular_file(Path, ec))
+            Files.push_back(Path.string());
+    }
+
+    std::vector<std::string> Rest;
+    std::vector<std::string> SubDirs;
+    for (const auto &Entry : fs::directory_iterator(Directory, ec)) {
+        if (Entry.is_directory(ec))
+            SubDirs.push_back(Entry.path().string());
+        else if (IsLevelFile(Entry.path()) &&
+                 std::find(Files.begin(), Files.end(), Entry.path().string()) == Files.end())
+            Rest.push_back(Entry.path().string());
+    }
+
+    std::sort(Rest.begin(), Rest.end());
+    std::sort(SubDirs.begin(), SubDirs.end());
+
+    Files.insert(Files.end(), Rest.begin(), Rest.end());
+    for (const auto &SubDir : SubDirs) {
+        auto const Sub = ListPack(SubDir);
+        Files.insert(Files.end(), Sub.begin(), Sub.end());
+    }
+
+    return Files;
+}
+
+// --------------------------------------------------------------------------------------
+// Gemerkte Infos laden / speichern
+// Pro Eintrag: Pfadlänge, Pfad, ModTime, FileSize, Valid/V2, FileHeader, FileAppendix.
+// Die Datei bleibt auf dem Rechner, daher einfach in dessen Byte-Reihenfolge.
+// --------------------------------------------------------------------------------------
+
+bool LevelScannerClass::LoadCache(const std::string &Filename) {
+    std::ifstream Datei(Filename, std::ifstream::binary);
+    if (!Datei)
+        return false;
+
+    char Magic[sizeof(LEVELSCAN_MAGIC)];
+    uint32_t Count = 0;
+    Datei.read(Magic, sizeof(Magic));
+    Datei.read(reinterpret_cast<char *>(&Count), sizeof(Count));
+
+    if (!Datei || memcmp(Magic, LEVELSCAN_MAGIC, sizeof(Magic)) != 0) {
+        Protokoll << "-> Ignoring level scan cache " << Filename << ": unknown format" << std::endl;
+        return false;
+    }
+
+    std::unordered_map<std::string, LevelInfo> Cache;
+    for (uint32_t i = 0; i < Count; i++) {
+        LevelInfo Info;
+        uint32_t Length = 0;
+        uint8_t Flags = 0;
+
+        Datei.read(reinterpret_cast<char *>(&Length), sizeof(Length));
+        if (!Datei || Length > 4096)
+            break;
+
+        Info.Filename.resize(Length);
+        Datei.read(&Info.Filename[0], Length);
+        Datei.read(reinterpret_cast<char *>(&Info.ModTime), sizeof(Info.ModTime));
+        Datei.read(reinterpret_cast<char *>(&Info.FileSize), sizeof(Info.FileSize));
+        Datei.read(reinterpret_cast<char *>(&Flags), sizeof(Flags));
+        Datei.read(reinterpret_cast<char *>(&Info.Header), sizeof(Info.Header));
+        Datei.read(reinterpret_cast<char *>(&Info.Appendix), sizeof(Info.Appendix));
+
+        if (!Datei)
+            break;
+
+        Info.Valid = (Flags & 1) != 0;
+        Info.V2 = (Flags & 2) != 0;
+        Cache[Info.Filename] = std::move(Info);
+    }
+
+    if (Cache.size() != Count) {
+        Protokoll << "-> Ignoring level scan cache " << Filename << ": file is truncated" << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> Lock(itsMutex);
+    itsCache = std::move(Cache);
+    return true;
+}
+
+bool LevelScannerClass::SaveCache(const std::string &Filename) const {
+    std::ofstream Datei(Filename, std::ofstream::binary | std::ofstream::trunc);
+    if (!Datei) {
+        Protokoll << "-> Error: could not write level scan cache " << Filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> Lock(itsMutex);
+
+    auto const Count = static_cast<uint32_t>(itsCache.size());
+    Datei.write(LEVELSCAN_MAGIC, sizeof(LEVELSCAN_MAGIC));
+    Datei.write(reinterpret_cast<const char *>(&Count), sizeof(Count));
+
+    for (const auto &Entry : itsCache) {
+        const LevelInfo &Info = Entry.second;
+        auto const Length = static_cast<uint32_t>(Info.Filename.size());
+        uint8_t const Flags = (Info.Valid ? 1 : 0) | (Info.V2 ? 2 : 0);
+
+        Datei.write(reinterpret_cast<const char *>(&Length), sizeof(Length));
+        Datei.write(Info.Filename.data(), Length);
+        Datei.write(reinterpret_cast<const char *>(&Info.ModTime), sizeof(Info.ModTime));
+        Datei.write(reinterpret_cast<const char *>(&Info.FileSize), sizeof(Info.FileSize));
+        Datei.write(reinterpret_cast<const char *>(&Flags), sizeof(Flags));
+        Datei.write(reinterpret_cast<const char *>(&Info.Header), sizeof(Info.Header));
+        Datei.write(reinterpret_cast<const char *>(&Info.Appendix), sizeof(Info.Appendix));
+    }
+
+    return static_cast<bool>(Datei);
+}
+
+void LevelScannerClass::ClearCache() {
+    std::lock_guard<std::mutex> Lock(itsMutex);
+    itsCache.clear();
+}
@@ -0,0 +1,92 @@
+// Datei : LevelScanner.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Level-Infos ohne das Level zu laden
+//
+// Für eine Übersicht über ein Levelpaket reichen der FileHeader (Beschreibung, Grösse,
+// Tilesets, Hintergrund) und der FileAppendix (Songs, Powerblock, Taschenlampe). Die
+// werden mit zwei gezielten Leseaufrufen pro Datei geholt, bei v2 Dateien über das
+// Inhaltsverzeichnis. Mehrere Dateien werden parallel gelesen. Das Ergebnis wird pro
+// Pfad zusammen mit Änderungszeit und Grösse gemerkt und kann auf die Platte geschrieben
+// werden, beim nächsten Öffnen des Pakets muss dann nichts mehr gelesen werden.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _LEVELSCANNER_HPP_
+#define _LEVELSCANNER_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Level.hpp"
+
+// --------------------------------------------------------------------------------------
+// Defines
+// --------------------------------------------------------------------------------------
+
+constexpr char LEVELSCAN_CACHEFILE[] = "levelscan.cache";  // gemerkte Infos aller Pakete
+
+// --------------------------------------------------------------------------------------
+// Strukturen
+// --------------------------------------------------------------------------------------
+
+struct LevelInfo {
+    std::string Filename;
+    int64_t ModTime = 0;    // Änderungszeit und Grösse der Datei,
+    uint64_t FileSize = 0;  // mit denen die Infos gelesen wurden
+
+    bool Valid = false;     // Header und Appendix gelesen und plausibel
+    bool V2 = false;        // v2 Container
+
+    FileHeader Header;      // wie in der Datei, Zahlen schon FixEndian
+    FileAppendix Appendix;  // wie in der Datei, Zahlen schon FixEndian
+
+    std::string Description() const;
+    std::string Tileset(int i) const;   // leer, wenn i >= UsedTilesets
+    std::string Song(int i) const;      // 0 = Stage, 1 = Boss
+    int SizeX() const { return static_cast<int>(Header.SizeX); }
+    int SizeY() const { return static_cast<int>(Header.SizeY); }
+    int NumObjects() const { return static_cast<int>(Header.NumObjects); }
+    int UsedTilesets() const { return Header.UsedTilesets; }
+};
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class LevelScannerClass {
+  public:
+    // Infos zu allen Dateien, in derselben Reihenfolge. Nur Dateien, die sich seit dem
+    // letzten Mal geändert haben (oder neu sind), werden gelesen
+    std::vector<LevelInfo> Scan(const std::vector<std::string> &Files);
+
+    // Alle Levels eines Pakets: erst die aus levellist.dat in deren Reihenfolge, dann
+    // die übrigen .map/.map2 Dateien und dann die Unterordner
+    static std::vector<std::string> ListPack(const std::string &Directory);
+
+    // Nur Header und Appendix einer Datei lesen
+    static bool ReadLevelInfo(const std::string &Filename, LevelInfo &Info);
+
+    bool LoadCache(const std::string &Filename);        // gemerkte Infos laden
+    bool SaveCache(const std::string &Filename) const;  // und speichern
+    void ClearCache();
+
+    size_t GetFilesRead() const { return itsFilesRead; }  // beim letzten Scan() gelesen
+
+  private:
+    mutable std::mutex itsMutex;
+    std::unordered_map<std::string, LevelInfo> itsCache;
+    size_t itsFilesRead = 0;
+};
+
+// --------------------------------------------------------------------------------------
+// Externals
+// --------------------------------------------------------------------------------------
+
+extern LevelScannerClass LevelScanner;
+
+#endif
@@ -38,10 +38,44 @@ Logdatei::~Logdatei() {
         fs::remove(fs::path(filename_));
 }
 
+namespace {
+
+thread_local bool lineGone = false;
+
+// A thread that ends in the middle of a statement leaves its text to the shared buffer
+struct LineBuffer {
+    std::ostringstream stream;
+    ~LineBuffer() {
+        lineGone = true;
+        if (stream.tellp() > 0)
+            Protokoll << stream.str();
+    }
+};
+
+}  // namespace
+
+std::ostringstream *Logdatei::line() {
+    if (lineGone)
+        return nullptr;
+
+    thread_local LineBuffer buffer;
+    return &buffer.stream;
+}
+
 /**
- * Puts the internal buffer into the output-streams, flushes them and empties the buffer
+ * Appends this thread's pending text, puts the internal buffer into the output-streams,
+ * flushes them and empties the buffer
  **/
 void Logdatei::flush() {
+    std::ostringstream *pending = line();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (pending) {
+        (*static_cast<std::ostringstream *>(this)) << pending->str();
+        pending->str("");
+    }
+
 #ifdef ANDROID
     // Android has no usable std::cout, so we use the Android-specific logging
     __android_log_print(ANDROID_LOG_INFO, "Hurrican", "%s", this->str().c_str());
@@ -9,6 +9,7 @@
 #define _LOGDATEI_HPP_
 
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
 
@@ -18,6 +19,13 @@ class Logdatei : public std::ostringstream {
     std::ofstream file;           ///< Filestream of the logfile
     // FIXME: This doesn't work currently. It's not a nice solution, anyway.
     bool delLogFile;  // Logfile am Ende löschen, wenn kein Fehler auftrat
+    std::mutex mutex_;            ///< Levels are loaded on a worker thread which logs, too
+
+    /// Text of the statement currently being written, one per thread. It only goes into the
+    /// shared buffer on std::endl or flush(), under a single lock, so lines from different
+    /// threads never interleave. nullptr once the thread's buffer is destroyed (static
+    /// destructors at exit), then text goes straight into the shared buffer
+    static std::ostringstream *line();
 
   public:
     Logdatei(const std::string &filename);
@@ -28,7 +36,12 @@ class Logdatei : public std::ostringstream {
     // inherit all the output-operators for compatibility
     template <typename T>
     inline Logdatei &operator<<(const T &t) {
-        (*reinterpret_cast<std::ostringstream *>(this)) << t;
+        if (std::ostringstream *pending = line()) {
+            *pending << t;
+        } else {
+            std::lock_guard<std::mutex> lock(mutex_);
+            (*static_cast<std::ostringstream *>(this)) << t;
+        }
         return *this;
     }
 
@@ -40,7 +53,7 @@ class Logdatei : public std::ostringstream {
 // overload std::endl with a Logdatei-compatible version
 namespace std {
 inline Logdatei &endl(Logdatei &out) {
-    out.put('\n');
+    out << '\n';
     out.flush();
     return out;
 }
@@ -7,6 +7,7 @@
 #include "Logdatei.hpp"
 #include "Tileengine.hpp"
 #include "Timer.hpp"
+#include "ObjectGraphics.hpp"
 #include "ObjectList.hpp"
 
 bool GameRunning = true;
@@ -18,6 +19,7 @@ TexturesystemClass Textures;
 TimerClass Timer;
 TileEngineClass TileEngine;
 ObjectListClass ObjectList;
+ObjectGraphicsClass ObjectGraphics;
 
 const Uint8 *KeyBuffer;
 int NumberOfKeys;
@@ -98,9 +100,11 @@ int main() {
     if (MouseMask & (SDL_BUTTON(3))) {
         const int x_tile = MouseX / TileEngine.TileSizeX + TileEngine.XOffset / TileEngine.TileSizeX;
         const int y_tile = MouseY / TileEngine.TileSizeY + TileEngine.YOffset / TileEngine.TileSizeY;
-        TileEngine.TileAt(x_tile, y_tile).FrontArt = 0;
-        TileEngine.TileAt(x_tile, y_tile).BackArt = 0;
-        TileEngine.TileAt(x_tile, y_tile).Block = 0;
+        LevelTileStruct tile = TileEngine.GetTile(x_tile, y_tile);
+        tile.FrontArt = 0;
+        tile.BackArt = 0;
+        tile.Block = 0;
+        TileEngine.SetTile(x_tile, y_tile, tile);
     }
 
     if (KeyDown(SDLK_LEFT)) {
@@ -130,7 +134,7 @@ int main() {
     TileEngine.DrawBackLevel();
     TileEngine.DrawFrontLevel();
 
-    ObjectList.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset, TileEngine.Scale);
+    ObjectGraphics.DrawAllObjects(TileEngine.XOffset, TileEngine.YOffset, TileEngine.Scale);
 
     DirectGraphics.SetColorKeyMode();
 
@@ -0,0 +1,117 @@
+// Datei : MappedFile.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Read-only memory mapping of a whole file
+//
+// --------------------------------------------------------------------------------------
+
+#include "MappedFile.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Logdatei.hpp"
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+bool MappedFile::Open(const std::string &Filename) {
+    Close();
+
+#if !defined(_WIN32)
+    int fd = open(Filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        Protokoll << "-> Error: could not open " << Filename << " for mapping" << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        Protokoll << "-> Error: could not stat " << Filename << std::endl;
+        return false;
+    }
+
+    itsSize = static_cast<size_t>(st.st_size);
+
+    if (itsSize > 0) {
+        void *addr = mmap(nullptr, itsSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // The whole file is parsed front to back exactly once
+            madvise(addr, itsSize, MADV_WILLNEED);
+            itsData = static_cast<const uint8_t *>(addr);
+            itsMapped = true;
+        }
+    }
+
+    close(fd);
+
+    if (itsMapped || itsSize == 0) {
+        itsOpen = true;
+        return true;
+    }
+#endif
+
+    // Kein mmap verfügbar (oder fehlgeschlagen), dann eben am Stück einlesen
+    std::ifstream Datei(Filename, std::ifstream::binary | std::ifstream::ate);
+    if (!Datei) {
+        Protokoll << "-> Error: could not open " << Filename << std::endl;
+        itsSize = 0;
+        return false;
+    }
+
+    itsSize = static_cast<size_t>(Datei.tellg());
+    itsFallback.resize(itsSize);
+    Datei.seekg(0);
+    Datei.read(reinterpret_cast<char *>(itsFallback.data()), itsSize);
+
+    if (!Datei) {
+        Protokoll << "-> Error: short read on " << Filename << std::endl;
+        Close();
+        return false;
+    }
+
+    itsData = itsFallback.data();
+    itsOpen = true;
+    return true;
+}
+
+void MappedFile::Release(size_t offset, size_t length) const {
+#if !defined(_WIN32)
+    if (!itsMapped || offset >= itsSize)
+        return;
+
+    // Only whole pages inside the range, the neighbours may still be in use
+    const size_t Page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t Begin = (offset + Page - 1) / Page * Page;
+    const size_t End = std::min(offset + length, itsSize) / Page * Page;
+
+    if (Begin < End)
+        madvise(const_cast<uint8_t *>(itsData) + Begin, End - Begin, MADV_DONTNEED);
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
+
+void MappedFile::Close() {
+#if !defined(_WIN32)
+    if (itsMapped)
+        munmap(const_cast<uint8_t *>(itsData), itsSize);
+#endif
+
+    itsFallback = std::vector<uint8_t>();
+    itsData = nullptr;
+    itsSize = 0;
+    itsMapped = false;
+    itsOpen = false;
+}
@@ -0,0 +1,53 @@
+// Datei : MappedFile.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Read-only memory mapping of a whole file
+// Used by the level loader so the .map data can be parsed straight out of the
+// page cache instead of going through one stream read per tile
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _MAPPEDFILE_HPP_
+#define _MAPPEDFILE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool Open(const std::string &Filename);  // Datei einblenden
+    void Close();                            // und wieder freigeben
+
+    const uint8_t *Data() const { return itsData; }
+    size_t Size() const { return itsSize; }
+    bool IsOpen() const { return itsOpen; }
+
+    // Bounds-checked view of [offset, offset + length), nullptr if it does not fit
+    const uint8_t *Range(size_t offset, size_t length) const {
+        if (offset > itsSize || length > itsSize - offset)
+            return nullptr;
+        return itsData + offset;
+    }
+
+    // Pages of [offset, offset + length) are no longer needed, drop them from the
+    // process (they come back from the file if touched again)
+    void Release(size_t offset, size_t length) const;
+
+  private:
+    const uint8_t *itsData = nullptr;
+    size_t itsSize = 0;
+    bool itsOpen = false;
+    bool itsMapped = false;              // true: itsData comes from mmap()
+    std::vector<uint8_t> itsFallback;    // read() fallback where mmap is not available
+};
+
+#endif
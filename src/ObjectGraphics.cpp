@@ -0,0 +1,75 @@
+#include "ObjectGraphics.hpp"
+
+#include <string>
+#include <vector>
+
+#include "DX8Texture.hpp"
+#include "Gegner.hpp"
+#include "Globals.hpp"
+
+void ObjectGraphicsClass::DrawObject(int index, float xoff, float yoff, float scale) {
+    const Object& obj = ObjectList.Objects[index];
+
+    if (obj.ObjectID == NULLENEMY)
+        return;
+
+    #ifndef NDEBUG
+    if (obj.ObjectID >= MAX_GEGNERGFX || Graphics[obj.ObjectID] == nullptr) {
+        Protokoll << "Failed to draw object with index " << index << " and ID " << obj.ObjectID << std::endl;
+        GameRunning = false;
+    }
+    #endif
+
+    float x = obj.XPos * scale - xoff;
+    float y = obj.YPos * scale - yoff;
+
+    Graphics[obj.ObjectID]->RenderSpriteWithScale(x, y, scale, 0xFFFFFFFF);
+}
+
+// Nach Textur sortiert, so zeichnet jede Objektgrafik einmal statt einmal pro Objekt
+void ObjectGraphicsClass::DrawAllObjects(float xoff, float yoff, float scale) {
+    DirectGraphics.BeginSprites();
+
+    for (unsigned int i = 0; i < ObjectList.ObjectCount; i++) {
+        DrawObject(i, xoff, yoff, scale);
+    }
+
+    DirectGraphics.EndSprites();
+}
+
+void ObjectGraphicsClass::LoadObjectGraphic(int index) {
+    // Check if graphics is already loaded
+    if (Graphics[index] != nullptr)
+        return;
+
+    Graphics[index] = new DirectGraphicsSprite();
+
+    const SpriteData* data = ObjectListClass::GetSpriteData(index);
+    if (data == nullptr || data->filename == nullptr)
+        return;
+
+    Graphics[index]->LoadImage(data->filename, data->xs, data->ys, data->xfs, data->yfs, data->xfc, data->yfc);
+}
+
+void ObjectGraphicsClass::LoadAllGraphics() {
+    // Decode everything that is still missing in one go, LoadImage() then only uploads
+    std::vector<std::string> filenames;
+    for (int i = 0; i < MAX_GEGNERGFX; i++) {
+        const char* filename = ObjectListClass::GetGraphicFilename(i);
+        if (Graphics[i] == nullptr && filename != nullptr)
+            filenames.emplace_back(filename);
+    }
+    Textures.PreloadTextures(filenames);
+
+    for (int i = 0; i < MAX_GEGNERGFX; i++) {
+        LoadObjectGraphic(i);
+    }
+}
+
+ObjectGraphicsClass::~ObjectGraphicsClass() {
+    for (int i = 0; i < MAX_GEGNERGFX; i++) {
+        if (Graphics[i] != nullptr) {
+            delete Graphics[i];
+        }
+    }
+}
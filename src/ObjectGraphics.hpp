@@ -0,0 +1,27 @@
+#ifndef OBJECT_GRAPHICS_HPP_
+#define OBJECT_GRAPHICS_HPP_
+
+#include <array>
+#include "DX8Sprite.hpp"
+#include "Gegner.hpp"
+#include "ObjectList.hpp"
+
+// Grafiken zu den Objekten in ObjectList, braucht im Gegensatz zu dieser OpenGL
+class ObjectGraphicsClass {
+public:
+  void LoadObjectGraphic(int index);
+  void LoadAllGraphics();
+
+  void DrawObject(int index, float xoff, float yoff, float scale);
+  void DrawAllObjects(float xoff, float yoff, float scale);
+
+  bool IsLoaded(int index) const { return Graphics[index] != nullptr; }
+
+  std::array<DirectGraphicsSprite*, MAX_GEGNERGFX> Graphics{};
+
+  ~ObjectGraphicsClass();
+};
+
+extern ObjectGraphicsClass ObjectGraphics;
+
+#endif
@@ -1,16 +1,8 @@
 #include "ObjectList.hpp"
-#include "Gegner.hpp"
-#include "Globals.hpp"
 
-struct SpriteData {
-  const char* filename;
-  uint16_t xs;
-  uint16_t ys;
-  uint16_t xfs;
-  uint16_t yfs;
-  uint16_t xfc;
-  uint16_t yfc;
-};
+#include <iterator>
+
+#include "Gegner.hpp"
 
 SpriteData sprites[] = {
     { "extras.png", 312, 24, 24, 24, 13, 1 }, // EXTRAS
@@ -223,50 +215,20 @@ void ObjectListClass::PushObject(Object object) {
     ObjectCount++;
 }
 
-void ObjectListClass::DrawObject(int index, float xoff, float yoff, float scale) {
-    if (Objects[index].ObjectID == NULLENEMY)
-        return;
-
-    #ifndef NDEBUG
-    if (Objects[index].ObjectID >= MAX_GEGNERGFX || ObjectGraphics[Objects[index].ObjectID] == nullptr) {
-        Protokoll << "Failed to draw object with index " << index << " and ID " << Objects[index].ObjectID << std::endl;
-        GameRunning = false;
-    }
-    #endif
-
-    auto& obj = Objects[index];
-    float x = obj.XPos * scale - xoff;
-    float y = obj.YPos * scale - yoff;
-
-    ObjectGraphics[obj.ObjectID]->RenderSpriteWithScale(x, y, scale, 0xFFFFFFFF);
-}
+const char* ObjectListClass::GetGraphicFilename(int index) {
+    if (index < 0 || index >= static_cast<int>(std::size(sprites)))
+        return nullptr;
 
-void ObjectListClass::DrawAllObjects(float xoff, float yoff, float scale) {
-    for (unsigned int i = 0; i < ObjectCount; i++) {
-        DrawObject(i, xoff, yoff, scale);
-    }
+    return sprites[index].filename;
 }
 
-void ObjectListClass::LoadObjectGraphic(int index) {
-    // Check if graphics is already loaded
-    if (ObjectGraphics[index] != nullptr)
-        return;
-
-    ObjectGraphics[index] = new DirectGraphicsSprite();
-
-    SpriteData& data = sprites[index];
-    if (data.filename == nullptr)
-        return;
+const SpriteData* ObjectListClass::GetSpriteData(int index) {
+    if (index < 0 || index >= static_cast<int>(std::size(sprites)))
+        return nullptr;
 
-    ObjectGraphics[index]->LoadImage(data.filename, data.xs, data.ys, data.xfs, data.yfs, data.xfc, data.yfc);
+    return &sprites[index];
 }
 
-void ObjectListClass::LoadAllGraphics() {
-    for (int i = 0; i < MAX_GEGNERGFX; i++) {
-        LoadObjectGraphic(i);
-    }
-};
-
 void ObjectListClass::ClearObjects() {
     for (auto& object : Objects) {
         object = { NULLENEMY, 0, 0, 0, 0, 0, 0 };
@@ -277,10 +239,3 @@ void ObjectListClass::ClearObjects() {
 ObjectListClass::ObjectListClass() {
     ClearObjects();
 }
-ObjectListClass::~ObjectListClass() {
-    for (int i = 0; i < MAX_GEGNERGFX; i++) {
-        if (ObjectGraphics[i] != nullptr) {
-            delete ObjectGraphics[i];
-        }
-    }
-}
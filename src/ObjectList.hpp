@@ -2,7 +2,7 @@
 #define OBJECT_LIST_HPP_
 
 #include <array>
-#include "DX8Sprite.hpp"
+#include <cstdint>
 #include "Gegner.hpp"
 
 class Object {
@@ -16,23 +16,30 @@ public:
   int32_t Value2;
 };
 
+// Grafik eines Objekttyps, wie sie DirectGraphicsSprite::LoadImage() bekommt
+struct SpriteData {
+  const char* filename;
+  uint16_t xs;
+  uint16_t ys;
+  uint16_t xfs;
+  uint16_t yfs;
+  uint16_t xfc;
+  uint16_t yfc;
+};
+
+// Nur die Objekte des Levels, die Grafiken dazu liegen in ObjectGraphicsClass
 class ObjectListClass {
 public:
   void PushObject(Object object);
 
-  void LoadObjectGraphic(int index);
-  void LoadAllGraphics();
-
-  void DrawObject(int index, float xoff, float yoff, float scale);
-  void DrawAllObjects(float xoff, float yoff, float scale);
+  static const char* GetGraphicFilename(int index);
+  static const SpriteData* GetSpriteData(int index);
 
   void ClearObjects();
 
   std::array<Object, MAX_GEGNER> Objects;
-  std::array<DirectGraphicsSprite*, MAX_GEGNERGFX> ObjectGraphics;
 
   ObjectListClass();
-  ~ObjectListClass();
 
   unsigned int ObjectCount;
 private:
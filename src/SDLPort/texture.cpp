@@ -25,12 +25,17 @@
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
+#include <map>
+#include <mutex>
 namespace fs = std::filesystem;
 
 #include "DX8Graphics.hpp"
 #include "DX8Texture.hpp"
 #include "texture.hpp"
 
+static std::map<std::string, image_t> decoded_textures;  // see SDL_QueueDecodedTexture()
+static std::mutex decoded_textures_mutex;
+
 // DKS - Textures are now managed in DX8Sprite.cpp in new TexturesystemClass.
 //      This function now returns a TextureHandle object, and if it fails to load the file,
 //      all of the returned TextureHandle's data members will be set to 0.
@@ -60,7 +65,23 @@ bool SDL_LoadTexture(const std::string &path,
     }
 
     fullpath = path + "/" + filename;
-    success = loadImageSDL(image, fullpath, buf, buf_size) && load_texture(image, th.tex);
+
+    bool queued = false;
+    if (!load_from_memory) {
+        std::lock_guard<std::mutex> lock(decoded_textures_mutex);
+        auto it = decoded_textures.find(filename);
+        if (it != decoded_textures.end()) {
+            image = std::move(it->second);
+            decoded_textures.erase(it);
+            queued = true;
+        }
+    }
+
+    if (queued) {
+        success = load_texture(image, th.tex);
+    } else {
+        success = loadImageSDL(image, fullpath, buf, buf_size) && load_texture(image, th.tex);
+    }
     image.data = std::vector<char>();
 
     if (success)
@@ -81,6 +102,16 @@ loaded:
     return success;
 }
 
+void SDL_QueueDecodedTexture(const std::string &filename, image_t &&image) {
+    std::lock_guard<std::mutex> lock(decoded_textures_mutex);
+    decoded_textures[filename] = std::move(image);
+}
+
+void SDL_ClearDecodedTextures() {
+    std::lock_guard<std::mutex> lock(decoded_textures_mutex);
+    decoded_textures.clear();
+}
+
 void SDL_UnloadTexture(TextureHandle &th) {
     glDeleteTextures(1, &th.tex);
     th.tex = 0;
@@ -63,6 +63,13 @@ bool SDL_LoadTexture(const std::string &path,
                      TextureHandle &th);
 void SDL_UnloadTexture(TextureHandle &th);
 
+// Images that were already decoded off the GL thread (see LevelLoader and
+// TexturesystemClass::DecodeTextures). The next SDL_LoadTexture() of that filename,
+// which has to run on the GL thread, only uploads the queued image instead of
+// reading the file again. Queueing and clearing may happen on any thread.
+void SDL_QueueDecodedTexture(const std::string &filename, image_t &&image);
+void SDL_ClearDecodedTextures();
+
 bool load_texture(image_t &image, GLuint &new_texture);
 
 #if defined(USE_ETC1)
@@ -0,0 +1,111 @@
+// Datei : ConvertTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_convert <data/levels>: ConvertLevelFile() wie levelconvert, .map -> v2 -> .map
+//
+// - jede .map kommt nach dem Weg über v2 Byte für Byte wieder heraus, die v2 Datei
+//   lädt dieselben Tiles wie die .map
+// - eine vorhandene Zieldatei wird ersetzt, auch wenn sie die Quelle selbst ist
+// - schlägt die Umwandlung fehl, bleibt die Zieldatei unverändert und es bleibt keine
+//   Temp-Datei liegen
+//
+// --------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+#include "LevelFormat.hpp"
+#include "TestUtil.hpp"
+
+static std::vector<char> ReadFile(const std::string &Filename) {
+    std::ifstream File(Filename, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("convert");
+    std::vector<fs::path> Files;
+
+    std::error_code ec;
+    for (const auto &Entry : fs::recursive_directory_iterator(argv[1], ec))
+        if (Entry.is_regular_file(ec) && Entry.path().extension() == ".map")
+            Files.push_back(Entry.path());
+
+    std::sort(Files.begin(), Files.end());
+    CHECK(!Files.empty());
+
+    const std::string V2 = (Dir / (std::string("level") + LEVELV2_EXTENSION)).string();
+    const std::string Back = (Dir / "back.map").string();
+
+    for (const fs::path &File : Files) {
+        const int Before = TestFailures;
+        const std::vector<char> Original = ReadFile(File.string());
+
+        // Ziele vom vorigen Level werden jedes Mal ersetzt
+        CHECK(ConvertLevelFile(File.string(), V2));
+        CHECK(ConvertLevelFile(V2, Back));
+        CHECK(ReadFile(Back) == Original);
+
+        LevelClass Map, Container;
+        CHECK(Map.LoadLevel(File.string()));
+        CHECK(Container.LoadLevel(V2));
+        CHECK(SameTiles(ReadAllTiles(Map), ReadAllTiles(Container)));
+
+        if (TestFailures != Before)
+            Protokoll << "-> Convert test failed for " << File.string() << std::endl;
+    }
+
+    CHECK(!fs::exists(V2 + ".tmp") && !fs::exists(Back + ".tmp"));
+
+    // Quelle und Ziel gleich, hin und wieder zurück
+    //
+    const std::string Map = CopyLevel(fs::path(argv[1]) / "elevator.map", Dir);
+    const std::vector<char> Elevator = ReadFile(Map);
+
+    CHECK(ConvertLevelFile(Map, Map));
+    CHECK(ReadFile(Map) != Elevator);
+    CHECK(ConvertLevelFile(Map, Map));
+    CHECK(ReadFile(Map) == Elevator);
+
+    CHECK(ConvertLevelFile(Map, V2));
+    CHECK(ConvertLevelFile(V2, Back));
+    CHECK(ReadFile(Back) == Elevator);
+
+    // Abgeschnittene Quelle: das alte Ziel bleibt stehen
+    //
+    const std::string Broken = (Dir / "broken.map").string();
+    {
+        std::ofstream Out(Broken, std::ios::binary);
+        Out.write(Elevator.data(), static_cast<std::streamsize>(Elevator.size() / 2));
+    }
+
+    const std::vector<char> OldV2 = ReadFile(V2);
+    CHECK(!ConvertLevelFile(Broken, V2));
+    CHECK(ReadFile(V2) == OldV2);
+    CHECK(!fs::exists(V2 + ".tmp"));
+
+    // Kaputter Chunk in v2: das alte .map Ziel bleibt stehen
+    std::vector<char> Damaged = OldV2;
+    Damaged[Damaged.size() - 10] ^= 0x5A;
+    {
+        std::ofstream Out(Broken, std::ios::binary | std::ios::trunc);
+        Out.write(Damaged.data(), static_cast<std::streamsize>(Damaged.size()));
+    }
+
+    CHECK(!ConvertLevelFile(Broken, Back));
+    CHECK(ReadFile(Back) == Elevator);
+    CHECK(!fs::exists(Back + ".tmp"));
+
+    return TestResult("convert");
+}
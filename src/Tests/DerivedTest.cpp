@@ -0,0 +1,126 @@
+// Datei : DerivedTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_derived <data/levels>: Liquid, Wasseranim und Licht nach Änderungen
+//
+// SetTile() und WriteTiles() rechnen nur das Tile und seine Nachbarn neu. Nach vielen
+// Änderungen rund um Wasser, Wände und Farben muss trotzdem genau dasselbe herauskommen
+// wie bei einem frisch geladenen Level, das alles einmal komplett berechnet: Block samt
+// BLOCKWERT_LIQUID und Wasseranim, und das Licht der Ecken aus dem CornerWindow.
+//
+// --------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+#include "TestUtil.hpp"
+
+static unsigned Next(unsigned &Seed) {
+    Seed = Seed * 1103515245u + 12345u;
+    return Seed >> 8;
+}
+
+// Blockierung ändern wie im TileCanvas: BLOCKWERT_LIQUID setzt SetTile()/WriteTiles()
+// selbst für Wasser und Sumpf
+static uint32_t Toggle(uint32_t Block, uint32_t Flag) {
+    return (Block ^ Flag) & ~BLOCKWERT_LIQUID;
+}
+
+static void Edit(LevelClass &Level, unsigned Seed) {
+    const uint32_t Toggles[] = {BLOCKWERT_WASSER, BLOCKWERT_WAND, BLOCKWERT_WASSERFALL, BLOCKWERT_SUMPF};
+
+    // Einzelne Tiles in einer Ecke des Levels, damit sich Änderungen gegenseitig treffen
+    const int w = std::min(Level.LEVELSIZE_X, 48);
+    const int h = std::min(Level.LEVELSIZE_Y, 48);
+
+    for (int n = 0; n < 400; n++) {
+        const int x = static_cast<int>(Next(Seed) % w);
+        const int y = static_cast<int>(Next(Seed) % h);
+        const unsigned r = Next(Seed);
+
+        LevelTileStruct Tile = Level.GetTile(x, y);
+        Tile.Block = Toggle(Tile.Block, Toggles[r % 4]);
+        Tile.Red = static_cast<uint8_t>(r >> 4);
+        Tile.Blue = static_cast<uint8_t>(r >> 10);
+        Level.SetTile(x, y, Tile);
+    }
+
+    // Rechtecke roh (Undo/Redo, Journal), Wasser ohne BLOCKWERT_LIQUID
+    for (int n = 0; n < 8; n++) {
+        const int x0 = static_cast<int>(Next(Seed) % Level.LEVELSIZE_X);
+        const int y0 = static_cast<int>(Next(Seed) % Level.LEVELSIZE_Y);
+        const int x1 = std::min(x0 + 1 + static_cast<int>(Next(Seed) % 40), Level.LEVELSIZE_X);
+        const int y1 = std::min(y0 + 1 + static_cast<int>(Next(Seed) % 40), Level.LEVELSIZE_Y);
+        std::vector<TileRawStruct> Rect(static_cast<size_t>(x1 - x0) * (y1 - y0));
+
+        Level.ReadTiles(x0, y0, x1, y1, Rect.data());
+        for (TileRawStruct &Tile : Rect) {
+            const unsigned r = Next(Seed);
+            if (r & 1)
+                Tile.Block = Toggle(Tile.Block, BLOCKWERT_WASSER);
+            if (r & 2)
+                Tile.Block = Toggle(Tile.Block, BLOCKWERT_WAND);
+            Tile.Color.Green = static_cast<uint8_t>(r >> 4);
+        }
+        Level.WriteTiles(x0, y0, x1, y1, Rect.data());
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("derived");
+    std::vector<fs::path> Files;
+
+    std::error_code ec;
+    for (const auto &Entry : fs::directory_iterator(argv[1], ec))
+        if (Entry.is_regular_file(ec) && Entry.path().extension() == ".map")
+            Files.push_back(Entry.path());
+
+    std::sort(Files.begin(), Files.end());
+    CHECK(!Files.empty());
+
+    unsigned Seed = 1;
+
+    for (const fs::path &File : Files) {
+        const std::string Saved = (Dir / File.filename()).string();
+        const int Before = TestFailures;
+
+        LevelClass Level;
+        CHECK(Level.LoadLevel(File.string()));
+
+        // Licht für das ganze Level im CornerWindow, das wird dann nur noch nachgeführt
+        Level.PrepareTiles(0, 0, Level.LEVELSIZE_X, Level.LEVELSIZE_Y);
+
+        Edit(Level, Seed++);
+        CHECK(Level.SaveLevel(Saved));
+
+        LevelClass Fresh;
+        CHECK(Fresh.LoadLevel(Saved));
+        CHECK(SameTiles(ReadAllTiles(Level), ReadAllTiles(Fresh)));
+
+        size_t Mismatches = 0;
+        for (int j = 0; j < Level.LEVELSIZE_Y; j++)
+            for (int i = 0; i < Level.LEVELSIZE_X; i++) {
+                const TileCornerStruct a = Level.TileRow(i, j).Corner();
+                const TileCornerStruct b = Fresh.TileRow(i, j).Corner();
+                if (memcmp(&a, &b, sizeof(a)) != 0)
+                    Mismatches++;
+            }
+        CHECK(Mismatches == 0);
+
+        if (TestFailures != Before)
+            Protokoll << "-> Derived data test failed for " << File.string() << std::endl;
+
+        fs::remove(Saved, ec);
+    }
+
+    return TestResult("derived");
+}
@@ -0,0 +1,182 @@
+// Datei : HistoryTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_history <data/levels>: EditHistory auf einer Kopie von elevator.map
+//
+// - Undo/Redo von einzeln gemerkten Tiles, gepackten Rechtecken und Objekten über das
+//   XOR bringt genau den alten bzw. neuen Stand zurück, auch nach dem Abspielen des
+//   Journals, in das Undo/Redo schreibt
+// - Trim() wirft zuerst die ältesten Undo-Schritte weg, dann die am weitesten
+//   entfernten Redo-Schritte
+// - TouchTile() ausserhalb eines Strichs verwirft die ganze History
+//
+// --------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "EditHistory.hpp"
+#include "EditJournal.hpp"
+#include "Level.hpp"
+#include "TestUtil.hpp"
+
+// Ein Strich, der ein einzelnes Tile ändert, wie beim Malen im TileCanvas
+static void PaintTile(LevelClass &Level, EditHistoryClass &History, EditJournalClass &Journal, int x, int y,
+                      uint8_t Art) {
+    History.BeginStroke();
+    History.TouchTile(x, y);
+
+    LevelTileStruct Tile = Level.GetTile(x, y);
+    Tile.FrontArt = Art;
+    Tile.Block ^= BLOCKWERT_WAND;
+    Level.SetTile(x, y, Tile);
+    Journal.RecordTile(x, y, Level.GetTile(x, y));
+
+    History.EndStroke();
+}
+
+static bool SameTile(LevelClass &Level, int x, int y, const std::vector<TileRawStruct> &Tiles) {
+    TileRawStruct Tile;
+    Level.ReadTiles(x, y, x + 1, y + 1, &Tile);
+    return memcmp(&Tile, &Tiles[static_cast<size_t>(y) * Level.LEVELSIZE_X + x], sizeof(Tile)) == 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("history");
+    const std::string Map = CopyLevel(fs::path(argv[1]) / "elevator.map", Dir);
+
+    LevelClass Level;
+    EditJournalClass Journal(Level);
+    EditHistoryClass History(Level, Journal);
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(Journal.Open(Map) == 0);
+    CHECK(ObjectList.ObjectCount > 1);
+
+    const std::vector<TileRawStruct> Original = ReadAllTiles(Level);
+    const std::vector<Object> OriginalObjects = CurrentObjects();
+
+    // Einzelne Tiles, dazu Objekte
+    //
+    History.BeginStroke();
+    for (int x = 2; x < 12; x++) {
+        History.TouchTile(x, 5);
+        LevelTileStruct Tile = Level.GetTile(x, 5);
+        Tile.BackArt = static_cast<uint8_t>(Tile.BackArt + x);
+        Tile.Green = static_cast<uint8_t>(Tile.Green ^ 0x55);
+        Level.SetTile(x, 5, Tile);
+        Journal.RecordTile(x, 5, Level.GetTile(x, 5));
+    }
+
+    History.TouchObject(0);
+    ObjectList.Objects[0].XPos += 40;
+    ObjectList.Objects[0].Value1 = 17;
+    History.TouchObject(static_cast<int>(ObjectList.ObjectCount) - 1);
+    ObjectList.ObjectCount--;
+    History.EndStroke();
+
+    const std::vector<TileRawStruct> Painted = ReadAllTiles(Level);
+    const std::vector<Object> PaintedObjects = CurrentObjects();
+    CHECK(!SameTiles(Painted, Original));
+    CHECK(History.CanUndo());
+
+    // Gepacktes Rechteck (Füllen/Einfügen), nur jedes zweite Tile ändert sich wirklich
+    //
+    const int RX0 = 1, RY0 = 8, RX1 = std::min(Level.LEVELSIZE_X - 1, 65);
+    const int RY1 = RY0 + static_cast<int>(2 * HISTORY_REGION_TILES) / (RX1 - RX0);
+    std::vector<TileRawStruct> Rect(static_cast<size_t>(RX1 - RX0) * (RY1 - RY0));
+
+    History.BeginStroke();
+    History.TouchRegion(RX0, RY0, RX1, RY1);
+    Level.ReadTiles(RX0, RY0, RX1, RY1, Rect.data());
+    for (size_t n = 0; n < Rect.size(); n += 2) {
+        Rect[n].Art.FrontArt = static_cast<uint8_t>(n);
+        Rect[n].Color.Blue ^= 0xFF;
+    }
+    Level.WriteTiles(RX0, RY0, RX1, RY1, Rect.data());
+    Level.ReadTiles(RX0, RY0, RX1, RY1, Rect.data());
+    Journal.RecordTiles(RX0, RY0, RX1, RY1, Rect.data());
+    History.EndStroke();
+
+    const std::vector<TileRawStruct> Filled = ReadAllTiles(Level);
+    CHECK(!SameTiles(Filled, Painted));
+
+    // Ein Strich ohne Änderung gibt keinen Schritt
+    History.BeginStroke();
+    History.TouchTile(1, 1);
+    History.EndStroke();
+
+    CHECK(History.Undo());
+    CHECK(SameTiles(ReadAllTiles(Level), Painted));
+    CHECK(History.Undo());
+    CHECK(SameTiles(ReadAllTiles(Level), Original));
+    CHECK(SameObjects(CurrentObjects(), OriginalObjects));
+    CHECK(!History.Undo());
+
+    CHECK(History.Redo());
+    CHECK(SameTiles(ReadAllTiles(Level), Painted));
+    CHECK(SameObjects(CurrentObjects(), PaintedObjects));
+    CHECK(History.Redo());
+    CHECK(SameTiles(ReadAllTiles(Level), Filled));
+    CHECK(!History.Redo());
+
+    // Undo/Redo stehen im Journal wie jede andere Änderung
+    CHECK(History.Undo());
+    Journal.Flush();
+    Journal.Close();
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(Journal.Open(Map) > 0);
+    CHECK(SameTiles(ReadAllTiles(Level), Painted));
+    CHECK(SameObjects(CurrentObjects(), PaintedObjects));
+    Journal.Close();
+
+    // Trim(): erst die ältesten Undo-Schritte, dann die entferntesten Redo-Schritte
+    //
+    CHECK(Level.LoadLevel(Map));
+    History.Clear();
+    CHECK(!History.CanUndo() && !History.CanRedo() && History.Bytes() == 0);
+
+    PaintTile(Level, History, Journal, 3, 20, 1);  // A
+    PaintTile(Level, History, Journal, 3, 21, 2);  // B
+    PaintTile(Level, History, Journal, 3, 22, 3);  // C
+    const std::vector<TileRawStruct> Three = ReadAllTiles(Level);
+
+    CHECK(History.Undo());  // C
+    CHECK(History.Undo());  // B, übrig: Undo [A], Redo [C, B]
+
+    History.SetBudget(History.Bytes() - 1);  // A fällt raus
+    CHECK(!History.CanUndo());
+    CHECK(History.CanRedo());
+    CHECK(!SameTile(Level, 3, 20, Original));  // bleibt, wie es ist
+
+    History.SetBudget(History.Bytes() - 1);  // C fällt raus, B ist das nächste Redo
+    CHECK(History.Redo());
+    CHECK(SameTile(Level, 3, 21, Three));
+    CHECK(SameTile(Level, 3, 22, Original));
+    CHECK(!History.Redo());
+
+    History.SetBudget(0);
+    CHECK(!History.CanUndo() && !History.CanRedo() && History.Bytes() == 0);
+    History.SetBudget(HISTORY_BUDGET);
+
+    // Tile ausserhalb eines Strichs geändert: kein XOR passt mehr
+    //
+    PaintTile(Level, History, Journal, 3, 30, 4);
+    PaintTile(Level, History, Journal, 3, 31, 5);
+    CHECK(History.Undo());
+    CHECK(History.CanUndo() && History.CanRedo());
+
+    History.TouchTile(3, 32);
+    CHECK(!History.CanUndo() && !History.CanRedo() && History.Bytes() == 0);
+
+    return TestResult("history");
+}
@@ -0,0 +1,177 @@
+// Datei : JournalTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_journal <data/levels>: EditJournal auf einer Kopie von elevator.map
+//
+// - aufgezeichnete Tile-, Rechteck- und Objektänderungen werden wieder abgespielt
+// - ein mitten im letzten Datensatz abgeschnittenes Journal spielt alles davor ab,
+//   wird auf den letzten ganzen Datensatz gekürzt und lässt sich weiterschreiben
+// - ein Journal zu einer anderen Änderungszeit oder Levelgrösse wird verworfen
+// - nach dem Speichern und Compact() bleibt nur, was danach kam
+//
+// --------------------------------------------------------------------------------------
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "EditJournal.hpp"
+#include "Level.hpp"
+#include "TestUtil.hpp"
+
+// Tile x/y ändern und ins Journal schreiben, wie es der TileCanvas macht
+static void EditTile(LevelClass &Level, EditJournalClass &Journal, int x, int y, uint8_t Art) {
+    LevelTileStruct Tile = Level.GetTile(x, y);
+    Tile.FrontArt = Art;
+    Tile.Red = static_cast<uint8_t>(Tile.Red + 16);
+    Level.SetTile(x, y, Tile);
+    Journal.RecordTile(x, y, Level.GetTile(x, y));
+}
+
+static uintmax_t JournalSize(const std::string &Filename) {
+    std::error_code ec;
+    const uintmax_t Size = fs::file_size(Filename, ec);
+    return ec ? 0 : Size;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("journal");
+    const std::string Map = CopyLevel(fs::path(argv[1]) / "elevator.map", Dir);
+    const std::string JournalFile = Map + JOURNAL_EXTENSION;
+    constexpr uintmax_t TileRecord = sizeof(JournalRecordHeader) + sizeof(JournalTile);
+
+    LevelClass Level;
+    EditJournalClass Journal(Level);
+
+    // Aufzeichnen
+    //
+    CHECK(Level.LoadLevel(Map));
+    const std::vector<TileRawStruct> Original = ReadAllTiles(Level);
+
+    CHECK(Journal.Open(Map) == 0);
+    CHECK(JournalSize(JournalFile) == sizeof(JournalHeader));
+
+    EditTile(Level, Journal, 3, 4, 7);
+
+    std::vector<TileRawStruct> Rect(10 * 5);
+    Level.ReadTiles(10, 10, 20, 15, Rect.data());
+    for (TileRawStruct &Tile : Rect)
+        Tile.Art.BackArt++;
+    Level.WriteTiles(10, 10, 20, 15, Rect.data());
+    Level.ReadTiles(10, 10, 20, 15, Rect.data());
+    Journal.RecordTiles(10, 10, 20, 15, Rect.data());
+
+    CHECK(ObjectList.ObjectCount > 1);
+    ObjectList.Objects[0].XPos += 40;
+    Journal.RecordObject(0, ObjectList.Objects[0]);
+    ObjectList.ObjectCount--;
+    Journal.RecordObjectCount(ObjectList.ObjectCount);
+
+    const std::vector<TileRawStruct> BeforeLast = ReadAllTiles(Level);
+    EditTile(Level, Journal, 5, 6, 9);
+
+    Journal.Flush();
+    Journal.Close();
+
+    const std::vector<TileRawStruct> Expected = ReadAllTiles(Level);
+    const std::vector<Object> ExpectedObjects = CurrentObjects();
+    const uintmax_t Full = JournalSize(JournalFile);
+    CHECK(!SameTiles(Expected, Original));
+
+    // Abspielen
+    //
+    CHECK(Level.LoadLevel(Map));
+    CHECK(SameTiles(ReadAllTiles(Level), Original));
+    CHECK(Journal.Open(Map) == 5);
+    CHECK(SameTiles(ReadAllTiles(Level), Expected));
+    CHECK(SameObjects(CurrentObjects(), ExpectedObjects));
+    Journal.Close();
+    CHECK(JournalSize(JournalFile) == Full);
+
+    // Absturz mitten im letzten Datensatz
+    //
+    fs::resize_file(JournalFile, Full - 7);
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(Journal.Open(Map) == 4);
+    CHECK(SameTiles(ReadAllTiles(Level), BeforeLast));
+    CHECK(SameObjects(CurrentObjects(), ExpectedObjects));
+
+    // Der kaputte Rest ist weg, neue Datensätze landen direkt dahinter
+    EditTile(Level, Journal, 5, 6, 9);
+    Journal.Flush();
+    Journal.Close();
+    CHECK(JournalSize(JournalFile) == Full);
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(Journal.Open(Map) == 5);
+    CHECK(SameTiles(ReadAllTiles(Level), Expected));
+    Journal.Close();
+
+    // .map hat sich seitdem geändert
+    //
+    fs::last_write_time(Map, fs::last_write_time(Map) + std::chrono::seconds(2));
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(Journal.Open(Map) == 0);
+    CHECK(SameTiles(ReadAllTiles(Level), Original));
+    CHECK(JournalSize(JournalFile) == sizeof(JournalHeader));
+
+    // Journal zu einem Level anderer Grösse
+    //
+    EditTile(Level, Journal, 3, 4, 7);
+    Journal.Flush();
+    Journal.Close();
+
+    {
+        std::fstream File(JournalFile, std::ios::in | std::ios::out | std::ios::binary);
+        const uint32_t SizeX = FixEndian(static_cast<uint32_t>(Level.LEVELSIZE_X + 1));
+        File.seekp(offsetof(JournalHeader, SizeX));
+        File.write(reinterpret_cast<const char *>(&SizeX), sizeof(SizeX));
+    }
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(Journal.Open(Map) == 0);
+    CHECK(SameTiles(ReadAllTiles(Level), Original));
+    CHECK(JournalSize(JournalFile) == sizeof(JournalHeader));
+
+    // Speichern und Compact()
+    //
+    EditTile(Level, Journal, 3, 4, 7);
+    Journal.Flush();
+    CHECK(JournalSize(JournalFile) == sizeof(JournalHeader) + TileRecord);
+
+    CHECK(Level.SaveLevel(Map));
+    Journal.Compact(Map);
+    CHECK(JournalSize(JournalFile) == sizeof(JournalHeader));
+    const std::vector<TileRawStruct> Saved = ReadAllTiles(Level);
+
+    EditTile(Level, Journal, 7, 8, 11);
+    Journal.Flush();
+    Journal.Close();
+    const std::vector<TileRawStruct> AfterSave = ReadAllTiles(Level);
+
+    CHECK(Level.LoadLevel(Map));
+    CHECK(SameTiles(ReadAllTiles(Level), Saved));
+    CHECK(Journal.Open(Map) == 1);
+    CHECK(SameTiles(ReadAllTiles(Level), AfterSave));
+
+    // Unter anderem Namen gespeichert: das alte Journal gehört zur alten Datei nicht mehr
+    const std::string Copy = (Dir / "copy.map").string();
+    CHECK(Level.SaveLevel(Copy));
+    Journal.Compact(Copy);
+    CHECK(!fs::exists(JournalFile));
+    CHECK(JournalSize(Copy + JOURNAL_EXTENSION) == sizeof(JournalHeader));
+    Journal.Close();
+
+    return TestResult("journal");
+}
@@ -0,0 +1,109 @@
+// Datei : PagerTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_pager <data/levels>: Levels über den TilePager ausgelagert
+//
+// Mit einem ResidentLimit von ein paar Bricks landet jedes Level in einer
+// Auslagerungsdatei. Nach dem Ändern aller Tiles und PageOut() für das ganze Level ist
+// kein Brick mehr im Speicher, alles muss wieder genau so aus der Datei kommen, wie es
+// geschrieben wurde, auch über Schnappschüsse und nach dem Speichern.
+//
+// --------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+#include "TestUtil.hpp"
+#include "TilePager.hpp"
+
+// Jedes Tile ändern, als ein Rechteck über das ganze Level
+static void EditAll(LevelClass &Level, uint8_t Value) {
+    std::vector<TileRawStruct> Tiles = ReadAllTiles(Level);
+
+    for (size_t n = 0; n < Tiles.size(); n++) {
+        Tiles[n].Art.FrontArt = static_cast<uint8_t>(n + Value);
+        Tiles[n].Color.Red = static_cast<uint8_t>((n >> 8) ^ Value);
+    }
+    Level.WriteTiles(0, 0, Level.LEVELSIZE_X, Level.LEVELSIZE_Y, Tiles.data());
+}
+
+static void PageOutAll(LevelClass &Level) {
+    Level.Tiles.PageOut(0, 0, Level.LEVELSIZE_X, Level.LEVELSIZE_Y);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("pager");
+    std::vector<fs::path> Files;
+
+    std::error_code ec;
+    for (const auto &Entry : fs::directory_iterator(argv[1], ec))
+        if (Entry.is_regular_file(ec) && Entry.path().extension() == ".map")
+            Files.push_back(Entry.path());
+
+    std::sort(Files.begin(), Files.end());
+    CHECK(!Files.empty());
+
+    TilePager::SetResidentLimit(4);
+    TilePager::SetDirectory(Dir.string());
+
+    for (const fs::path &File : Files) {
+        const std::string Map = CopyLevel(File, Dir);
+        const int Before = TestFailures;
+
+        LevelClass Level;
+        CHECK(Level.LoadLevel(Map));
+        CHECK(Level.Tiles.Pager != nullptr);
+        if (!Level.Tiles.Pager)
+            continue;
+
+        const std::vector<TileRawStruct> Original = ReadAllTiles(Level);
+        const TilePlanes Snapshot = Level.SnapshotTiles();
+
+        // Alles ändern und auslagern
+        EditAll(Level, 1);
+        const std::vector<TileRawStruct> Edited = ReadAllTiles(Level);
+        CHECK(!SameTiles(Edited, Original));
+
+        PageOutAll(Level);
+        CHECK(Level.Tiles.Pager->ResidentBricks() == 0);
+        CHECK(SameTiles(ReadAllTiles(Level), Edited));
+
+        // Beim Lesen wurde nichts angemeldet, das hält nur KeepResident()
+        Level.Tiles.KeepResident(0, 0, Level.LEVELSIZE_X, Level.LEVELSIZE_Y);
+        CHECK(Level.Tiles.Pager->ResidentBricks() <= TilePager::ResidentLimit());
+
+        // Der Schnappschuss teilt sich die alten Bricks, die stehen auch noch in der Datei
+        PageOutAll(Level);
+        Level.RestoreTiles(Snapshot);
+        CHECK(SameTiles(ReadAllTiles(Level), Original));
+
+        // Noch einmal ändern, auslagern, speichern und frisch geladen vergleichen
+        EditAll(Level, 2);
+        const std::vector<TileRawStruct> Saved = ReadAllTiles(Level);
+        PageOutAll(Level);
+        CHECK(Level.SaveLevel(Map));
+
+        LevelClass Fresh;
+        CHECK(Fresh.LoadLevel(Map));
+        CHECK(SameTiles(ReadAllTiles(Fresh), Saved));
+
+        if (TestFailures != Before)
+            Protokoll << "-> Pager test failed for " << File.string() << std::endl;
+
+        fs::remove(Map, ec);
+    }
+
+    TilePager::SetResidentLimit(TILEPAGE_RESIDENT);
+    TilePager::SetDirectory({});
+
+    return TestResult("pager");
+}
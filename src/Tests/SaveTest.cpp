@@ -0,0 +1,133 @@
+// Datei : SaveTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_save <data/levels>: gepatchtes Speichern gegen ganz neu Schreiben
+//
+// Jede .map wird kopiert, geladen und verändert: einzelne Tiles quer durchs Level, ein
+// Rechteck, ein Objekt und die Levelfarben. SaveLevel() über die Kopie muss die Datei
+// in place patchen (gleiche Inode) und genau dieselben Bytes liefern wie SaveLevel()
+// in eine neue Datei, die immer ganz geschrieben wird. Danach dasselbe noch einmal auf
+// einer Datei, die der Editor selbst ganz geschrieben hat.
+//
+// --------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+#include "Level.hpp"
+#include "TestUtil.hpp"
+
+static std::vector<char> ReadFile(const std::string &Filename) {
+    std::ifstream File(Filename, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+}
+
+// Gepatcht wird in place, ganz geschrieben über eine Temp-Datei und rename()
+static uint64_t FileId(const std::string &Filename) {
+#if !defined(_WIN32)
+    struct stat Info;
+    return stat(Filename.c_str(), &Info) == 0 ? static_cast<uint64_t>(Info.st_ino) : 0;
+#else
+    (void)Filename;
+    return 0;
+#endif
+}
+
+static void Edit(LevelClass &Level, unsigned Seed) {
+    // Einzelne Tiles, auch in der ersten und letzten Spalte/Zeile
+    for (int n = 0; n < 200; n++) {
+        Seed = Seed * 1103515245u + 12345u;
+        const int x = n == 0 ? 0 : n == 1 ? Level.LEVELSIZE_X - 1 : static_cast<int>((Seed >> 8) % Level.LEVELSIZE_X);
+        Seed = Seed * 1103515245u + 12345u;
+        const int y = n == 0 ? 0 : n == 1 ? Level.LEVELSIZE_Y - 1 : static_cast<int>((Seed >> 8) % Level.LEVELSIZE_Y);
+
+        LevelTileStruct Tile = Level.GetTile(x, y);
+        Tile.FrontArt = static_cast<uint8_t>(Seed >> 16);
+        Tile.Red = static_cast<uint8_t>(Seed >> 24);
+        Tile.Block ^= (Seed & 1) ? BLOCKWERT_WAND : BLOCKWERT_WASSER;
+        Tile.Block &= ~BLOCKWERT_LIQUID;  // wie im TileCanvas, SetTile() setzt es für Wasser wieder
+        Level.SetTile(x, y, Tile);
+    }
+
+    // Ein Rechteck (Füllen/Einfügen, Undo)
+    const int x0 = Level.LEVELSIZE_X / 3, y0 = Level.LEVELSIZE_Y / 3;
+    const int x1 = std::min(x0 + 40, Level.LEVELSIZE_X), y1 = std::min(y0 + 30, Level.LEVELSIZE_Y);
+    std::vector<TileRawStruct> Rect(static_cast<size_t>(x1 - x0) * (y1 - y0));
+
+    Level.ReadTiles(x0, y0, x1, y1, Rect.data());
+    for (TileRawStruct &Tile : Rect) {
+        Tile.Art.BackArt++;
+        Tile.Color.Green ^= 0x0F;
+    }
+    Level.WriteTiles(x0, y0, x1, y1, Rect.data());
+
+    // Objekt und Anhang
+    if (ObjectList.ObjectCount > 0)
+        ObjectList.Objects[0].YPos += 20;
+    Level.ColR1 ^= 0x10;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("save");
+    std::vector<fs::path> Files;
+
+    std::error_code ec;
+    for (const auto &Entry : fs::recursive_directory_iterator(argv[1], ec))
+        if (Entry.is_regular_file(ec) && Entry.path().extension() == ".map")
+            Files.push_back(Entry.path());
+
+    std::sort(Files.begin(), Files.end());
+    CHECK(!Files.empty());
+
+    unsigned Seed = 1;
+
+    for (const fs::path &File : Files) {
+        const std::string Map = CopyLevel(File, Dir);
+        const std::string Full = (Dir / "full.map").string();
+        const int Before = TestFailures;
+
+        LevelClass Level;
+        CHECK(Level.LoadLevel(Map));
+
+        for (int Round = 0; Round < 2; Round++) {
+            // Nach SaveLevel(Full) gehört der Stand zu Full, also erst wieder Map ganz schreiben
+            if (Round > 0)
+                CHECK(Level.SaveLevel(Map));
+
+            Edit(Level, Seed++);
+
+            const uint64_t Id = FileId(Map);
+            CHECK(Level.SaveLevel(Map));
+            CHECK(FileId(Map) == Id);
+            CHECK(Level.SaveLevel(Full));
+            CHECK(ReadFile(Map) == ReadFile(Full));
+        }
+
+        // Und wieder geladen ist alles da
+        const std::vector<TileRawStruct> Saved = ReadAllTiles(Level);
+        CHECK(Level.LoadLevel(Map));
+        CHECK(SameTiles(ReadAllTiles(Level), Saved));
+
+        if (TestFailures != Before)
+            Protokoll << "-> Save test failed for " << File.string() << std::endl;
+
+        fs::remove(Map, ec);
+        fs::remove(Full, ec);
+    }
+
+    return TestResult("save");
+}
@@ -0,0 +1,98 @@
+// Datei : ScannerTest.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// test_scanner <data/levels>: LevelScanner::ReadLevelInfo() nimmt dieselben Dateien wie
+// LoadLevel()
+//
+// - v2 Dateien beider Versionen (32- und 64-bit Chunkindex), unbekannte Versionen nicht
+// - .map mit mehr als MAX_GEGNER Objekten, davon werden wie beim Laden nur die ersten
+//   MAX_GEGNER gezählt
+//
+// --------------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+#include "LevelFormat.hpp"
+#include "LevelScanner.hpp"
+#include "TestUtil.hpp"
+
+// Version im Kopf einer v2 Datei umschreiben und die Datei scannen
+static bool ScanVersion(const std::string &Filename, uint32_t Version) {
+    {
+        std::fstream File(Filename, std::ios::in | std::ios::out | std::ios::binary);
+        const uint32_t Value = FixEndian(Version);
+        File.seekp(offsetof(LevelV2Header, Version));
+        File.write(reinterpret_cast<const char *>(&Value), sizeof(Value));
+    }
+
+    LevelInfo Info;
+    return LevelScannerClass::ReadLevelInfo(Filename, Info) && Info.V2;
+}
+
+// Kopie von From mit Count Objekten, aufgefüllt mit dem ersten Objekt
+static bool WriteObjects(const fs::path &From, const std::string &To, uint32_t Count) {
+    std::ifstream In(From, std::ios::binary);
+    std::vector<char> Data((std::istreambuf_iterator<char>(In)), std::istreambuf_iterator<char>());
+    if (Data.size() < sizeof(FileHeader))
+        return false;
+
+    FileHeader Header;
+    memcpy(&Header, Data.data(), sizeof(Header));
+
+    const uint32_t NumObjects = FixEndian(Header.NumObjects);
+    const size_t Objects = sizeof(FileHeader) + static_cast<size_t>(FixEndian(Header.SizeX)) *
+                                                    FixEndian(Header.SizeY) * sizeof(LevelTileLoadStruct);
+    if (NumObjects == 0 || NumObjects > Count || Objects + NumObjects * sizeof(LevelObjectStruct) > Data.size())
+        return false;
+
+    const std::vector<char> First(Data.begin() + Objects, Data.begin() + Objects + sizeof(LevelObjectStruct));
+    for (uint32_t n = NumObjects; n < Count; n++)
+        Data.insert(Data.begin() + Objects + NumObjects * sizeof(LevelObjectStruct), First.begin(), First.end());
+
+    Header.NumObjects = FixEndian(Count);
+    memcpy(Data.data(), &Header, sizeof(Header));
+
+    std::ofstream Out(To, std::ios::binary | std::ios::trunc);
+    Out.write(Data.data(), static_cast<std::streamsize>(Data.size()));
+    return static_cast<bool>(Out);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <data/levels>\n", argv[0]);
+        return 2;
+    }
+
+    const fs::path Dir = TestDirectory("scanner");
+    const fs::path Elevator = fs::path(argv[1]) / "elevator.map";
+
+    // v2 Versionen
+    //
+    const std::string V2 = (Dir / "elevator.map2").string();
+    CHECK(ConvertLevelFile(Elevator.string(), V2));
+    CHECK(ScanVersion(V2, LEVELV2_VERSION));
+    CHECK(ScanVersion(V2, LEVELV2_VERSION_OFFSET32));
+    CHECK(!ScanVersion(V2, LEVELV2_VERSION + 1));
+
+    // Zu viele Objekte
+    //
+    const std::string Many = (Dir / "many.map").string();
+    CHECK(WriteObjects(Elevator, Many, MAX_GEGNER + 52));
+
+    LevelInfo Info;
+    CHECK(LevelScannerClass::ReadLevelInfo(Many, Info));
+    CHECK(Info.NumObjects() == MAX_GEGNER);
+
+    LevelClass Level;
+    CHECK(Level.LoadLevel(Many));
+    CHECK(ObjectList.ObjectCount == MAX_GEGNER);
+
+    return TestResult("scanner");
+}
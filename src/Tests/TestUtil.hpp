@@ -0,0 +1,92 @@
+// Datei : TestUtil.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Gemeinsames für die Tests unter src/Tests. Jeder Test ist ein eigenes Programm gegen
+// editorcore, bekommt data/levels als Argument und arbeitet auf Kopien in einem
+// Verzeichnis unter dem aktuellen (bei ctest das Build-Verzeichnis).
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _TESTUTIL_HPP_
+#define _TESTUTIL_HPP_
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+#include "Logdatei.hpp"
+#include "ObjectList.hpp"
+
+namespace fs = std::filesystem;
+
+inline int TestFailures = 0;
+
+// Fehlgeschlagene Bedingung ins Protokoll schreiben und weitermachen
+#define CHECK(Cond)                                                                                      \
+    do {                                                                                                 \
+        if (!(Cond)) {                                                                                   \
+            TestFailures++;                                                                              \
+            Protokoll << "-> FAILED " << __FILE__ << ":" << __LINE__ << ": " << #Cond << std::endl;     \
+        }                                                                                                \
+    } while (0)
+
+// Rückgabe für main()
+inline int TestResult(const char *Name) {
+    Protokoll << "-> Test " << Name << ": " << TestFailures << " failures" << std::endl;
+    return TestFailures == 0 ? 0 : 1;
+}
+
+// Leeres Arbeitsverzeichnis testdata_<Name>
+inline fs::path TestDirectory(const std::string &Name) {
+    const fs::path Dir = fs::current_path() / ("testdata_" + Name);
+
+    std::error_code ec;
+    fs::remove_all(Dir, ec);
+    fs::create_directories(Dir, ec);
+    return Dir;
+}
+
+// Level aus data/levels ins Arbeitsverzeichnis kopieren, gibt den neuen Pfad zurück
+inline std::string CopyLevel(const fs::path &From, const fs::path &Dir) {
+    const fs::path To = Dir / From.filename();
+
+    std::error_code ec;
+    fs::copy_file(From, To, fs::copy_options::overwrite_existing, ec);
+    return To.string();
+}
+
+// Alle Tiles des Levels roh, wie LevelClass::ReadTiles() sie liefert
+inline std::vector<TileRawStruct> ReadAllTiles(LevelClass &Level) {
+    Level.PrepareAllTiles();
+
+    std::vector<TileRawStruct> Tiles(static_cast<size_t>(Level.LEVELSIZE_X) * Level.LEVELSIZE_Y);
+    Level.ReadTiles(0, 0, Level.LEVELSIZE_X, Level.LEVELSIZE_Y, Tiles.data());
+    return Tiles;
+}
+
+inline bool SameTiles(const std::vector<TileRawStruct> &a, const std::vector<TileRawStruct> &b) {
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(TileRawStruct)) == 0;
+}
+
+// Die ersten ObjectList.ObjectCount Objekte
+inline std::vector<Object> CurrentObjects() {
+    return std::vector<Object>(ObjectList.Objects.begin(), ObjectList.Objects.begin() + ObjectList.ObjectCount);
+}
+
+inline bool SameObjects(const std::vector<Object> &a, const std::vector<Object> &b) {
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t n = 0; n < a.size(); n++)
+        if (a[n].ObjectID != b[n].ObjectID || a[n].XPos != b[n].XPos || a[n].YPos != b[n].YPos ||
+            a[n].ChangeLight != b[n].ChangeLight || a[n].Skill != b[n].Skill || a[n].Value1 != b[n].Value1 ||
+            a[n].Value2 != b[n].Value2)
+            return false;
+
+    return true;
+}
+
+#endif
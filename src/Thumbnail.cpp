@@ -0,0 +1,406 @@
+// Datei : Thumbnail.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Vorschaubilder von Levels ohne OpenGL (siehe Thumbnail.hpp)
+//
+// --------------------------------------------------------------------------------------
+
+#include "Thumbnail.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "Globals.hpp"
+#include "LevelFormat.hpp"
+#include "Logdatei.hpp"
+#include "MappedFile.hpp"
+
+namespace fs = std::filesystem;
+
+constexpr char TILECOLORS_MAGIC[8] = {'H', 'U', 'R', 'R', 'T', 'C', 'L', '1'};
+constexpr char THUMBNAIL_MAGIC[8] = {'H', 'U', 'R', 'R', 'T', 'H', 'B', '1'};
+
+// --------------------------------------------------------------------------------------
+// Hilfsfunktionen
+// --------------------------------------------------------------------------------------
+
+namespace {
+
+// Änderungszeit und Grösse, damit ein Cache-Eintrag zur Datei passt
+struct FileStamp {
+    int64_t ModTime = 0;
+    uint64_t Size = 0;
+
+    bool Read(const std::string &Filename) {
+        std::error_code ec;
+        auto const Time = fs::last_write_time(Filename, ec);
+        if (ec)
+            return false;
+        ModTime = static_cast<int64_t>(Time.time_since_epoch().count());
+        Size = fs::file_size(Filename, ec);
+        return !ec;
+    }
+
+    bool operator==(const FileStamp &Other) const { return ModTime == Other.ModTime && Size == Other.Size; }
+};
+
+// a * b / 255, exakt gerundet für alle a, b aus 0..255
+inline uint8_t Mul255(unsigned a, unsigned b) {
+    unsigned const t = a * b + 128;
+    return static_cast<uint8_t>((t + (t >> 8)) >> 8);
+}
+
+uint64_t HashString(const std::string &Text) {
+    uint64_t Hash = 14695981039346656037ull;  // FNV-1a
+    for (char c : Text)
+        Hash = (Hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    return Hash;
+}
+
+// Back- und Front-Tile übereinander legen und mit der Tilefarbe multiplizieren:
+//   Out = (Back * (255 - Front.a) / 255 + Front) * Mod / 255
+// Farben liegen als RGBA Bytes vor, Back/Front schon mit ihrem Alpha multipliziert
+void ComposeTiles(const uint32_t *Back, const uint32_t *Front, const uint32_t *Mod, uint32_t *Out, int Count) {
+    int i = 0;
+
+#if defined(__SSE2__)
+    __m128i const Zero = _mm_setzero_si128();
+    __m128i const Round = _mm_set1_epi16(128);
+    __m128i const Full = _mm_set1_epi16(255);
+
+    auto Mul = [&](__m128i a, __m128i b) {
+        __m128i const t = _mm_add_epi16(_mm_mullo_epi16(a, b), Round);
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    };
+
+    // Front.a in alle vier Kanäle, 255 - Front.a
+    auto InvAlpha = [&](__m128i f) {
+        __m128i const a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(f, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+        return _mm_sub_epi16(Full, a);
+    };
+
+    for (; i + 4 <= Count; i += 4) {
+        __m128i const b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Back + i));
+        __m128i const f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Front + i));
+        __m128i const m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Mod + i));
+
+        // je zwei Pixel in 16-Bit Kanälen
+        __m128i const fl = _mm_unpacklo_epi8(f, Zero);
+        __m128i const fh = _mm_unpackhi_epi8(f, Zero);
+
+        __m128i lo = _mm_add_epi16(Mul(_mm_unpacklo_epi8(b, Zero), InvAlpha(fl)), fl);
+        __m128i hi = _mm_add_epi16(Mul(_mm_unpackhi_epi8(b, Zero), InvAlpha(fh)), fh);
+
+        lo = Mul(lo, _mm_unpacklo_epi8(m, Zero));
+        hi = Mul(hi, _mm_unpackhi_epi8(m, Zero));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Out + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+
+    for (; i < Count; i++) {
+        uint8_t b[4], f[4], m[4], o[4];
+        memcpy(b, &Back[i], 4);
+        memcpy(f, &Front[i], 4);
+        memcpy(m, &Mod[i], 4);
+
+        for (int c = 0; c < 4; c++)
+            o[c] = Mul255(std::min(255u, static_cast<unsigned>(Mul255(b[c], 255 - f[3]) + f[c])), m[c]);
+
+        memcpy(&Out[i], o, 4);
+    }
+}
+
+}  // namespace
+
+// --------------------------------------------------------------------------------------
+// Farben eines Tilesets
+// --------------------------------------------------------------------------------------
+
+void ThumbnailClass::ComputeTilesetColors(const uint8_t *Pixels, int Width, int Height, TilesetColors &Colors) {
+    for (int t = 0; t < MAX_TILERECTS; t++) {
+        // wie TileRects in der TileEngine
+        int const x0 = (t % 12) * ORIGINAL_TILE_SIZE_X;
+        int const y0 = (t / 12) * ORIGINAL_TILE_SIZE_Y;
+        int const x1 = std::min(x0 + ORIGINAL_TILE_SIZE_X, Width);
+        int const y1 = std::min(y0 + ORIGINAL_TILE_SIZE_Y, Height);
+
+        uint64_t r = 0, g = 0, b = 0, a = 0;
+        for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++) {
+                const uint8_t *p = Pixels + (static_cast<size_t>(y) * Width + x) * 4;
+                r += p[0] * p[3];
+                g += p[1] * p[3];
+                b += p[2] * p[3];
+                a += p[3];
+            }
+
+        // Ausserhalb des Bildes zählt als durchsichtig
+        uint64_t const n = static_cast<uint64_t>(ORIGINAL_TILE_SIZE_X) * ORIGINAL_TILE_SIZE_Y;
+
+        TileColor &Color = Colors.Tiles[t];
+        Color.r = static_cast<uint8_t>((r + n * 255 / 2) / (n * 255));
+        Color.g = static_cast<uint8_t>((g + n * 255 / 2) / (n * 255));
+        Color.b = static_cast<uint8_t>((b + n * 255 / 2) / (n * 255));
+        Color.a = static_cast<uint8_t>((a + n / 2) / n);
+    }
+}
+
+const TilesetColors *ThumbnailClass::GetTilesetColors(const std::string &Name) {
+    {
+        std::lock_guard<std::mutex> Lock(itsMutex);
+        auto Found = itsTilesets.find(Name);
+        if (Found != itsTilesets.end())
+            return Found->second.get();
+    }
+
+    std::string const Path = (fs::path(itsTexturePath) / Name).string();
+    auto Colors = std::make_unique<TilesetColors>();
+    FileStamp Stamp;
+    bool Loaded = false;
+
+    // Erst im Cache nachsehen, das PNG muss dann gar nicht dekodiert werden
+    std::string const Cache = CacheFile(Name, ".tiles");
+    if (Stamp.Read(Path) && !Cache.empty()) {
+        std::ifstream Datei(Cache, std::ifstream::binary);
+        char Magic[sizeof(TILECOLORS_MAGIC)];
+        FileStamp Cached;
+
+        Datei.read(Magic, sizeof(Magic));
+        Datei.read(reinterpret_cast<char *>(&Cached), sizeof(Cached));
+        Datei.read(reinterpret_cast<char *>(Colors.get()), sizeof(TilesetColors));
+
+        Loaded = Datei && memcmp(Magic, TILECOLORS_MAGIC, sizeof(Magic)) == 0 && Cached == Stamp;
+    }
+
+    std::vector<uint8_t> Pixels;
+    int Width = 0, Height = 0;
+
+    if (!Loaded && itsDecoder && itsDecoder(Path, Pixels, Width, Height) &&
+        Pixels.size() >= static_cast<size_t>(Width) * Height * 4) {
+        ComputeTilesetColors(Pixels.data(), Width, Height, *Colors);
+        Loaded = true;
+
+        if (!Cache.empty()) {
+            std::ofstream Datei(Cache, std::ofstream::binary | std::ofstream::trunc);
+            Datei.write(TILECOLORS_MAGIC, sizeof(TILECOLORS_MAGIC));
+            Datei.write(reinterpret_cast<const char *>(&Stamp), sizeof(Stamp));
+            Datei.write(reinterpret_cast<const char *>(Colors.get()), sizeof(TilesetColors));
+        }
+    }
+
+    if (!Loaded) {
+        Protokoll << "-> Thumbnail: could not load tileset " << Path << std::endl;
+        Colors.reset();
+    }
+
+    std::lock_guard<std::mutex> Lock(itsMutex);
+    auto &Entry = itsTilesets[Name];
+    if (Entry == nullptr)
+        Entry = std::move(Colors);
+    return Entry.get();
+}
+
+// --------------------------------------------------------------------------------------
+// Vorschaubild rendern
+// --------------------------------------------------------------------------------------
+
+std::string ThumbnailClass::CacheFile(const std::string &Name, const char *Extension) const {
+    if (itsCachePath.empty())
+        return {};
+
+    std::error_code ec;
+    fs::create_directories(itsCachePath, ec);
+    return (fs::path(itsCachePath) / (Name + Extension)).string();
+}
+
+bool ThumbnailClass::Render(const std::string &Filename, int MaxSize, LevelThumbnail &Thumbnail) {
+    FileStamp Stamp;
+    if (MaxSize <= 0 || !Stamp.Read(Filename))
+        return false;
+
+    // Cache: Stempel, Grösse und voller Pfad, falls zwei Pfade denselben Hash haben
+    char HashName[17];
+    snprintf(HashName, sizeof(HashName), "%016llx",
+             static_cast<unsigned long long>(HashString(fs::absolute(Filename).string())));
+    std::string const Cache = CacheFile(HashName, ".thumb");
+
+    if (!Cache.empty()) {
+        std::ifstream Datei(Cache, std::ifstream::binary);
+        char Magic[sizeof(THUMBNAIL_MAGIC)];
+        FileStamp Cached;
+        int32_t Values[4] = {};  // MaxSize, Width, Height, TilesPerPixel
+        uint32_t Length = 0;
+
+        Datei.read(Magic, sizeof(Magic));
+        Datei.read(reinterpret_cast<char *>(&Cached), sizeof(Cached));
+        Datei.read(reinterpret_cast<char *>(Values), sizeof(Values));
+        Datei.read(reinterpret_cast<char *>(&Length), sizeof(Length));
+
+        std::string Path(Datei && Length < 4096 ? Length : 0, '\0');
+        Datei.read(&Path[0], Path.size());
+
+        if (Datei && memcmp(Magic, THUMBNAIL_MAGIC, sizeof(Magic)) == 0 && Cached == Stamp && Values[0] == MaxSize &&
+            Path == fs::absolute(Filename).string() && Values[1] > 0 && Values[2] > 0 && Values[1] <= MaxSize &&
+            Values[2] <= MaxSize) {
+            Thumbnail.Width = Values[1];
+            Thumbnail.Height = Values[2];
+            Thumbnail.TilesPerPixel = Values[3];
+            Thumbnail.Pixels.resize(static_cast<size_t>(Thumbnail.Width) * Thumbnail.Height * 4);
+            Datei.read(reinterpret_cast<char *>(Thumbnail.Pixels.data()), Thumbnail.Pixels.size());
+            if (Datei)
+                return true;
+        }
+    }
+
+    // Rohe Tiles spaltenweise wie in der .map, bei v2 erst alle Chunks auspacken
+    MappedFile Datei;
+    if (!Datei.Open(Filename))
+        return false;
+
+    FileHeader Header;
+    const uint8_t *Tiles;
+    std::vector<uint8_t> Unpacked;
+
+    if (LevelV2File::IsLevelV2(Datei.Data(), Datei.Size())) {
+        Datei.Close();
+
+        LevelV2File V2;
+        if (!V2.Open(Filename))
+            return false;
+
+        Header = V2.Header();
+        int const SizeY = V2.SizeY();
+        Unpacked.resize(static_cast<size_t>(V2.SizeX()) * SizeY * sizeof(LevelTileLoadStruct));
+
+        std::vector<uint8_t> Chunk(LEVELV2_CHUNKSIZE * LEVELV2_CHUNKSIZE * sizeof(LevelTileLoadStruct));
+        for (int cx = 0; cx < V2.ChunksX(); cx++)
+            for (int cy = 0; cy < V2.ChunksY(); cy++) {
+                if (!V2.DecodeChunk(cx, cy, Chunk.data()))
+                    return false;
+
+                int const w = V2.ChunkWidth(cx);
+                int const h = V2.ChunkHeight(cy);
+                for (int i = 0; i < w; i++)
+                    memcpy(&Unpacked[(static_cast<size_t>(cx * LEVELV2_CHUNKSIZE + i) * SizeY + cy * LEVELV2_CHUNKSIZE) *
+                                     sizeof(LevelTileLoadStruct)],
+                           &Chunk[static_cast<size_t>(i) * h * sizeof(LevelTileLoadStruct)],
+                           h * sizeof(LevelTileLoadStruct));
+            }
+
+        Tiles = Unpacked.data();
+    } else {
+        const uint8_t *HeaderData = Datei.Range(0, sizeof(FileHeader));
+        if (HeaderData == nullptr)
+            return false;
+        memcpy(&Header, HeaderData, sizeof(Header));
+
+        Tiles = Datei.Range(sizeof(FileHeader), static_cast<size_t>(FixEndian(Header.SizeX)) *
+                                                    FixEndian(Header.SizeY) * sizeof(LevelTileLoadStruct));
+        if (Tiles == nullptr)
+            return false;
+    }
+
+    if (!RenderTiles(Header, Tiles, MaxSize, Thumbnail))
+        return false;
+
+    if (!Cache.empty()) {
+        std::ofstream Out(Cache, std::ofstream::binary | std::ofstream::trunc);
+        int32_t const Values[4] = {MaxSize, Thumbnail.Width, Thumbnail.Height, Thumbnail.TilesPerPixel};
+        std::string const Path = fs::absolute(Filename).string();
+        auto const Length = static_cast<uint32_t>(Path.size());
+
+        Out.write(THUMBNAIL_MAGIC, sizeof(THUMBNAIL_MAGIC));
+        Out.write(reinterpret_cast<const char *>(&Stamp), sizeof(Stamp));
+        Out.write(reinterpret_cast<const char *>(Values), sizeof(Values));
+        Out.write(reinterpret_cast<const char *>(&Length), sizeof(Length));
+        Out.write(Path.data(), Length);
+        Out.write(reinterpret_cast<const char *>(Thumbnail.Pixels.data()), Thumbnail.Pixels.size());
+    }
+
+    return true;
+}
+
+bool ThumbnailClass::RenderTiles(const FileHeader &Header, const uint8_t *Tiles, int MaxSize,
+                                 LevelThumbnail &Thumbnail) {
+    int const SizeX = static_cast<int>(FixEndian(Header.SizeX));
+    int const SizeY = static_cast<int>(FixEndian(Header.SizeY));
+    int const UsedTilesets = std::min<int>(Header.UsedTilesets, MAX_TILESETS);
+
+    if (SizeX <= 0 || SizeY <= 0 || SizeX > MAX_LEVELSIZE_X || SizeY > MAX_LEVELSIZE_Y)
+        return false;
+
+    // Farben aller benutzten Tilesets, fehlende bleiben leer
+    std::vector<const TilesetColors *> Sets(UsedTilesets, nullptr);
+    for (int s = 0; s < UsedTilesets; s++) {
+        char Name[sizeof(Header.SetNames[s]) + 1] = {};
+        memcpy(Name, Header.SetNames[s], sizeof(Header.SetNames[s]));
+        if (Name[0] != '\0')
+            Sets[s] = GetTilesetColors(Name);
+    }
+
+    auto Lookup = [&](uint8_t Set, uint8_t Art) -> uint32_t {
+        if (Art < INCLUDE_ZEROTILE || Set >= UsedTilesets || Sets[Set] == nullptr ||
+            Art - INCLUDE_ZEROTILE >= MAX_TILERECTS)
+            return 0;
+        uint32_t Color;
+        memcpy(&Color, &Sets[Set]->Tiles[Art - INCLUDE_ZEROTILE], 4);
+        return Color;
+    };
+
+    int const Factor = std::max(1, (std::max(SizeX, SizeY) + MaxSize - 1) / MaxSize);
+    int const Width = (SizeX + Factor - 1) / Factor;
+    int const Height = (SizeY + Factor - 1) / Factor;
+
+    std::vector<uint32_t> Sums(static_cast<size_t>(Width) * Height * 4, 0);
+    std::vector<uint32_t> Counts(static_cast<size_t>(Width) * Height, 0);
+    std::vector<uint32_t> Back(SizeY), Front(SizeY), Mod(SizeY), Out(SizeY);
+
+    // Spalte für Spalte, die liegt in der Datei am Stück
+    for (int i = 0; i < SizeX; i++) {
+        const uint8_t *Column = Tiles + static_cast<size_t>(i) * SizeY * sizeof(LevelTileLoadStruct);
+
+        for (int j = 0; j < SizeY; j++) {
+            const uint8_t *Tile = Column + j * sizeof(LevelTileLoadStruct);  // Back/Front Set, Back/Front Art, RGBA
+            Back[j] = Lookup(Tile[0], Tile[2]);
+            Front[j] = Lookup(Tile[1], Tile[3]);
+
+            uint8_t const m[4] = {Tile[4], Tile[5], Tile[6], 255};
+            memcpy(&Mod[j], m, 4);
+        }
+
+        ComposeTiles(Back.data(), Front.data(), Mod.data(), Out.data(), SizeY);
+
+        int const x = i / Factor;
+        for (int j = 0; j < SizeY; j++) {
+            size_t const Pixel = static_cast<size_t>(j / Factor) * Width + x;
+            uint8_t c[4];
+            memcpy(c, &Out[j], 4);
+            Sums[Pixel * 4 + 0] += c[0];
+            Sums[Pixel * 4 + 1] += c[1];
+            Sums[Pixel * 4 + 2] += c[2];
+            Sums[Pixel * 4 + 3] += c[3];
+            Counts[Pixel]++;
+        }
+    }
+
+    Thumbnail.Width = Width;
+    Thumbnail.Height = Height;
+    Thumbnail.TilesPerPixel = Factor;
+    Thumbnail.Pixels.resize(static_cast<size_t>(Width) * Height * 4);
+
+    // Leere Stellen sind schwarz, nicht durchsichtig
+    for (size_t p = 0; p < Counts.size(); p++)
+        for (int c = 0; c < 4; c++)
+            Thumbnail.Pixels[p * 4 + c] =
+                c == 3 ? 255 : static_cast<uint8_t>((Sums[p * 4 + c] + Counts[p] / 2) / Counts[p]);
+
+    return true;
+}
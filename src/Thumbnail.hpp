@@ -0,0 +1,95 @@
+// Datei : Thumbnail.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Vorschaubilder von Levels ohne OpenGL
+//
+// Pro Tileset wird einmal für jedes der 144 Tiles (das 12x12 Raster aus TileRects) die
+// mittlere Farbe und Deckung berechnet. Ein Leveltile ist im Vorschaubild dann nur noch
+// Back- und Front-Tile übereinandergelegt und mit Red/Green/Blue des Tiles
+// multipliziert, mehrere Tiles werden zu einem Pixel gemittelt. Tileset-Farben und
+// fertige Vorschaubilder werden auf der Platte gemerkt.
+//
+// PNGs dekodieren kann der Core nicht, das übernimmt der Decoder, den der Editor setzt.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _THUMBNAIL_HPP_
+#define _THUMBNAIL_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+
+// --------------------------------------------------------------------------------------
+// Strukturen
+// --------------------------------------------------------------------------------------
+
+// Mittlere Farbe eines Tiles, mit der Deckung (Alpha) schon multipliziert
+//
+struct TileColor {
+    uint8_t r, g, b, a;
+};
+
+struct TilesetColors {
+    TileColor Tiles[MAX_TILERECTS];
+};
+
+// Fertiges Vorschaubild, RGBA Bytes Zeile für Zeile
+//
+struct LevelThumbnail {
+    int Width = 0;
+    int Height = 0;
+    int TilesPerPixel = 1;  // so viele Tiles in X und Y stecken in einem Pixel
+    std::vector<uint8_t> Pixels;
+};
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class ThumbnailClass {
+  public:
+    // Bild nach RGBA (Zeile für Zeile, Width * 4 Bytes pro Zeile) dekodieren
+    using DecodeFunction = std::function<bool(const std::string &Path, std::vector<uint8_t> &Pixels,
+                                              int &Width, int &Height)>;
+
+    void SetDecoder(DecodeFunction Decoder) { itsDecoder = std::move(Decoder); }
+    void SetTexturePath(const std::string &Path) { itsTexturePath = Path; }  // dort liegen die Tilesets
+    void SetCachePath(const std::string &Path) { itsCachePath = Path; }      // leer = nichts auf die Platte
+
+    // Vorschaubild eines .map/.map2 Levels, höchstens MaxSize Pixel breit und hoch
+    bool Render(const std::string &Filename, int MaxSize, LevelThumbnail &Thumbnail);
+
+    // Farben der Tiles eines Tilesets, nullptr wenn es sich nicht laden lässt
+    const TilesetColors *GetTilesetColors(const std::string &Name);
+
+    // 12x12 Tiles zu je ORIGINAL_TILE_SIZE_X/Y Pixeln aus einem RGBA Bild mitteln
+    static void ComputeTilesetColors(const uint8_t *Pixels, int Width, int Height, TilesetColors &Colors);
+
+  private:
+    bool RenderTiles(const FileHeader &Header, const uint8_t *Tiles, int MaxSize, LevelThumbnail &Thumbnail);
+
+    std::string CacheFile(const std::string &Name, const char *Extension) const;
+
+    DecodeFunction itsDecoder;
+    std::string itsTexturePath;
+    std::string itsCachePath;
+
+    std::mutex itsMutex;
+    std::map<std::string, std::unique_ptr<TilesetColors>> itsTilesets;  // nullptr: lässt sich nicht laden
+};
+
+// --------------------------------------------------------------------------------------
+// Externals
+// --------------------------------------------------------------------------------------
+
+extern ThumbnailClass Thumbnails;
+
+#endif
@@ -0,0 +1,311 @@
+// Datei : TilePager.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Tile-Bricks grosser Levels in einer eingeblendeten Auslagerungsdatei
+//
+// --------------------------------------------------------------------------------------
+
+#include "TilePager.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <new>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Level.hpp"
+#include "Logdatei.hpp"
+
+namespace fs = std::filesystem;
+
+// Jeder Slot beginnt auf einer eigenen Seite, sonst könnte Release() den Nachbarn treffen
+constexpr size_t SLOT_PAGE = 4096;
+constexpr size_t SLOT_SIZE = (sizeof(TileBrick) + SLOT_PAGE - 1) / SLOT_PAGE * SLOT_PAGE;
+
+static std::atomic<size_t> ResidentLimitBricks{TILEPAGE_RESIDENT};
+
+static std::mutex PageDirectoryMutex;
+static std::string PageDirectory;
+
+void TilePager::SetResidentLimit(size_t Bricks) {
+    ResidentLimitBricks = std::max<size_t>(Bricks, 1);
+}
+
+size_t TilePager::ResidentLimit() {
+    return ResidentLimitBricks;
+}
+
+void TilePager::SetDirectory(const std::string &Directory) {
+    std::lock_guard<std::mutex> lock(PageDirectoryMutex);
+    PageDirectory = Directory;
+}
+
+std::string TilePager::Directory() {
+    std::lock_guard<std::mutex> lock(PageDirectoryMutex);
+    return PageDirectory;
+}
+
+// --------------------------------------------------------------------------------------
+// Auslagerungsdatei anlegen
+//
+// Die Datei wird gleich wieder gelöscht, sie lebt nur so lange wie die Einblendung. Sie
+// ist anfangs leer (sparse), Platz auf der Platte belegen nur benutzte Slots.
+// --------------------------------------------------------------------------------------
+
+std::shared_ptr<TilePager> TilePager::Create(size_t Capacity, const std::string &LevelFile) {
+#if !defined(_WIN32)
+    fs::path Dir = Directory();
+    if (Dir.empty() && !LevelFile.empty())
+        Dir = fs::absolute(LevelFile).parent_path();
+    if (Dir.empty())
+        Dir = fs::temp_directory_path();
+
+    std::string Name = (Dir / ".hurrican-tiles-XXXXXX").string();
+    const int fd = mkstemp(&Name[0]);
+    if (fd < 0) {
+        Protokoll << "-> Error: could not create tile page file " << Name << std::endl;
+        return nullptr;
+    }
+
+    unlink(Name.c_str());
+
+    std::shared_ptr<TilePager> Pager(new TilePager);
+    Pager->itsFile = fd;
+
+    if (!Pager->Grow(Capacity))
+        return nullptr;
+
+    Protokoll << "-> Paging level tiles through " << Capacity * SLOT_SIZE / 1024 << " kB file in " << Dir.string()
+              << ", keeping " << ResidentLimit() << " bricks resident" << std::endl;
+    return Pager;
+#else
+    (void)Capacity;
+    (void)LevelFile;
+    return nullptr;
+#endif
+}
+
+bool TilePager::Grow(size_t Count) {
+#if !defined(_WIN32)
+    const size_t Offset = itsCapacity * SLOT_SIZE;
+    const size_t Size = Count * SLOT_SIZE;
+
+    if (ftruncate(itsFile, static_cast<off_t>(Offset + Size)) != 0) {
+        Protokoll << "-> Error: could not size tile page file to " << Offset + Size << " bytes" << std::endl;
+        return false;
+    }
+
+    // Nur den neuen Teil einblenden, die Zeiger in die alten Bereiche bleiben gültig
+    void *addr = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED, itsFile, static_cast<off_t>(Offset));
+    if (addr == MAP_FAILED) {
+        Protokoll << "-> Error: could not map tile page file" << std::endl;
+        return false;
+    }
+
+    // Kein Readahead: der Kernel würde sonst bei jedem Zugriff auf einen ausgelagerten
+    // Brick gleich Megabytes an Nachbarn mit einblenden, die meist gar nicht gebraucht werden
+    madvise(addr, Size, MADV_RANDOM);
+
+    itsSegments.push_back(Segment{static_cast<uint8_t *>(addr), itsCapacity, Count});
+    itsStamp.resize(itsCapacity + Count, 0);
+    itsListed.resize(itsCapacity + Count, 0);
+
+    // Von vorne nach hinten vergeben, dann liegen die Bricks beim Laden in Dateireihenfolge
+    for (size_t i = 0; i < Count; i++)
+        itsFree.push_back(static_cast<uint32_t>(itsCapacity + Count - 1 - i));
+
+    itsCapacity += Count;
+    return true;
+#else
+    (void)Count;
+    return false;
+#endif
+}
+
+TilePager::~TilePager() {
+#if !defined(_WIN32)
+    for (const Segment &Seg : itsSegments)
+        munmap(Seg.Data, Seg.Count * SLOT_SIZE);
+    if (itsFile >= 0)
+        close(itsFile);
+#endif
+}
+
+// --------------------------------------------------------------------------------------
+// Slots vergeben und zurücknehmen
+// --------------------------------------------------------------------------------------
+
+std::shared_ptr<TileBrick> TilePager::NewBrick(const TileBrick &Brick) {
+    size_t Slot;
+    uint8_t *Data;
+
+    {
+        std::lock_guard<std::mutex> lock(itsMutex);
+
+        // Die Datei wächst jedesmal um die Hälfte
+        if (itsFree.empty() && !itsFull) {
+            if (Grow(std::max<size_t>(itsCapacity / 2, 1))) {
+                Protokoll << "-> Tile page file grown to " << itsCapacity << " bricks" << std::endl;
+            } else {
+                Protokoll << "-> Tile page file is full, keeping new bricks in memory" << std::endl;
+                itsFull = true;
+            }
+        }
+
+        if (itsFree.empty())
+            return std::make_shared<TileBrick>(Brick);
+
+        Slot = itsFree.back();
+        itsFree.pop_back();
+
+        Stamp(Slot);
+        Data = SlotData(Slot);
+    }
+
+    TileBrick *Copy = new (Data) TileBrick(Brick);
+
+    // Der Deleter hält den Pager fest, die Datei bleibt also, bis der letzte Brick weg ist
+    return std::shared_ptr<TileBrick>(Copy, [Pager = shared_from_this(), Slot](TileBrick *) {
+        Pager->FreeSlot(Slot);
+    });
+}
+
+void TilePager::FreeSlot(size_t Slot) {
+    std::lock_guard<std::mutex> lock(itsMutex);
+
+    if (itsStamp[Slot] != 0) {
+        itsStamp[Slot] = 0;
+        itsResident--;
+    }
+
+    Release(Slot);
+
+#if defined(FALLOC_FL_PUNCH_HOLE)
+    // Platz auf der Platte auch gleich zurückgeben
+    fallocate(itsFile, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(Slot * SLOT_SIZE), SLOT_SIZE);
+#endif
+
+    itsFree.push_back(static_cast<uint32_t>(Slot));
+}
+
+uint8_t *TilePager::SlotData(size_t Slot) const {
+    for (const Segment &Seg : itsSegments)
+        if (Slot - Seg.First < Seg.Count)
+            return Seg.Data + (Slot - Seg.First) * SLOT_SIZE;
+
+    return nullptr;
+}
+
+size_t TilePager::SlotOf(const TileBrick *Brick) const {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(Brick);
+
+    for (const Segment &Seg : itsSegments)
+        if (p >= Seg.Data && p < Seg.Data + Seg.Count * SLOT_SIZE)
+            return Seg.First + static_cast<size_t>(p - Seg.Data) / SLOT_SIZE;
+
+    return itsCapacity;
+}
+
+// --------------------------------------------------------------------------------------
+// Arbeitsmenge
+//
+// Jeder Slot merkt sich, wann er zuletzt angefasst wurde. Sind mehr als ResidentLimit()
+// im Speicher, fliegt das älteste Viertel auf einmal raus. Durchsucht werden dabei nur
+// die Slots in itsTouched, nicht die ganze Datei.
+// --------------------------------------------------------------------------------------
+
+void TilePager::Stamp(size_t Slot) {
+    if (itsStamp[Slot] == 0)
+        itsResident++;
+
+    itsStamp[Slot] = ++itsClock;
+
+    if (!itsListed[Slot]) {
+        itsListed[Slot] = 1;
+        itsTouched.push_back(static_cast<uint32_t>(Slot));
+    }
+
+    if (itsResident > ResidentLimit())
+        Evict();
+}
+
+void TilePager::Touch(const TileBrick *Brick) {
+    std::lock_guard<std::mutex> lock(itsMutex);
+
+    const size_t Slot = SlotOf(Brick);
+    if (Slot == itsCapacity)
+        return;
+
+    Stamp(Slot);
+}
+
+void TilePager::PageOut(const TileBrick *Brick) {
+    std::lock_guard<std::mutex> lock(itsMutex);
+
+    const size_t Slot = SlotOf(Brick);
+    if (Slot == itsCapacity)
+        return;
+
+    if (itsStamp[Slot] != 0) {
+        itsStamp[Slot] = 0;
+        itsResident--;
+    }
+
+    Release(Slot);
+}
+
+size_t TilePager::ResidentBricks() const {
+    std::lock_guard<std::mutex> lock(itsMutex);
+    return itsResident;
+}
+
+void TilePager::Evict() {
+    const size_t Limit = ResidentLimit();
+    const size_t Keep = Limit - Limit / 4;
+
+    // Ausgelagerte und freigegebene Slots stehen noch in der Liste, die fallen hier raus
+    std::vector<std::pair<uint64_t, uint32_t>> Resident;
+    Resident.reserve(itsResident);
+
+    for (const uint32_t Slot : itsTouched) {
+        if (itsStamp[Slot] != 0)
+            Resident.emplace_back(itsStamp[Slot], Slot);
+        else
+            itsListed[Slot] = 0;
+    }
+
+    const size_t Drop = Resident.size() - std::min(Keep, Resident.size());
+    std::nth_element(Resident.begin(), Resident.begin() + Drop, Resident.end());
+
+    itsTouched.clear();
+
+    for (size_t n = 0; n < Resident.size(); n++) {
+        const uint32_t Slot = Resident[n].second;
+
+        if (n < Drop) {
+            itsStamp[Slot] = 0;
+            itsListed[Slot] = 0;
+            Release(Slot);
+        } else {
+            itsTouched.push_back(Slot);
+        }
+    }
+
+    itsResident -= Drop;
+}
+
+void TilePager::Release(size_t Slot) {
+#if !defined(_WIN32)
+    // Bei MAP_SHARED geht dabei nichts verloren, die Seiten kommen beim nächsten Zugriff
+    // wieder aus der Datei
+    madvise(SlotData(Slot), SLOT_SIZE, MADV_DONTNEED);
+#else
+    (void)Slot;
+#endif
+}
@@ -0,0 +1,107 @@
+// Datei : TilePager.hpp
+
+// --------------------------------------------------------------------------------------
+//
+// Tile-Bricks grosser Levels in einer eingeblendeten Auslagerungsdatei
+//
+// Hat ein Level mehr Bricks als ResidentLimit(), liegen seine Bricks nicht auf dem Heap,
+// sondern in Slots einer temporären Datei, die mit mmap eingeblendet ist. Die Zeiger auf
+// die Bricks bleiben dadurch immer gültig, alles was Tiles liest funktioniert also
+// unverändert. Im Speicher bleiben nur die zuletzt mit Touch() angefassten Bricks, die
+// übrigen werden mit madvise() aus dem Prozess geworfen und beim nächsten Zugriff vom
+// Kernel wieder aus der Datei geholt.
+//
+// Die Datei liegt in Directory(), wenn eins gesetzt ist, sonst neben dem Level. Das
+// Temp-Verzeichnis ist oft ein tmpfs im Speicher, dann wäre das Auslagern sinnlos, es
+// wird nur für noch nie gespeicherte Levels genommen. Sind alle Slots belegt, wird die
+// Datei um einen weiteren, eigenen eingeblendeten Bereich verlängert, die alten Bereiche
+// bleiben dabei wo sie sind.
+//
+// Ohne mmap (oder wenn die Datei nicht angelegt werden kann) gibt Create() nullptr
+// zurück und das Level liegt wie gehabt ganz im Speicher.
+//
+// --------------------------------------------------------------------------------------
+
+#ifndef _TILEPAGER_HPP_
+#define _TILEPAGER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TileBrick;
+
+// --------------------------------------------------------------------------------------
+// Defines
+// --------------------------------------------------------------------------------------
+
+constexpr size_t TILEPAGE_RESIDENT = 16384;  // so viele Bricks (je 4 KB in der Datei) bleiben höchstens im Speicher
+
+// --------------------------------------------------------------------------------------
+// Klassendeklaration
+// --------------------------------------------------------------------------------------
+
+class TilePager : public std::enable_shared_from_this<TilePager> {
+  public:
+    ~TilePager();
+
+    TilePager(const TilePager &) = delete;
+    TilePager &operator=(const TilePager &) = delete;
+
+    // Auslagerungsdatei mit Platz für Capacity Bricks für das Level LevelFile (darf leer
+    // sein), nullptr wenn das nicht geht
+    static std::shared_ptr<TilePager> Create(size_t Capacity, const std::string &LevelFile);
+
+    // Kopie von Brick in einem freien Slot. Ist keiner mehr frei und lässt sich die Datei
+    // nicht verlängern, auf dem Heap
+    std::shared_ptr<TileBrick> NewBrick(const TileBrick &Brick);
+
+    void Touch(const TileBrick *Brick);    // wird gleich gebraucht, im Speicher halten
+    void PageOut(const TileBrick *Brick);  // wird erstmal nicht mehr gebraucht
+
+    size_t ResidentBricks() const;
+
+    // Ab wie vielen Bricks ein Level ausgelagert wird und wie viele dann im Speicher bleiben
+    static void SetResidentLimit(size_t Bricks);
+    static size_t ResidentLimit();
+
+    // Verzeichnis für die Auslagerungsdateien, leer = neben dem Level
+    static void SetDirectory(const std::string &Directory);
+    static std::string Directory();
+
+  private:
+    // Ein eingeblendeter Bereich der Datei, Slot First bis First + Count - 1
+    struct Segment {
+        uint8_t *Data;
+        size_t First;
+        size_t Count;
+    };
+
+    TilePager() = default;
+
+    bool Grow(size_t Count);    // Datei um Count Slots verlängern, itsMutex muss gesperrt sein
+    uint8_t *SlotData(size_t Slot) const;
+    size_t SlotOf(const TileBrick *Brick) const;  // itsCapacity, wenn nicht aus der Datei
+    void FreeSlot(size_t Slot);
+    void Stamp(size_t Slot);    // Slot ist jetzt im Speicher, itsMutex muss gesperrt sein
+    void Evict();               // älteste Bricks auslagern, itsMutex muss gesperrt sein
+    void Release(size_t Slot);  // Speicher des Slots freigeben, der Inhalt bleibt in der Datei
+
+    int itsFile = -1;
+    std::vector<Segment> itsSegments;
+    size_t itsCapacity = 0;            // Slots in allen Bereichen zusammen
+    bool itsFull = false;              // Verlängern ging schief, neue Bricks auf den Heap
+
+    mutable std::mutex itsMutex;       // Schnappschüsse können Bricks auf anderen Threads freigeben
+    std::vector<uint32_t> itsFree;     // freie Slots
+    std::vector<uint64_t> itsStamp;    // pro Slot: zuletzt angefasst, 0 = nicht im Speicher
+    std::vector<uint32_t> itsTouched;  // alle Slots, die im Speicher sein könnten
+    std::vector<uint8_t> itsListed;    // pro Slot: steht schon in itsTouched
+    uint64_t itsClock = 0;
+    size_t itsResident = 0;
+};
+
+#endif
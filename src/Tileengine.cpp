@@ -14,13 +14,14 @@
 // Includes
 // --------------------------------------------------------------------------------------
 
-#include <cmath>
-#include <cstring>
-#include <filesystem>
-#include <string>
 #include <algorithm>
+#include <future>
+#include <string>
 #include <utility>
+#include <filesystem>
 #include "Gegner.hpp"
+#include "LevelLoader.hpp"
+#include "ObjectGraphics.hpp"
 #include "ObjectList.hpp"
 namespace fs = std::filesystem;
 
@@ -28,9 +29,9 @@ namespace fs = std::filesystem;
 #include "DX8Sprite.hpp"
 #include "Globals.hpp"
 #include "Logdatei.hpp"
+#include "SDLPort/texture.hpp"
 #include "Tileengine.hpp"
 #include "Timer.hpp"
-#include "Globals.hpp"
 
 // --------------------------------------------------------------------------------------
 // externe Variablen
@@ -69,30 +70,30 @@ TileEngineClass::TileEngineClass() {
     RenderPosXTo = 0;
     RenderPosYTo = 0;
 
-    LEVELSIZE_X = 128;
-    LEVELSIZE_Y = 96;
-
     //CloudMovement = 0.0f;
     TileAnimCount = 0.0f;
     TileAnimPhase = 0;
-    LoadedTilesets = 0;
-
-    memset(Tiles, 0, sizeof(Tiles));
-
-    for (int i = 0; i < MAX_LEVELSIZE_X; i++)
-        for (int j = 0; j < MAX_LEVELSIZE_Y; j++) {
-            LevelTileStruct& tile = Tiles[i][j];
-            tile.Red = 255;
-            tile.Green = 255;
-            tile.Blue = 255;
-            tile.Alpha = 255;
-
-            tile.move_v1 = tile.move_v2 = tile.move_v3 = tile.move_v4 = false;
-        }
 
     for (auto &gfx : TileGfx)
         gfx.itsTexIdx = -1;
 
+    LightMapWanted = false;  // Lightmap-Licht weicht an Wandkanten und am Rand ab, also aus
+    LightMapReady = false;
+    LightMapOn = false;
+    TilesLit = true;
+    LightMapSizeX = 0;
+    LightMapSizeY = 0;
+
+    TileChunksX = 0;
+    TileChunksY = 0;
+    TileChunksLightMap = false;
+    TileChunksAtlas = false;
+    TileAtlasSlots = 0;
+    InstancingWanted = false;  // langsamer als die Vertex-Chunks, siehe SetInstancing()
+    TileChunksInstanced = false;
+    TileChunksResident = 0;
+    TileChunkPass = 0;
+
     // Texturkoordinaten für das Wasser vorberechnen
     for (int i = 0; i < 9; i++) {
         float const w = 128.0f / 8.0f * static_cast<float>(i) / 128.0f;
@@ -118,137 +119,63 @@ TileEngineClass::TileEngineClass() {
 
 TileEngineClass::~TileEngineClass() {}
 
-void TileEngineClass::LoadSprites() {
-    // Wasserfall Textur laden
-    Wasserfall[0].LoadImage("wasserfall.png", 60, 240, 60, 240, 1, 1);
-    Wasserfall[1].LoadImage("wasserfall2.png", 640, 480, 640, 480, 1, 1);
-
-    LiquidGfx[0].LoadImage("water.png", 128, 128, 128, 128, 1, 1);
-    LiquidGfx[1].LoadImage("water2.png", 128, 128, 128, 128, 1, 1);
-
-    // GameOver Schriftzug laden
-    //GameOver.LoadImage("gameover.png", 400, 90, 400, 90, 1, 1);
-
-    // Shatten für das Alien Level laden
-    Shadow.LoadImage("shadow.png", 512, 512, 512, 512, 1, 1);
-}
-
-void TileEngineClass::Zoom(float times) {
-    float OriginalScale = Scale;
-
-    Scale *= times;
-
-    CalcRenderRange();
-
-    // Cap the zoom
-    if (times < 1.0f && LEVELPIXELSIZE_X <= DirectGraphics.RenderWidth
-      ||times < 1.0f && LEVELPIXELSIZE_Y <= DirectGraphics.RenderHeight) {
-        Scale = OriginalScale;
-        CalcRenderRange();
-        return;
-    }
-
-    Scale = OriginalScale;
-
-    // Center screen again
-    const float aspect = (Scale * times) / Scale;
-    const float screenaspectx = (DirectGraphics.RenderWidth * aspect) - DirectGraphics.RenderWidth;
-    const float screenaspecty = (DirectGraphics.RenderHeight * aspect) - DirectGraphics.RenderHeight;
-    XOffset = XOffset * aspect + screenaspectx / 2.0f;
-    YOffset = YOffset * aspect + screenaspecty / 2.0f;
-
-    Scale *= times;
-}
-void TileEngineClass::ZoomBy(float times) {
-    float OriginalScale = Scale;
-
-    Scale += times;
-
-    CalcRenderRange();
-
-    // Cap the zoom
-    if (times < 1.0f && LEVELPIXELSIZE_X <= DirectGraphics.RenderWidth
-      ||times < 1.0f && LEVELPIXELSIZE_Y <= DirectGraphics.RenderHeight) {
-        Scale = OriginalScale;
-        CalcRenderRange();
-        return;
-    }
+// --------------------------------------------------------------------------------------
+// Level einlesen
+// Die Leveldaten liest LevelClass::ParseLevel() ein. Sobald die Objekte bekannt sind,
+// werden die Grafiken, die ApplyLevel() laden wird, in einem zweiten Task dekodiert.
+// --------------------------------------------------------------------------------------
 
-    Scale = OriginalScale;
+bool TileEngineClass::ParseLevel(const std::string &Filename, LevelLoaderStage &Stage, LevelLoadProgress *Progress) {
+    std::future<std::vector<std::pair<std::string, image_t>>> Images;
 
-    // Center screen again
-    const float aspect = (Scale + times) / Scale;
-    const float screenaspectx = (DirectGraphics.RenderWidth * aspect) - DirectGraphics.RenderWidth;
-    const float screenaspecty = (DirectGraphics.RenderHeight * aspect) - DirectGraphics.RenderHeight;
-    XOffset = XOffset * aspect + screenaspectx / 2.0f;
-    YOffset = YOffset * aspect + screenaspecty / 2.0f;
+    auto DecodeImages = [&Stage, &Images, Progress] {
+        std::vector<std::string> ImageFiles;
+        auto AddImage = [&ImageFiles](const char *Name) {
+            if (Name != nullptr && Name[0] != '\0' && std::find(ImageFiles.begin(), ImageFiles.end(), Name) == ImageFiles.end())
+                ImageFiles.emplace_back(Name);
+        };
 
-    Scale += times;
-}
+        for (int i = 0; i < Stage.Header.UsedTilesets && i < MAX_TILESETS; i++)
+            AddImage(Stage.Header.SetNames[i]);
 
-// --------------------------------------------------------------------------------------
-// Neues, leeres Level der Grösse xSize/ySize erstellen
-// --------------------------------------------------------------------------------------
+        AddImage(Stage.Header.BackgroundFile);
 
-void TileEngineClass::InitNewLevel(int xSize, int ySize) {
-    LEVELSIZE_X = xSize;
-    LEVELSIZE_Y = ySize;
+        for (const auto &Obj : Stage.Objects)
+            if (Obj.ObjectID < MAX_GEGNERGFX && !Stage.ObjectGraphicLoaded[Obj.ObjectID])
+                AddImage(ObjectListClass::GetGraphicFilename(Obj.ObjectID));
 
-    memset(&Tiles, 0, sizeof(Tiles));
+        Images = std::async(std::launch::async, [ImageFiles = std::move(ImageFiles), Progress] {
+            return TexturesystemClass::DecodeTextures(ImageFiles, Progress != nullptr ? &Progress->Cancel : nullptr);
+        });
+    };
 
-    WaterSinTable.ResetPosition();
+    const bool Parsed = LevelClass::ParseLevel(Filename, Stage, Progress, DecodeImages);
 
-    DrawDragon = true;
+    // Auch bei Fehler/Abbruch auf den Task warten, der hängt an Stage
+    if (Images.valid())
+        Stage.Images = Images.get();
 
-    XOffset = 0.0f;
-    YOffset = 0.0f;
+    return Parsed;
 }
 
 // --------------------------------------------------------------------------------------
-// Level freigeben
-// --------------------------------------------------------------------------------------
-
-void TileEngineClass::ClearLevel() {}
-
-// --------------------------------------------------------------------------------------
-// Level laden
+// Eingelesenes Level übernehmen
+// Nur auf dem GL-Thread aufrufen, hier werden die Texturen hochgeladen.
 // --------------------------------------------------------------------------------------
 
-bool TileEngineClass::LoadLevel(const std::string &Filename) {
-    ObjectList.ClearObjects();
-
-    LevelObjectStruct LoadObject;
+bool TileEngineClass::ApplyLevel(LevelLoaderStage &Stage) {
+    // Vorab dekodierte Bilder müssen nur noch hochgeladen werden
+    for (auto &Image : Stage.Images)
+        SDL_QueueDecodedTexture(Image.first, std::move(Image.second));
+    Stage.Images.clear();
 
-    // Dann checken, ob sich das File im Standard Ordner befindet
-    if (!fs::exists(Filename) && !fs::is_regular_file(Filename)) {
-        Protokoll << "\n-> Error loading level " << Filename << "!" << std::endl;
-        GameRunning = false;
+    if (!LevelClass::ApplyLevel(Stage))
         return false;
-    }
 
-    Protokoll << "\n-> Loading Level <-\n" << std::endl;
-
-    ClearLevel();
-
-    // File öffnen
-    std::ifstream Datei(Filename, std::ifstream::binary);
-
-    if (!Datei) {
-        Protokoll << " \n-> Error loading level !" << std::endl;
-        return false;
-    }
-
-    // DateiHeader auslesen
-    Datei.read(reinterpret_cast<char *>(&DateiHeader), sizeof(DateiHeader));
-
-    // und Werte übertragen
-    LEVELSIZE_X = FixEndian(DateiHeader.SizeX);
-    LEVELSIZE_Y = FixEndian(DateiHeader.SizeY);
-    LoadedTilesets = DateiHeader.UsedTilesets;
-    strcpy_s(Beschreibung, DateiHeader.Beschreibung);
     bScrollBackground = DateiHeader.ScrollBackground;
 
     // Benutzte Tilesets laden
+    LoadedTilesetPathsWithID.clear();
     for (int i = 0; i < LoadedTilesets; i++) {
         TileGfx[i].LoadImage(DateiHeader.SetNames[i], 256, 256, TileSizeX, TileSizeY, 12, 12);
         std::string str = DateiHeader.SetNames[i];
@@ -257,192 +184,47 @@ bool TileEngineClass::LoadLevel(const std::string &Filename) {
         }
     }
 
+    // Alle Tilesets zusätzlich in einen Atlas, dann muss ein Durchgang nicht mehr bei jedem
+    // Wechsel des Tilesets zeichnen. Klappt das nicht, bleibt es bei den einzelnen Texturen
+    std::vector<int> AtlasTextures;
+    for (int i = 0; i < LoadedTilesets; i++)
+        AtlasTextures.push_back(TileGfx[i].itsTexIdx);
+
+    TileAtlasSlots = DirectGraphics.CreateAtlas(AtlasTextures, static_cast<int>(TILESETSIZE_X)) ? LoadedTilesets : 0;
+
+    // Die Plätze im Atlas sind jetzt andere
+    for (auto &Chunk : TileChunks)
+        Chunk.Dirty = true;
+
     // Benutzte Hintergrundgrafiken laden
 
     Background.LoadImage(DateiHeader.BackgroundFile, 640, 480, 640, 480, 1, 1);
     //ParallaxLayer[0].LoadImage(DateiHeader.ParallaxAFile, 640, 480, 640, 480, 1, 1);
     //ParallaxLayer[1].LoadImage(DateiHeader.ParallaxBFile, 640, 480, 640, 480, 1, 1);
     //CloudLayer.LoadImage(DateiHeader.CloudFile, 640, 240, 640, 240, 1, 1);
-    //Timelimit = static_cast<float>(FixEndian(DateiHeader.Timelimit));
-    DateiHeader.NumObjects = FixEndian(DateiHeader.NumObjects);
-
-    if (Timelimit <= 0.0f)
-        Timelimit = 500.0f;
-
-    MaxSecrets = 0;
-    MaxDiamonds = 0;
-    MaxOneUps = 0;
-    MaxBlocks = 0;
-
-    // LevelDaten laden
-    InitNewLevel(LEVELSIZE_X, LEVELSIZE_Y);
-
-    LevelTileLoadStruct LoadTile;
-
-    for (int i = 0; i < LEVELSIZE_X; i++)
-        for (int j = 0; j < LEVELSIZE_Y; j++) {
-            Datei.read(reinterpret_cast<char *>(&LoadTile), sizeof(LoadTile));
-
-            if (LoadTile.TileSetBack > LoadedTilesets)
-                LoadTile.TileSetBack = LoadedTilesets;
-            if (LoadTile.TileSetFront > LoadedTilesets)
-                LoadTile.TileSetFront = LoadedTilesets;
-
-            LevelTileStruct& tile = TileAt(i, j);
-
-            // Geladenes Leveltile übernehmen
-            //
-            tile.Alpha = LoadTile.Alpha;
-            tile.BackArt = LoadTile.BackArt;
-            tile.Block = FixEndian(LoadTile.Block);
-            tile.Blue = LoadTile.Blue;
-            tile.FrontArt = LoadTile.FrontArt;
-            tile.Green = LoadTile.Green;
-            tile.Red = LoadTile.Red;
-            tile.TileSetBack = LoadTile.TileSetBack;
-            tile.TileSetFront = LoadTile.TileSetFront;
-
-            tile.Color[0] = D3DCOLOR_RGBA(LoadTile.Red, LoadTile.Green, LoadTile.Blue, LoadTile.Alpha);
-            tile.Color[1] = D3DCOLOR_RGBA(LoadTile.Red, LoadTile.Green, LoadTile.Blue, LoadTile.Alpha);
-            tile.Color[2] = D3DCOLOR_RGBA(LoadTile.Red, LoadTile.Green, LoadTile.Blue, LoadTile.Alpha);
-            tile.Color[3] = D3DCOLOR_RGBA(LoadTile.Red, LoadTile.Green, LoadTile.Blue, LoadTile.Alpha);
-
-            // Eine Flüssigkeit als Block?
-            // damit man nicht immer auf alle vier möglichen Flüssigkeiten checken muss,
-            // sondern nur auf BLOCKWERT_LIQUID
-
-            if (tile.Block & BLOCKWERT_WASSER || tile.Block & BLOCKWERT_SUMPF)
-                tile.Block ^= BLOCKWERT_LIQUID;
-        }
 
-    // eventuelle Schrägen ermitteln und Ecken für die Wasseranim festlegen
+    // Gegner laden, wenn sie nicht schon geladen wurden
+    for (const auto &object : Stage.Objects)
+        ObjectGraphics.LoadObjectGraphic(object.ObjectID);
 
-    for (int i = 1; i < LEVELSIZE_X - 1; i++)
-        for (int j = 2; j < LEVELSIZE_Y - 1; j++) {
-      #if 0
-            // Schräge links hoch
-            if (TileAt(i + 0, j + 0).Block & BLOCKWERT_WAND && !(TileAt(i + 1, j + 0).Block & BLOCKWERT_WAND) &&
-                TileAt(i + 1, j + 1).Block & BLOCKWERT_WAND && !(TileAt(i + 0, j - 1).Block & BLOCKWERT_WAND)) {
-                if (!(TileAt(i + 1, j + 0).Block & BLOCKWERT_SCHRAEGE_L))
-                    TileAt(i + 1, j + 0).Block ^= BLOCKWERT_SCHRAEGE_L;
-            }
-
-            // Schräge rechts hoch
-            if (TileAt(i + 0, j + 0).Block & BLOCKWERT_WAND && !(TileAt(i - 1, j + 0).Block & BLOCKWERT_WAND) &&
-                TileAt(i - 1, j + 1).Block & BLOCKWERT_WAND && !(TileAt(i + 0, j - 1).Block & BLOCKWERT_WAND)) {
-                if (!(TileAt(i - 1, j + 0).Block & BLOCKWERT_SCHRAEGE_R))
-                    TileAt(i - 1, j + 0).Block ^= BLOCKWERT_SCHRAEGE_R;
-            }
-      #endif
-
-            // Wasseranim
-            //
-            uint32_t bl = TileAt(i - 1, j + 0).Block;
-            uint32_t br = TileAt(i + 1, j + 0).Block;
-            uint32_t bo = TileAt(i + 0, j - 1).Block;
-            uint32_t bu = TileAt(i + 0, j + 1).Block;
-
-            LevelTileStruct& tile = TileAt(i, j);
-
-            if (!(TileAt(i - 1, j - 1).Block & BLOCKWERT_WAND) && !(TileAt(i, j - 1).Block & BLOCKWERT_WASSERFALL) &&
-                !(TileAt(i - 1, j - 1).Block & BLOCKWERT_WASSERFALL) &&
-                (bl & BLOCKWERT_LIQUID && (!(bo & BLOCKWERT_WAND))))
-                tile.move_v1 = true;
-            else
-                tile.move_v1 = false;
-
-            if (!(TileAt(i - 1, j + 1).Block & BLOCKWERT_WAND) && (bl & BLOCKWERT_LIQUID && bu & BLOCKWERT_LIQUID))
-                tile.move_v3 = true;
-            else
-                tile.move_v3 = false;
-
-            if (!(TileAt(i + 1, j - 1).Block & BLOCKWERT_WAND) && !(TileAt(i, j - 1).Block & BLOCKWERT_WASSERFALL) &&
-                !(TileAt(i + 1, j - 1).Block & BLOCKWERT_WASSERFALL) &&
-                (br & BLOCKWERT_LIQUID && (!(bo & BLOCKWERT_WAND))))
-                tile.move_v2 = true;
-            else
-                tile.move_v2 = false;
-
-            if (!(TileAt(i + 1, j + 1).Block & BLOCKWERT_WAND) && (br & BLOCKWERT_LIQUID && bu & BLOCKWERT_LIQUID))
-                tile.move_v4 = true;
-            else
-                tile.move_v4 = false;
-        }
+    WaterSinTable.ResetPosition();
 
-    // Objekt Daten laden und gleich Liste mit Objekten erstellen
-    for (int i = 0; i < static_cast<int>(DateiHeader.NumObjects); i++) {
-        Datei.read(reinterpret_cast<char *>(&LoadObject), sizeof(LoadObject));  // Objekt laden
-
-        LoadObject.ObjectID = FixEndian(LoadObject.ObjectID);
-        LoadObject.XPos = FixEndian(LoadObject.XPos);
-        LoadObject.YPos = FixEndian(LoadObject.YPos);
-        LoadObject.Value1 = FixEndian(LoadObject.Value1);
-        LoadObject.Value2 = FixEndian(LoadObject.Value2);
-
-        // Gegner und andere Objekte laden und ins Level setzen
-        switch (LoadObject.ObjectID) {
-            // Count Secrets, OneUps etc., for Summary-Box
-            case SECRET:
-                MaxSecrets++;
-                break;
-            case DIAMANT:
-                MaxDiamonds++;
-                break;
-            case ONEUP:
-                MaxOneUps++;
-                break;
-            case POWERBLOCK:
-                MaxBlocks++;
-                break;
+    DrawDragon = true;
 
-            default:
-                break;
-        }
+    // Startposition des Spielers
+    XOffset = 0.0f;
+    YOffset = 0.0f;
 
-        // Startposition des Spielers
-        if (LoadObject.ObjectID == 0) {
-            XOffset = static_cast<float>(LoadObject.XPos) - static_cast<float>(DirectGraphics.RenderWidth) / 2;
-            YOffset = static_cast<float>(LoadObject.YPos) - static_cast<float>(DirectGraphics.RenderHeight) / 2;
-        } 
-
-        // Gegner laden, wenn er nicht schon geladen wurde
-        ObjectList.LoadObjectGraphic(LoadObject.ObjectID);
-        Object object {
-              LoadObject.ObjectID,
-              LoadObject.XPos,
-              LoadObject.YPos,
-              LoadObject.ChangeLight,
-              LoadObject.Skill,
-              LoadObject.Value1,
-              LoadObject.Value2,
-        };
-        ObjectList.PushObject(object);
+    if (Stage.HasPlayerStart) {
+        XOffset = static_cast<float>(Stage.PlayerX) - static_cast<float>(DirectGraphics.RenderWidth) / 2;
+        YOffset = static_cast<float>(Stage.PlayerY) - static_cast<float>(DirectGraphics.RenderHeight) / 2;
     }
 
-    Datei.read(reinterpret_cast<char *>(&DateiAppendix), sizeof(DateiAppendix));
-
-    DateiAppendix.UsedPowerblock = FixEndian(DateiAppendix.UsedPowerblock);
-
     bDrawShadow = DateiAppendix.Taschenlampe;
     ShadowAlpha = 255.0f;
 
-    // Datei schliessen
-    Datei.close();
-
-    // Temp Datei löschen und speicher freigeben
-    fs::remove(fs::path("temp.map"));
-
-    // Liquid Farben setzen
-    ColR1 = std::stoi(std::string(&DateiAppendix.Col1[0], 2), nullptr, 16);
-    ColG1 = std::stoi(std::string(&DateiAppendix.Col1[2], 2), nullptr, 16);
-    ColB1 = std::stoi(std::string(&DateiAppendix.Col1[4], 2), nullptr, 16);
-
-    ColR2 = std::stoi(std::string(&DateiAppendix.Col2[0], 2), nullptr, 16);
-    ColG2 = std::stoi(std::string(&DateiAppendix.Col2[2], 2), nullptr, 16);
-    ColB2 = std::stoi(std::string(&DateiAppendix.Col2[4], 2), nullptr, 16);
-    
-    ColA1 = std::stoi(std::string(&DateiAppendix.Col1[6], 2), nullptr, 16);
-    ColA2 = std::stoi(std::string(&DateiAppendix.Col2[6], 2), nullptr, 16);
+    // Nicht abgeholte Bilder (Textur war schon geladen) wieder freigeben
+    SDL_ClearDecodedTextures();
 
     Col1 = D3DCOLOR_RGBA(ColR1, ColG1, ColB1, ColA1);
     Col2 = D3DCOLOR_RGBA(ColR2, ColG2, ColB2, ColA2);
@@ -462,7 +244,29 @@ bool TileEngineClass::LoadLevel(const std::string &Filename) {
 
     Col3 = D3DCOLOR_RGBA(ColR3, ColG3, ColB3, ColA3);
 
-    ComputeCoolLight();
+    return true;
+}
+
+// --------------------------------------------------------------------------------------
+// Level samt Grafiken laden (synchron, der Editor nimmt sonst den LevelLoader)
+// --------------------------------------------------------------------------------------
+
+bool TileEngineClass::LoadLevel(const std::string &Filename) {
+    // Dann checken, ob sich das File im Standard Ordner befindet
+    if (!fs::exists(Filename) && !fs::is_regular_file(Filename)) {
+        Protokoll << "\n-> Error loading level " << Filename << "!" << std::endl;
+        GameRunning = false;
+        return false;
+    }
+
+    Protokoll << "\n-> Loading Level <-\n" << std::endl;
+
+    LevelLoaderStage Stage;
+    for (int i = 0; i < MAX_GEGNERGFX; i++)
+        Stage.ObjectGraphicLoaded[i] = ObjectGraphics.IsLoaded(i);
+
+    if (!ParseLevel(Filename, Stage, nullptr) || !ApplyLevel(Stage))
+        return false;
 
     // Level korrekt geladen
     Protokoll << "-> Load Level : " << Filename << " successful ! <-\n" << std::endl;
@@ -470,79 +274,72 @@ bool TileEngineClass::LoadLevel(const std::string &Filename) {
     return true;
 }
 
+void TileEngineClass::LoadSprites() {
+    // Wasserfall Textur laden
+    Wasserfall[0].LoadImage("wasserfall.png", 60, 240, 60, 240, 1, 1);
+    Wasserfall[1].LoadImage("wasserfall2.png", 640, 480, 640, 480, 1, 1);
 
-void TileEngineClass::SaveLevel(const std::string &Filename) {
-    // File öffnen
-    std::ofstream Datei(Filename, std::ofstream::binary);
-
-    Datei.write(reinterpret_cast<char *>(&DateiHeader), sizeof(DateiHeader));
+    LiquidGfx[0].LoadImage("water.png", 128, 128, 128, 128, 1, 1);
+    LiquidGfx[1].LoadImage("water2.png", 128, 128, 128, 128, 1, 1);
 
-    LevelTileLoadStruct SaveTile;
-    for(int i = 0; i < LEVELSIZE_X; i++) {
-        for(int j = 0; j < LEVELSIZE_Y; j++) {
-            SaveTile.TileSetBack = Tiles[i][j].TileSetBack;
-            SaveTile.TileSetFront = Tiles[i][j].TileSetFront;
-            SaveTile.BackArt = Tiles[i][j].BackArt;
-            SaveTile.FrontArt = Tiles[i][j].FrontArt;
-            SaveTile.Red = Tiles[i][j].Red;
-            SaveTile.Green = Tiles[i][j].Green;
-            SaveTile.Blue = Tiles[i][j].Blue;
-            SaveTile.Alpha = Tiles[i][j].Alpha;
-            SaveTile.Block = Tiles[i][j].Block & ~BLOCKWERT_LIQUID;
+    // GameOver Schriftzug laden
+    //GameOver.LoadImage("gameover.png", 400, 90, 400, 90, 1, 1);
 
-            Datei.write(reinterpret_cast<char *>(&SaveTile), sizeof(SaveTile));
-        }
-    }
+    // Shatten für das Alien Level laden
+    Shadow.LoadImage("shadow.png", 512, 512, 512, 512, 1, 1);
+}
 
-    LevelObjectStruct SaveObject;
-    for (auto& object: ObjectList.Objects) {
-        if (object.ObjectID == NULLENEMY) {
-            break;
-        }
+void TileEngineClass::Zoom(float times) {
+    float OriginalScale = Scale;
 
-        SaveObject.ObjectID = object.ObjectID;
-        SaveObject.XPos = object.XPos;
-        SaveObject.YPos = object.YPos;
-        SaveObject.ChangeLight = object.ChangeLight;
-        SaveObject.Skill = object.Skill;
-        SaveObject.Value1 = object.Value1;
-        SaveObject.Value2 = object.Value2;
+    Scale *= times;
 
-        SaveObject.PADDING_CHUNK_1[0] = 0xcc;
-        SaveObject.PADDING_CHUNK_1[1] = 0xcc;
+    CalcRenderRange();
 
-        Datei.write(reinterpret_cast<char *>(&SaveObject), sizeof(SaveObject));
+    // Cap the zoom
+    if (times < 1.0f && LEVELPIXELSIZE_X <= DirectGraphics.RenderWidth
+      ||times < 1.0f && LEVELPIXELSIZE_Y <= DirectGraphics.RenderHeight) {
+        Scale = OriginalScale;
+        CalcRenderRange();
+        return;
     }
 
-    DateiAppendix.Taschenlampe = bDrawShadow;
-    DateiAppendix.UsedPowerblock = FixEndian(DateiAppendix.UsedPowerblock);
+    Scale = OriginalScale;
 
+    // Center screen again
+    const float aspect = (Scale * times) / Scale;
+    const float screenaspectx = (DirectGraphics.RenderWidth * aspect) - DirectGraphics.RenderWidth;
+    const float screenaspecty = (DirectGraphics.RenderHeight * aspect) - DirectGraphics.RenderHeight;
+    XOffset = XOffset * aspect + screenaspectx / 2.0f;
+    YOffset = YOffset * aspect + screenaspecty / 2.0f;
 
-    memset(DateiAppendix.Col1, 0, 8);
-    memset(DateiAppendix.Col2, 0, 8);
+    Scale *= times;
+}
+void TileEngineClass::ZoomBy(float times) {
+    float OriginalScale = Scale;
 
-    auto ColToString = [](int col) {
-        std::ostringstream TmpString;
-        TmpString << std::setfill('0') << std::setw(2) << std::hex << col;
-        auto str = TmpString.str();
-        std::transform(str.begin(), str.end(), str.begin(), ::toupper);
-        return str;
-    };
+    Scale += times;
 
-    std::memcpy(&DateiAppendix.Col1[0], ColToString(ColR1).c_str(), 2);
-    std::memcpy(&DateiAppendix.Col1[2], ColToString(ColG1).c_str(), 2);
-    std::memcpy(&DateiAppendix.Col1[4], ColToString(ColB1).c_str(), 2);
+    CalcRenderRange();
 
-    std::memcpy(&DateiAppendix.Col2[0], ColToString(ColR2).c_str(), 2);
-    std::memcpy(&DateiAppendix.Col2[2], ColToString(ColG2).c_str(), 2);
-    std::memcpy(&DateiAppendix.Col2[4], ColToString(ColB2).c_str(), 2);
+    // Cap the zoom
+    if (times < 1.0f && LEVELPIXELSIZE_X <= DirectGraphics.RenderWidth
+      ||times < 1.0f && LEVELPIXELSIZE_Y <= DirectGraphics.RenderHeight) {
+        Scale = OriginalScale;
+        CalcRenderRange();
+        return;
+    }
 
-    std::memcpy(&DateiAppendix.Col1[6], ColToString(ColA1).c_str(), 2);
-    std::memcpy(&DateiAppendix.Col2[6], ColToString(ColA2).c_str(), 2);
+    Scale = OriginalScale;
 
-    Datei.write(reinterpret_cast<char *>(&DateiAppendix), sizeof(DateiAppendix));
+    // Center screen again
+    const float aspect = (Scale + times) / Scale;
+    const float screenaspectx = (DirectGraphics.RenderWidth * aspect) - DirectGraphics.RenderWidth;
+    const float screenaspecty = (DirectGraphics.RenderHeight * aspect) - DirectGraphics.RenderHeight;
+    XOffset = XOffset * aspect + screenaspectx / 2.0f;
+    YOffset = YOffset * aspect + screenaspecty / 2.0f;
 
-    Datei.close();
+    Scale += times;
 }
 
 // --------------------------------------------------------------------------------------
@@ -609,6 +406,142 @@ void TileEngineClass::CalcRenderRange() {
     yTileOffs = fmod(YOffset, TileSizeY);
 
     WaterSinTable.UpdateTableIndexes(xLevel, yLevel);
+
+    // Noch gepackte v2 Chunks im sichtbaren Bereich (plus Rand) auspacken, und zwar für
+    // die ganzen TileChunks, die gleich gebaut werden
+    PrepareTiles((((xLevel + RenderPosX) >> TILECHUNK_SHIFT) << TILECHUNK_SHIFT) - 1,
+                 (((yLevel + RenderPosY) >> TILECHUNK_SHIFT) << TILECHUNK_SHIFT) - 1,
+                 ((((xLevel + RenderPosXTo - 1) >> TILECHUNK_SHIFT) + 1) << TILECHUNK_SHIFT) + 1,
+                 ((((yLevel + RenderPosYTo - 1) >> TILECHUNK_SHIFT) + 1) << TILECHUNK_SHIFT) + 1);
+}
+
+// --------------------------------------------------------------------------------------
+// Lightmap
+//
+// Statt das Licht der Ecken in jeden Vertex zu schreiben, liegen die Farben aller Tiles in
+// einer Textur (ein Texel pro Tile), die der Tile-Shader linear gefiltert ausliest. An den
+// Ecken ist das der Mittelwert der vier Tiles drumherum wie bei ComputeCoolLight(), nur
+// ohne dessen Sonderfall für Wände: an Kanten zwischen Wand und Nicht-Wand mischt die
+// Lightmap die Farben, und die Tiles am Levelrand sind nicht einfarbig. Die Vertices
+// brauchen dann keine Farbe mehr und CornerWindow wird gar nicht erst angelegt.
+//
+// Solange das so ist, sieht das Level damit anders aus als im Spiel. Deshalb bleibt es
+// aus, bis jemand SetLightMap(true) ruft, der Editor selbst tut das nicht.
+//
+// Hochgeladen wird nach dem Laden einmal alles, danach nur noch das Rechteck, in dem
+// sich Farben geändert haben (Editieren, Undo, ausgepackte v2 Chunks).
+// --------------------------------------------------------------------------------------
+
+void TileEngineClass::SetLightMap(bool On) {
+    LightMapWanted = On;
+}
+
+void TileEngineClass::SetInstancing(bool On) {
+    InstancingWanted = On;
+}
+
+void TileEngineClass::PrepareLightMap() {
+    LightMapOn = false;
+    TilesLit = true;
+
+    if (!LightMapWanted || !DirectGraphics.IsLightMapSupported()) {
+        if (LightMapSizeX != 0) {
+            DirectGraphics.DeleteLightMap();
+            LightMapSizeX = LightMapSizeY = 0;
+            LightMapReady = false;
+        }
+        CornerLight = true;
+        return;
+    }
+
+    // Neues Level oder andere Grösse: neu anlegen und alles hochladen. Klappt das nicht,
+    // bleibt es für dieses Level beim Licht der Ecken
+    if (LightMapSizeX != LEVELSIZE_X || LightMapSizeY != LEVELSIZE_Y) {
+        LightMapSizeX = LEVELSIZE_X;
+        LightMapSizeY = LEVELSIZE_Y;
+        LightMapReady = LEVELSIZE_X <= LIGHTMAP_MAX_SIZE && LEVELSIZE_Y <= LIGHTMAP_MAX_SIZE &&
+                        DirectGraphics.CreateLightMap(LEVELSIZE_X, LEVELSIZE_Y);
+
+        ColorsChangedX0 = ColorsChangedY0 = 0;
+        ColorsChangedX1 = LEVELSIZE_X;
+        ColorsChangedY1 = LEVELSIZE_Y;
+    }
+
+    CornerLight = !LightMapReady;
+
+    if (!LightMapReady)
+        return;
+
+    const int x0 = ColorsChangedX0;
+    const int x1 = ColorsChangedX1;
+
+    if (x0 < x1) {
+        const int w = x1 - x0;
+        const int Band = std::max(LIGHTMAP_UPLOAD_TEXELS / w, 1);
+
+        LightMapRows.resize(static_cast<size_t>(w) * std::min(Band, ColorsChangedY1 - ColorsChangedY0));
+
+        for (int y = ColorsChangedY0; y < ColorsChangedY1; y += Band) {
+            const int h = std::min(Band, ColorsChangedY1 - y);
+            TileBaseColorStruct *Out = LightMapRows.data();
+
+            for (int j = y; j < y + h; j++) {
+                TileRowIterator Row = TileRow(x0, j);
+                for (int i = x0; i < x1; i++, ++Row)
+                    *Out++ = Row.Color();
+            }
+
+            // TileBaseColorStruct liegt als R, G, B, A im Speicher, also direkt als RGBA
+            DirectGraphics.UpdateLightMap(x0, y, w, h, LightMapRows.data());
+        }
+
+        ColorsChangedX0 = ColorsChangedY0 = 0;
+        ColorsChangedX1 = ColorsChangedY1 = 0;
+    }
+
+    // Screen-Koordinaten der Tiles -> Lightmap, Tile xLevel + i liegt bei -xTileOffs + i * TileSizeX
+    LightTransform = glm::vec4(1.0f / (TileSizeX * LEVELSIZE_X), 1.0f / (TileSizeY * LEVELSIZE_Y),
+                               (xLevel + xTileOffs / TileSizeX) / LEVELSIZE_X,
+                               (yLevel + yTileOffs / TileSizeY) / LEVELSIZE_Y);
+    LightMapOn = true;
+}
+
+void TileEngineClass::SetTilesLit(int &NumToRender, bool Lit) {
+    if (Lit == TilesLit)
+        return;
+
+    FlushTiles(NumToRender);
+    TilesLit = Lit;
+}
+
+void TileEngineClass::QueueTile(int &NumToRender) {
+    if (LightMapOn) {
+        VERTEXTILE *v = &LitTilesToRender[NumToRender * 4];
+
+        v[0] = VERTEXTILE{v1.x, v1.y, v1.tu, v1.tv};  // Die vier Ecken als
+        v[1] = VERTEXTILE{v2.x, v2.y, v2.tu, v2.tv};  // ein Quad ins Array
+        v[2] = VERTEXTILE{v3.x, v3.y, v3.tu, v3.tv};  // kopieren, die Dreiecke
+        v[3] = VERTEXTILE{v4.x, v4.y, v4.tu, v4.tv};  // macht der Indexbuffer
+    } else {
+        TilesToRender[NumToRender * 4 + 0] = v1;  // Die vier Ecken als
+        TilesToRender[NumToRender * 4 + 1] = v2;  // ein Quad ins Array
+        TilesToRender[NumToRender * 4 + 2] = v3;  // kopieren, die Dreiecke
+        TilesToRender[NumToRender * 4 + 3] = v4;  // macht der Indexbuffer
+    }
+
+    NumToRender++;  // Weiter im Vertex Array
+}
+
+void TileEngineClass::FlushTiles(int &NumToRender) {
+    if (NumToRender == 0)
+        return;
+
+    if (LightMapOn)
+        DirectGraphics.RenderTiles(NumToRender, &LitTilesToRender[0], LightTransform, TilesLit);
+    else
+        DirectGraphics.RenderQuads(NumToRender, &TilesToRender[0]);
+
+    NumToRender = 0;
 }
 
 // --------------------------------------------------------------------------------------
@@ -724,555 +657,623 @@ void TileEngineClass::DrawBackground() {
 }
 
 // --------------------------------------------------------------------------------------
-// Level Hintergrund anzeigen
+// Zwischengespeicherte Leveltiles
 //
-// Das Level wird Tile für Tile durchgegangen das Vertex-Array solange mit
-// Vertices gefüllt, die das selbe Tileset verwenden, bis ein anderes Tileset
-// gesetzt werden muss, worauf alle Vetices im Array mit der alten Textur gerendert
-// werden und alles mit der neuen Textur von vorne wieder losgeht, bis alle Tiles
-// durchgenommen wurden.
-
-// So funzt das auch bei FrontLevel und (vielleicht bald) Overlay
+// Früher wurde jeder Durchgang Tile für Tile durchgegangen und alle sichtbaren Tiles
+// jeden Frame neu in TilesToRender geschrieben. Jetzt liegen die Tiles pro Chunk von
+// TILECHUNK_SIZE x TILECHUNK_SIZE in einem Vertexbuffer, nach Layer, Tileset und Licht
+// sortiert. Die Koordinaten sind in Tiles relativ zur Ecke des Chunks, so bleibt der
+// Buffer beim Scrollen und Zoomen gültig und ein Frame zeichnet pro sichtbarem Chunk
+// nur noch seine Gruppen. Neu gebaut wird ein Chunk, sobald LevelClass Tiles in ihm
+// (oder deren Nachbarn, wegen Licht und Wasseranim) als geändert meldet.
 //
-// Hier werden alle Tiles im Back-Layer gesetzt, die KEINE Wand sind,
-// da die Wände später gesetzt werden, da sie alles verdecken, was in sie reinragt
+// Animierte Tiles, schwabbelnde Tiles im Wasser und Tiles mit Texturbewegung ändern sich
+// jeden Frame. Die merkt sich der Chunk nur und sie gehen wie bisher über QueueTile().
+//
+// Liegen die Tilesets im Atlas (siehe ApplyLevel()), fallen die Gruppen der Tilesets in
+// eine zusammen, dann zeichnet ein Chunk pro Layer höchstens zweimal: mit und ohne Licht.
+//
+// Mit Instanzen (SetInstancing()) steht pro Tile nur ein TILEINSTANCE im Buffer. Licht,
+// Animation und Schwabbeln rechnet dann der Shader, so bleiben auch die animierten Tiles
+// im Chunk und nur die mit Texturbewegung gehen noch über QueueTile().
+//
+// Die Tiles eines Layers überdecken sich nur, wenn eins schwabbelt, dann ragt es in der
+// Zeile ins Tile links oder rechts daneben. Früher kam dabei immer das linke zuerst,
+// deshalb zieht ein Tile, das so an seinem linken Nachbarn hängt, in dessen Durchgang
+// (TILEPASS_*) mit, wenn der später kommt. Am linken Rand des Chunks ist der Durchgang
+// des Nachbarn nicht bekannt, dort geht das Tile im Zweifel über QueueTile().
 // --------------------------------------------------------------------------------------
 
-void TileEngineClass::DrawBackLevel() {
-    // Am Anfang noch keine Textur gewählt
-    int ActualTexture = -1;
+int TileEngineClass::LayerTileSet(int Layer, uint32_t block, const TileArtStruct &art) const {
+    switch (Layer) {
+        // Alle Tiles im Back-Layer, die KEINE Wand sind, da die Wände später gesetzt
+        // werden, da sie alles verdecken, was in sie reinragt
+        case TILELAYER_BACK:
+            if (art.BackArt > 0 && (!(block & BLOCKWERT_WAND) || (art.FrontArt > 0 && block & BLOCKWERT_VERDECKEN)))
+                return art.TileSetBack;
+            break;
 
-    // x und ypos am screen errechnen
-    xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
-    yScreen = static_cast<float>(-yTileOffs + RenderPosY * TileSizeY);
+        case TILELAYER_FRONT:
+            if (art.FrontArt > 0 && !(block & BLOCKWERT_VERDECKEN) && !(block & BLOCKWERT_WAND))
+                return art.TileSetFront;
+            break;
 
-    DirectGraphics.SetColorKeyMode();
+        // Wandstücke, die den Spieler vedecken, erneut zeichnen
+        case TILELAYER_BACKOVERLAY:
+            if (art.BackArt > 0 && block & BLOCKWERT_WAND && !(art.FrontArt > 0 && block & BLOCKWERT_VERDECKEN))
+                return art.TileSetBack;
+            break;
 
-    // Noch keine Tiles zum rendern
-    int NumToRender = 0;
+        // Vordergrund Tiles setzen, um Spieler zu verdecken
+        case TILELAYER_OVERLAY:
+            if (art.FrontArt > 0 &&
+                block & (BLOCKWERT_VERDECKEN | BLOCKWERT_MOVEVERTICAL | BLOCKWERT_MOVELINKS | BLOCKWERT_MOVERECHTS |
+                         BLOCKWERT_WAND))
+                return art.TileSetFront;
+            break;
+    }
 
-    for (int j = RenderPosY; j < RenderPosYTo; j++) {
-        xScreen = static_cast<float>(-xTileOffs) + RenderPosX * TileSizeX;
+    return -1;
+}
 
-        for (int i = RenderPosX; i < RenderPosXTo; i++) {
-            const LevelTileStruct& tile = TileAt(xLevel + i, yLevel + j);
+bool TileEngineClass::LayerTileMoves(int Layer, uint32_t block) const {
+    switch (Layer) {
+        case TILELAYER_BACK:
+            return block & (BLOCKWERT_ANIMIERT_BACK | BLOCKWERT_WASSERANIM);
+        case TILELAYER_FRONT:
+            return block & (BLOCKWERT_ANIMIERT_FRONT | BLOCKWERT_WASSERANIM);
+        case TILELAYER_BACKOVERLAY:
+            return block & BLOCKWERT_ANIMIERT_BACK;
+        default:
+            return block & (BLOCKWERT_ANIMIERT_FRONT | BLOCKWERT_MOVEVERTICAL | BLOCKWERT_MOVELINKS |
+                            BLOCKWERT_MOVERECHTS);
+    }
+}
 
-            if (tile.BackArt > 0 &&  // Überhaupt ein Tile drin ?
-                (!(tile.Block & BLOCKWERT_WAND) ||
-                 (tile.FrontArt > 0 &&
-                  tile.Block & BLOCKWERT_VERDECKEN))) {
-                // Neue Textur ?
-                if (tile.TileSetBack != ActualTexture) {
-                    // Aktuelle Textur sichern
-                    ActualTexture = tile.TileSetBack;
+// Schwabbelt das Tile im Layer an einer der Ecken in Corners? Dann ragt es in der Zeile
+// ins Tile links oder rechts daneben
+bool TileEngineClass::LayerTileSways(int Layer, uint32_t block, uint32_t Corners) const {
+    return (Layer == TILELAYER_BACK || Layer == TILELAYER_FRONT) && block & Corners;
+}
 
-                    // Tiles zeichnen
-                    if (NumToRender > 0)
-                        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+// Tiles mit Texturbewegung laufen über den Rand ihres Tilesets hinaus und brauchen dafür
+// GL_REPEAT, die bleiben bei der eigenen Textur
+bool TileEngineClass::TileFromAtlas(int Layer, uint32_t block, int TileSet) const {
+    if (TileSet >= TileAtlasSlots)
+        return false;
 
-                    // Neue aktuelle Textur setzen
-                    DirectGraphics.SetTexture(TileGfx[ActualTexture].itsTexIdx);
+    return Layer != TILELAYER_OVERLAY ||
+           !(block & (BLOCKWERT_MOVEVERTICAL | BLOCKWERT_MOVELINKS | BLOCKWERT_MOVERECHTS));
+}
 
-                    // Und beim rendern wieder von vorne anfangen
-                    NumToRender = 0;
-                }
+// v1..v4 für das Tile unter Row im Layer setzen, l/o bis r/u ist das Rechteck, in dem es
+// landet. Mit Lightmap bleiben die Farben liegen, zurück kommt dann, ob es Licht bekommt
+bool TileEngineClass::SetTileVertices(int Layer, const TileRowIterator &Row, float l, float o, float r, float u) {
+    const uint32_t block = Row.Block();
+    const TileArtStruct &art = Row.Art();
+    const bool Back = Layer == TILELAYER_BACK || Layer == TILELAYER_BACKOVERLAY;
+
+    unsigned int Type = (Back ? art.BackArt : art.FrontArt) - INCLUDE_ZEROTILE;
+
+    // Animiertes Tile ?
+    if (block & (Back ? BLOCKWERT_ANIMIERT_BACK : BLOCKWERT_ANIMIERT_FRONT))
+        Type += 36 * TileAnimPhase;
+
+    // richtigen Ausschnitt für das aktuelle Tile setzen
+    RECT_struct const Rect = TileRects[Type];
+
+    // Textur-Koordinaten
+    float tl = Rect.left / TILESETSIZE_X;    // Links
+    float tr = Rect.right / TILESETSIZE_X;   // Rechts
+    float to = Rect.top / TILESETSIZE_Y;     // Oben
+    float tu = Rect.bottom / TILESETSIZE_Y;  // Unten
+
+    if (Layer == TILELAYER_OVERLAY) {
+        // bewegtes Tile vertikal
+        if (block & BLOCKWERT_MOVEVERTICAL) {
+            to -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
+            tu -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
+        }
 
-                if (NumToRender >= TilesToRenderMax) {
-                    DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-                    NumToRender = 0;
-                }
+        // bewegtes Tile links
+        if (block & BLOCKWERT_MOVELINKS) {
+            tl += 60.0f / 256.0f * WasserfallOffset / 120.0f;
+            tr += 60.0f / 256.0f * WasserfallOffset / 120.0f;
+        }
 
-                unsigned int Type = tile.BackArt - INCLUDE_ZEROTILE;
+        // bewegtes Tile rechts
+        if (block & BLOCKWERT_MOVERECHTS) {
+            tl -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
+            tr -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
+        }
+    }
 
-                // Animiertes Tile ?
-                if (tile.Block & BLOCKWERT_ANIMIERT_BACK)
-                    Type += 36 * TileAnimPhase;
+    // Im Atlas liegt das Tileset an seinem Platz
+    const int TileSet = Back ? art.TileSetBack : art.TileSetFront;
 
-                // richtigen Ausschnitt für das aktuelle Tile setzen
-                RECT_struct const Rect = TileRects[Type];
+    if (TileFromAtlas(Layer, block, TileSet)) {
+        const glm::vec4 &Slot = DirectGraphics.GetAtlasSlot(TileSet);
+        tl = tl * Slot.x + Slot.z;
+        tr = tr * Slot.x + Slot.z;
+        to = to * Slot.y + Slot.w;
+        tu = tu * Slot.y + Slot.w;
+    }
 
-                // Screen-Koordinaten der Vertices
-                float const l = xScreen;               // Links
-                float const o = yScreen;               // Oben
-                float const r = xScreen + TileSizeX;  // Rechts
-                float const u = yScreen + TileSizeY;  // Unten
-
-                // Textur-Koordinaten
-                float const tl = Rect.left / TILESETSIZE_X;    // Links
-                float const tr = Rect.right / TILESETSIZE_X;   // Rechts
-                float const to = Rect.top / TILESETSIZE_Y;     // Oben
-                float const tu = Rect.bottom / TILESETSIZE_Y;  // Unten
-
-                // Vertices definieren
-                v1.color = tile.Color[0];
-                v2.color = tile.Color[1];
-                v3.color = tile.Color[2];
-                v4.color = tile.Color[3];
-
-                v1.x = l;  // Links oben
-                v1.y = o;
-                v1.tu = tl;
-                v1.tv = to;
-
-                v2.x = r;  // Rechts oben
-                v2.y = o;
-                v2.tu = tr;
-                v2.tv = to;
-
-                v3.x = l;  // Links unten
-                v3.y = u;
-                v3.tu = tl;
-                v3.tv = tu;
-
-                v4.x = r;  // Rechts unten
-                v4.y = u;
-                v4.tu = tr;
-                v4.tv = tu;
+    // Licht setzen (Vordergrund prüfen auf Overlay light, wegen hellen Kanten)
+    const bool Lit = Back || block & BLOCKWERT_OVERLAY_LIGHT;
+
+    if (LightMapOn) {
+        // das Licht kommt erst im Shader
+    } else if (Lit) {
+        const TileCornerStruct &corner = Row.Corner();
+        v1.color = corner.Color[0];
+        v2.color = corner.Color[1];
+        v3.color = corner.Color[2];
+        v4.color = corner.Color[3];
+    } else {
+        v1.color = v2.color = v3.color = v4.color = D3DCOLOR_RGBA(255, 255, 255, Row.Color().Alpha);
+    }
 
-                // Hintergrund des Wasser schwabbeln lassen
+    v1.x = l;  // Links oben
+    v1.y = o;
+    v1.tu = tl;
+    v1.tv = to;
 
-                if (tile.move_v1 || tile.move_v2 ||
-                    tile.move_v3 || tile.move_v4) {
-                    float x_offs[2];
-                    WaterSinTable.GetNonWaterSin(j, x_offs);
+    v2.x = r;  // Rechts oben
+    v2.y = o;
+    v2.tu = tr;
+    v2.tv = to;
 
-                    if (yLevel + j > 0 &&  // DKS Added this check to above line
-                        TileAt(xLevel + i, yLevel + j - 1).Block & BLOCKWERT_LIQUID) {
-                        if (tile.move_v1 == true)
-                            v1.x += x_offs[0];
-                        if (tile.move_v2 == true)
-                            v2.x += x_offs[0];
-                    }
+    v3.x = l;  // Links unten
+    v3.y = u;
+    v3.tu = tl;
+    v3.tv = tu;
 
-                    if (tile.move_v3 == true)
-                        v3.x += x_offs[1];
-                    if (tile.move_v4 == true)
-                        v4.x += x_offs[1];
-                }
+    v4.x = r;  // Rechts unten
+    v4.y = u;
+    v4.tu = tr;
+    v4.tv = tu;
 
-                // Zu rendernde Vertices ins Array schreiben
-                TilesToRender[NumToRender * 6 + 0] = v1;  // Jeweils 2 Dreicke als
-                TilesToRender[NumToRender * 6 + 1] = v2;  // als ein viereckiges
-                TilesToRender[NumToRender * 6 + 2] = v3;  // Tile ins Array kopieren
-                TilesToRender[NumToRender * 6 + 3] = v3;
-                TilesToRender[NumToRender * 6 + 4] = v2;
-                TilesToRender[NumToRender * 6 + 5] = v4;
-
-                NumToRender++;  // Weiter im Vertex Array
-            }
-            xScreen += TileSizeX;  // Am Screen weiter
+    return Lit;
+}
+
+// Instanz für das Tile unter Row im Layer, i/j im Level
+TILEINSTANCE TileEngineClass::TileInstance(int Layer, const TileRowIterator &Row, int i, int j) const {
+    const uint32_t block = Row.Block();
+    const TileArtStruct &art = Row.Art();
+    const bool Back = Layer == TILELAYER_BACK || Layer == TILELAYER_BACKOVERLAY;
+
+    TILEINSTANCE Instance{};
+    Instance.x = static_cast<uint8_t>(i & (TILECHUNK_SIZE - 1));
+    Instance.y = static_cast<uint8_t>(j & (TILECHUNK_SIZE - 1));
+    Instance.Slot = static_cast<uint8_t>(Back ? art.TileSetBack : art.TileSetFront);
+    Instance.Rect = static_cast<uint8_t>((Back ? art.BackArt : art.FrontArt) - INCLUDE_ZEROTILE);
+
+    // wie in SetTileVertices()
+    if (Back || block & BLOCKWERT_OVERLAY_LIGHT)
+        Instance.Flags |= TILEINSTANCE_LIT;
+
+    if (block & (Back ? BLOCKWERT_ANIMIERT_BACK : BLOCKWERT_ANIMIERT_FRONT))
+        Instance.Flags |= TILEINSTANCE_ANIM;
+
+    // wie in DrawTileLayer(), oben nur unter Flüssigkeit. Ändert sich das Tile darüber,
+    // wird der Chunk neu gebaut, weil das geänderte Rechteck einen Rand von einem Tile hat
+    if ((Layer == TILELAYER_BACK || Layer == TILELAYER_FRONT) && block & BLOCKWERT_WASSERANIM) {
+        if (j > 0 && BlockAt(i, j - 1) & BLOCKWERT_LIQUID) {
+            if (block & BLOCKWERT_MOVE_V1)
+                Instance.Flags |= TILEINSTANCE_SWAY_V1;
+            if (block & BLOCKWERT_MOVE_V2)
+                Instance.Flags |= TILEINSTANCE_SWAY_V2;
         }
-        yScreen += TileSizeY;  // Am Screen weiter
+
+        if (block & BLOCKWERT_MOVE_V3)
+            Instance.Flags |= TILEINSTANCE_SWAY_V3;
+        if (block & BLOCKWERT_MOVE_V4)
+            Instance.Flags |= TILEINSTANCE_SWAY_V4;
     }
 
-    if (NumToRender > 0)
-        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+    return Instance;
 }
 
-// --------------------------------------------------------------------------------------
-// Level Vodergrund anzeigen
-// --------------------------------------------------------------------------------------
-
-void TileEngineClass::DrawFrontLevel() {
-    // Am Anfang noch keine Textur gewählt
-    int ActualTexture = -1;
+void TileEngineClass::PrepareTileChunks() {
+    const int ChunksX = (LEVELSIZE_X + TILECHUNK_SIZE - 1) >> TILECHUNK_SHIFT;
+    const int ChunksY = (LEVELSIZE_Y + TILECHUNK_SIZE - 1) >> TILECHUNK_SHIFT;
 
-    // x und ypos am screen errechnen
-    xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
-    yScreen = static_cast<float>(-yTileOffs + RenderPosY * TileSizeY);
+    // Andere Levelgrösse: alle Chunks neu
+    if (ChunksX != TileChunksX || ChunksY != TileChunksY) {
+        for (auto &Chunk : TileChunks)
+            DirectGraphics.DeleteStaticBuffer(Chunk.Buffer);
 
-    DirectGraphics.SetColorKeyMode();
+        TileChunks.clear();
+        TileChunks.resize(static_cast<size_t>(ChunksX) * ChunksY);
+        TileChunksX = ChunksX;
+        TileChunksY = ChunksY;
+        TileChunksResident = 0;
+    }
 
-    // Noch keine Tiles zum rendern
-    int NumToRender = 0;
+    // Mit und ohne Lightmap sehen die Vertices anders aus
+    if (TileChunksLightMap != LightMapOn) {
+        for (auto &Chunk : TileChunks)
+            Chunk.Dirty = true;
 
-    for (int j = RenderPosY; j < RenderPosYTo; j++) {
-        xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
+        TileChunksLightMap = LightMapOn;
+    }
 
-        for (int i = RenderPosX; i < RenderPosXTo; i++) {
-            const LevelTileStruct& tile = TileAt(xLevel + i, yLevel + j);
+    // Ebenso mit und ohne Atlas
+    if (TileChunksAtlas != (TileAtlasSlots > 0)) {
+        for (auto &Chunk : TileChunks)
+            Chunk.Dirty = true;
 
-            if (tile.FrontArt > 0 &&
-                !(tile.Block & BLOCKWERT_VERDECKEN) &&
-                !(tile.Block & BLOCKWERT_WAND)) {
-                // Neue Textur ?
-                if (tile.TileSetFront != ActualTexture) {
-                    // Aktuelle Textur sichern
-                    ActualTexture = tile.TileSetFront;
+        TileChunksAtlas = TileAtlasSlots > 0;
+    }
 
-                    // Tiles zeichnen
-                    if (NumToRender > 0)
-                        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+    // Instanzen holen sich Licht und Tilesets im Shader, also nur mit Lightmap und Atlas
+    const bool Instanced = InstancingWanted && LightMapOn && TileAtlasSlots > 0 &&
+                           TileAtlasSlots <= INSTANCE_ATLAS_SLOTS && DirectGraphics.IsInstancingSupported();
 
-                    // Neue aktuelle Textur setzen
-                    DirectGraphics.SetTexture(TileGfx[ActualTexture].itsTexIdx);
+    if (TileChunksInstanced != Instanced) {
+        for (auto &Chunk : TileChunks)
+            Chunk.Dirty = true;
 
-                    // Und beim rendern wieder von vorne anfangen
-                    NumToRender = 0;
-                }
+        TileChunksInstanced = Instanced;
+    }
 
-                if (NumToRender >= TilesToRenderMax) {
-                    DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-                    NumToRender = 0;
-                }
+    // Geänderte Tiles seit dem letzten Durchgang
+    if (TilesChangedX0 < TilesChangedX1) {
+        for (int cy = TilesChangedY0 >> TILECHUNK_SHIFT; cy <= (TilesChangedY1 - 1) >> TILECHUNK_SHIFT; cy++)
+            for (int cx = TilesChangedX0 >> TILECHUNK_SHIFT; cx <= (TilesChangedX1 - 1) >> TILECHUNK_SHIFT; cx++)
+                TileChunks[static_cast<size_t>(cy) * TileChunksX + cx].Dirty = true;
 
-                unsigned int Type = tile.FrontArt - INCLUDE_ZEROTILE;
+        TilesChangedX0 = TilesChangedY0 = 0;
+        TilesChangedX1 = TilesChangedY1 = 0;
+    }
 
-                // Animiertes Tile ?
-                if (tile.Block & BLOCKWERT_ANIMIERT_FRONT)
-                    Type += 36 * TileAnimPhase;
+    TileChunkPass++;
 
-                // richtigen Ausschnitt für das aktuelle Tile setzen
-                RECT_struct const Rect = TileRects[Type];
+    // Sichtbare Chunks bauen, soweit nötig
+    const int cx0 = (xLevel + RenderPosX) >> TILECHUNK_SHIFT;
+    const int cy0 = (yLevel + RenderPosY) >> TILECHUNK_SHIFT;
+    const int cx1 = std::min((xLevel + RenderPosXTo - 1) >> TILECHUNK_SHIFT, TileChunksX - 1);
+    const int cy1 = std::min((yLevel + RenderPosYTo - 1) >> TILECHUNK_SHIFT, TileChunksY - 1);
 
-                // Screen-Koordinaten der Vertices
-                float const l = xScreen;               // Links
-                float const o = yScreen;               // Oben
-                float const r = xScreen + TileSizeX;  // Rechts
-                float const u = yScreen + TileSizeY;  // Unten
-
-                // Textur-Koordinaten
-                float const tl = Rect.left / TILESETSIZE_X;    // Links
-                float const tr = Rect.right / TILESETSIZE_X;   // Rechts
-                float const to = Rect.top / TILESETSIZE_Y;     // Oben
-                float const tu = Rect.bottom / TILESETSIZE_Y;  // Unten
-
-                // Licht setzen (prüfen auf Overlay light, wegen hellen Kanten)
-                if (tile.Block & BLOCKWERT_OVERLAY_LIGHT) {
-                    v1.color = tile.Color[0];
-                    v2.color = tile.Color[1];
-                    v3.color = tile.Color[2];
-                    v4.color = tile.Color[3];
-                } else {
-                    v1.color = v2.color = v3.color = v4.color =
-                        D3DCOLOR_RGBA(255, 255, 255, tile.Alpha);
-                }
+    for (int cy = cy0; cy <= cy1; cy++)
+        for (int cx = cx0; cx <= cx1; cx++) {
+            TileChunkStruct &Chunk = TileChunks[static_cast<size_t>(cy) * TileChunksX + cx];
 
-                v1.x = l;  // Links oben
-                v1.y = o;
-                v1.tu = tl;
-                v1.tv = to;
+            if (Chunk.Dirty)
+                BuildTileChunk(cx, cy);
 
-                v2.x = r;  // Rechts oben
-                v2.y = o;
-                v2.tu = tr;
-                v2.tv = to;
+            Chunk.LastUsed = TileChunkPass;
+        }
 
-                v3.x = l;  // Links unten
-                v3.y = u;
-                v3.tu = tl;
-                v3.tv = tu;
+    // Zu viele Buffer: alles freigeben, was gerade nicht zu sehen ist
+    if (TileChunksResident > TILECHUNK_RESIDENT_MAX) {
+        for (auto &Chunk : TileChunks) {
+            if (Chunk.Buffer == 0 || Chunk.LastUsed == TileChunkPass)
+                continue;
 
-                v4.x = r;  // Rechts unten
-                v4.y = u;
-                v4.tu = tr;
-                v4.tv = tu;
+            DirectGraphics.DeleteStaticBuffer(Chunk.Buffer);
+            Chunk.Dirty = true;
+            TileChunksResident--;
+        }
+    }
+}
 
-                // Hintergrund des Wasser schwabbeln lassen
-                if (tile.move_v1 || tile.move_v2 ||
-                    tile.move_v3 || tile.move_v4) {
-                    float x_offs[2];
-                    WaterSinTable.GetNonWaterSin(j, x_offs);
+void TileEngineClass::BuildTileChunk(int cx, int cy) {
+    TileChunkStruct &Chunk = TileChunks[static_cast<size_t>(cy) * TileChunksX + cx];
 
-                    if (yLevel + j > 0 &&  // DKS Added this check to above line
-                        TileAt(xLevel + i, yLevel + j - 1).Block & BLOCKWERT_LIQUID) {
-                        if (tile.move_v1 == true)
-                            v1.x += x_offs[0];
-                        if (tile.move_v2 == true)
-                            v2.x += x_offs[0];
-                    }
+    const int x0 = cx * TILECHUNK_SIZE;
+    const int y0 = cy * TILECHUNK_SIZE;
+    const int x1 = std::min(x0 + TILECHUNK_SIZE, LEVELSIZE_X);
+    const int y1 = std::min(y0 + TILECHUNK_SIZE, LEVELSIZE_Y);
 
-                    if (tile.move_v3 == true)
-                        v3.x += x_offs[1];
-                    if (tile.move_v4 == true)
-                        v4.x += x_offs[1];
-                }
+    for (auto &Moving : Chunk.Moving)
+        Moving.clear();
 
-                // Zu rendernde Vertices ins Array schreiben
-                TilesToRender[NumToRender * 6 + 0] = v1;  // Jeweils 2 Dreicke als
-                TilesToRender[NumToRender * 6 + 1] = v2;  // als ein viereckiges
-                TilesToRender[NumToRender * 6 + 2] = v3;  // Tile ins Array kopieren
-                TilesToRender[NumToRender * 6 + 3] = v3;
-                TilesToRender[NumToRender * 6 + 4] = v2;
-                TilesToRender[NumToRender * 6 + 5] = v4;
-
-                NumToRender++;  // Weiter im Vertex Array
-            }
-            xScreen += TileSizeX;  // Am Screen weiter
-        }
-        yScreen += TileSizeY;  // Am Screen weiter
-    }
+    // Jedes Tile in alle Layer einsortieren, in denen es vorkommt
+    for (int j = y0; j < y1; j++) {
+        // Durchgang des Tiles links daneben pro Layer, -1: nicht im Layer. Was im Chunk
+        // links davon liegt, zählt, als käme es zum Schluss
+        uint32_t LeftBlock = 0;
+        int LeftPass[TILELAYER_TOTAL];
 
-    if (NumToRender > 0)
-        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-}
+        for (int Layer = 0; Layer < TILELAYER_TOTAL; Layer++)
+            LeftPass[Layer] = -1;
 
-// --------------------------------------------------------------------------------------
-// Wandstücke, die den Spieler vedecken, erneut zeichnen
-// --------------------------------------------------------------------------------------
+        if (x0 > 0) {
+            const TileRowIterator Left = TileRow(x0 - 1, j);
+            LeftBlock = Left.Block();
 
-void TileEngineClass::DrawBackLevelOverlay() {
+            for (int Layer = 0; Layer < TILELAYER_TOTAL; Layer++)
+                if (LayerTileSet(Layer, LeftBlock, Left.Art()) >= 0)
+                    LeftPass[Layer] = TILEPASS_QUEUE;
+        }
 
-    // Am Anfang noch keine Textur gewählt
-    int ActualTexture = -1;
+        TileRowIterator Row = TileRow(x0, j);
 
-    // x und ypos am screen errechnen
-    xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
-    yScreen = static_cast<float>(-yTileOffs + RenderPosY * TileSizeY);
+        for (int i = x0; i < x1; i++, ++Row) {
+            const uint32_t block = Row.Block();
+            const TileArtStruct &art = Row.Art();
 
-    DirectGraphics.SetColorKeyMode();
+            for (int Layer = 0; Layer < TILELAYER_TOTAL; Layer++) {
+                const int TileSet = LayerTileSet(Layer, block, art);
 
-    // Noch keine Tiles zum rendern
-    int NumToRender = 0;
+                if (TileSet < 0) {
+                    LeftPass[Layer] = -1;
+                    continue;
+                }
 
-    for (int j = RenderPosY; j < RenderPosYTo; j++) {
-        xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
+                // Mit Instanzen bleibt nur draussen, was nicht aus dem Atlas kommt
+                int Pass = LayerTileMoves(Layer, block) ? TILEPASS_MOVING : TILEPASS_STATIC;
 
-        for (int i = RenderPosX; i < RenderPosXTo; i++) {
-            const LevelTileStruct& tile = TileAt(xLevel + i, yLevel + j);
+                if (!TileChunksInstanced && Pass == TILEPASS_MOVING)
+                    Pass = TILEPASS_QUEUE;
+                else if (TileChunksInstanced && !TileFromAtlas(Layer, block, TileSet))
+                    Pass = TILEPASS_QUEUE;
 
-            // Hintergrundtile nochmal neu setzen?
-            //
-            if (tile.BackArt > 0 && tile.Block & BLOCKWERT_WAND &&
-                (!(tile.FrontArt > 0 &&
-                   tile.Block & BLOCKWERT_VERDECKEN))) {
-                // Neue Textur ?
-                if (tile.TileSetBack != ActualTexture) {
-                    // Aktuelle Textur sichern
-                    ActualTexture = tile.TileSetBack;
+                // Schwabbelt eins der beiden ins andere hinein, kommt dieses wie früher
+                // nach dem links daneben
+                if (LeftPass[Layer] >= 0 && (LayerTileSways(Layer, LeftBlock, BLOCKWERT_MOVE_V2 | BLOCKWERT_MOVE_V4) ||
+                                             LayerTileSways(Layer, block, BLOCKWERT_MOVE_V1 | BLOCKWERT_MOVE_V3)))
+                    Pass = std::max(Pass, LeftPass[Layer]);
 
-                    // Tiles zeichnen
-                    if (NumToRender > 0)
-                        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+                LeftPass[Layer] = Pass;
 
-                    // Neue aktuelle Textur setzen
-                    DirectGraphics.SetTexture(TileGfx[ActualTexture].itsTexIdx);
-
-                    // Und beim rendern wieder von vorne anfangen
-                    NumToRender = 0;
+                if (Pass == TILEPASS_QUEUE) {
+                    Chunk.Moving[Layer].push_back(static_cast<uint16_t>((j - y0) * TILECHUNK_SIZE + i - x0));
+                    continue;
                 }
 
-                if (NumToRender >= TilesToRenderMax) {
-                    DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-                    NumToRender = 0;
+                if (TileChunksInstanced) {
+                    TileChunkInstances[Layer * 2 + (Pass == TILEPASS_MOVING)].push_back(TileInstance(Layer, Row, i, j));
+                    continue;
                 }
 
-                unsigned int Type = tile.BackArt - INCLUDE_ZEROTILE;
-
-                // Animiertes Tile ?
-                if (tile.Block & BLOCKWERT_ANIMIERT_BACK)
-                    Type += 36 * TileAnimPhase;
+                const float l = static_cast<float>(i - x0);
+                const float o = static_cast<float>(j - y0);
 
-                // richtigen Ausschnitt für das aktuelle Tile setzen
-                RECT_struct const Rect = TileRects[Type];
+                // Ohne Lightmap steckt das Licht schon in den Farben
+                const bool Lit = SetTileVertices(Layer, Row, l, o, l + 1.0f, o + 1.0f) || !LightMapOn;
 
-                // Screen-Koordinaten der Vertices
-                float const l = xScreen;               // Links
-                float const o = yScreen;               // Oben
-                float const r = xScreen + TileSizeX;  // Rechts
-                float const u = yScreen + TileSizeY;  // Unten
-
-                // Textur-Koordinaten
-                float const tl = Rect.left / TILESETSIZE_X;    // Links
-                float const tr = Rect.right / TILESETSIZE_X;   // Rechts
-                float const to = Rect.top / TILESETSIZE_Y;     // Oben
-                float const tu = Rect.bottom / TILESETSIZE_Y;  // Unten
-
-                v1.color = tile.Color[0];
-                v2.color = tile.Color[1];
-                v3.color = tile.Color[2];
-                v4.color = tile.Color[3];
-
-                v1.x = l;  // Links oben
-                v1.y = o;
-                v1.tu = tl;
-                v1.tv = to;
-
-                v2.x = r;  // Rechts oben
-                v2.y = o;
-                v2.tu = tr;
-                v2.tv = to;
-
-                v3.x = l;  // Links unten
-                v3.y = u;
-                v3.tu = tl;
-                v3.tv = tu;
-
-                v4.x = r;  // Rechts unten
-                v4.y = u;
-                v4.tu = tr;
-                v4.tv = tu;
+                // Aus dem Atlas landen alle Tilesets in einer Gruppe
+                const int Texture = TileFromAtlas(Layer, block, TileSet) ? TILESET_ATLAS : TileSet;
 
-                // Zu rendernde Vertices ins Array schreiben
-                TilesToRender[NumToRender * 6 + 0] = v1;  // Jeweils 2 Dreicke als
-                TilesToRender[NumToRender * 6 + 1] = v2;  // als ein viereckiges
-                TilesToRender[NumToRender * 6 + 2] = v3;  // Tile ins Array kopieren
-                TilesToRender[NumToRender * 6 + 3] = v3;
-                TilesToRender[NumToRender * 6 + 4] = v2;
-                TilesToRender[NumToRender * 6 + 5] = v4;
-
-                NumToRender++;  // Weiter im Vertex Array
+                std::vector<VERTEX2D> &Out = TileChunkVertices[(Layer * (MAX_TILESETS + 1) + Texture) * 2 + Lit];
+                Out.push_back(v1);  // Die vier Ecken als
+                Out.push_back(v2);  // ein Quad ins Array
+                Out.push_back(v3);  // kopieren
+                Out.push_back(v4);
             }
-            xScreen += TileSizeX;  // Am Screen weiter
+
+            LeftBlock = block;
         }
-        yScreen += TileSizeY;  // Am Screen weiter
     }
 
-    if (NumToRender > 0)
-        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-}
+    // Gruppen am Stück in den Buffer. Ein Tile liegt in höchstens drei Layern, das bleibt
+    // weit unter den QUADS_MAX, die DirectGraphics.RenderStatic() zeichnen kann
+    Chunk.Groups.clear();
+    TileChunkUpload.clear();
+    TileChunkInstanceUpload.clear();
 
-// --------------------------------------------------------------------------------------
-// Die Levelstücke zeigen, die den Spieler verdecken
-// --------------------------------------------------------------------------------------
+    for (int Group = 0; Group < TILELAYER_TOTAL * 2; Group++) {
+        std::vector<TILEINSTANCE> &Instances = TileChunkInstances[Group];
 
-void TileEngineClass::DrawOverlayLevel() {
+        if (Instances.empty())
+            continue;
 
-    // Am Anfang noch keine Textur gewählt
-    int ActualTexture = -1;
+        Chunk.Groups.push_back(TileChunkGroup{static_cast<uint8_t>(Group / 2), TILESET_ATLAS, true, (Group & 1) != 0,
+                                              static_cast<int>(TileChunkInstanceUpload.size()),
+                                              static_cast<int>(Instances.size())});
+        TileChunkInstanceUpload.insert(TileChunkInstanceUpload.end(), Instances.begin(), Instances.end());
+        Instances.clear();
+    }
 
-    // x und ypos am screen errechnen
-    xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
-    yScreen = static_cast<float>(-yTileOffs + RenderPosY * TileSizeY);
+    for (int Group = 0; Group < TILELAYER_TOTAL * (MAX_TILESETS + 1) * 2; Group++) {
+        std::vector<VERTEX2D> &Vertices = TileChunkVertices[Group];
 
-    DirectGraphics.SetColorKeyMode();
+        if (Vertices.empty())
+            continue;
 
-    // Noch keine Tiles zum rendern
-    int NumToRender = 0;
+        Chunk.Groups.push_back(TileChunkGroup{static_cast<uint8_t>(Group / ((MAX_TILESETS + 1) * 2)),
+                                              static_cast<uint8_t>(Group / 2 % (MAX_TILESETS + 1)), (Group & 1) != 0,
+                                              false, static_cast<int>(TileChunkUpload.size()),
+                                              static_cast<int>(Vertices.size())});
+        TileChunkUpload.insert(TileChunkUpload.end(), Vertices.begin(), Vertices.end());
+        Vertices.clear();
+    }
 
-    for (int j = RenderPosY; j < RenderPosYTo; j++) {
-        xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
+    if (TileChunkUpload.empty() && TileChunkInstanceUpload.empty()) {
+        if (Chunk.Buffer != 0)
+            TileChunksResident--;
+        DirectGraphics.DeleteStaticBuffer(Chunk.Buffer);
+    } else {
+        if (Chunk.Buffer == 0)
+            TileChunksResident++;
+        if (TileChunksInstanced)
+            DirectGraphics.UploadStaticBuffer(Chunk.Buffer, TileChunkInstanceUpload.data(),
+                                              static_cast<int>(TileChunkInstanceUpload.size()));
+        else
+            DirectGraphics.UploadStaticBuffer(Chunk.Buffer, TileChunkUpload.data(),
+                                              static_cast<int>(TileChunkUpload.size()));
+    }
 
-        for (int i = RenderPosX; i < RenderPosXTo; i++) {
-            const LevelTileStruct& tile = TileAt(xLevel + i, yLevel + j);
-
-            // Vordergrund Tiles setzen, um Spieler zu verdecken
-            if ((tile.FrontArt > 0 &&
-                 (tile.Block & BLOCKWERT_VERDECKEN ||
-                  tile.Block & BLOCKWERT_WAND)) ||
-                tile.Block & BLOCKWERT_WASSERFALL ||
-                tile.Block & BLOCKWERT_MOVELINKS ||
-                tile.Block & BLOCKWERT_MOVERECHTS ||
-                tile.Block & BLOCKWERT_MOVEVERTICAL) {
-                // Screen-Koordinaten der Vertices
-                float const l = xScreen;               // Links
-                float const o = yScreen;               // Oben
-                float const r = xScreen + TileSizeX;  // Rechts
-                float const u = yScreen + TileSizeY;  // Unten
-                
-                if ((tile.FrontArt > 0 &&
-                     (tile.Block & BLOCKWERT_VERDECKEN ||
-                      tile.Block & BLOCKWERT_MOVEVERTICAL ||
-                      tile.Block & BLOCKWERT_MOVELINKS ||
-                      tile.Block & BLOCKWERT_MOVERECHTS ||
-                      tile.Block & BLOCKWERT_WAND))) {
-                    // Neue Textur ?
-                    if (tile.TileSetFront != ActualTexture) {
-                        // Aktuelle Textur sichern
-                        ActualTexture = tile.TileSetFront;
-
-                        // Tiles zeichnen
-                        if (NumToRender > 0)
-                            DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-
-                        // Neue aktuelle Textur setzen
-                        DirectGraphics.SetTexture(TileGfx[ActualTexture].itsTexIdx);
+    Chunk.Dirty = false;
+}
 
-                        // Und beim rendern wieder von vorne anfangen
-                        NumToRender = 0;
+void TileEngineClass::DrawTileLayer(int Layer) {
+    DirectGraphics.SetColorKeyMode();
+    PrepareLightMap();
+    PrepareTileChunks();
+
+    // Sichtbarer Bereich in Tiles
+    const int x0 = xLevel + RenderPosX;
+    const int y0 = yLevel + RenderPosY;
+    const int x1 = xLevel + RenderPosXTo;
+    const int y1 = yLevel + RenderPosYTo;
+
+    const int cx0 = x0 >> TILECHUNK_SHIFT;
+    const int cy0 = y0 >> TILECHUNK_SHIFT;
+    const int cx1 = std::min((x1 - 1) >> TILECHUNK_SHIFT, TileChunksX - 1);
+    const int cy1 = std::min((y1 - 1) >> TILECHUNK_SHIFT, TileChunksY - 1);
+
+    // Erst alles, was fertig im Chunk liegt (TILEPASS_STATIC). Mit Instanzen folgen in einem
+    // zweiten Durchgang die Tiles, die sich bewegen (TILEPASS_MOVING), in derselben
+    // Reihenfolge wie sonst über QueueTile()
+    const int Passes = TileChunksInstanced ? 2 : 1;
+
+    for (int Pass = 0; Pass < Passes; Pass++)
+        for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++) {
+                const TileChunkStruct &Chunk = TileChunks[static_cast<size_t>(cy) * TileChunksX + cx];
+
+                // Tile xLevel + i liegt am Screen bei -xTileOffs + i * TileSizeX
+                const glm::mat4x4 matChunk = glm::scale(
+                    glm::translate(glm::mat4x4(1.0f),
+                                   glm::vec3(-xTileOffs + static_cast<float>(cx * TILECHUNK_SIZE - xLevel) * TileSizeX,
+                                             -yTileOffs + static_cast<float>(cy * TILECHUNK_SIZE - yLevel) * TileSizeY,
+                                             0.0f)),
+                    glm::vec3(TileSizeX, TileSizeY, 1.0f));
+
+                // Tile-Koordinaten im Chunk -> Lightmap
+                const glm::vec4 ChunkLight(1.0f / LEVELSIZE_X, 1.0f / LEVELSIZE_Y,
+                                           static_cast<float>(cx * TILECHUNK_SIZE) / LEVELSIZE_X,
+                                           static_cast<float>(cy * TILECHUNK_SIZE) / LEVELSIZE_Y);
+
+                for (const TileChunkGroup &Group : Chunk.Groups) {
+                    if (Group.Layer != Layer || Group.Moves != (Pass == 1))
+                        continue;
+
+                    if (TileChunksInstanced) {
+                        // Animationsphase, Schwabbeln ab der ersten Zeile des Chunks
+                        const glm::vec4 ChunkAnim(
+                            static_cast<float>(TileAnimPhase),
+                            static_cast<float>(WaterSinTable.GetNonWaterSinIndex(cy * TILECHUNK_SIZE - yLevel)),
+                            WaterSinTable.GetNonWaterSway() / TileSizeX, 0.0f);
+
+                        DirectGraphics.RenderTileInstances(Chunk.Buffer, Group.First, Group.Count, matChunk,
+                                                           ChunkLight, ChunkAnim);
+                        continue;
                     }
 
-                    if (NumToRender >= TilesToRenderMax) {
-                        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
-                        NumToRender = 0;
-                    }
+                    if (Group.TileSet == TILESET_ATLAS)
+                        DirectGraphics.SetAtlasTexture();
+                    else
+                        DirectGraphics.SetTexture(TileGfx[Group.TileSet].itsTexIdx);
 
-                    // "normales" Overlay Tile setzen
-                    unsigned int Type = tile.FrontArt - INCLUDE_ZEROTILE;
+                    if (LightMapOn)
+                        DirectGraphics.RenderStaticTiles(Chunk.Buffer, Group.First, Group.Count, matChunk,
+                                                         ChunkLight, Group.Lit);
+                    else
+                        DirectGraphics.RenderStatic(Chunk.Buffer, Group.First, Group.Count, matChunk);
+                }
+            }
 
-                    // Animiertes Tile ?
-                    if (tile.Block & BLOCKWERT_ANIMIERT_FRONT)
-                        Type += 36 * TileAnimPhase;
+    // Dann was sich bewegt, für jeden Frame neu (TILEPASS_QUEUE). Am Anfang noch keine
+    // Textur gewählt
+    int ActualTexture = -1;
+    int NumToRender = 0;
 
-                    // richtigen Ausschnitt für das aktuelle Tile setzen
-                    RECT_struct const Rect = TileRects[Type];
+    for (int cy = cy0; cy <= cy1; cy++)
+        for (int cx = cx0; cx <= cx1; cx++) {
+            const TileChunkStruct &Chunk = TileChunks[static_cast<size_t>(cy) * TileChunksX + cx];
 
-                    // Textur-Koordinaten
-                    float tl = Rect.left / TILESETSIZE_X;    // Links
-                    float tr = Rect.right / TILESETSIZE_X;   // Rechts
-                    float to = Rect.top / TILESETSIZE_Y;     // Oben
-                    float tu = Rect.bottom / TILESETSIZE_Y;  // Unten
+            for (const uint16_t Tile : Chunk.Moving[Layer]) {
+                const int i = cx * TILECHUNK_SIZE + (Tile & (TILECHUNK_SIZE - 1));
+                const int j = cy * TILECHUNK_SIZE + (Tile >> TILECHUNK_SHIFT);
 
-                    // bewegtes Tile vertikal
-                    if (tile.Block & BLOCKWERT_MOVEVERTICAL) {
-                        to -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
-                        tu -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
-                    }
+                if (i < x0 || i >= x1 || j < y0 || j >= y1)
+                    continue;
 
-                    // bewegtes Tile links
-                    if (tile.Block & BLOCKWERT_MOVELINKS) {
-                        tl += 60.0f / 256.0f * WasserfallOffset / 120.0f;
-                        tr += 60.0f / 256.0f * WasserfallOffset / 120.0f;
-                    }
+                TileRowIterator Row = TileRow(i, j);
+                const uint32_t block = Row.Block();
+                const int TileSet = LayerTileSet(Layer, block, Row.Art());
+                const int Texture = TileFromAtlas(Layer, block, TileSet) ? TILESET_ATLAS : TileSet;
 
-                    // bewegtes Tile rechts
-                    if (tile.Block & BLOCKWERT_MOVERECHTS) {
-                        tl -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
-                        tr -= 60.0f / 256.0f * WasserfallOffset / 120.0f;
-                    }
+                // Neue Textur ?
+                if (Texture != ActualTexture) {
+                    // Tiles zeichnen
+                    FlushTiles(NumToRender);
 
-                    // al = tile.Alpha;
+                    // Neue aktuelle Textur setzen
+                    ActualTexture = Texture;
+                    if (ActualTexture == TILESET_ATLAS)
+                        DirectGraphics.SetAtlasTexture();
+                    else
+                        DirectGraphics.SetTexture(TileGfx[ActualTexture].itsTexIdx);
+                }
 
-                    if (tile.Block & BLOCKWERT_OVERLAY_LIGHT) {
-                        v1.color = tile.Color[0];
-                        v2.color = tile.Color[1];
-                        v3.color = tile.Color[2];
-                        v4.color = tile.Color[3];
-                    } else {
-                        v1.color = v2.color = v3.color = v4.color =
-                            D3DCOLOR_RGBA(255, 255, 255, tile.Alpha);
-                    }
+                if (NumToRender >= TilesToRenderMax)
+                    FlushTiles(NumToRender);
 
-                    v1.x = l;  // Links oben
-                    v1.y = o;
-                    v1.tu = tl;
-                    v1.tv = to;
+                // Screen-Koordinaten der Vertices
+                float const l = -xTileOffs + static_cast<float>(i - xLevel) * TileSizeX;  // Links
+                float const o = -yTileOffs + static_cast<float>(j - yLevel) * TileSizeY;  // Oben
 
-                    v2.x = r;  // Rechts oben
-                    v2.y = o;
-                    v2.tu = tr;
-                    v2.tv = to;
+                const bool Lit = SetTileVertices(Layer, Row, l, o, l + TileSizeX, o + TileSizeY);
 
-                    v3.x = l;  // Links unten
-                    v3.y = u;
-                    v3.tu = tl;
-                    v3.tv = tu;
+                if (LightMapOn)
+                    SetTilesLit(NumToRender, Lit);
 
-                    v4.x = r;  // Rechts unten
-                    v4.y = u;
-                    v4.tu = tr;
-                    v4.tv = tu;
+                // Hintergrund des Wasser schwabbeln lassen
+                if ((Layer == TILELAYER_BACK || Layer == TILELAYER_FRONT) && block & BLOCKWERT_WASSERANIM) {
+                    float x_offs[2];
+                    WaterSinTable.GetNonWaterSin(j - yLevel, x_offs);
 
-                    // Zu rendernde Vertices ins Array schreiben
-                    TilesToRender[NumToRender * 6 + 0] = v1;  // Jeweils 2 Dreicke als
-                    TilesToRender[NumToRender * 6 + 1] = v2;  // als ein viereckiges
-                    TilesToRender[NumToRender * 6 + 2] = v3;  // Tile ins Array kopieren
-                    TilesToRender[NumToRender * 6 + 3] = v3;
-                    TilesToRender[NumToRender * 6 + 4] = v2;
-                    TilesToRender[NumToRender * 6 + 5] = v4;
+                    if (j > 0 &&  // DKS Added this check to above line
+                        BlockAt(i, j - 1) & BLOCKWERT_LIQUID) {
+                        if (block & BLOCKWERT_MOVE_V1)
+                            v1.x += x_offs[0];
+                        if (block & BLOCKWERT_MOVE_V2)
+                            v2.x += x_offs[0];
+                    }
 
-                    NumToRender++;  // Weiter im Vertex Array
+                    if (block & BLOCKWERT_MOVE_V3)
+                        v3.x += x_offs[1];
+                    if (block & BLOCKWERT_MOVE_V4)
+                        v4.x += x_offs[1];
                 }
-            }
 
-            xScreen += TileSizeX;  // Am Screen weiter
+                // Zu rendernde Vertices ins Array schreiben
+                QueueTile(NumToRender);
+            }
         }
 
-        yScreen += TileSizeY;  // Am Screen weiter
-    }
+    FlushTiles(NumToRender);
+}
+
+// --------------------------------------------------------------------------------------
+// Level Hintergrund anzeigen
+//
+// Hier werden alle Tiles im Back-Layer gesetzt, die KEINE Wand sind,
+// da die Wände später gesetzt werden, da sie alles verdecken, was in sie reinragt
+// --------------------------------------------------------------------------------------
+
+void TileEngineClass::DrawBackLevel() {
+    DrawTileLayer(TILELAYER_BACK);
+}
+
+// --------------------------------------------------------------------------------------
+// Level Vodergrund anzeigen
+// --------------------------------------------------------------------------------------
+
+void TileEngineClass::DrawFrontLevel() {
+    DrawTileLayer(TILELAYER_FRONT);
+}
+
+// --------------------------------------------------------------------------------------
+// Wandstücke, die den Spieler vedecken, erneut zeichnen
+// --------------------------------------------------------------------------------------
 
-    if (NumToRender > 0)
-        DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+void TileEngineClass::DrawBackLevelOverlay() {
+    DrawTileLayer(TILELAYER_BACKOVERLAY);
+}
+
+// --------------------------------------------------------------------------------------
+// Die Levelstücke zeigen, die den Spieler verdecken
+// --------------------------------------------------------------------------------------
+
+void TileEngineClass::DrawOverlayLevel() {
+    DrawTileLayer(TILELAYER_OVERLAY);
 }
 
 // --------------------------------------------------------------------------------------
@@ -1302,16 +1303,18 @@ void TileEngineClass::DrawWater() {
         for (int j = RenderPosY; j < RenderPosYTo; j++) {
             xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
 
-            for (int i = RenderPosX; i < RenderPosXTo; i++) {
-                const LevelTileStruct& tile = TileAt(xLevel + i, yLevel + j);
+            TileRowIterator Row = TileRow(xLevel + RenderPosX, yLevel + j);
+
+            for (int i = RenderPosX; i < RenderPosXTo; i++, ++Row) {
+                const uint32_t block = Row.Block();
 
                 if (NumToRender >= TilesToRenderMax) {
-                    DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+                    DirectGraphics.RenderQuads(NumToRender, &TilesToRender[0]);
                     NumToRender = 0;
                 }
 
                 // Vordergrund Tiles setzen um Spieler zu verdecken
-                if (tile.Block & BLOCKWERT_LIQUID) {
+                if (block & BLOCKWERT_LIQUID) {
                     // Screen-Koordinaten der Vertices
                     float const l = xScreen;               // Links
                     float const o = yScreen;               // Oben
@@ -1335,16 +1338,16 @@ void TileEngineClass::DrawWater() {
                     }
 
                     // Oberfläche des Wassers aufhellen
-                    if (yLevel + j - 1 >= 0 && !(TileAt(xLevel + i, yLevel + j - 1).Block & BLOCKWERT_LIQUID) &&
-                        !(TileAt(xLevel + i, yLevel + j - 1).Block & BLOCKWERT_WASSERFALL)) {
+                    if (yLevel + j - 1 >= 0 && !(BlockAt(xLevel + i, yLevel + j - 1) & BLOCKWERT_LIQUID) &&
+                        !(BlockAt(xLevel + i, yLevel + j - 1) & BLOCKWERT_WASSERFALL)) {
                         if (xLevel + i - 1 >= 0 &&
-                            !(TileAt(xLevel + i - 1, yLevel + j - 1).Block & BLOCKWERT_LIQUID) &&
-                            !(TileAt(xLevel + i - 1, yLevel + j - 1).Block & BLOCKWERT_WASSERFALL))
+                            !(BlockAt(xLevel + i - 1, yLevel + j - 1) & BLOCKWERT_LIQUID) &&
+                            !(BlockAt(xLevel + i - 1, yLevel + j - 1) & BLOCKWERT_WASSERFALL))
                             v1.color = Col3;
 
                         if (xLevel + i + 1 < LEVELSIZE_X &&
-                            !(TileAt(xLevel + i + 1, yLevel + j - 1).Block & BLOCKWERT_LIQUID) &&
-                            !(TileAt(xLevel + i + 1, yLevel + j - 1).Block & BLOCKWERT_WASSERFALL))
+                            !(BlockAt(xLevel + i + 1, yLevel + j - 1) & BLOCKWERT_LIQUID) &&
+                            !(BlockAt(xLevel + i + 1, yLevel + j - 1) & BLOCKWERT_WASSERFALL))
                             v2.color = Col3;
                     }
 
@@ -1375,27 +1378,24 @@ void TileEngineClass::DrawWater() {
                         v4.tv = WasserV[yo + 1];
                     }
 
-                    if (tile.move_v1 || tile.move_v2 ||
-                        tile.move_v3 || tile.move_v4) {
+                    if (block & BLOCKWERT_WASSERANIM) {
                         float y_offs[2];
                         WaterSinTable.GetWaterSin(i, j, y_offs);
-                        if (tile.move_v1 == true)
+                        if (block & BLOCKWERT_MOVE_V1)
                             v1.y += y_offs[0];
-                        if (tile.move_v2 == true)
+                        if (block & BLOCKWERT_MOVE_V2)
                             v2.y += y_offs[0];
-                        if (tile.move_v3 == true)
+                        if (block & BLOCKWERT_MOVE_V3)
                             v3.y += y_offs[1];
-                        if (tile.move_v4 == true)
+                        if (block & BLOCKWERT_MOVE_V4)
                             v4.y += y_offs[1];
                     }
 
                     // Zu rendernde Vertices ins Array schreiben
-                    TilesToRender[NumToRender * 6 + 0] = v1;  // Jeweils 2 Dreicke als
-                    TilesToRender[NumToRender * 6 + 1] = v2;  // als ein viereckiges
-                    TilesToRender[NumToRender * 6 + 2] = v3;  // Tile ins Array kopieren
-                    TilesToRender[NumToRender * 6 + 3] = v3;
-                    TilesToRender[NumToRender * 6 + 4] = v2;
-                    TilesToRender[NumToRender * 6 + 5] = v4;
+                    TilesToRender[NumToRender * 4 + 0] = v1;  // Die vier Ecken als
+                    TilesToRender[NumToRender * 4 + 1] = v2;  // ein Quad ins Array
+                    TilesToRender[NumToRender * 4 + 2] = v3;  // kopieren
+                    TilesToRender[NumToRender * 4 + 3] = v4;
 
                     NumToRender++;  // Weiter im Vertex Array
                 }
@@ -1414,7 +1414,7 @@ void TileEngineClass::DrawWater() {
                 DirectGraphics.SetTexture(LiquidGfx[0].itsTexIdx);
             }
 
-            DirectGraphics.RendertoBuffer(GL_TRIANGLES, NumToRender * 2, &TilesToRender[0]);
+            DirectGraphics.RenderQuads(NumToRender, &TilesToRender[0]);
         }
 
         NumToRender = 0;
@@ -1426,9 +1426,11 @@ void TileEngineClass::DrawWater() {
     for (int j = RenderPosY; j < RenderPosYTo; j++) {
         xScreen = static_cast<float>(-xTileOffs + RenderPosX * TileSizeX);
 
-        for (int i = RenderPosX; i < RenderPosXTo; i++) {
+        TileRowIterator Row = TileRow(xLevel + RenderPosX, yLevel + j);
+
+        for (int i = RenderPosX; i < RenderPosXTo; i++, ++Row) {
             // Ist ein Wasserfall teil?
-            if (TileAt(i + xLevel, j + yLevel).Block & BLOCKWERT_WASSERFALL) {
+            if (Row.Block() & BLOCKWERT_WASSERFALL) {
                 DirectGraphics.SetColorKeyMode();
                 // Drei Schichten Wasserfall rendern =)
                 //
@@ -1552,7 +1554,7 @@ uint32_t TileEngineClass::BlockRechts(float &x, float y, float &xo, float /*yo*/
         bool blockWand = block & BLOCKWERT_WAND;
 
         if (!blockWand) {
-            uint32_t const newBlock = TileAt(xlev, ylev).Block;
+            uint32_t const newBlock = BlockAt(xlev, ylev);
             if (newBlock != 0) {
                 block = newBlock;
                 blockWand = block & BLOCKWERT_WAND;
@@ -1598,7 +1600,7 @@ uint32_t TileEngineClass::BlockLinks(float &x, float y, float &xo, float /*yo*/,
         bool blockWand = block & BLOCKWERT_WAND;
 
         if (!blockWand) {
-            uint32_t const newBlock = TileAt(xlev, ylev).Block;
+            uint32_t const newBlock = BlockAt(xlev, ylev);
             if (newBlock != 0) {
                 block = newBlock;
                 blockWand = block & BLOCKWERT_WAND;
@@ -1642,7 +1644,7 @@ uint32_t TileEngineClass::BlockOben(float x, float &y, float /*xo*/, float &yo,
         bool blockWand = block & BLOCKWERT_WAND;
 
         if (!blockWand) {
-            uint32_t const newBlock = TileAt(xlev, ylev).Block;
+            uint32_t const newBlock = BlockAt(xlev, ylev);
             if (newBlock > 0) {
                 block = newBlock;
                 blockWand = block & BLOCKWERT_WAND;
@@ -1690,7 +1692,7 @@ uint32_t TileEngineClass::BlockUntenNormal(float x, float y, float /*xo*/, float
         bool blockWand = block & BLOCKWERT_WAND;
 
         if (!blockWand) {
-            uint32_t const newBlock = TileAt(xlev, ylev).Block;
+            uint32_t const newBlock = BlockAt(xlev, ylev);
             if (newBlock > 0) {
                 block = newBlock;
                 blockWand = block & BLOCKWERT_WAND;
@@ -1732,7 +1734,7 @@ uint32_t TileEngineClass::BlockUnten(float x, float &y, float /*xo*/, float &yo,
         bool blockPlatform = block & BLOCKWERT_PLATTFORM;
 
         if (!blockWand && !blockPlatform) {
-            uint32_t const newBlock = TileAt(xlev, ylev).Block;
+            uint32_t const newBlock = BlockAt(xlev, ylev);
             if (newBlock > 0) {
                 block = newBlock;
                 blockWand = block & BLOCKWERT_WAND;
@@ -1779,7 +1781,7 @@ uint32_t TileEngineClass::BlockSlopes(const float x, float &y, const RECT_struct
             else if (xlev >= LEVELSIZE_X)
                 break;
 
-            uint32_t const block = TileAt(xlev, ylev).Block;
+            uint32_t const block = BlockAt(xlev, ylev);
 
             if (block & BLOCKWERT_SCHRAEGE_L) {
                 float newy = static_cast<float>((ylev + 1) * TileSizeY - rect.bottom -
@@ -1803,7 +1805,7 @@ uint32_t TileEngineClass::BlockSlopes(const float x, float &y, const RECT_struct
             else if (xlev < 0)
                 break;
 
-            uint32_t const block = TileAt(xlev, ylev).Block;
+            uint32_t const block = BlockAt(xlev, ylev);
 
             if (block & BLOCKWERT_SCHRAEGE_R) {
                 float newy = static_cast<float>((ylev + 1) * TileSizeY - rect.bottom -
@@ -1830,13 +1832,13 @@ D3DCOLOR TileEngineClass::LightValue(float x, float y, RECT_struct rect, bool fo
     int const y_level = static_cast<int>((y + static_cast<float>(rect.bottom - rect.top) / 2) / TileSizeY);  // yPosition im Level
 
     if ((x_level >= LEVELSIZE_X || y_level >= LEVELSIZE_Y) ||
-        (!forced && !(TileAt(x_level, y_level).Block & BLOCKWERT_LIGHT)))  // Soll das Leveltile garnicht
+        (!forced && !(BlockAt(x_level, y_level) & BLOCKWERT_LIGHT)))  // Soll das Leveltile garnicht
         return 0xFFFFFFFF;                                               // das Licht des Objektes ändern
 
-    const LevelTileStruct& tile = TileAt(x_level, y_level);
-    unsigned int r = tile.Red;
-    unsigned int g = tile.Green;
-    unsigned int b = tile.Blue;
+    const TileBaseColorStruct& color = Tiles.ColorAt(TileIndex(x_level, y_level));
+    unsigned int r = color.Red;
+    unsigned int g = color.Green;
+    unsigned int b = color.Blue;
 
     r += 48;  // Farbewerte ein wenig erhöhen, damit man selbst bei 0,0,0
     g += 48;  // noch ein wenig was sehen kann und das Sprite nicht
@@ -1852,94 +1854,6 @@ D3DCOLOR TileEngineClass::LightValue(float x, float y, RECT_struct rect, bool fo
     return D3DCOLOR_RGBA(r, g, b, 255);
 }
 
-// --------------------------------------------------------------------------------------
-// Neue Lichtberechnung
-// Jedes Tile hat an allen vier Ecken eine interpolierte Farbe
-// entsprechend der umliegenden Tiles -> smoothe Übergänge -> Geilomat!
-// --------------------------------------------------------------------------------------
-
-inline void interpolateColor(const LevelTileStruct& centralTile, const LevelTileStruct& otherTile, int& r, int& g, int& b) {
-    if (!((otherTile.Block ^ centralTile.Block) & BLOCKWERT_WAND)) {
-        r = otherTile.Red;
-        g = otherTile.Green;
-        b = otherTile.Blue;
-    } else {
-        r = centralTile.Red;
-        g = centralTile.Green;
-        b = centralTile.Blue;
-    }
-}
-
-void TileEngineClass::ComputeCoolLight() {
-    // Lichter im Level interpolieren
-    // Dabei werden die Leveltiles in 2er Schritten durchgegangen
-    // Dann werden die 4 Ecken des aktuellen Tiles auf die Farben der Nachbarfelder gesetzt
-    // Farben der Nachbarfelder werden allerdings nur mit verrechnet, wenn es sich nicht um eine massive Wand handelt.
-    // In diesem Falle wird die Standard-Tilefarbe verwendet
-    //
-    for (int i = 1; i < LEVELSIZE_X - 1; i += 1)
-        for (int j = 1; j < LEVELSIZE_Y - 1; j += 1) {
-            LevelTileStruct& tile = TileAt(i, j);
-
-            int const al = tile.Alpha;
-
-            int const r4 = tile.Red;
-            int const g4 = tile.Green;
-            int const b4 = tile.Blue;
-
-            int rn, gn, bn, r1, r2, r3, g1, g2, g3, b1, b2, b3;
-
-            // Ecke links oben
-            //
-            interpolateColor(tile, TileAt(i - 1, j - 1), r1, g1, b1);
-            interpolateColor(tile, TileAt(i + 0, j - 1), r2, g2, b2);
-            interpolateColor(tile, TileAt(i - 1, j + 0), r3, g3, b3);
-
-            rn = (r1 + r2 + r3 + r4) / 4;
-            gn = (g1 + g2 + g3 + g4) / 4;
-            bn = (b1 + b2 + b3 + b4) / 4;
-
-            tile.Color[0] = D3DCOLOR_RGBA(rn, gn, bn, al);
-
-            // Ecke rechts oben
-            //
-            interpolateColor(tile, TileAt(i - 0, j - 1), r1, g1, b1);
-            interpolateColor(tile, TileAt(i + 1, j - 1), r2, g2, b2);
-            interpolateColor(tile, TileAt(i + 1, j + 0), r3, g3, b3);
-
-            rn = (r1 + r2 + r3 + r4) / 4;
-            gn = (g1 + g2 + g3 + g4) / 4;
-            bn = (b1 + b2 + b3 + b4) / 4;
-
-            tile.Color[1] = D3DCOLOR_RGBA(rn, gn, bn, al);
-
-            // Ecke links unten
-            //
-            interpolateColor(tile, TileAt(i - 1, j - 0), r1, g1, b1);
-            interpolateColor(tile, TileAt(i - 1, j + 1), r2, g2, b2);
-            interpolateColor(tile, TileAt(i - 0, j + 1), r3, g3, b3);
-
-            rn = (r1 + r2 + r3 + r4) / 4;
-            gn = (g1 + g2 + g3 + g4) / 4;
-            bn = (b1 + b2 + b3 + b4) / 4;
-
-            tile.Color[2] = D3DCOLOR_RGBA(rn, gn, bn, al);
-
-            // Ecke rechts unten
-            //
-            interpolateColor(tile, TileAt(i + 1, j - 0), r1, g1, b1);
-            interpolateColor(tile, TileAt(i - 0, j + 0), r2, g2, b2);
-            interpolateColor(tile, TileAt(i + 1, j + 1), r3, g3, b3);
-
-            rn = (r1 + r2 + r3 + r4) / 4;
-            gn = (g1 + g2 + g3 + g4) / 4;
-            bn = (b1 + b2 + b3 + b4) / 4;
-
-            tile.Color[3] = D3DCOLOR_RGBA(rn, gn, bn, al);
-        }
-
-}  // ComputeCoolLight
-
 // --------------------------------------------------------------------------------------
 // "Taschenlampen" Ausschnitt im Alien Level rendern
 // --------------------------------------------------------------------------------------
@@ -1974,5 +1888,7 @@ void TileEngineClass::ToggleLamp() {
         ShadowAlpha = 255.0f;
     } else
         bDrawShadow = false;
+
+    DateiAppendix.Taschenlampe = bDrawShadow;
 }
 
@@ -18,60 +18,32 @@
 #include "DX8Graphics.hpp"
 #include "DX8Sprite.hpp"
 #include "Globals.hpp"
+#include "Level.hpp"
 
-#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct LevelLoaderStage;
 
 // --------------------------------------------------------------------------------------
 // Defines
 // --------------------------------------------------------------------------------------
 
-//----- Flags für den Blockwert
-
-enum BlockValue : uint32_t {
-  BLOCKWERT_WAND           = 0x000001,    // Solide Wand
-  BLOCKWERT_GEGNERWAND     = 0x000002,    // Wand nur für Gegner
-  BLOCKWERT_PLATTFORM      = 0x000004,    // Plattform
-  BLOCKWERT_LIGHT          = 0x000008,    // Licht bei Objekten verändern
-  BLOCKWERT_VERDECKEN      = 0x000010,    // Spieler und Objekte verdecken
-  BLOCKWERT_ANIMIERT_BACK  = 0x000020,    // Animiert Hintergrund
-  BLOCKWERT_ANIMIERT_FRONT = 0x000040,    // Animiert Overlay
-  BLOCKWERT_WASSER         = 0x000080,    // Wasser (macht platsch :D )
-  BLOCKWERT_SCHADEN        = 0x000100,    // Schaden
-  BLOCKWERT_FLIESSBANDL    = 0x000200,    // Fliessband Links
-  BLOCKWERT_FLIESSBANDR    = 0x000400,    // Fliessband Rechts
-  BLOCKWERT_WENDEPUNKT     = 0x000800,    // Bewegte Plattformen umdrehen lassen
-  BLOCKWERT_DESTRUCTIBLE   = 0x001000,    // Zerstörbare Wand
-  BLOCKWERT_MOVELINKS      = 0x002000,    // Textur nach links bewegen
-  BLOCKWERT_OVERLAY_LIGHT  = 0x004000,    // Overlay nimmt Licht an
-  BLOCKWERT_SUMPF          = 0x008000,    // Einsinken
-  BLOCKWERT_EIS            = 0x010000,    // Eis, auf dem man ausrutscht
-  BLOCKWERT_MOVEVERTICAL   = 0x020000,    // Vertikale Texturbewegung
-  BLOCKWERT_WASSERFALL     = 0x040000,    // Wasserfall
-  BLOCKWERT_MOVERECHTS     = 0x080000,    // Textur nach rechts bewegen
-
-  BLOCKWERT_SCHRAEGE_L     = 0x200000,    // Schräge Rechts
-  BLOCKWERT_SCHRAEGE_R     = 0x400000,    // Schräge Rechts
-  BLOCKWERT_LIQUID         = 0x800000     // Flüssigkeit (Wasser, Säure, Lava, Magensäure)
-};
-
 //--- Animationsgeschwindigkeit der animierten Level-Tiles
 
 constexpr float TILEANIM_SPEED = 0.8f;
 
-//--- Werte zur Levelgrösse
-
-constexpr int ORIGINAL_TILE_SIZE_X = 20;         // Grösse eines
-constexpr int ORIGINAL_TILE_SIZE_Y = 20;         // einzelnen Tiles
-constexpr float TILESETSIZE_X = 256.0f;  // Grösse eines
-constexpr float TILESETSIZE_Y = 256.0f;  // Tilesets
+//--- Lightmap (ein Texel pro Tile). Grössere Levels bleiben beim Licht der Ecken
 
-constexpr int MAX_LEVELSIZE_X = 1024;  // Gesamtgrösse des Level
-constexpr int MAX_LEVELSIZE_Y = 1600;
+constexpr int LIGHTMAP_MAX_SIZE = 4096;            // höchstens 64 MB Textur
+constexpr int LIGHTMAP_UPLOAD_TEXELS = 256 * 1024;  // so viele Texel auf einmal hochladen
 
-constexpr int MAX_TILESETS = 64;     // Maximalzahl der Tilesets
-constexpr int INCLUDE_ZEROTILE = 1;  // Tile = 0;,0 im Tileset mit verwenden ?
+//--- Zwischengespeicherte Leveltiles, pro Chunk ein Vertexbuffer
 
-constexpr int MAX_TILERECTS = 144;
+constexpr int TILECHUNK_SHIFT = 5;
+constexpr int TILECHUNK_SIZE = 1 << TILECHUNK_SHIFT;  // 32x32 Tiles
+constexpr int TILECHUNK_RESIDENT_MAX = 1024;         // mehr Buffer, dann die nicht sichtbaren freigeben
 
 //----- Grösse des nicht scrollbaren Bereichs
 
@@ -87,95 +59,6 @@ constexpr int SCROLL_BORDER_BOTTOM = 50;
 constexpr int LOOK_BORDER_TOP = 60;
 constexpr int LOOK_BORDER_BOTTOM = 400;
 
-// --------------------------------------------------------------------------------------
-// Strukturen
-// --------------------------------------------------------------------------------------
-
-// Struktur für ein Level Tile wie es aus dem Level geladen wird
-//
-struct LevelTileLoadStruct {
-    uint8_t TileSetBack;              // Back  aus welchem Tileset ?
-    uint8_t TileSetFront;             // Front aus welchem Tileset ?
-    uint8_t BackArt;                  // Tile im Hintergrund
-    uint8_t FrontArt;                 // Tile im Vordergrund
-    uint8_t Red, Green, Blue, Alpha;  // Farbwert des Tiles
-    uint32_t Block;                   // Blockierungsart (siehe #defines)
-};
-
-static_assert(sizeof(LevelTileLoadStruct) == 12, "Size of LevelTileLoadStruct is wrong");
-
-// Struktur für ein Level Tile wie es im Level vorkommt (wie beim Laden, nur noch mit Extra Farben für alle Ecken)
-//
-struct LevelTileStruct {
-    unsigned char TileSetBack;                // Back  aus welchem Tileset ?
-    unsigned char TileSetFront;               // Front aus welchem Tileset ?
-    unsigned char BackArt;                    // Tile im Hintergrund
-    unsigned char FrontArt;                   // Tile im Vordergrund
-    unsigned char Red, Green, Blue, Alpha;    // Farbwert des Tiles
-    D3DCOLOR Color[4];                        // Farbwert des Tiles (Alle vier Ecken)
-    uint32_t Block;                           // Blockierungsart (siehe #defines)
-    bool move_v1, move_v2, move_v3, move_v4;  // Die Ecken eines Tiles bei der Wasseranim bewegen?
-};
-
-static_assert(sizeof(LevelTileStruct) == 32, "Size of LevelTileStruct is wrong");
-
-// --------------------------------------------------------------------------------------
-// Struktur für ein aus dem Level zu ladendes Objekte
-// --------------------------------------------------------------------------------------
-
-struct LevelObjectStruct {
-    uint32_t ObjectID;           // Welche Objekt ID ?
-    int32_t XPos;                // x-Position
-    int32_t YPos;                // y-Position
-    bool ChangeLight;         // Umgebungslicht annehmen ?
-    uint8_t Skill;               // 0 = Easy, 1 = Medium, 2 = Hard, 3 = Hurrican
-    uint8_t PADDING_CHUNK_1[2];  // 2 PADDING BYTES
-    int32_t Value1;              // Werte für diverse Trigger
-    int32_t Value2;              // Werte für diverse Trigger
-};
-
-static_assert(sizeof(LevelObjectStruct) == 24, "Size of LevelObjectStruct is wrong");
-
-// --------------------------------------------------------------------------------------
-// Level-Datei Header
-// --------------------------------------------------------------------------------------
-
-struct FileHeader {
-    char Kennung[46];            // Level-Kennung
-    char Beschreibung[100];      // Level-Beschreibung
-    char BackgroundFile[24];     // Dateiname des Hintergrundes
-    char ParallaxAFile[24];      // Dateiname des 1. Parallax Layers
-    char ParallaxBFile[24];      // Dateiname des 2. Parallax Layers
-    char CloudFile[24];          // Dateiname des WolkenLayers
-    uint8_t PADDING_CHUNK_1[2];  // 2 PADDING  BYTES
-    uint32_t Timelimit;          // aktuelles Zeitlimit des Levels
-    uint8_t UsedTilesets;        // Anzahl der Tilesets
-    char SetNames[64][16];       // Namen der benutzten Sets
-    uint8_t PADDING_CHUNK_2[3];  // 3 PADDING BYTES
-    uint32_t SizeX, SizeY;       // Größe des Levels
-    uint32_t NumObjects;         // Anzahl der Objekte
-    uint8_t ScrollBackground;    // Hintergrundbild srollen oder statisch ?
-    uint8_t PADDING_CHUNK_3[3];  // 3 PADDING BYTES
-};
-
-static_assert(sizeof(FileHeader) == 1292, "Size of FileHeader is wrong");
-
-// --------------------------------------------------------------------------------------
-// Anhang am File nach den Level Daten
-// damit nicht alle levels nochmal konvertiert werden, hänge ich einfach alle dinge, die
-// noch ins level format reinmüssen, dahinter =)
-// --------------------------------------------------------------------------------------
-
-struct FileAppendix {
-    char Songs[2][30];       // Namen der benutzten Songs (Stage und Boss)
-    int32_t UsedPowerblock;  // ID der benutzten Powerblock Art
-    char Col1[8], Col2[8];   // Farben für Liquid
-    uint8_t Taschenlampe;
-    uint8_t PADDING_CHUNK_1[3];  // 3 padding bytes
-};
-
-static_assert(sizeof(FileAppendix) == 84, "Size of FileAppendix is wrong");
-
 // --------------------------------------------------------------------------------------
 // Unions
 // --------------------------------------------------------------------------------------
@@ -269,6 +152,11 @@ class WaterSinTableClass {
         }
     }
 
+    // The same for the tile shader, which computes the sine itself: the table index of the
+    // top vertices in screen row j (may be past 63) and the sway at its peak in pixels
+    int GetNonWaterSinIndex(const int j) const { return NonWaterSinTableIdx + (j + 1) * 3; }
+    float GetNonWaterSway() const { return NonWaterSinTable[16]; }
+
   private:
     // Convert an index x representing x/64 fraction of a circle,
     // 64 being 2*pi, to an internal table index 0-16, 16
@@ -315,22 +203,93 @@ class WaterSinTableClass {
     float SinTable[17], NonWaterSinTable[17];
 };
 
+// --------------------------------------------------------------------------------------
+// Zwischengespeicherte Tiles eines Chunks
+// --------------------------------------------------------------------------------------
+
+// Die vier Durchgänge, in denen Leveltiles gezeichnet werden
+enum { TILELAYER_BACK = 0, TILELAYER_FRONT, TILELAYER_BACKOVERLAY, TILELAYER_OVERLAY, TILELAYER_TOTAL };
+
+constexpr int TILESET_ATLAS = MAX_TILESETS;  // Gruppe für Tiles aus dem Atlas aller Tilesets
+
+// Durchgänge in DrawTileLayer(), in dieser Reihenfolge
+enum { TILEPASS_STATIC = 0, TILEPASS_MOVING, TILEPASS_QUEUE };
+
+// Tiles eines Layers mit demselben Tileset und Licht, am Stück im Vertexbuffer
+struct TileChunkGroup {
+    uint8_t Layer;
+    uint8_t TileSet;  // oder TILESET_ATLAS
+    bool Lit;    // mit Lightmap: Licht oder weiss
+    bool Moves;  // Instanzen, die sich jeden Frame bewegen, werden nach den anderen gezeichnet
+    int First;   // erster Vertex (mit Instanzen: erste Instanz)
+    int Count;   // Vertices (Instanzen)
+};
+
+struct TileChunkStruct {
+    GLuint Buffer = 0;                              // Vertices oder Instanzen in Tiles relativ zur Ecke des Chunks
+    bool Dirty = true;                              // muss vor dem Zeichnen neu gebaut werden
+    unsigned int LastUsed = 0;                      // zuletzt gezeichnet in Durchgang Nr.
+    std::vector<TileChunkGroup> Groups;             // nach Layer sortiert
+    std::vector<uint16_t> Moving[TILELAYER_TOTAL];  // Tiles für TILEPASS_QUEUE (y * TILECHUNK_SIZE + x)
+};
+
 // --------------------------------------------------------------------------------------
 // TileEngine Klasse
 // --------------------------------------------------------------------------------------
 
 constexpr int TilesToRenderMax = 1024;
 
-class TileEngineClass {
+class TileEngineClass : public LevelClass {
   private:
-    FileHeader DateiHeader;  // Header der Level-Datei
-
     float TileAnimCount;  // Animations-Zähler und
     //float CloudMovement;
     int TileAnimPhase;                      // Phase der Tile Animation
-    VERTEX2D TilesToRender[TilesToRenderMax * 6];    // Alle zu rendernden Leveltiles
+    VERTEX2D TilesToRender[TilesToRenderMax * 4];    // Alle zu rendernden Leveltiles, 4 Vertices pro Tile
+    VERTEXTILE LitTilesToRender[TilesToRenderMax * 4];  // dasselbe mit Lightmap, ohne Farben
     VERTEX2D v1, v2, v3, v4;                // Vertices zum Sprite rendern
-    unsigned char LoadedTilesets;           // Anzahl geladener Sets
+
+    // Licht aus der Lightmap statt aus den Ecken
+    bool LightMapWanted;    // SetLightMap()
+    bool LightMapReady;     // Lightmap für dieses Level angelegt
+    bool LightMapOn;        // der laufende Draw-Durchgang nimmt die Lightmap
+    bool TilesLit;          // die gesammelten Tiles bekommen Licht (sonst weiss)
+    int LightMapSizeX;      // Levelgrösse, für die die Lightmap angelegt wurde
+    int LightMapSizeY;
+    glm::vec4 LightTransform;                       // Screen -> Lightmap, für DirectGraphics.RenderTiles()
+    std::vector<TileBaseColorStruct> LightMapRows;  // Puffer zum Hochladen
+
+    void PrepareLightMap();                      // vor jedem Draw-Durchgang, geänderte Farben hochladen
+    void SetTilesLit(int &NumToRender, bool Lit);  // bei Wechsel erst die gesammelten Tiles zeichnen
+    void QueueTile(int &NumToRender);             // v1..v4 als Quad sammeln
+    void FlushTiles(int &NumToRender);            // gesammelte Tiles zeichnen
+
+    // Was sich nicht bewegt, liegt pro Chunk fertig in einem Vertexbuffer und wird nur neu
+    // gebaut, wenn sich Tiles darin oder ihr Licht geändert haben
+    std::vector<TileChunkStruct> TileChunks;
+    int TileChunksX;              // Chunks pro Zeile
+    int TileChunksY;
+    bool TileChunksLightMap;      // mit Lightmap gebaut (ohne Farben)
+    bool TileChunksAtlas;         // mit Texturkoordinaten im Atlas gebaut
+    int TileAtlasSlots;           // Tilesets im Atlas von DirectGraphics, 0 = kein Atlas
+    bool InstancingWanted;        // SetInstancing()
+    bool TileChunksInstanced;     // mit Instanzen statt Vertices gebaut
+    int TileChunksResident;       // Chunks mit Vertexbuffer
+    unsigned int TileChunkPass;   // zählt die Durchgänge für TileChunkStruct::LastUsed
+    std::vector<VERTEX2D> TileChunkVertices[TILELAYER_TOTAL * (MAX_TILESETS + 1) * 2];  // zum Bauen, pro Gruppe
+    std::vector<VERTEX2D> TileChunkUpload;
+    std::vector<TILEINSTANCE> TileChunkInstances[TILELAYER_TOTAL * 2];  // pro Layer fest und bewegt
+    std::vector<TILEINSTANCE> TileChunkInstanceUpload;
+
+    int LayerTileSet(int Layer, uint32_t block, const TileArtStruct &art) const;  // -1: nicht im Layer
+    bool LayerTileMoves(int Layer, uint32_t block) const;                         // jeden Frame neu, nicht im Chunk
+    bool LayerTileSways(int Layer, uint32_t block, uint32_t Corners) const;      // ragt ins Tile daneben
+    bool TileFromAtlas(int Layer, uint32_t block, int TileSet) const;             // sonst eigene Textur des Tilesets
+    bool SetTileVertices(int Layer, const TileRowIterator &Row,  // v1..v4 setzen, gibt zurück,
+                         float l, float o, float r, float u);    // ob das Tile Licht bekommt
+    TILEINSTANCE TileInstance(int Layer, const TileRowIterator &Row, int i, int j) const;
+    void PrepareTileChunks();                                    // Änderungen übernehmen, sichtbare Chunks bauen
+    void BuildTileChunk(int cx, int cy);
+    void DrawTileLayer(int Layer);
 
     WaterSinTableClass WaterSinTable;
 
@@ -360,27 +319,14 @@ class TileEngineClass {
     float WasserU[9];                            // vorberechnete TexturKoordinaten für das Wasser TU
     float WasserV[9];                            // vorberechnete TexturKoordinaten für das Wasser TV
 
-    FileAppendix DateiAppendix;  // Anhang der Level-Datei
-
   public:
-    LevelTileStruct Tiles[MAX_LEVELSIZE_X]  // Array mit Leveldaten
-                         [MAX_LEVELSIZE_Y];
-
     float Scale = 1.0f;
     float TileSizeX;
     float TileSizeY;
 
     bool IsElevatorLevel;
     bool MustCenterPlayer;
-    int ColR1, ColG1, ColB1, ColA1;  // Farben in RGB
-    int ColR2, ColG2, ColB2, ColA2;
-    int ColR3, ColG3, ColB3;
-
-    char Beschreibung[100];      // Beschreibung des Levels
-    int MaxBlocks;
-    int MaxOneUps;
-    int MaxSecrets;
-    int MaxDiamonds;
+    int ColR3, ColG3, ColB3;         // Mischfarbe aus ColR1.. und ColR2.. in RGB
 
     float SinPos2;  // Position in der SinusListe für den Wasserhintergrund
 
@@ -392,24 +338,29 @@ class TileEngineClass {
     DirectGraphicsSprite Wasserfall[2];          // Wasserfall Grafiken
     float WasserfallOffset;                      // Wasserfall Offset
     float XOffset, YOffset;                      // Scrolloffset des Levels
-    float Timelimit;                             // Zeitlimit
-    int LEVELSIZE_X;                             // Grösse des Levels
-    int LEVELSIZE_Y;                             // in Tiles
     float LEVELPIXELSIZE_X;                      // Levelgrösse in Pixeln
     float LEVELPIXELSIZE_Y;                      // (für XOffset und YOffset)
 
     TileEngineClass();   // Konstruktor
     ~TileEngineClass();  // Destruktor
 
+    void SetLightMap(bool On);  // Licht aus der Lightmap (wenn der Shader und die Levelgrösse das zulassen),
+                                // Standard aus, weil es vom Eckenlicht abweicht
+    bool LightMapEnabled() const { return LightMapWanted; }
+    void SetInstancing(bool On);  // Chunks als Instanzen zeichnen (braucht Lightmap, Atlas und GL 3.3),
+                                  // Standard aus, war beim Messen langsamer als die Vertex-Chunks
+    bool InstancingEnabled() const { return InstancingWanted; }
+
     void Zoom(float times);
     void ZoomBy(float times);
 
     void LoadSprites();
 
-    void ClearLevel();                            // Level freigeben
-    bool LoadLevel(const std::string &Filename);  // Level laden
-    void SaveLevel(const std::string &Filename);  // Save level
-    void InitNewLevel(int xSize, int ySize);      // Neues Level initialisieren
+    bool LoadLevel(const std::string &Filename);  // Level samt Grafiken laden (.map oder v2)
+    static bool ParseLevel(const std::string &Filename,  // Level einlesen und Grafiken
+                           LevelLoaderStage &Stage,      // dekodieren, darf auf jedem
+                           LevelLoadProgress *Progress); // Thread laufen
+    bool ApplyLevel(LevelLoaderStage &Stage);     // eingelesenes Level übernehmen (GL-Thread)
     void CalcRenderRange();                       // Bereiche berechnen, die gerendert werden sollen
     void DrawBackground();                        // Hintergrund Layer zeichnen
     void DrawBackLevel();                         // Level hintergrund anzeigen
@@ -430,40 +381,10 @@ class TileEngineClass {
 
     D3DCOLOR LightValue(float x, float y, RECT_struct rect, bool forced);  // Helligkeit an Stelle x/y
 
-    void ComputeCoolLight();  // Coole   Lightberechnung
-
     void DrawShadow();  // Schatten im Alien Level zeichnen
 
     void WertAngleichen(float &nachx, float &nachy, float vonx, float vony);
 
-#ifdef NDEBUG
-    inline
-#endif
-    LevelTileStruct &TileAt(const int i, const int j) {
-#ifndef NDEBUG
-        if (i >= MAX_LEVELSIZE_X || i < 0 || j >= MAX_LEVELSIZE_Y || j < 0) {
-            Protokoll << "-> Error: Out of bounds in TileEngineClass::TileAt():\n"
-                      << "\tparam i: " << i << "\tLower bound: " << 0 << "\tUpper bound: " << MAX_LEVELSIZE_X - 1
-                      << "\n"
-                      << "\tparam j: " << j << "\tLower bound: " << 0 << "\tUpper bound: " << MAX_LEVELSIZE_Y - 1
-                      << std::endl;
-            GameRunning = false;
-            exit(EXIT_FAILURE);  // WriteText above should do this for us (first param==true)
-        }
-
-        // Stricter bounds-check I use when optimizing
-        if (i >= LEVELSIZE_X || j >= LEVELSIZE_Y) {
-            Protokoll << "-> Warning: Out of level bound in TileEngineClass::TileAt():\n"
-                      << "\tparam i: " << i << "\tUpper bound: " << LEVELSIZE_X - 1 << "\n"
-                      << "\tparam j: " << j << "\tUpper bound: " << LEVELSIZE_Y - 1
-                      << std::endl;
-        }
-#endif
-        return Tiles[i][j];
-    }
-
-    int32_t GetUsedPowerBlock() const { return DateiAppendix.UsedPowerblock; }
-    const char* GetSong(int i) const { return DateiAppendix.Songs[i]; }
     void ToggleLamp();
 };
 
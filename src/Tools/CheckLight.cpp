@@ -0,0 +1,173 @@
+// Datei : CheckLight.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// checklight <map|verzeichnis>...: schnelles Licht gegen die ursprüngliche Berechnung
+// Tile für Tile (TileEngineClass::ComputeCoolLight() vor den Bricks) prüfen. Verzeichnisse
+// werden nach .map und .map2 Dateien durchsucht. Läuft als Test über data/levels, Rückgabe
+// ist ungleich 0, sobald ein Level abweicht oder nicht lädt.
+//
+// checklight_avx2 ist dasselbe Tool gegen editorcore mit -mavx2 (siehe CMakeLists.txt).
+//
+// --------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Level.hpp"
+#include "Logdatei.hpp"
+
+namespace fs = std::filesystem;
+
+// --------------------------------------------------------------------------------------
+// Referenz: die alte Lichtberechnung, absichtlich unverändert übernommen und nur auf
+// GetTile() umgestellt. Die Randtiles hat sie nie angefasst, dort blieb die Farbe aus
+// dem Laden an allen vier Ecken stehen.
+// --------------------------------------------------------------------------------------
+
+inline void interpolateColor(const LevelTileStruct& centralTile, const LevelTileStruct& otherTile, int& r, int& g, int& b) {
+    if (!((otherTile.Block ^ centralTile.Block) & BLOCKWERT_WAND)) {
+        r = otherTile.Red;
+        g = otherTile.Green;
+        b = otherTile.Blue;
+    } else {
+        r = centralTile.Red;
+        g = centralTile.Green;
+        b = centralTile.Blue;
+    }
+}
+
+static TileCornerStruct ReferenceCorners(const LevelClass &Level, int i, int j) {
+    const LevelTileStruct tile = Level.GetTile(i, j);
+    TileCornerStruct corner;
+
+    int const al = tile.Alpha;
+
+    int const r4 = tile.Red;
+    int const g4 = tile.Green;
+    int const b4 = tile.Blue;
+
+    if (i < 1 || j < 1 || i >= Level.LEVELSIZE_X - 1 || j >= Level.LEVELSIZE_Y - 1) {
+        corner.Color[0] = corner.Color[1] = corner.Color[2] = corner.Color[3] = D3DCOLOR_RGBA(r4, g4, b4, al);
+        return corner;
+    }
+
+    auto TileAt = [&](int x, int y) { return Level.GetTile(x, y); };
+
+    int rn, gn, bn, r1, r2, r3, g1, g2, g3, b1, b2, b3;
+
+    // Ecke links oben
+    //
+    interpolateColor(tile, TileAt(i - 1, j - 1), r1, g1, b1);
+    interpolateColor(tile, TileAt(i + 0, j - 1), r2, g2, b2);
+    interpolateColor(tile, TileAt(i - 1, j + 0), r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[0] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    // Ecke rechts oben
+    //
+    interpolateColor(tile, TileAt(i - 0, j - 1), r1, g1, b1);
+    interpolateColor(tile, TileAt(i + 1, j - 1), r2, g2, b2);
+    interpolateColor(tile, TileAt(i + 1, j + 0), r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[1] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    // Ecke links unten
+    //
+    interpolateColor(tile, TileAt(i - 1, j - 0), r1, g1, b1);
+    interpolateColor(tile, TileAt(i - 1, j + 1), r2, g2, b2);
+    interpolateColor(tile, TileAt(i - 0, j + 1), r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[2] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    // Ecke rechts unten
+    //
+    interpolateColor(tile, TileAt(i + 1, j - 0), r1, g1, b1);
+    interpolateColor(tile, TileAt(i - 0, j + 0), r2, g2, b2);
+    interpolateColor(tile, TileAt(i + 1, j + 1), r3, g3, b3);
+
+    rn = (r1 + r2 + r3 + r4) / 4;
+    gn = (g1 + g2 + g3 + g4) / 4;
+    bn = (b1 + b2 + b3 + b4) / 4;
+
+    corner.Color[3] = D3DCOLOR_RGBA(rn, gn, bn, al);
+
+    return corner;
+}
+
+static bool IsLevelFile(const fs::path &Path) {
+    return Path.extension() == ".map" || Path.extension() == LEVELV2_EXTENSION;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <map|directory>...\n", argv[0]);
+        return 2;
+    }
+
+#if defined(CHECKLIGHT_AVX2)
+    // Ohne AVX2 würde schon das erste Licht abstürzen, ctest wertet 77 als übersprungen
+    if (!__builtin_cpu_supports("avx2")) {
+        Protokoll << "-> Check light: CPU has no AVX2, skipped" << std::endl;
+        return 77;
+    }
+#endif
+
+    std::vector<std::string> Files;
+
+    for (int n = 1; n < argc; n++) {
+        std::error_code ec;
+
+        if (!fs::is_directory(argv[n], ec)) {
+            Files.emplace_back(argv[n]);
+            continue;
+        }
+
+        for (const auto &Entry : fs::recursive_directory_iterator(argv[n], ec))
+            if (Entry.is_regular_file(ec) && IsLevelFile(Entry.path()))
+                Files.push_back(Entry.path().string());
+    }
+
+    std::sort(Files.begin(), Files.end());
+
+    if (Files.empty()) {
+        Protokoll << "-> Error: no levels found" << std::endl;
+        return 1;
+    }
+
+    int Failed = 0;
+
+    for (const std::string &File : Files) {
+        auto Level = std::make_unique<LevelClass>();
+        size_t Mismatches = 0;
+
+        const bool Loaded = Level->LoadLevel(File);
+        if (Loaded)
+            Mismatches = Level->CheckCoolLight([&](int i, int j) { return ReferenceCorners(*Level, i, j); });
+
+        Protokoll << "-> Check light " << File << ": "
+                  << (Loaded ? std::to_string(Mismatches) + " mismatches" : "could not load") << std::endl;
+
+        if (!Loaded || Mismatches != 0)
+            Failed++;
+    }
+
+    Protokoll << "-> Check light: " << Failed << " of " << Files.size() << " levels failed" << std::endl;
+    return Failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,26 @@
+// Datei : LevelConvert.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// levelconvert <from> <to>: .map <-> .map2 umwandeln, ohne GUI
+//
+// --------------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <string>
+
+#include "LevelFormat.hpp"
+#include "Logdatei.hpp"
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <from> <to>\n", argv[0]);
+        return 2;
+    }
+
+    const bool ok = ConvertLevelFile(argv[1], argv[2]);
+
+    Protokoll << "-> Convert " << argv[1] << " -> " << argv[2] << (ok ? " successful" : " failed") << std::endl;
+
+    return ok ? 0 : 1;
+}
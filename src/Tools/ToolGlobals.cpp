@@ -0,0 +1,15 @@
+// Datei : ToolGlobals.cpp
+
+// --------------------------------------------------------------------------------------
+//
+// Globale Objekte, die editorcore braucht, für die Kommandozeilen-Tools ohne GUI
+//
+// --------------------------------------------------------------------------------------
+
+#include "Logdatei.hpp"
+#include "ObjectList.hpp"
+
+bool GameRunning = true;
+
+Logdatei Protokoll("logdatei.txt");
+ObjectListClass ObjectList;